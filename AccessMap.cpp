@@ -0,0 +1,53 @@
+// AccessMap.cpp Rev 1.0
+
+#include "AccessMap.h"
+
+AccessMap::AccessMap(){clear();}
+
+void AccessMap::clear()
+{
+	memset(_allow, 0, sizeof(_allow));
+	memset(_once, 0, sizeof(_once));
+	memset(_pending, 0, sizeof(_pending));
+}
+
+void AccessMap::set(uint8_t slot, uint8_t doors, bool once)
+{
+	uint8_t idx		= slot >> 3;
+	uint8_t mask	= 1 << (slot & 7);
+
+	for(uint8_t door = 0; door < ACSMAP_DOORS; door++)
+	{
+		if(doors & (1 << door)){_allow[door][idx] |= mask;}
+		else{_allow[door][idx] &= ~mask;}
+	}
+	if(once){_once[idx] |= mask;}
+	else{_once[idx] &= ~mask;}
+}
+
+bool AccessMap::use(uint8_t slot)
+{
+	uint8_t idx		= slot >> 3;
+	uint8_t mask	= 1 << (slot & 7);
+
+	if(!(_once[idx] & mask)){return false;}
+	set(slot, 0, false);													// One-time access used, revoke all rights.
+	_pending[idx] |= mask;
+	return true;
+}
+
+int16_t AccessMap::nextPending()
+{
+	for(uint8_t idx = 0; idx < ACSMAP_BYTES; idx++)
+	{
+		if(_pending[idx])
+		{
+			uint8_t bit = 0;
+			while(!(_pending[idx] & (1 << bit))){bit++;}
+			return (idx << 3) | bit;
+		}
+	}
+	return -1;
+}
+
+void AccessMap::done(uint8_t slot){_pending[slot >> 3] &= ~(1 << (slot & 7));}
@@ -0,0 +1,58 @@
+// AccessMap.h Rev 1.0
+
+// Rev 1.0	- RAM copy of the access rights held in the RFID database. One bitmap per door, indexed by the
+//						  user position (slot) in the database, so the decision at the door is a single bit test and
+//						  never waits on EEPROM.
+//						- Users whose only right is one-time access are marked "once". Using the access clears the
+//						  user's bits straight away and leaves the slot "pending" so the attribute byte in EEPROM
+//						  can be updated once the door has been opened.
+
+#ifndef _ACCESSMAP_H
+#define _ACCESSMAP_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#define ACSMAP_DOORS			4							// Number of doors (bitmaps).
+#define ACSMAP_USERS			256						// Number of user slots (RfidDb holds at most 255 users).
+#define ACSMAP_BYTES			(ACSMAP_USERS / 8)
+
+class AccessMap
+{
+
+public:
+	AccessMap();
+
+	// Revokes every right and clears the pending slots.
+	void							clear();
+
+	// Sets the rights of "slot". Bit N of "doors" allows door N. Set "once" if the rights come from
+	// one-time access only.
+	void							set(uint8_t slot, uint8_t doors, bool once);
+
+	// Returns true if "slot" may open "door".
+	bool							allowed(uint8_t slot, uint8_t door)
+	{
+		return (door < ACSMAP_DOORS) && (_allow[door][slot >> 3] & (1 << (slot & 7)));
+	}
+
+	// Called once access has been granted. If "slot" had one-time access its rights are revoked,
+	// the slot is marked pending and true is returned.
+	bool							use(uint8_t slot);
+
+	// Returns the first slot waiting for its one-time access to be cleared in EEPROM or -1 if none.
+	int16_t						nextPending();
+
+	// Clears the pending mark of "slot".
+	void							done(uint8_t slot);
+
+private:
+	uint8_t						_allow[ACSMAP_DOORS][ACSMAP_BYTES];
+	uint8_t						_once[ACSMAP_BYTES];
+	uint8_t						_pending[ACSMAP_BYTES];
+};
+
+#endif
@@ -0,0 +1,130 @@
+// CliEngine.cpp Rev 1.1
+
+#include "CliEngine.h"
+
+static const char CLI_DELIM[] = " ";						// Argument delimiter.
+
+CliEngine::CliEngine(const CliCommand *table, uint8_t count, void (*defaultHandler)())
+{
+	_table					= table;
+	_count					= count;
+	_defaultHandler	= defaultHandler;
+	_pending				= NULL;
+	_frameHandler		= NULL;
+	_timeout				= 0;
+	_bufPos					= 0;
+	_last						= NULL;
+	_buffer[0]			= '\0';
+}
+
+void CliEngine::tick(){if(_timeout){_timeout--;}}
+
+bool CliEngine::awaiting(){return _pending != NULL;}
+
+void CliEngine::cancel(){_pending = NULL;}
+
+void CliEngine::setFrameHandler(void (*handler)(char *line)){_frameHandler = handler;}
+
+void CliEngine::await(void (*handler)(), uint8_t timeout)
+{
+	_pending = handler;
+	_timeout = timeout;
+}
+
+char *CliEngine::next(){return strtok_r(NULL, CLI_DELIM, &_last);}
+
+bool CliEngine::peek()
+{
+	if(_last == NULL){return false;}
+	char *p = _last;
+	while(*p == ' '){p++;}
+	return *p != '\0';
+}
+
+char *CliEngine::rest()
+{
+	if(_last == NULL){return (char *)"";}
+	while(*_last == ' '){_last++;}
+	char *p = _last;
+	_last = NULL;																	// Line fully consumed.
+	return p;
+}
+
+void CliEngine::feedNum(uint32_t val)
+{
+	if(_pending == NULL){return;}
+	ultoa(val, _buffer, 10);
+	_bufPos = 0;																	// Discard any partially typed line.
+	process();
+}
+
+void CliEngine::readSerial()
+{
+	if(_pending && !_timeout)											// Operator did not respond in time.
+	{
+		_pending = NULL;
+		Serial.println(F("SERIAL INPUT TIMEOUT"));
+	}
+
+	while(Serial.available() > 0)
+	{
+		char c = Serial.read();
+		if(c == '\r' || c == '\n')									// Line received and ready.
+		{
+			if(_bufPos == 0 && _pending == NULL){continue;}	// Ignore empty lines and CR/LF pairs.
+			_buffer[_bufPos] = '\0';
+			_bufPos = 0;
+			process();
+		}
+		else if(_bufPos < CLI_BUFFER - 1){_buffer[_bufPos++] = c;}
+	}
+}
+
+// Process Method (PRIVATE)-------------------------------------------------------------------------------------------
+// Hands the line in the buffer to the frame handler, the pending continuation or looks the command up in the table.
+void CliEngine::process()
+{
+	_last = _buffer;
+	if(_buffer[0] == '{' && _frameHandler)
+	{
+		_last = NULL;
+		_frameHandler(_buffer);
+		return;
+	}
+	if(_pending)
+	{
+		void (*handler)() = _pending;
+		_pending = NULL;														// Handler may register a new continuation.
+		handler();
+		return;
+	}
+	char *token = strtok_r(_buffer, CLI_DELIM, &_last);
+	if(token != NULL){dispatch(token);}
+}
+
+const CliCommand *CliEngine::find(const CliCommand *table, uint8_t count, const char *token)
+{
+	int16_t lo = 0;
+	int16_t hi = count - 1;
+	while(lo <= hi)
+	{
+		int16_t mid = (lo + hi) >> 1;
+		int     cmp = strncasecmp_P(token, table[mid].name, CLI_CMDLENGTH);
+		if(cmp == 0){return &table[mid];}
+		else if(cmp < 0){hi = mid - 1;}
+		else{lo = mid + 1;}
+	}
+	return NULL;
+}
+
+// Dispatch Method (PRIVATE)------------------------------------------------------------------------------------------
+void CliEngine::dispatch(char *token)
+{
+	const CliCommand *cmd = find(_table, _count, token);
+	if(cmd != NULL)
+	{
+		void (*handler)() = (void (*)())pgm_read_ptr(&cmd->handler);
+		handler();
+	}
+	else if(_defaultHandler){_defaultHandler();}
+}
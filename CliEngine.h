@@ -0,0 +1,112 @@
+// CliEngine.h Rev 1.1
+
+// Rev 1.1	- Lines starting with '{' are machine protocol requests and are passed to the frame handler
+//						  set with setFrameHandler(), ahead of any pending continuation, so a host tool and an
+//						  operator can share the port.
+//						- Line buffer increased to 80 characters to hold machine protocol requests.
+//						- Table lookup made public (find) so other tables can use the same sorted layout.
+// Rev 1.0	- Replaces the ArduinoSerialCommand library. Lines are assembled incrementally from the UART
+//						  without ever waiting for input, and commands are dispatched through a sorted table held in
+//						  program memory using a binary search instead of a linear strncasecmp walk.
+//						- Commands that need more input from the operator (arguments, names, Y/N confirmation)
+//						  register a continuation with await(). The next line, or the next keypad/tag entry passed
+//						  in through feedNum(), is routed to the continuation instead of the command table, so
+//						  a slow operator never stalls the main loop.
+
+#ifndef _CLIENGINE_H
+#define _CLIENGINE_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#define CLI_BUFFER				80						// Maximum line length including NULL character.
+#define CLI_CMDLENGTH			5							// Maximum command length including NULL character.
+
+// One entry of the command table. The table must be stored in program memory and sorted in
+// ascending (case insensitive) order of command name. Use cliSorted() in a static_assert to
+// have the compiler check the order.
+struct CliCommand
+{
+	char							name[CLI_CMDLENGTH];
+	void							(*handler)();
+};
+
+// Compile time helpers used to verify the command table order.
+constexpr char cliLower(char c){return (c >= 'A' && c <= 'Z') ? (c + 32) : c;}
+constexpr int  cliCmp(const char *a, const char *b)
+{
+	return (cliLower(*a) != cliLower(*b) || *a == '\0') ? (cliLower(*a) - cliLower(*b)) : cliCmp(a + 1, b + 1);
+}
+constexpr bool cliSorted(const CliCommand *table, uint8_t count)
+{
+	return (count < 2) || ((cliCmp(table[0].name, table[1].name) < 0) && cliSorted(table + 1, count - 1));
+}
+
+class CliEngine
+{
+
+public:
+	// Parameters:
+	//   table:           Sorted command table stored in program memory.
+	//   count:           Number of entries in the command table.
+	//   defaultHandler:  Called when a command is not found in the table.
+	CliEngine(const CliCommand *table, uint8_t count, void (*defaultHandler)());
+
+	// Reads every character currently waiting in the UART receive buffer and dispatches
+	// complete lines. Never waits for input. Must be called from the main loop.
+	void							readSerial();
+
+	// Counts down the timeout of a pending continuation. Must be called once per second and
+	// may be called from the timer interrupt. The expired continuation is dropped by readSerial().
+	void							tick();
+
+	// Returns the next argument of the line being processed or NULL if there is none.
+	char *						next();
+
+	// Returns true if the line being processed holds another argument, without consuming it.
+	bool							peek();
+
+	// Returns the remainder of the line being processed (leading blanks removed) or an
+	// empty string if the line has been consumed.
+	char *						rest();
+
+	// Routes the next line (or keypad entry) to "handler" instead of the command table.
+	// If no input is received within "timeout" seconds the continuation is dropped.
+	void							await(void (*handler)(), uint8_t timeout);
+
+	// Returns true if a continuation is waiting for input.
+	bool							awaiting();
+
+	// Drops the pending continuation (if any).
+	void							cancel();
+
+	// Lines starting with '{' are passed to "handler" instead of the command table.
+	void							setFrameHandler(void (*handler)(char *line));
+
+	// Binary search of a sorted table in program memory. Returns the matching entry or NULL.
+	static const CliCommand *find(const CliCommand *table, uint8_t count, const char *token);
+
+	// Delivers a number entered on a keypad or read from a tag to the pending continuation
+	// as if it had been typed on the console.
+	void							feedNum(uint32_t val);
+
+private:
+	void							process();
+	void							dispatch(char *token);
+
+	const CliCommand *	_table;
+	uint8_t						_count;
+	void							(*_defaultHandler)();
+	void							(*_pending)();
+	void							(*_frameHandler)(char *line);
+	volatile uint8_t	_timeout;
+
+	char							_buffer[CLI_BUFFER];
+	uint8_t						_bufPos;
+	char *						_last;
+};
+
+#endif
@@ -0,0 +1,35 @@
+// DbJournal.cpp Rev 1.0
+
+#include "DbJournal.h"
+
+DbJournal::DbJournal(JnlEntry *entries, uint8_t size)
+{
+	_entries = entries;
+	_size = size;
+	_epoch = 0;
+	_head = 0;
+	_paused = false;
+}
+
+void DbJournal::begin(uint16_t epoch)
+{
+	_epoch = epoch ? epoch : 1;
+	_head = 0;
+}
+
+void DbJournal::add(uint8_t op, uint32_t key)
+{
+	if(_paused || _epoch == 0){return;}															// Paused or not started.
+	_head++;
+	_entries[_head % _size].key = key;
+	_entries[_head % _size].op = op;
+}
+
+uint32_t DbJournal::first(){return _head >= _size ? _head - _size + 1 : 1;}
+
+bool DbJournal::get(uint32_t seq, JnlEntry &e)
+{
+	if(seq < first() || seq > _head){return false;}
+	e = _entries[seq % _size];
+	return true;
+}
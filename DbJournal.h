@@ -0,0 +1,64 @@
+// DbJournal.h Rev 1.0
+
+// Rev 1.0	- Change journal of the RFID database, kept in RAM for DbSync. Every change made through the database
+//						  methods adds an entry with the next sequence number: the user holding a tag ID or password was
+//						  added or changed (JNL_SET), removed (JNL_DEL), or the database was erased (JNL_CLR). Entries
+//						  name the user by its tag ID or password, not by its position, as positions differ between
+//						  controllers. The record itself is read from the database when the entry is sent, so an entry
+//						  sent late carries the latest data.
+//						- The journal is a ring of the last "size" entries. Sequence numbers start at 1 and never wrap.
+//						  The epoch changes at each start, it tells a peer that older sequence numbers are gone.
+
+#ifndef _DBJOURNAL_H
+#define _DBJOURNAL_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#define JNL_SET						0x01					// User holding "key" added or changed.
+#define JNL_DEL						0x02					// User holding "key" removed, or "key" changed to another value.
+#define JNL_CLR						0x03					// Database erased.
+#define JNL_OP						0x7F
+#define JNL_PWD						0x80					// "key" is a password (tag ID otherwise).
+
+struct JnlEntry																			// One journal entry.
+{
+	uint32_t					key;														// Tag ID or password of the user.
+	uint8_t						op;															// JNL_SET, JNL_DEL or JNL_CLR, with JNL_PWD.
+};
+
+class DbJournal
+{
+
+public:
+	// Journal of the last "size" changes in "entries", which must stay allocated.
+	DbJournal(JnlEntry *entries, uint8_t size);
+
+	// Starts an empty journal. "epoch" must differ from the one of the previous start (0 is not used).
+	void							begin(uint16_t epoch);
+
+	// Adds a change. Ignored while paused.
+	void							add(uint8_t op, uint32_t key);
+
+	// Changes received from a peer are applied with the journal paused, so they are not sent back.
+	void							pause(bool on){_paused = on;}
+
+	uint16_t					epoch(){return _epoch;}
+	uint32_t					head(){return _head;}									// Sequence number of the last change, 0 if none.
+	uint32_t					first();																// Oldest sequence number held (head + 1 if empty).
+
+	// Returns the entry of sequence number "seq", false if it is no longer (or not yet) in the journal.
+	bool							get(uint32_t seq, JnlEntry &e);
+
+private:
+	JnlEntry *				_entries;
+	uint8_t						_size;
+	uint16_t					_epoch;
+	uint32_t					_head;
+	bool							_paused;
+};
+
+#endif
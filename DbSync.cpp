@@ -0,0 +1,563 @@
+// DbSync.cpp Rev 1.2
+
+#include "DbSync.h"
+#include "EepromMeter.h"
+
+#define SYNC_BYTE					0x7E					// Start of frame.
+#define SYNC_GAP					100						// ms between two bytes of a frame before it is dropped.
+#define SYNC_REC					14						// Bytes of a record before the name.
+
+#define FR_HELLO					'H'						// Status: epoch, head, first, applied epoch, applied, digest, users, paired.
+#define FR_ACK						'A'						// Last change applied: epoch, sequence.
+#define FR_REC						'R'						// User added or changed: epoch, sequence, record.
+#define FR_DEL						'D'						// User removed: epoch, sequence, journal op, key.
+#define FR_CLR						'C'						// Database erased: epoch, sequence.
+#define FR_SNAP						'S'						// Snapshot start: epoch.
+#define FR_USER						'U'						// Snapshot user: epoch, index, record.
+#define FR_SNAPACK				'K'						// Snapshot users applied: epoch, count.
+#define FR_BASE						'B'						// Peer is up to date at: epoch, sequence, users (end of a snapshot).
+
+static uint16_t crc16(uint16_t crc, uint8_t c)
+{
+	crc ^= (uint16_t)c << 8;
+	for(uint8_t i = 0; i < 8; i++){crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;}
+	return crc;
+}
+
+static const uint32_t noClock = 0;
+
+static uint32_t getVal(const uint8_t *p, uint8_t n)
+{
+	uint32_t val = 0;
+	for(uint8_t i = 0; i < n; i++){val |= (uint32_t)p[i] << (8 * i);}
+	return val;
+}
+
+// Writes record "r" with time stamp "tm" at "p", returns its length.
+static uint8_t packRec(SyncRec &r, uint32_t tm, uint8_t *p)
+{
+	uint8_t n = 0;
+	uint8_t i;
+
+	for(i = 0; i < 4; i++){p[n++] = r.id >> (8 * i);}
+	for(i = 0; i < 4; i++){p[n++] = r.pwd >> (8 * i);}
+	for(i = 0; i < 4; i++){p[n++] = tm >> (8 * i);}
+	p[n++] = r.att;
+	p[n++] = r.sch;
+	for(i = 0; i < DBSYNC_MAXNAME - 1 && r.name[i]; i++){p[n++] = r.name[i];}
+	return n;
+}
+
+// Reads a record of "len" bytes at "p", returns false if it is too short or its name too long.
+static bool unpackRec(const uint8_t *p, uint8_t len, SyncRec &r)
+{
+	if(len < SYNC_REC || len - SYNC_REC >= DBSYNC_MAXNAME){return false;}
+	r.id = getVal(p, 4);
+	r.pwd = getVal(p + 4, 4);
+	r.tm = getVal(p + 8, 4);
+	r.att = p[12];
+	r.sch = p[13];
+	memcpy(r.name, p + SYNC_REC, len - SYNC_REC);
+	r.name[len - SYNC_REC] = '\0';
+	return true;
+}
+
+DbSync::DbSync(Stream &port, DbJournal &jnl) : _port(port), _jnl(jnl)
+{
+	_minutes = &noClock;
+	_rxLen = 0;
+	_rxTime = 0;
+	_txLen = 0;
+	_peerEpoch = 0;
+	_peerHead = 0;
+	_peerFirst = 1;
+	_peerDigest = 0;
+	_peerUsers = 0;
+	_peerPaired = false;
+	_peerTime = 0;
+	_ackEpoch = 0;
+	_ack = 0;
+	_sendSeq = 0;
+	_sendTime = 0;
+	_appEpoch = 0;
+	_applied = 0;
+	_ackDue = false;
+	_snapEpoch = 0;
+	_snapNext = 0;
+	_snapAckDue = false;
+	_snapping = false;
+	_snapAck = -1;
+	_snapSent = -1;
+	_snapBase = 0;
+	_snapRev = 0;
+	_snapTime = 0;
+	_helloTime = 0;
+	_digest = 0;
+	_digestRev = 0;
+	_digestOk = false;
+	_errors = 0;
+	_snapsSent = 0;
+	_snapsRcvd = 0;
+	_pairAddr = -1;
+	_paired = false;
+}
+
+void DbSync::begin(uint16_t pairAddr)
+{
+	_pairAddr = pairAddr;
+	_paired = eeMeter.read(pairAddr) == DBSYNC_PAIRED;
+}
+
+void DbSync::service()
+{
+	uint8_t n = 0;
+
+	while(_port.available() && n++ < sizeof(_rx)){receive(_port.read());}	// The rest at the next call.
+	if(_ackDue)
+	{
+		start(FR_ACK);
+		put(_appEpoch, 2);
+		put(_applied, 4);
+		if(send()){_ackDue = false;}
+	}
+	if(_snapAckDue)
+	{
+		start(FR_SNAPACK);
+		put(_snapEpoch, 2);
+		put(_snapNext, 1);
+		if(send()){_snapAckDue = false;}
+	}
+	if(millis() - _helloTime >= DBSYNC_HELLO && sendHello()){_helloTime = millis();}
+	if(!linkUp()){return;}
+	if(_snapping){sendSnapshot();}
+	else{sendData();}
+}
+
+void DbSync::snapshot()
+{
+	_snapping = true;
+	_snapAck = -1;
+	_snapSent = -1;
+	_snapRev = revision();
+	_snapBase = _jnl.head();
+	_snapTime = millis() - DBSYNC_RETRY;
+}
+
+bool DbSync::linkUp(){return _peerEpoch != 0 && millis() - _peerTime < DBSYNC_LINKDOWN;}
+bool DbSync::synced(){return linkUp() && !missed() && _ack == _jnl.head();}
+
+// The digest is the sum of the CRC of each record, so it does not depend on the order of the users. The time
+// stamps are left out, each side counts them on its own clock.
+uint16_t DbSync::digest()
+{
+	SyncRec	r;
+	uint8_t	buf[SYNC_REC + DBSYNC_MAXNAME];
+
+	if(_digestOk && _digestRev == revision()){return _digest;}
+	_digest = 0;
+	for(uint8_t pos = 0; pos < users(); pos++)
+	{
+		if(!readUser(pos, r)){continue;}
+		uint8_t		len = packRec(r, 0, buf);
+		uint16_t	crc = 0xFFFF;
+		for(uint8_t i = 0; i < len; i++){crc = crc16(crc, buf[i]);}
+		_digest += crc;
+	}
+	_digestRev = revision();
+	_digestOk = true;
+	return _digest;
+}
+
+// receive Method (PRIVATE)---------------------------------------------------------------------------------------
+// Adds a byte to the frame being received. "_rxLen" is 0 while waiting for the start of a frame, then 1 + the
+// number of bytes stored (length, type, data, CRC).
+void DbSync::receive(uint8_t c)
+{
+	uint32_t now = millis();
+
+	if(_rxLen && now - _rxTime > SYNC_GAP){_rxLen = 0; _errors++;}		// Rest of the frame lost.
+	_rxTime = now;
+	if(_rxLen == 0)
+	{
+		if(c == SYNC_BYTE){_rxLen = 1;}
+		return;
+	}
+	_rx[_rxLen - 1] = c;
+	_rxLen++;
+	if(_rxLen == 2 && (c == 0 || c > DBSYNC_FRAME)){_rxLen = 0; _errors++; return;}
+	if(_rxLen - 1 < _rx[0] + 3){return;}
+
+	uint8_t		len = _rx[0];
+	uint16_t	crc = 0xFFFF;
+	_rxLen = 0;
+	for(uint8_t i = 0; i <= len; i++){crc = crc16(crc, _rx[i]);}
+	if(crc != (_rx[len + 1] | (uint16_t)_rx[len + 2] << 8)){_errors++; return;}
+	frame(&_rx[1], len);
+}
+
+// frame Method (PRIVATE)-----------------------------------------------------------------------------------------
+// Handles a frame of the peer, "d" holds its type and data. Changes are applied in sequence only, anything else
+// is answered with the last change applied so the peer sends the right one.
+void DbSync::frame(uint8_t *d, uint8_t len)
+{
+	SyncRec		r;
+	uint16_t	epoch;
+	uint32_t	seq;
+	bool			inSeq;
+	int16_t		pos;
+
+	if(len < 3 || (len < 7 && d[0] != FR_SNAP && d[0] != FR_SNAPACK && d[0] != FR_USER)){_errors++; return;}
+	epoch = getVal(d + 1, 2);
+	seq = getVal(d + 3, 4);																			// Not used by the snapshot frames.
+	inSeq = epoch == _appEpoch && seq == _applied + 1 && _snapEpoch == 0;
+	_peerTime = millis();
+	switch(d[0])
+	{
+		case FR_HELLO:
+			if(len < 21){_errors++; return;}
+			_peerEpoch = epoch;
+			_peerHead = seq;
+			_peerFirst = getVal(d + 7, 4);
+			_ackEpoch = getVal(d + 11, 2);
+			_ack = getVal(d + 13, 4);
+			_peerDigest = getVal(d + 17, 2);
+			_peerUsers = d[19];
+			_peerPaired = d[20];
+			if(diverged()){snapshot();}
+		break;
+
+		case FR_ACK:
+			_ackEpoch = epoch;
+			_ack = seq;
+			_sendSeq = 0;
+		break;
+
+		case FR_SNAPACK:
+			if(len < 4){_errors++; return;}
+			if(_snapping && epoch == _jnl.epoch()){_snapAck = d[3];}
+		break;
+
+		case FR_REC:
+		case FR_DEL:
+		case FR_CLR:
+			_ackDue = true;
+			if(!inSeq){return;}
+			if(d[0] == FR_REC && !unpackRec(d + 7, len - 7, r)){_errors++; return;}
+			if(d[0] == FR_DEL && len < 12){_errors++; return;}
+			_jnl.pause(true);
+			if(d[0] == FR_REC){storeUser(r);}
+			else if(d[0] == FR_DEL){dropUser(getVal(d + 8, 4), d[7] & JNL_PWD);}
+			else{clearUsers();}
+			_jnl.pause(false);
+			_applied = seq;
+		break;
+
+		case FR_SNAP:
+			_snapEpoch = epoch;
+			_snapNext = 0;
+			_appEpoch = 0;
+			memset(_snapHave, 0, sizeof(_snapHave));
+			_snapAckDue = true;
+			_snapsRcvd++;
+		break;
+
+		case FR_USER:
+			_snapAckDue = true;
+			if(len < 4 || epoch != _snapEpoch || d[3] != _snapNext){return;}
+			if(!unpackRec(d + 4, len - 4, r)){_errors++; return;}
+			_jnl.pause(true);
+			pos = storeUser(r);
+			if(pos < 0 && spare()){pos = storeUser(r);}								// Full of users not in the snapshot.
+			_jnl.pause(false);
+			if(pos >= 0){_snapHave[pos >> 3] |= 1 << (pos & 7);}
+			else{_errors++;}
+			_snapNext++;
+		break;
+
+		case FR_BASE:
+			if(_snapEpoch && len >= 8 && epoch == _snapEpoch && d[7] == _snapNext)	// End of the snapshot, every user received.
+			{
+				_jnl.pause(true);
+				prune();
+				_jnl.pause(false);
+			}
+			pair();
+			_appEpoch = epoch;
+			_applied = seq;
+			_snapEpoch = 0;
+			_ackDue = true;
+		break;
+
+		default:
+			_errors++;
+		break;
+	}
+}
+
+// sendData Method (PRIVATE)--------------------------------------------------------------------------------------
+// Sends the next change the peer has not applied. When the peer missed changes no longer in the journal, sends
+// the base sequence number if the databases are equal or starts a snapshot.
+void DbSync::sendData()
+{
+	uint32_t now = millis();
+
+	if(missed())
+	{
+		if(now - _sendTime < DBSYNC_RETRY){return;}
+		if(digest() == _peerDigest)
+		{
+			start(FR_BASE);
+			put(_jnl.epoch(), 2);
+			put(_jnl.head(), 4);
+			if(send()){_sendTime = now; pair();}
+			return;
+		}
+		if(!peerMissed() || elected()){snapshot();}
+		_sendTime = now;
+		return;
+	}
+	if(_ack >= _jnl.head()){return;}
+	if(_sendSeq == _ack + 1 && now - _sendTime < DBSYNC_RETRY){return;}	// Waiting for the acknowledgement.
+	if(sendEntry(_ack + 1))
+	{
+		_sendSeq = _ack + 1;
+		_sendTime = now;
+	}
+}
+
+// sendSnapshot Method (PRIVATE)----------------------------------------------------------------------------------
+// Sends the snapshot start, then each user once the previous one is acknowledged, then the base sequence number.
+// A database change restarts the snapshot, users may have moved.
+void DbSync::sendSnapshot()
+{
+	SyncRec		r;
+	uint32_t	now = millis();
+
+	if(revision() != _snapRev){snapshot();}
+	if(_snapAck < 0)
+	{
+		if(now - _snapTime < DBSYNC_RETRY){return;}
+		start(FR_SNAP);
+		put(_jnl.epoch(), 2);
+		if(send()){_snapTime = now;}
+	}
+	else if(_snapAck < users())
+	{
+		if(_snapSent == _snapAck && now - _snapTime < DBSYNC_RETRY){return;}
+		readUser(_snapAck, r);
+		start(FR_USER);
+		put(_jnl.epoch(), 2);
+		put(_snapAck, 1);
+		putRec(r);
+		if(send())
+		{
+			_snapSent = _snapAck;
+			_snapTime = now;
+		}
+	}
+	else
+	{
+		start(FR_BASE);
+		put(_jnl.epoch(), 2);
+		put(_snapBase, 4);
+		put(_snapAck, 1);																						// Users sent.
+		if(send())
+		{
+			_snapping = false;
+			_snapsSent++;
+			_sendTime = now;
+			pair();
+		}
+	}
+}
+
+// sendEntry Method (PRIVATE)-------------------------------------------------------------------------------------
+// Sends journal entry "seq". A user changed is sent with its current record, or as removed if it is gone.
+bool DbSync::sendEntry(uint32_t seq)
+{
+	JnlEntry	e;
+	SyncRec		r;
+	int16_t		pos;
+
+	if(!_jnl.get(seq, e)){return false;}
+	if((e.op & JNL_OP) == JNL_SET)
+	{
+		pos = userOf(e.key, e.op & JNL_PWD);
+		if(pos >= 0 && readUser(pos, r))
+		{
+			start(FR_REC);
+			put(_jnl.epoch(), 2);
+			put(seq, 4);
+			putRec(r);
+			return send();
+		}
+		e.op = JNL_DEL | (e.op & JNL_PWD);
+	}
+	start((e.op & JNL_OP) == JNL_CLR ? FR_CLR : FR_DEL);
+	put(_jnl.epoch(), 2);
+	put(seq, 4);
+	if((e.op & JNL_OP) == JNL_DEL)
+	{
+		put(e.op, 1);
+		put(e.key, 4);
+	}
+	return send();
+}
+
+// sendHello Method (PRIVATE)-------------------------------------------------------------------------------------
+bool DbSync::sendHello()
+{
+	start(FR_HELLO);
+	put(_jnl.epoch(), 2);
+	put(_jnl.head(), 4);
+	put(_jnl.first(), 4);
+	put(_appEpoch, 2);
+	put(_applied, 4);
+	put(digest(), 2);
+	put(users(), 1);
+	put(_paired, 1);
+	return send();
+}
+
+// diverged Method (PRIVATE)--------------------------------------------------------------------------------------
+// Called with the status of the peer. True if each side applied every change of the other but the databases
+// differ, which happens when both sides change the same user at the same time (a change on one side crossing an
+// erase on the other). Only one side sends the snapshot, see "elected".
+bool DbSync::diverged()
+{
+	if(_snapping || _snapEpoch || missed() || peerMissed()){return false;}
+	if(_ack != _jnl.head() || _applied != _peerHead || digest() == _peerDigest){return false;}
+	return elected();
+}
+
+// elected Method (PRIVATE)---------------------------------------------------------------------------------------
+// True if this side sends the snapshot when the databases differ. An empty database never does, so a new or
+// erased controller can not erase its peer. Then a paired database wins over one never synchronized, and between
+// two never synchronized the one with more users. Then the side with changes since its start, the higher epoch and
+// the higher digest.
+bool DbSync::elected()
+{
+	bool mine = _jnl.head() > 0;
+	bool theirs = _peerHead > 0;
+
+	if(users() == 0 || _peerUsers == 0){return users() > 0;}
+	if(_paired != _peerPaired){return _paired;}
+	if(!_paired && users() != _peerUsers){return users() > _peerUsers;}
+	if(mine != theirs){return mine;}
+	if(_jnl.epoch() != _peerEpoch){return _jnl.epoch() > _peerEpoch;}
+	return digest() > _peerDigest;
+}
+
+// pair Method (PRIVATE)------------------------------------------------------------------------------------------
+// Called when the databases are the same on both sides. Sets the paired flag, written to EEPROM once.
+void DbSync::pair()
+{
+	if(_paired){return;}
+	_paired = true;
+	if(_pairAddr >= 0){eeMeter.write(_pairAddr, DBSYNC_PAIRED);}
+}
+
+// spare Method (PRIVATE)-----------------------------------------------------------------------------------------
+// Removes the last user not received in the snapshot yet, to make room for one received. Returns false if every
+// user was received.
+bool DbSync::spare()
+{
+	for(int16_t pos = users() - 1; pos >= 0; pos--)
+	{
+		if(!(_snapHave[pos >> 3] & (1 << (pos & 7)))){dropAt(pos); return true;}
+	}
+	return false;
+}
+
+// prune Method (PRIVATE)-----------------------------------------------------------------------------------------
+// Removes the users not received in the snapshot, from the last position down.
+void DbSync::prune()
+{
+	for(int16_t pos = users() - 1; pos >= 0; pos--)
+	{
+		if(!(_snapHave[pos >> 3] & (1 << (pos & 7)))){dropAt(pos);}
+	}
+}
+
+// dropAt Method (PRIVATE)----------------------------------------------------------------------------------------
+// Removes the user at "pos". The databases move the last user into the position freed, its mark moves with it.
+void DbSync::dropAt(uint8_t pos)
+{
+	SyncRec	r;
+	uint8_t	last = users() - 1;
+
+	if(!readUser(pos, r)){return;}
+	dropUser(r.id ? r.id : r.pwd, r.id == 0);
+	if(last == pos){return;}
+	if(_snapHave[last >> 3] & (1 << (last & 7))){_snapHave[pos >> 3] |= 1 << (pos & 7);}
+	else{_snapHave[pos >> 3] &= ~(1 << (pos & 7));}
+	_snapHave[last >> 3] &= ~(1 << (last & 7));
+}
+
+// missed Method (PRIVATE)----------------------------------------------------------------------------------------
+// True if the peer missed changes no longer in the journal (or never synchronized with this journal).
+bool DbSync::missed()
+{
+	return _ackEpoch != _jnl.epoch() || _ack > _jnl.head() || _ack + 1 < _jnl.first();
+}
+
+// peerMissed Method (PRIVATE)------------------------------------------------------------------------------------
+// Same as "missed" for the changes of the peer. A snapshot being received is not missed.
+bool DbSync::peerMissed()
+{
+	if(_snapEpoch){return false;}
+	return _appEpoch != _peerEpoch || _applied > _peerHead || _applied + 1 < _peerFirst;
+}
+
+// start Method (PRIVATE)-----------------------------------------------------------------------------------------
+void DbSync::start(char type)
+{
+	_tx[0] = type;
+	_txLen = 1;
+}
+
+// put Method (PRIVATE)-------------------------------------------------------------------------------------------
+// Adds the "n" low bytes of "val" to the frame, low byte first.
+void DbSync::put(uint32_t val, uint8_t n)
+{
+	for(uint8_t i = 0; i < n; i++){_tx[_txLen++] = val >> (8 * i);}
+}
+
+// putRec Method (PRIVATE)----------------------------------------------------------------------------------------
+void DbSync::putRec(SyncRec &r){_txLen += packRec(r, tmLeft(r.tm), _tx + _txLen);}
+
+// tmLeft Method (PROTECTED)--------------------------------------------------------------------------------------
+// Minutes left + 1 of time stamp "tm", so a time stamp of this minute is still valid and 0 is one that expired.
+uint32_t DbSync::tmLeft(uint32_t tm)
+{
+	uint32_t now = *_minutes;
+	return tm >= now ? tm - now + 1 : 0;
+}
+
+// tmLocal Method (PROTECTED)-------------------------------------------------------------------------------------
+// Time stamp of "left" minutes left on this clock. The current time stamp "cur" is kept if it gives the same
+// minutes left, so a record received again is not written again.
+uint32_t DbSync::tmLocal(uint32_t left, uint32_t cur)
+{
+	uint32_t now = *_minutes;
+
+	if(tmLeft(cur) == left){return cur;}
+	if(left){return now + left - 1;}
+	return now ? now - 1 : 0;																				// Expired.
+}
+
+// send Method (PRIVATE)------------------------------------------------------------------------------------------
+// Sends the frame if the transmit buffer has room for all of it, returns false otherwise.
+bool DbSync::send()
+{
+	uint16_t crc = crc16(0xFFFF, _txLen);
+
+	if(_port.availableForWrite() < _txLen + 4){return false;}
+	for(uint8_t i = 0; i < _txLen; i++){crc = crc16(crc, _tx[i]);}
+	_port.write(SYNC_BYTE);
+	_port.write(_txLen);
+	for(uint8_t i = 0; i < _txLen; i++){_port.write(_tx[i]);}
+	_port.write(crc & 0xFF);
+	_port.write(crc >> 8);
+	return true;
+}
@@ -0,0 +1,252 @@
+// DbSync.h Rev 1.2
+
+// Rev 1.2	- The temporary access time stamp of a user ("tm") counts the minutes of its own controller since it
+//						  started ("timeStmp" of the sketch). A record now carries the minutes left (+ 1, 0 = expired)
+//						  on the clock given to clock(), the receiving side adds them to its own clock. The digest leaves
+//						  "tm" out: the two clocks do not tick at the same moment.
+// Rev 1.1	- The side sending the snapshot is never an empty database, then the side that has completed a
+//						  synchronization before ("paired" flag kept in EEPROM, see begin()) over one that never has, then
+//						  the larger database when neither has. The status frame carries the user count and the flag.
+//						- A snapshot received no longer erases the database first: each user received is added or
+//						  updated in place and the users not in the snapshot are removed when it ends, so the doors keep
+//						  being served from a full database meanwhile.
+// Rev 1.0	- Replication of the RFID database between two controllers over a serial link (UART2 on the Mega).
+//						  Each side sends the changes of its journal (DbJournal) that the peer has not acknowledged yet,
+//						  one frame per change: the whole record of a user added or changed, the tag ID or password of a
+//						  user removed, or a database erase. The peer applies them with its journal paused and answers
+//						  with the last sequence number applied. A change waits for the acknowledgement of the previous
+//						  one, so a peer busy writing EEPROM never loses a frame to its receive buffer.
+//						- Frames: [0x7E] [length] [type] [data] [CRC-16 CCITT of length, type and data, low byte first].
+//						  A frame with a bad CRC is dropped, the sender sends it again after DBSYNC_RETRY ms.
+//						- Each side sends a status frame every DBSYNC_HELLO ms: its journal epoch and sequence numbers,
+//						  the last change of the peer it applied and a digest of its database. When the peer has missed
+//						  changes no longer in the journal (journal full, restart), the databases are compared by their
+//						  digest. Equal databases only restart the sequence numbers, otherwise every user is sent and
+//						  replaces the database of the peer (snapshot). If both sides missed changes, the side with
+//						  changes since its start sends the snapshot, then the side with the higher epoch.
+//						- Changes made on both sides at the same time may be applied in a different order on each side.
+//						  When each side applied every change of the other and the digests still differ, the side with
+//						  the higher epoch sends a snapshot.
+//						- service() never waits: a frame is only sent when the transmit buffer has room for all of it.
+//						- The database is reached through the virtual methods of DbSync. DbSyncOf implements them for
+//						  RfidDb, RfidDbFixed and RfidDbCompact.
+
+#ifndef _DBSYNC_H
+#define _DBSYNC_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+#include "DbJournal.h"
+
+#define DBSYNC_MAXNAME		32						// Longest name (including null) sent.
+#define DBSYNC_FRAME			(24 + DBSYNC_MAXNAME)	// Largest frame length (type and data).
+#define DBSYNC_RETRY			250						// ms without acknowledgement before a frame is sent again.
+#define DBSYNC_HELLO			1000					// ms between status frames.
+#define DBSYNC_LINKDOWN		3000					// ms without a frame from the peer before the link is down.
+#define DBSYNC_PWDFLAG		0x1000				// posOf() result flag of a password match.
+#define DBSYNC_PWDMASK		0xFFF
+#define DBSYNC_USERS			256						// Most users in a database (positions 0 to 255).
+#define DBSYNC_PAIRED			0xA7					// Paired flag value in EEPROM.
+
+struct SyncRec																			// User record sent to the peer.
+{
+	uint32_t					id;
+	uint32_t					pwd;
+	uint32_t					tm;
+	uint8_t						att;
+	uint8_t						sch;
+	char							name[DBSYNC_MAXNAME];
+};
+
+class DbSync
+{
+
+public:
+	// Replicates the database through "port" and journal "jnl". The journal must be started first.
+	DbSync(Stream &port, DbJournal &jnl);
+
+	// Loads the paired flag kept at EEPROM address "pairAddr" (1 byte), set once this database has been synchronized
+	// with a peer. Without it, the database is never paired.
+	void							begin(uint16_t pairAddr);
+
+	// Clock of the temporary access time stamps (minutes). Without it the time stamps are sent as they are.
+	void							clock(const volatile uint32_t &minutes){_minutes = &minutes;}
+
+	// Receives and applies the frames of the peer and sends the next change. Call from the main loop.
+	void							service();
+
+	// Sends every user to the peer, replacing its database.
+	void							snapshot();
+
+	bool							linkUp();																// Frame received from the peer lately.
+	bool							synced();																// Peer applied every change of the journal.
+	bool							paired(){return _paired;}
+	uint16_t					peerEpoch(){return _peerEpoch;}
+	uint8_t						peerUsers(){return _peerUsers;}
+	bool							peerPaired(){return _peerPaired;}
+	uint32_t					peerHead(){return _peerHead;}
+	uint32_t					acked(){return _ackEpoch == _jnl.epoch() ? _ack : 0;}	// Changes applied by the peer.
+	uint32_t					applied(){return _applied;}						// Changes of the peer applied here.
+	uint16_t					digest();																// Digest of the database.
+	uint16_t					peerDigest(){return _peerDigest;}
+	uint16_t					errors(){return _errors;}							// Frames dropped (CRC, length).
+	uint16_t					snapsSent(){return _snapsSent;}
+	uint16_t					snapsRcvd(){return _snapsRcvd;}
+
+protected:
+	virtual uint8_t		users() = 0;																	// Number of users.
+	virtual uint16_t	revision() = 0;																// Changes when the database is written.
+	virtual bool			readUser(uint8_t pos, SyncRec &r) = 0;
+	virtual int16_t		userOf(uint32_t key, bool pwd) = 0;						// Position of the user holding "key", or -1.
+	virtual int16_t		storeUser(SyncRec &r) = 0;										// Adds or updates the user, returns its position or -1.
+	virtual void			dropUser(uint32_t key, bool pwd) = 0;					// Removes the user holding "key".
+	virtual void			clearUsers() = 0;
+
+	uint32_t					tmLeft(uint32_t tm);												// Time stamp as sent, minutes left + 1.
+	uint32_t					tmLocal(uint32_t left, uint32_t cur);				// Time stamp received, "cur" if it is the same.
+
+private:
+	Stream &					_port;
+	DbJournal &				_jnl;
+	const volatile uint32_t *_minutes;
+
+	uint8_t						_rx[DBSYNC_FRAME + 3];									// Frame being received (length to CRC).
+	uint8_t						_rxLen;
+	uint32_t					_rxTime;
+	uint8_t						_tx[DBSYNC_FRAME];											// Frame being sent (type and data).
+	uint8_t						_txLen;
+
+	uint16_t					_peerEpoch;															// Status of the peer (status frame).
+	uint32_t					_peerHead;
+	uint32_t					_peerFirst;
+	uint16_t					_peerDigest;
+	uint8_t						_peerUsers;
+	bool							_peerPaired;
+	uint32_t					_peerTime;
+	uint16_t					_ackEpoch;															// Last change of the journal applied by the peer.
+	uint32_t					_ack;
+	uint32_t					_sendSeq;																// Change waiting for acknowledgement (0 = none).
+	uint32_t					_sendTime;
+	uint16_t					_appEpoch;															// Last change of the peer applied here.
+	uint32_t					_applied;
+	bool							_ackDue;
+	uint16_t					_snapEpoch;															// Snapshot received (0 = none).
+	uint8_t						_snapNext;															// Next user expected.
+	bool							_snapAckDue;
+	uint8_t						_snapHave[DBSYNC_USERS / 8];						// Positions received in the snapshot.
+	bool							_snapping;															// Snapshot sent.
+	int16_t						_snapAck;																// Users acknowledged, -1 before the start.
+	int16_t						_snapSent;															// Last user sent.
+	uint32_t					_snapBase;															// Journal head when the snapshot started.
+	uint16_t					_snapRev;
+	uint32_t					_snapTime;
+	uint32_t					_helloTime;
+	uint16_t					_digest;
+	uint16_t					_digestRev;
+	bool							_digestOk;
+	uint16_t					_errors;
+	uint16_t					_snapsSent;
+	uint16_t					_snapsRcvd;
+	int16_t						_pairAddr;															// -1 = flag not kept.
+	bool							_paired;
+
+	void							receive(uint8_t c);
+	void							frame(uint8_t *d, uint8_t len);
+	void							sendData();
+	void							sendSnapshot();
+	bool							sendEntry(uint32_t seq);
+	bool							sendHello();
+	bool							diverged();
+	bool							elected();
+	void							pair();
+	bool							spare();
+	void							prune();
+	void							dropAt(uint8_t pos);
+	bool							peerMissed();
+	bool							missed();
+	void							start(char type);
+	void							put(uint32_t val, uint8_t n);
+	void							putRec(SyncRec &r);
+	bool							send();
+};
+
+// DbSync of a database with the RfidDb methods (RfidDb, RfidDbFixed, RfidDbCompact).
+template<class Db> class DbSyncOf : public DbSync
+{
+
+public:
+	DbSyncOf(Stream &port, DbJournal &jnl, Db &db) : DbSync(port, jnl), _db(db){}
+
+protected:
+	uint8_t						users(){return _db.count();}
+	uint16_t					revision(){return _db.revision();}
+
+	bool							readUser(uint8_t pos, SyncRec &r)
+	{
+		memset(&r, 0, sizeof(r));
+		if(!_db.readId(pos, r.id)){return false;}
+		_db.readPwd(pos, r.pwd);
+		_db.readTm(pos, r.tm);
+		_db.readAtt(pos, r.att);
+		_db.readSch(pos, r.sch);
+		if(_db.maxNameLength() <= DBSYNC_MAXNAME){_db.readNam(pos, r.name);}
+		return true;
+	}
+
+	int16_t						userOf(uint32_t key, bool pwd)
+	{
+		int16_t pos = key ? _db.posOf(key) : -1;
+		if(pos < 0 || (pos >= DBSYNC_PWDFLAG) != pwd){return -1;}
+		return pos & DBSYNC_PWDMASK;
+	}
+
+	// Finds the user by its tag ID, then by its password, and writes only the fields that differ.
+	int16_t						storeUser(SyncRec &r)
+	{
+		SyncRec	cur;
+		int16_t	pos = userOf(r.id, false);
+
+		if(!r.id && !r.pwd){return -1;}
+		if(pos < 0){pos = userOf(r.pwd, true);}
+		if(pos < 0)
+		{
+			if(r.id ? !_db.insertId(r.id, r.pwd) : !_db.insertPwd(r.pwd)){return -1;}	// Database full.
+			pos = r.id ? userOf(r.id, false) : userOf(r.pwd, true);
+			if(pos < 0){return -1;}
+		}
+		readUser(pos, cur);
+		if(cur.id != r.id){_db.modifyIdPwd(pos, r.id);}
+		if(cur.pwd != r.pwd){_db.modifyIdPwd(pos | DBSYNC_PWDFLAG, r.pwd);}
+		if(cur.att != r.att){_db.modifyAtt(pos, r.att);}
+		if(cur.sch != r.sch){_db.modifySch(pos, r.sch);}
+		r.tm = tmLocal(r.tm, cur.tm);
+		if(cur.tm != r.tm){_db.insertTm(r.id ? r.id : r.pwd, r.tm);}
+		if(_db.maxNameLength() == 0 || _db.maxNameLength() > DBSYNC_MAXNAME){return pos;}
+		r.name[_db.maxNameLength() - 1] = '\0';
+		if(strcmp(cur.name, r.name) == 0){return pos;}
+		if(r.name[0]){_db.modifyNam(pos, r.name);}
+		else if(r.id){_db.removeIdNam(r.id);}
+		else{_db.removePwdNam(r.pwd);}
+		return pos;
+	}
+
+	void							dropUser(uint32_t key, bool pwd)
+	{
+		SyncRec	cur;
+		int16_t	pos = userOf(key, pwd);
+
+		if(pos < 0 || !readUser(pos, cur)){return;}
+		if(cur.id){_db.removeId(cur.id);}											// Only clears the id when a password is left.
+		if(cur.pwd){_db.removePwd(cur.pwd);}
+	}
+
+	void							clearUsers(){_db.initDb();}
+
+private:
+	Db &							_db;
+};
+
+#endif
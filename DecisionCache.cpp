@@ -0,0 +1,68 @@
+// DecisionCache.cpp Rev 1.1
+
+#include "DecisionCache.h"
+
+DecisionCache::DecisionCache()
+{
+	_ttl = 0;
+	_absorbed = 0;
+	_decided = 0;
+	clear();
+}
+
+void DecisionCache::ttl(uint16_t ms)
+{
+	_ttl = ms;
+	if(ms == 0){clear();}
+}
+
+bool DecisionCache::seen(uint8_t loc, uint32_t code, uint32_t now, uint8_t &decision)
+{
+	for(uint8_t i = 0; i < DCACHE_ENTRIES; i++)
+	{
+		if(_entries[i].code == code && _entries[i].loc == loc && live(i, now))
+		{
+			decision = _entries[i].decision;
+			_absorbed++;
+			return true;
+		}
+	}
+	return false;
+}
+
+void DecisionCache::put(uint8_t loc, uint32_t code, uint8_t decision, uint32_t now)
+{
+	uint8_t		oldest = 0;
+
+	if(_ttl == 0){return;}
+	for(uint8_t i = 0; i < DCACHE_ENTRIES; i++)
+	{
+		if(!live(i, now) || (_entries[i].code == code && _entries[i].loc == loc)){oldest = i; break;}	// Free, expired or same tag.
+		if(now - _entries[i].time > now - _entries[oldest].time){oldest = i;}
+	}
+	_entries[oldest].code = code;
+	_entries[oldest].time = now;
+	_entries[oldest].loc = loc;
+	_entries[oldest].decision = decision;
+	_decided++;
+}
+
+void DecisionCache::clear()
+{
+	for(uint8_t i = 0; i < DCACHE_ENTRIES; i++){_entries[i].loc = 0xFF;}
+}
+
+void DecisionCache::forget(uint8_t loc, uint8_t decision)
+{
+	for(uint8_t i = 0; i < DCACHE_ENTRIES; i++)
+	{
+		if(_entries[i].loc == loc && _entries[i].decision == decision){_entries[i].loc = 0xFF;}
+	}
+}
+
+bool DecisionCache::entry(uint8_t i, uint32_t now, DecisionEntry &e)
+{
+	if(i >= DCACHE_ENTRIES || !live(i, now)){return false;}
+	e = _entries[i];
+	return true;
+}
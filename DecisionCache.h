@@ -0,0 +1,70 @@
+// DecisionCache.h Rev 1.1
+
+// Rev 1.0	- Recent access decisions (keypad location, tag ID, decision, time) kept for a short time (TTL). Readers
+//						  send the same tag several times while the card is held against them: a repeat found in the
+//						  cache is absorbed, so it does not unlock the door again, log again or count as another retry.
+//						- The time of an entry is refreshed by each repeat, so a card held longer than the TTL is still
+//						  absorbed. Entries are matched on location and tag, the oldest entry is replaced when full.
+//						- Times are millis() values given by the caller. A TTL of 0 turns the cache off.
+// Rev 1.1	- A repeat no longer refreshes the entry time, an entry lasts the TTL from its decision. A card held
+//						  longer is decided again.
+//						- forget() drops the decisions of a location, so a grant is not absorbed once its door relocked.
+
+#ifndef _DECISIONCACHE_H
+#define _DECISIONCACHE_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#define DCACHE_ENTRIES		8							// Decisions kept (all keypads).
+
+struct DecisionEntry
+{
+	uint32_t					code;														// Tag ID.
+	uint32_t					time;														// millis() of the decision.
+	uint8_t						loc;														// Keypad location, 0xFF = free.
+	uint8_t						decision;												// Caller's decision code.
+};
+
+class DecisionCache
+{
+
+public:
+	DecisionCache();
+
+	// Entries are kept "ms" milliseconds after the decision. 0 turns the cache off and clears it.
+	void							ttl(uint16_t ms);
+	uint16_t					ttl(){return _ttl;}
+
+	// Returns true if "code" was decided at "loc" less than the TTL before "now". The decision is returned in
+	// "decision" and the read is counted as absorbed. The entry time is not changed.
+	bool							seen(uint8_t loc, uint32_t code, uint32_t now, uint8_t &decision);
+
+	// Records the decision taken for "code" at "loc".
+	void							put(uint8_t loc, uint32_t code, uint8_t decision, uint32_t now);
+
+	// Forgets every decision (database changed).
+	void							clear();
+
+	// Forgets the entries of "loc" holding "decision" (for example a grant once the door has relocked).
+	void							forget(uint8_t loc, uint8_t decision);
+
+	uint32_t					absorbed(){return _absorbed;}						// Repeated reads absorbed.
+	uint32_t					decided(){return _decided;}							// Decisions recorded.
+
+	// Entry "i" (0 to DCACHE_ENTRIES - 1). Returns false if free or expired at "now".
+	bool							entry(uint8_t i, uint32_t now, DecisionEntry &e);
+
+private:
+	DecisionEntry			_entries[DCACHE_ENTRIES];
+	uint16_t					_ttl;
+	uint32_t					_absorbed;
+	uint32_t					_decided;
+
+	bool							live(uint8_t i, uint32_t now){return _entries[i].loc != 0xFF && now - _entries[i].time < _ttl;}
+};
+
+#endif
@@ -0,0 +1,125 @@
+// EepromMeter.cpp Rev 1.1
+
+#include "EepromMeter.h"
+
+#define EEMETER_MAGIC			0x5A
+
+EepromMeter eeMeter;
+
+EepromMeter::EepromMeter()
+{
+	_op							= EEOP_OTHER;
+	_addr						= 0;
+#if defined EEMETER
+	memset(_count, 0, sizeof(_count));
+	memset(_region, 0, sizeof(_region));
+	_minutes				= 0;
+#endif
+}
+
+uint8_t EepromMeter::read(int idx)
+{
+#if defined EEMETER
+	_count[_op].reads++;
+#endif
+	return EEPROM.read(idx);
+}
+
+void EepromMeter::write(int idx, uint8_t val)
+{
+	if(EEPROM.read(idx) == val)										// Value already stored, save a write cycle.
+	{
+#if defined EEMETER
+		_count[_op].skipped++;
+#endif
+		return;
+	}
+	EEPROM.write(idx, val);
+#if defined EEMETER
+	_count[_op].writes++;
+	if(idx >= 0 && idx < EEMETER_SIZE){_region[idx / EEMETER_REGION]++;}
+#endif
+}
+
+void EepromMeter::commit()
+{
+#if defined EEMETER
+	_count[_op].commits++;
+#endif
+}
+
+uint8_t EepromMeter::op(uint8_t op)
+{
+	uint8_t prev = _op;
+	_op = (op < EEOP_COUNT) ? op : (uint8_t)EEOP_OTHER;
+	return prev;
+}
+
+void EepromMeter::begin(uint16_t addr)
+{
+	_addr = addr;
+#if defined EEMETER
+	if(EEPROM.read(_addr) != EEMETER_MAGIC){return;}	// Nothing saved yet.
+	EEPROM.get(_addr + 1, _minutes);
+	for(uint8_t i = 0; i < EEMETER_REGIONS; i++){EEPROM.get(_addr + 5 + i * 4, _region[i]);}
+#endif
+}
+
+void EepromMeter::tick()
+{
+#if defined EEMETER
+	_minutes++;
+#endif
+}
+
+void EepromMeter::save()
+{
+#if defined EEMETER
+	uint8_t prev = op(EEOP_METER);
+	write(_addr, EEMETER_MAGIC);
+	put(_addr + 1, _minutes);
+	for(uint8_t i = 0; i < EEMETER_REGIONS; i++){put(_addr + 5 + i * 4, _region[i]);}
+	op(prev);
+#endif
+}
+
+void EepromMeter::clear()
+{
+#if defined EEMETER
+	memset(_count, 0, sizeof(_count));
+	memset(_region, 0, sizeof(_region));
+	_minutes = 0;
+	save();
+#endif
+}
+
+const EeCount &EepromMeter::count(uint8_t op)
+{
+#if defined EEMETER
+	return _count[(op < EEOP_COUNT) ? op : (uint8_t)EEOP_OTHER];
+#else
+	static const EeCount none = {0, 0, 0, 0};
+	return none;
+#endif
+}
+
+uint32_t EepromMeter::regionWrites(uint8_t region)
+{
+#if defined EEMETER
+	return (region < EEMETER_REGIONS) ? _region[region] : 0;
+#else
+	return 0;
+#endif
+}
+
+uint32_t EepromMeter::minutes()
+{
+#if defined EEMETER
+	return _minutes;
+#else
+	return 0;
+#endif
+}
+
+EeScope::EeScope(uint8_t op){_prev = eeMeter.op(op);}
+EeScope::~EeScope(){eeMeter.op(_prev);}
@@ -0,0 +1,125 @@
+// EepromMeter.h Rev 1.1
+
+// Rev 1.0	- EEPROM access wrapper used by RfidDb and the controller in place of EEPROM. A write leaving the byte
+//						  unchanged is skipped (no wear). With EEMETER defined, reads, writes, skipped writes and commits
+//						  are counted for each operation type (EEOP) and writes are counted for each EEPROM region. The
+//						  region counts and the time they were collected over are saved in EEPROM by save(), so wear
+//						  can be estimated across reboots.
+// Rev 1.1	- EEMETER is off by default, uncomment it below to count the accesses (about 350 bytes of RAM).
+//						  EEMETER_SIZE follows E2END of the board instead of the Mega2560 size.
+
+#ifndef _EEPROMMETER_H
+#define _EEPROMMETER_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+#include <EEPROM.h>
+
+//#define EEMETER														// Counts the accesses, uses RAM for the counters.
+#define EEMETER_SIZE			(E2END + 1)		// EEPROM size of the board (avr/io.h).
+#define EEMETER_REGIONS		32						// Number of regions counted (128 bytes each).
+#define EEMETER_REGION		(EEMETER_SIZE / EEMETER_REGIONS)
+#define EEMETER_ENDURANCE	100000UL			// Rated write cycles of one EEPROM cell.
+#define EEMETER_BLOCK			(1 + 4 + EEMETER_REGIONS * 4)	// EEPROM bytes used by save().
+
+enum EEOP																		// Operation types, set with EeScope.
+{
+	EEOP_OTHER,
+	EEOP_CONFIG,
+	EEOP_DST,
+	EEOP_LOG,
+	EEOP_DBREAD,
+	EEOP_DBLOOKUP,
+	EEOP_DBINSERT,
+	EEOP_DBREMOVE,
+	EEOP_DBMOVE,
+	EEOP_DBNAME,
+	EEOP_DBATT,
+	EEOP_DBMODIFY,
+	EEOP_DBINIT,
+	EEOP_METER,
+	EEOP_COUNT
+};
+
+struct EeCount
+{
+	uint32_t					reads;
+	uint32_t					writes;
+	uint32_t					skipped;							// Writes of a value already stored.
+	uint32_t					commits;
+};
+
+class EepromMeter
+{
+
+public:
+	EepromMeter();
+
+	uint8_t						read(int idx);
+	void							write(int idx, uint8_t val);				// Skips the write if "val" is already stored.
+
+	template<class T> T &get(int idx, T &t)
+	{
+		uint8_t *p = (uint8_t *)&t;
+		for(uint8_t i = 0; i < sizeof(T); i++){p[i] = read(idx + i);}
+		return t;
+	}
+
+	template<class T> const T &put(int idx, const T &t)
+	{
+		const uint8_t *p = (const uint8_t *)&t;
+		for(uint8_t i = 0; i < sizeof(T); i++){write(idx + i, p[i]);}
+		return t;
+	}
+
+	// Counts a commit (EEPROM.commit on ESP boards).
+	void							commit();
+
+	// Sets the operation type the next accesses are counted for. Returns the previous one.
+	uint8_t						op(uint8_t op);
+
+	// Loads the region counts saved at "addr" (EEMETER_BLOCK bytes).
+	void							begin(uint16_t addr);
+
+	// Counts one minute of run time, call from the 1 minute tick.
+	void							tick();
+
+	// Saves the region counts and run time at the address given to begin().
+	void							save();
+
+	// Clears all counts, saved ones included.
+	void							clear();
+
+	const EeCount &		count(uint8_t op);
+	uint32_t					regionWrites(uint8_t region);
+	uint32_t					minutes();												// Run time the region counts cover.
+
+private:
+	uint8_t						_op;
+	uint16_t					_addr;
+#if defined EEMETER
+	EeCount						_count[EEOP_COUNT];
+	uint32_t					_region[EEMETER_REGIONS];
+	uint32_t					_minutes;
+#endif
+};
+
+// Counts the EEPROM accesses of the enclosing block for operation "op", the previous operation is restored when
+// the block ends.
+class EeScope
+{
+
+public:
+	EeScope(uint8_t op);
+	~EeScope();
+
+private:
+	uint8_t						_prev;
+};
+
+extern EepromMeter					eeMeter;
+
+#endif
@@ -0,0 +1,134 @@
+// EventLink.cpp Rev 1.1
+
+#include "EventLink.h"
+
+#define EVLINK_MAXOUT			64						// Longest event line is 60 bytes.
+
+// Appends member "key" (program memory, with its quotes, comma and colon) and "val" at "p", returns the end.
+static char *member(char *p, const char *key, uint32_t val)
+{
+	for(char c; (c = pgm_read_byte(key)) != '\0'; key++){*p++ = c;}
+	ultoa(val, p, 10);
+	return p + strlen(p);
+}
+
+EventLink::EventLink(AccessEvent *events, uint8_t size, Transport &port) : _port(port)
+{
+	_events = events;
+	_size = size;
+	_handler = NULL;
+	_hold = 0;
+	_head = 0;
+	_acked = 0;
+	_next = 1;
+	_sendTime = 0;
+	_dropped = 0;
+	_resent = 0;
+	_batches = 0;
+	_lineLen = 0;
+	_rewound = false;
+}
+
+bool EventLink::push(uint8_t type, uint8_t loc, uint32_t key, bool typed)
+{
+	if(_head - _acked >= _size){_dropped++; return false;}
+	_head++;
+	AccessEvent &e = _events[_head % _size];
+	e.ms = millis();
+	e.key = key;
+	e.type = type;
+	e.loc = loc;
+	e.typed = typed;
+	return true;
+}
+
+void EventLink::service()
+{
+	receive();
+	if(!_port.connected()){return;}
+	if(_next > _acked + 1 && millis() - _sendTime >= EVLINK_RETRY)	// Not acknowledged, send again.
+	{
+		_resent += _next - _acked - 1;
+		_next = _acked + 1;
+	}
+	send();
+}
+
+// receive Method (PRIVATE)---------------------------------------------------------------------------------------
+// Assembles the lines of the collector. Reads at most one line worth of bytes per call.
+void EventLink::receive()
+{
+	uint8_t n = 0;
+
+	while(_port.available() && n++ < EVLINK_LINE)
+	{
+		char c = _port.read();
+		if(c != '\n' && c != '\r')
+		{
+			if(_lineLen < EVLINK_LINE - 1){_line[_lineLen++] = c;}
+			continue;
+		}
+		if(_lineLen == 0){continue;}
+		_line[_lineLen] = '\0';
+		_lineLen = 0;
+		if(strncmp(_line, "{\"ack\":", 7) == 0)
+		{
+			uint32_t ack = strtoul(_line + 7, NULL, 10);
+			if(ack > _acked && ack <= _head)
+			{
+				_acked = ack;
+				if(_next <= ack){_next = ack + 1;}
+				_rewound = false;
+			}
+			else if(ack == _acked && _next > _acked + 1 && !_rewound)	// Event lost, send again without waiting.
+			{
+				_resent += _next - _acked - 1;
+				_next = _acked + 1;
+				_rewound = true;
+			}
+		}
+		else if(_line[0] == '{' && _handler){_handler(_line);}
+	}
+}
+
+// send Method (PRIVATE)------------------------------------------------------------------------------------------
+// Sends a batch of the waiting events once the oldest has been held long enough or a full batch is waiting.
+void EventLink::send()
+{
+	char		buf[EVLINK_MAXOUT];
+	uint8_t	n = 0;
+
+	if(_next > _head){return;}
+	if(_head - _next + 1 < EVLINK_BATCH && millis() - _events[_next % _size].ms < _hold){return;}
+	while(_next <= _head && n < EVLINK_BATCH)
+	{
+		uint8_t len = format(_next, buf);
+		if(_port.availableForWrite() < len){break;}
+		if(n == 0){_port.beginBatch();}
+		_port.write((const uint8_t *)buf, len);
+		_next++;
+		n++;
+	}
+	if(n == 0){return;}
+	_port.endBatch();
+	_sendTime = millis();
+	_batches++;
+}
+
+// format Method (PRIVATE)----------------------------------------------------------------------------------------
+// Writes the line of event "seq" in "buf", returns its length.
+uint8_t EventLink::format(uint32_t seq, char *buf)
+{
+	AccessEvent	&e = _events[seq % _size];
+	uint32_t		age = millis() - e.ms;
+	char				*p = buf;
+
+	p = member(p, PSTR("{\"ev\":"), seq);
+	p = member(p, PSTR(",\"age\":"), age < 65535 ? age : 65535);
+	p = member(p, PSTR(",\"ty\":"), e.type);
+	p = member(p, PSTR(",\"loc\":"), e.loc);
+	p = member(p, e.typed ? PSTR(",\"u\":") : PSTR(",\"k\":"), e.key);
+	*p++ = '}';
+	*p++ = '\n';
+	return p - buf;
+}
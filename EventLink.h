@@ -0,0 +1,101 @@
+// EventLink.h Rev 1.1
+
+// Rev 1.0	- Sends access events to a host collector through a Transport and receives the collector's requests.
+//						  Events are kept in a RAM ring until the collector acknowledges them. Each event is one line,
+//						  for example: {"ev":42,"age":3,"ty":1,"loc":0,"k":4660}
+//						  "ev" is the sequence number (from 1, without gaps), "age" the ms since the event (65535 at
+//						  most), so the collector needs no clock of the controller, "ty" the event type (EV_xxx), "loc"
+//						  the keypad and "k" the tag ID or password entered. A line is 60 bytes at most and fits the AVR
+//						  UART transmit buffer. Up to EVLINK_BATCH waiting events are sent as one batch once the oldest
+//						  one has waited "hold" ms, and only while the transport has room for the whole line, so
+//						  service() never waits.
+//						- The collector answers with {"ack":N}, N being the last event received in order. Events not
+//						  acknowledged within EVLINK_RETRY ms are sent again from the first one (go-back-N), so events
+//						  lost on a datagram transport are sent again. A collector receiving an event after a missing
+//						  one repeats its last acknowledgement, the events are then sent again at once (once until the
+//						  next new acknowledgement). An event pushed while the ring is full is dropped and counted, it
+//						  gets no sequence number.
+//						- Other lines starting with '{' are machine protocol requests, passed to the frame handler.
+// Rev 1.1	- An entry typed at a keypad (password or PIN) is never sent. Its event carries "u", the user number
+//						  (position + 1, 0 if no user matched), instead of "k": {"ev":43,"age":0,"ty":1,"loc":2,"u":8}
+
+#ifndef _EVENTLINK_H
+#define _EVENTLINK_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+#include "Transport.h"
+
+#define EVLINK_BATCH			8							// Most events sent in one batch.
+#define EVLINK_RETRY			500						// ms without acknowledgement before events are sent again.
+#define EVLINK_LINE				80						// Longest line received from the collector (including null).
+
+#define EV_GRANTED				1							// Door unlocked (or garage door operated).
+#define EV_UNKNOWN				2							// Tag ID or password not in the database.
+#define EV_MISMATCH				3							// Second entry is not the other one of the same user.
+#define EV_NOPERM					4							// User has no permission for the door of this keypad.
+#define EV_SCHEDULE				5							// Outside the hours of the user's schedule profile.
+#define EV_LOCKOUT				6							// Keypad locked out after too many retries.
+
+struct AccessEvent
+{
+	uint32_t					ms;															// millis() of the event.
+	uint32_t					key;														// Tag ID, or user number of a typed entry.
+	uint8_t						type;
+	uint8_t						loc;														// Keypad location.
+	bool							typed;													// Entered on the keypad, "key" is the user number.
+};
+
+class EventLink
+{
+
+public:
+	// Link on "port" keeping up to "size" events in "events", which must stay allocated.
+	EventLink(AccessEvent *events, uint8_t size, Transport &port);
+
+	// Adds an event. "key" is the tag ID read or, if "typed", the user number (0 = none) of the entry typed at the
+	// keypad, which itself is never sent. Returns false (and counts it as dropped) if the ring is full.
+	bool							push(uint8_t type, uint8_t loc, uint32_t key, bool typed = false);
+
+	// Sends waiting events and handles the lines of the collector. Call from the main loop.
+	void							service();
+
+	// Lines starting with '{' other than acknowledgements are passed to "handler".
+	void							setFrameHandler(void (*handler)(char *line)){_handler = handler;}
+
+	// Time the oldest waiting event is held for more events to batch with it (0 = send at once).
+	void							hold(uint16_t ms){_hold = ms;}
+
+	uint32_t					head(){return _head;}									// Last event pushed.
+	uint32_t					acked(){return _acked;}								// Last event acknowledged.
+	uint32_t					dropped(){return _dropped;}
+	uint32_t					resent(){return _resent;}							// Events sent again.
+	uint32_t					batches(){return _batches;}
+
+private:
+	AccessEvent *			_events;
+	uint8_t						_size;
+	Transport &				_port;
+	void							(*_handler)(char *line);
+	uint16_t					_hold;
+
+	uint32_t					_head;
+	uint32_t					_acked;
+	uint32_t					_next;																// Next event to send.
+	uint32_t					_sendTime;														// Last batch sent.
+	uint32_t					_dropped;
+	uint32_t					_resent;
+	uint32_t					_batches;
+	char							_line[EVLINK_LINE];
+	uint8_t						_lineLen;
+	bool							_rewound;															// Sent again on a repeated acknowledgement.
+
+	void							receive();
+	void							send();
+	uint8_t						format(uint32_t seq, char *buf);
+};
+
+#endif
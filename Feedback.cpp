@@ -0,0 +1,126 @@
+// Feedback.cpp Rev 1.0
+
+#include "Feedback.h"
+
+Feedback::Feedback()
+{
+	for(uint8_t i = 0; i < FB_CHANNELS; i++)
+	{
+		_out[i] = NULL;
+		_tonePin[i] = 0xFF;
+		_pat[i] = NULL;
+	}
+	_active = 0;
+}
+
+void Feedback::setPin(uint8_t chan, uint8_t pin, uint8_t on)
+{
+	if(chan >= FB_CHANNELS){return;}
+	_out[chan] = portOutputRegister(digitalPinToPort(pin));
+	_mask[chan] = digitalPinToBitMask(pin);
+	_on[chan] = on ? _mask[chan] : 0;
+	pinMode(pin, OUTPUT);
+	output(chan, false);
+}
+
+void Feedback::setTone(uint8_t chan, uint8_t pin)
+{
+	if(chan >= FB_CHANNELS){return;}
+	_tonePin[chan] = pin;
+	noTone(pin);
+}
+
+void Feedback::play(uint8_t chan, const uint8_t *pattern)
+{
+	uint8_t oldSREG = SREG;
+
+	if(chan >= FB_CHANNELS){return;}
+	noInterrupts();
+	_start[chan] = pattern;
+	_pat[chan] = pattern;
+	_wait[chan] = 1;
+	_repeat[chan] = 0;
+	_active |= (1 << chan);
+	SREG = oldSREG;
+}
+
+bool Feedback::busy(uint8_t chan)
+{
+	uint8_t oldSREG = SREG;
+	bool		playing;
+
+	if(chan >= FB_CHANNELS){return false;}
+	noInterrupts();
+	playing = _pat[chan] != NULL;
+	SREG = oldSREG;
+	return playing;
+}
+
+void Feedback::stop(uint8_t chan)
+{
+	uint8_t oldSREG = SREG;
+
+	if(chan >= FB_CHANNELS){return;}
+	noInterrupts();
+	_pat[chan] = NULL;
+	_active &= ~(1 << chan);
+	output(chan, false);
+	SREG = oldSREG;
+}
+
+void Feedback::tick()
+{
+	if(!_active){return;}
+	for(uint8_t i = 0; i < FB_CHANNELS; i++)
+	{
+		const uint8_t *p = _pat[i];
+
+		if(p == NULL || --_wait[i]){continue;}
+		for(uint8_t steps = 0; _wait[i] == 0; steps++)											// Runs opcodes up to the next wait.
+		{
+			uint8_t op = (steps < FB_STEPS) ? pgm_read_byte(p++) : FB_OP_END;		// A pattern which never waits ends.
+
+			if(op == FB_OP_ON || op == FB_OP_OFF)
+			{
+				output(i, op == FB_OP_ON);
+				_wait[i] = pgm_read_byte(p++);
+			}
+			else if(op == FB_OP_TONE)
+			{
+				uint16_t hz = pgm_read_byte(p) | (pgm_read_byte(p + 1) << 8);
+				if(_tonePin[i] != 0xFF){tone(_tonePin[i], hz);}
+				_wait[i] = pgm_read_byte(p + 2);
+				p += 3;
+			}
+			else if(op == FB_OP_REPEAT)
+			{
+				uint8_t n = pgm_read_byte(p++);
+				if(_repeat[i] < n){_repeat[i]++; p = _start[i];}
+				else{_repeat[i] = 0;}
+			}
+			else if(op == FB_OP_LOOP){p = _start[i];}
+			else																											// FB_END, FB_HOLD or unknown.
+			{
+				if(op != FB_OP_HOLD){output(i, false);}
+				p = NULL;
+				_active &= ~(1 << i);
+				break;
+			}
+		}
+		_pat[i] = p;
+	}
+}
+
+// output Method (PRIVATE)----------------------------------------------------------------------------------------
+// Sets channel "chan" ON or OFF. A speaker channel is silenced when OFF; ON is only played by FB_TONE.
+void Feedback::output(uint8_t chan, bool on)
+{
+	if(_tonePin[chan] != 0xFF)
+	{
+		if(!on){noTone(_tonePin[chan]);}
+		return;
+	}
+	if(_out[chan] == NULL){return;}
+	if(on == (_on[chan] != 0)){*_out[chan] |= _mask[chan];}
+	else{*_out[chan] &= ~_mask[chan];}
+}
@@ -0,0 +1,79 @@
+// Feedback.h Rev 1.0
+
+// Rev 1.0	- Plays feedback patterns (beeps, blinks, tones) on up to FB_CHANNELS outputs at once from a timer ISR,
+//						  so a beep or a melody never holds up the controller. A channel is an output pin with its ON
+//						  level (beeper, LED, bell relay) or a speaker pin driven with tone().
+//						- Patterns are byte scripts in program memory built with the FB_xxx macros below, durations
+//						  in ticks of the timer calling tick(). A pattern ends with FB_END (output back to OFF),
+//						  FB_HOLD (output left as it is) or FB_LOOP (played again until stop()).
+//						- play() replaces what the channel is playing. Channels are independent: a pattern on one
+//						  keypad's beeper does not delay one on another keypad or on the speaker.
+
+#ifndef _FEEDBACK_H
+#define _FEEDBACK_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#define FB_CHANNELS				16						// Most channels.
+#define FB_STEPS					16						// Most opcodes run by a channel in one tick.
+
+// PATTERN OPCODES ------------------------------------------------------------------------------------------------
+#define FB_OP_END					0
+#define FB_OP_ON					1
+#define FB_OP_OFF					2
+#define FB_OP_TONE				3
+#define FB_OP_REPEAT			4
+#define FB_OP_LOOP				5
+#define FB_OP_HOLD				6
+
+#define FB_END						FB_OP_END																				// Ends, output OFF.
+#define FB_ON(t)					FB_OP_ON, (t)																		// Output ON for "t" ticks.
+#define FB_OFF(t)					FB_OP_OFF, (t)																	// Output OFF (speaker silent) for "t" ticks.
+#define FB_TONE(hz, t)		FB_OP_TONE, (uint8_t)(hz), (uint8_t)((hz) >> 8), (t)		// Speaker tone "hz" for "t" ticks.
+#define FB_REPEAT(n)			FB_OP_REPEAT, (n)																// Plays from the start "n" more times.
+#define FB_LOOP						FB_OP_LOOP																			// Plays from the start until stop().
+#define FB_HOLD						FB_OP_HOLD																			// Ends, output left as it is.
+
+class Feedback
+{
+
+public:
+	Feedback();
+
+	// Channel "chan" drives "pin", which is ON at level "on" (HIGH or LOW). Sets the pin as an OUTPUT, OFF.
+	void							setPin(uint8_t chan, uint8_t pin, uint8_t on);
+
+	// Channel "chan" drives a speaker on "pin" with tone().
+	void							setTone(uint8_t chan, uint8_t pin);
+
+	// Starts pattern "pattern" (program memory) on channel "chan" at the next tick.
+	void							play(uint8_t chan, const uint8_t *pattern);
+
+	// Stops channel "chan", output OFF.
+	void							stop(uint8_t chan);
+
+	// True while channel "chan" plays a pattern (not after FB_HOLD).
+	bool							busy(uint8_t chan);
+
+	// Runs the channels. Call from a timer ISR.
+	void							tick();
+
+private:
+	volatile uint8_t *	_out[FB_CHANNELS];
+	uint8_t						_mask[FB_CHANNELS];
+	uint8_t						_on[FB_CHANNELS];														// Output bits at ON (mask or 0).
+	uint8_t						_tonePin[FB_CHANNELS];												// 0xFF if not a speaker.
+	const uint8_t *		_start[FB_CHANNELS];
+	const uint8_t * volatile	_pat[FB_CHANNELS];											// Next opcode, NULL when idle.
+	uint8_t						_wait[FB_CHANNELS];														// Ticks left of the current step.
+	uint8_t						_repeat[FB_CHANNELS];
+	uint16_t					_active;																		// One bit per channel playing.
+
+	void							output(uint8_t chan, bool on);
+};
+
+#endif
@@ -0,0 +1,132 @@
+// InputEngine.cpp Rev 1.0
+
+#include "InputEngine.h"
+
+InputEngine::InputEngine(const uint8_t *pins, uint8_t count, uint8_t tickHz)
+{
+	_pins = pins;
+	_count = (count < INPUT_CHANNELS) ? count : INPUT_CHANNELS;
+	_tickHz = tickHz;
+	_ports = 0;
+	_allMask = 0;
+	_pollMask = 0;
+	_state = 0;
+	_cnt0 = 0;
+	_cnt1 = 0;
+	_wake = false;
+	_longMask = 0;
+	_longDone = 0;
+	_head = 0;
+	_tail = 0;
+	_dropped = 0;
+}
+
+void InputEngine::begin()
+{
+	for(uint8_t i = 0; i < _count; i++)
+	{
+		volatile uint8_t *reg = portInputRegister(digitalPinToPort(_pins[i]));
+		uint8_t p = 0;
+
+		pinMode(_pins[i], INPUT_PULLUP);
+		while(p < _ports && _port[p] != reg){p++;}										// Channels of one port share a read.
+		if(p == INPUT_PORTS){continue;}																	// Too many ports, channel not used.
+		if(p == _ports){_port[_ports++] = reg; _portChans[p] = 0;}
+		_portChans[p] |= (1 << i);
+		_chPort[i] = p;
+		_chMask[i] = digitalPinToBitMask(_pins[i]);
+		_allMask |= (1 << i);
+		_held[i] = 0;
+
+		volatile uint8_t *pcmsk = digitalPinToPCMSK(_pins[i]);
+		if(pcmsk == NULL){_pollMask |= (1 << i); continue;}
+		*pcmsk |= (1 << digitalPinToPCMSKbit(_pins[i]));
+		PCICR |= (1 << digitalPinToPCICRbit(_pins[i]));
+	}
+	_state = sample(_allMask);
+}
+
+void InputEngine::longPress(uint8_t chan, uint16_t ms)
+{
+	if(chan >= _count){return;}
+	_longTicks[chan] = ((uint32_t)ms * _tickHz + 999) / 1000;
+	_longMask |= (1 << chan);
+}
+
+void InputEngine::tick()
+{
+	uint8_t holding = _longMask & _state & ~_longDone;
+	uint8_t mask = (_wake || _cnt0 || _cnt1) ? _allMask : _pollMask;				// Settled PCINT channels are not read.
+
+	if(mask == 0 && holding == 0){return;}
+
+	uint8_t now = (sample(mask) & mask) | (_state & ~mask);
+	uint8_t delta = now ^ _state;
+
+	_cnt1 = (_cnt1 ^ _cnt0) & delta;																	// Counts 1, 2, 3, 0 while "delta" stays set.
+	_cnt0 = ~_cnt0 & delta;
+	uint8_t toggle = delta & ~(_cnt0 | _cnt1);
+	_state ^= toggle;
+	if(!(_cnt0 | _cnt1)){_wake = false;}
+
+	for(uint8_t i = 0, bit = 1; i < _count; i++, bit <<= 1)
+	{
+		if(toggle & bit)
+		{
+			if(_state & bit)
+			{
+				push(i, IN_PRESS);
+				_held[i] = 0;
+			}
+			else
+			{
+				push(i, IN_RELEASE);
+				if((_longMask & ~_longDone) & bit){push(i, IN_CLICK);}
+				_longDone &= ~bit;
+			}
+		}
+		else if((holding & bit) && ++_held[i] >= _longTicks[i])
+		{
+			push(i, IN_LONG);
+			_longDone |= bit;
+		}
+	}
+}
+
+bool InputEngine::next(InputEvent &ev)
+{
+	if(_head == _tail){return false;}
+	uint8_t e = _queue[_tail];
+	ev.chan = e & 0x0F;
+	ev.type = e >> 4;
+	_tail = (_tail + 1) & (INPUT_QUEUE - 1);
+	return true;
+}
+
+// sample Method (PRIVATE)----------------------------------------------------------------------------------------
+// Reads each port holding a channel of "mask" once. Returns 1 for channels reading LOW.
+uint8_t InputEngine::sample(uint8_t mask)
+{
+	uint8_t val[INPUT_PORTS];
+	uint8_t now = 0;
+
+	for(uint8_t p = 0; p < _ports; p++)
+	{
+		if(_portChans[p] & mask){val[p] = *_port[p];}
+	}
+	for(uint8_t i = 0; i < _count; i++)
+	{
+		if((mask & (1 << i)) && !(val[_chPort[i]] & _chMask[i])){now |= (1 << i);}
+	}
+	return now;
+}
+
+// push Method (PRIVATE)------------------------------------------------------------------------------------------
+void InputEngine::push(uint8_t chan, uint8_t type)
+{
+	uint8_t head = (_head + 1) & (INPUT_QUEUE - 1);
+
+	if(head == _tail){_dropped++; return;}
+	_queue[_head] = (type << 4) | chan;
+	_head = head;
+}
@@ -0,0 +1,98 @@
+// InputEngine.h Rev 1.0
+
+// Rev 1.0	- Push buttons and switches (up to INPUT_CHANNELS, active LOW with pull-ups) read a whole port at a time
+//						  and debounced together with a vertical counter: each channel has a 2 bit counter held in two
+//						  bytes, so all channels are debounced by a few bitwise operations. A channel takes its new
+//						  level after INPUT_SAMPLES ticks reading the same.
+//						- Channels on a pin change interrupt port (PORTK, PCINT2 on the Mega) are only read after wake()
+//						  reports an edge, until they are settled again. Other channels are read at each tick. With
+//						  nothing changing and no button held, tick() returns at once.
+//						- Pressed, released and long press events are queued and taken from the main loop with next(),
+//						  which is a single compare while the queue is empty. A channel with a long press time also
+//						  gets a click event when it is released before that time.
+//						- tick() is called from a timer ISR and wake() from the pin change ISR, both in the sketch.
+
+#ifndef _INPUTENGINE_H
+#define _INPUTENGINE_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#define INPUT_CHANNELS		8							// Most channels (one bit each).
+#define INPUT_PORTS				8							// Most ports the channels are on (one each at worst).
+#define INPUT_QUEUE				8							// Events queued (power of 2).
+#define INPUT_SAMPLES			4							// Ticks a channel must read the same (vertical counter).
+
+#define IN_PRESS					1							// Channel went LOW.
+#define IN_RELEASE				2							// Channel went HIGH.
+#define IN_LONG						3							// Held for the long press time.
+#define IN_CLICK					4							// Released before the long press time.
+
+struct InputEvent
+{
+	uint8_t						chan;
+	uint8_t						type;														// IN_xxx
+};
+
+class InputEngine
+{
+
+public:
+	// Channels on "pins", numbered in the order of the array. "tickHz" is the rate tick() is called at.
+	InputEngine(const uint8_t *pins, uint8_t count, uint8_t tickHz);
+
+	// Sets the pull-ups, reads the channels once and enables the pin change interrupts of their ports.
+	void							begin();
+
+	// Channel "chan" sends IN_LONG once held "ms" and IN_CLICK when released sooner.
+	void							longPress(uint8_t chan, uint16_t ms);
+
+	// Reads and debounces the channels, queues the events. Call from a timer ISR.
+	void							tick();
+
+	// A channel on a pin change interrupt port changed. Call from the pin change ISR.
+	void							wake(){_wake = true;}
+
+	// Takes the next event. Returns false if there is none.
+	bool							next(InputEvent &ev);
+
+	// Debounced state of channel "chan", true while LOW (pressed, switch closed).
+	bool							pressed(uint8_t chan){return (_state >> chan) & 1;}
+
+	uint8_t						dropped(){return _dropped;}							// Events lost, queue full.
+
+private:
+	const uint8_t *		_pins;
+	uint8_t						_count;
+	uint8_t						_tickHz;
+	volatile uint8_t *	_port[INPUT_PORTS];
+	uint8_t						_portChans[INPUT_PORTS];											// Channels on each port.
+	uint8_t						_ports;
+	uint8_t						_chPort[INPUT_CHANNELS];
+	uint8_t						_chMask[INPUT_CHANNELS];
+	uint8_t						_allMask;
+	uint8_t						_pollMask;														// Channels without pin change interrupt.
+
+	volatile uint8_t	_state;																// Debounced, 1 = pressed.
+	uint8_t						_cnt0;																// Vertical counter, bit 0.
+	uint8_t						_cnt1;																// Vertical counter, bit 1.
+	volatile bool			_wake;
+
+	uint8_t						_longMask;
+	uint8_t						_longDone;														// Long press sent for this press.
+	uint16_t					_longTicks[INPUT_CHANNELS];
+	uint16_t					_held[INPUT_CHANNELS];
+
+	uint8_t						_queue[INPUT_QUEUE];
+	volatile uint8_t	_head;
+	volatile uint8_t	_tail;
+	uint8_t						_dropped;
+
+	uint8_t						sample(uint8_t mask);
+	void							push(uint8_t chan, uint8_t type);
+};
+
+#endif
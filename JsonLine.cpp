@@ -0,0 +1,147 @@
+// JsonLine.cpp Rev 1.1
+
+#include "JsonLine.h"
+
+static char *skipWs(char *p)
+{
+	while(*p == ' ' || *p == '\t'){p++;}
+	return p;
+}
+
+JsonLine::JsonLine()
+{
+	_count					= 0;
+	_out						= &Serial;
+}
+
+bool JsonLine::parse(char *line)
+{
+	char *p = skipWs(line);
+	char sep;
+
+	_count = 0;
+	if(*p++ != '{'){return false;}
+	p = skipWs(p);
+	if(*p == '}'){return true;}										// Empty object.
+	while(_count < JSON_MAXKEYS)
+	{
+		if(*p != '"'){return false;}
+		_keys[_count] = ++p;
+		while(*p != '"'){if(*p++ == '\0'){return false;}}
+		*p = '\0';
+		p = skipWs(p + 1);
+		if(*p++ != ':'){return false;}
+		_vals[_count] = value(skipWs(p), &p, &sep);
+		if(_vals[_count] == NULL){return false;}
+		_count++;
+		p = skipWs(p);
+		if(sep == '}'){return true;}
+	}
+	return false;																	// Too many members.
+}
+
+// Value Method (PRIVATE)---------------------------------------------------------------------------------------------
+// Terminates the value starting at "p" in place. The separator following the value (',' or '}') is returned in
+// "sep" and "end" is set to the character after it. Returns NULL if the value is malformed.
+char *JsonLine::value(char *p, char **end, char *sep)
+{
+	char *val = p;
+	char *term;
+
+	if(*p == '"')																	// String, only \" and \\ escapes are supported.
+	{
+		char *dst = ++val;
+		for(p = val; *p != '"'; p++)
+		{
+			if(*p == '\0'){return NULL;}
+			if(*p == '\\' && p[1] != '\0'){p++;}
+			*dst++ = *p;
+		}
+		term = dst;
+		p++;
+	}
+	else																					// Number, true or false.
+	{
+		while(*p != ',' && *p != '}' && *p != ' ' && *p != '\t')
+		{
+			if(*p == '\0'){return NULL;}
+			p++;
+		}
+		if(p == val){return NULL;}
+		term = p;
+	}
+	p = skipWs(p);
+	if(*p != ',' && *p != '}'){return NULL;}
+	*sep = *p;
+	*end = p + 1;
+	*term = '\0';																// Separator has been saved so it may be overwritten.
+	return val;
+}
+
+// Find Method (PRIVATE)----------------------------------------------------------------------------------------------
+// Returns the index of member "key" or -1 if it is not present.
+int8_t JsonLine::find(const __FlashStringHelper *key)
+{
+	for(uint8_t i = 0; i < _count; i++)
+	{
+		if(strcmp_P(_keys[i], (PGM_P)key) == 0){return i;}
+	}
+	return -1;
+}
+
+const char *JsonLine::str(const __FlashStringHelper *key)
+{
+	int8_t i = find(key);
+	return (i < 0) ? NULL : _vals[i];
+}
+
+bool JsonLine::has(const __FlashStringHelper *key){return find(key) >= 0;}
+
+bool JsonLine::num(const __FlashStringHelper *key, uint32_t &val)
+{
+	const char	*p = str(key);
+	char				*end;
+
+	if(p == NULL || *p < '0' || *p > '9'){return false;}
+	val = strtoul(p, &end, 10);
+	return *end == '\0';
+}
+
+void JsonLine::begin(uint32_t id)
+{
+	_out->print(F("{\"id\":"));
+	_out->print(id);
+}
+
+// AddKey Method (PRIVATE)--------------------------------------------------------------------------------------------
+void JsonLine::addKey(const __FlashStringHelper *key)
+{
+	_out->print(F(",\""));
+	_out->print(key);
+	_out->print(F("\":"));
+}
+
+void JsonLine::add(const __FlashStringHelper *key, uint32_t val)
+{
+	addKey(key);
+	_out->print(val);
+}
+
+void JsonLine::add(const __FlashStringHelper *key, const char *val)
+{
+	addKey(key);
+	_out->print('"');
+	for(; *val != '\0'; val++)
+	{
+		if(*val == '"' || *val == '\\'){_out->print('\\');}
+		_out->print(*val);
+	}
+	_out->print('"');
+}
+
+void JsonLine::end(uint8_t err)
+{
+	_out->print(F(",\"err\":"));
+	_out->print(err);
+	_out->println(F("}"));
+}
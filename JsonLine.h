@@ -0,0 +1,75 @@
+// JsonLine.h Rev 1.3
+
+// Rev 1.3	- On a UART the host keeps one request in flight: it waits for the answer before sending the next
+//						  request, and a request line holds at most JSON_MAXLINE bytes with its line end. The AVR receive
+//						  buffer (64 bytes, 63 used) then never overflows while the controller is busy, an "add" writes
+//						  EEPROM for up to ~70 ms while 115200 baud fills the buffer in ~5.5 ms. Requests received on a
+//						  link with its own buffering (EventLink) are not limited.
+// Rev 1.2	- The members parsed before an error stay available, so the reply to a malformed request echoes its
+//						  id if the id came before the error.
+// Rev 1.1	- Replies are printed to the port set with output() (Serial by default), so requests received from an
+//						  event collector (EventLink) are answered on its transport.
+// Rev 1.0	- Machine protocol for the serial console. A request is one line holding a flat JSON object,
+//						  for example: {"id":12,"op":"add","tag":4660,"name":"JOHN","att":65}
+//						  The line is parsed in place (no copies, no heap) and every request is answered with
+//						  exactly one line echoing the request id and an error code, for example:
+//						  {"id":12,"pos":3,"err":0}
+//						- Requests do not wait on each other, so a host tool may send many requests without waiting
+//						  for the answers and match them up by id. The host should keep no more bytes in flight
+//						  than the UART receive buffer holds (64 bytes on AVR), see Rev 1.3.
+
+#ifndef _JSONLINE_H
+#define _JSONLINE_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#define JSON_MAXKEYS			8							// Maximum number of members in a request.
+#define JSON_MAXLINE			63						// Longest request on a UART, line end included (AVR receive buffer - 1).
+
+class JsonLine
+{
+
+public:
+	JsonLine();
+
+	// Parses a flat JSON object (string, number and true/false members only) held in "line".
+	// The line is modified in place and must stay valid until the request has been answered.
+	// Returns false if the line is not a valid object, the members before the error can still be read.
+	bool							parse(char *line);
+
+	// Returns the value of member "key" as a string or NULL if the member is not present.
+	const char *			str(const __FlashStringHelper *key);
+
+	// Converts the value of member "key" to a number. Returns false if the member is not
+	// present or is not a number.
+	bool							num(const __FlashStringHelper *key, uint32_t &val);
+
+	// Returns true if member "key" is present.
+	bool							has(const __FlashStringHelper *key);
+
+	// Starts the reply to request "id". Members are then added with add() and the reply is
+	// closed with end(), so each request is answered with exactly one line.
+	void							begin(uint32_t id);
+	void							add(const __FlashStringHelper *key, uint32_t val);
+	void							add(const __FlashStringHelper *key, const char *val);
+	void							end(uint8_t err);
+
+	// Sends the replies to "out" instead of Serial.
+	void							output(Print &out){_out = &out;}
+
+private:
+	char *						value(char *p, char **end, char *sep);
+	int8_t						find(const __FlashStringHelper *key);
+	void							addKey(const __FlashStringHelper *key);
+
+	char *						_keys[JSON_MAXKEYS];
+	char *						_vals[JSON_MAXKEYS];
+	uint8_t						_count;
+	Print *						_out;
+};
+
+#endif
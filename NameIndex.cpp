@@ -0,0 +1,89 @@
+// NameIndex.cpp Rev 1.0
+
+#include "NameIndex.h"
+
+NameIndex::NameIndex(NameKey *keys, uint8_t size)
+{
+	_keys = keys;
+	_size = size;
+	_count = 0;
+}
+
+void NameIndex::clear(){_count = 0;}
+
+void NameIndex::set(uint8_t slot, const char *name)
+{
+	remove(slot);
+	if(name[0]){insert(keyOf(name), slot);}
+}
+
+void NameIndex::remove(uint8_t slot)
+{
+	for(uint8_t i = 0; i < _count; i++)
+	{
+		if(_keys[i].slot == slot)
+		{
+			_count--;
+			memmove(&_keys[i], &_keys[i + 1], (_count - i) * sizeof(NameKey));
+			return;
+		}
+	}
+}
+
+void NameIndex::move(uint8_t from, uint8_t to)
+{
+	if(from == to){return;}
+	remove(to);
+	for(uint8_t i = 0; i < _count; i++)
+	{
+		if(_keys[i].slot == from){_keys[i].slot = to; return;}	// Same name, the order is unchanged.
+	}
+}
+
+uint8_t NameIndex::find(const char *prefix, uint8_t &first)
+{
+	uint32_t key = keyOf(prefix);
+	uint32_t end;
+
+	if(!prefix[0]){first = 0; return _count;}
+	if(!prefix[1]){end = key + 0x100;}										// Every second letter.
+	else{end = key + 1;}
+	first = lowerBound(key);
+	return lowerBound(end) - first;
+}
+
+// keyOf Method (PRIVATE)-----------------------------------------------------------------------------------------
+uint16_t NameIndex::keyOf(const char *name)
+{
+	if(!name[0]){return 0;}
+	return ((uint16_t)toupper((uint8_t)name[0]) << 8) | (uint8_t)toupper((uint8_t)name[1]);
+}
+
+// insert Method (PRIVATE)----------------------------------------------------------------------------------------
+// Adds an entry after the entries of the same key. Nothing is added when the index is full.
+void NameIndex::insert(uint16_t key, uint8_t slot)
+{
+	if(_count >= _size){return;}
+	uint8_t i = lowerBound((uint32_t)key + 1);
+
+	memmove(&_keys[i + 1], &_keys[i], (_count - i) * sizeof(NameKey));
+	_keys[i].key = key;
+	_keys[i].slot = slot;
+	_count++;
+}
+
+// lowerBound Method (PRIVATE)------------------------------------------------------------------------------------
+// Binary search: index of the first entry whose key is not below "key".
+uint8_t NameIndex::lowerBound(uint32_t key)
+{
+	uint8_t lo = 0;
+	uint8_t hi = _count;
+
+	while(lo < hi)
+	{
+		uint8_t mid = (lo + hi) / 2;
+		if(_keys[mid].key < key){lo = mid + 1;}
+		else{hi = mid;}
+	}
+	return lo;
+}
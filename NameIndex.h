@@ -0,0 +1,61 @@
+// NameIndex.h Rev 1.0
+
+// Rev 1.0	- Sorted RAM index of the user names held in the RFID database, for a search by name without reading
+//						  every record. An entry is the first two letters of the name (upper case) and the user position
+//						  (slot): 3 bytes per user, in an array given by the caller. The database keeps the index up to
+//						  date when a name is written, cleared or moved.
+//						- find() returns the range of entries starting with a prefix in O(log N). Prefixes longer than two
+//						  letters give the candidates, the caller compares the rest of the name.
+
+#ifndef _NAMEINDEX_H
+#define _NAMEINDEX_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+struct NameKey																			// One index entry.
+{
+	uint16_t					key;														// First letter << 8 | second letter.
+	uint8_t						slot;
+};
+
+class NameIndex
+{
+
+public:
+	// Index of at most "size" names in "keys", which must stay allocated.
+	NameIndex(NameKey *keys, uint8_t size);
+
+	// Removes every entry.
+	void							clear();
+
+	// Sets the name of "slot". An empty name removes the slot from the index.
+	void							set(uint8_t slot, const char *name);
+
+	// Removes "slot" from the index.
+	void							remove(uint8_t slot);
+
+	// The name of slot "from" now belongs to slot "to" (user moved), the old entry of "to" is removed.
+	void							move(uint8_t from, uint8_t to);
+
+	// Returns the number of entries whose name starts with the first two letters of "prefix" (case is ignored),
+	// the first one in "first". An empty prefix matches every entry.
+	uint8_t						find(const char *prefix, uint8_t &first);
+
+	uint8_t						count(){return _count;}
+	uint8_t						slot(uint8_t i){return _keys[i].slot;}	// Slot of entry "i" (sorted by name).
+
+private:
+	NameKey *					_keys;
+	uint8_t						_size;
+	uint8_t						_count;
+
+	uint16_t					keyOf(const char *name);
+	void							insert(uint16_t key, uint8_t slot);
+	uint8_t						lowerBound(uint32_t key);
+};
+
+#endif
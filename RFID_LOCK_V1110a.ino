@@ -69,12 +69,23 @@ rkp or RKP      Reads/displays the keypad data.
 rdi or RKP      Reads/displays the Database user id for a given user number.
                 If user 999 is entered,all user id and names are displayed.
 rdn or RDN      Reads/displays the user name for a give id in the database.
+fnd or FND      Displays the users whose name starts with the letters given (case is ignored).
 rle or RLE      Reads/display the last error code recorded.
 rep or REP      Displays all internal EEPROM contents.
+rew or REW      Displays EEPROM reads/writes per operation, writes per region and the estimated
+                EEPROM life. "rew clr" clears the counts. Needs EEMETER defined in "EepromMeter.h".
+rsy or RSY      Displays the database replication status (link to the other controller on UART2).
+rec or REC      Displays the access event link status (events sent to the collector, see EVENTS).
+rdc or RDC      Displays the recent tag decisions and the repeated reads absorbed. "rdc clr" clears them.
+rek or REK      Displays the enrol keypad, the only keypad or reader whose entries go to a command waiting
+                for a tag or password. Entries at the other keypads are still decided.
+syn or SYN      Sends the whole database to the other controller, replacing its database.
 
 svb or SVB      Turn ON/ continuous verbose monitoring every second to serial port.
 sar or SAR      Set the lock retry count, default = 3.
 skt or SKT      Set the keypad timeout, Default - 30 seconds.
+sdc or SDC      Set the duplicate tag window in tenths of a second (0 = off). Default = 2 seconds.
+sek or SEK      Set the enrol keypad (1 front, 2 garage, 3 rear, 4 shed, 0 reader with no keypad). Default = 1.
 slk or SLK      Set the unlock delay. Default = 5 seconds.
 sgt or SGT      Set the garage door lock timer. Default = 30 minutes.
 adi or ADI      Adds user id number in database.
@@ -88,10 +99,25 @@ ddp or DDP      Deletes user password in database.
 din or DIN      Deletes user name in database for a given id number.
 dpn or DPN      Deletes user name in database for a given id number.
 dda or DDA      Deletes user permission byte in database for a given id number or password.
+agr or AGR      Assigns a user to a group (0 = no group).
+sgr or SGR      Sets the access (days, 0 = permanent) and doors of a group.
+rgr or RGR      Displays the groups, their access and number of users. Groups are set on each controller,
+                they are not replicated (DBSYNC), only the group number of each user is.
+bop or BOP      Changes the users of a group, with temporary access expiring within N days or all users in one pass:
+                extends temporary access, revokes access, sets attributes or moves them to a group. Temporary
+                access already expired (turned off by the sweep) is given again with "adt".
 cdb or CDB      Clears user database (ID Tags, passwords, user names and attributes_.
 cep or CEP      Clears All of EEPROM including database and all configuration settings.
 
 menu or MENU or ?     Displays menu (commands).
+
+Lines starting with "{" are machine protocol requests for host tools (one JSON object per line), e.g.
+  {"id":1,"op":"add","tag":4660,"name":"JOHN","att":65}   Reply: {"id":1,"pos":3,"err":0}
+Operations: add, del, get, mod, cnt, rcf, scf, rle. See "protoFrame" and the PROTOERR error codes.
+On the serial port send one request at a time, wait for its reply before the next, and keep each request line
+within 63 bytes (line end included), longer ones are refused with err 6. The receive buffer holds 63 bytes and
+fills in 5.5 ms, an "add" keeps the controller busy writing EEPROM for longer.
+The same requests are accepted from the event collector (EVENTS) and answered on its link.
 */  
 
 // Rev 1.00   - Created to run on Arduino Arduino NANO. Compliled with Arduino IDE rev 1.8.12.
@@ -224,6 +250,77 @@ menu or MENU or ?     Displays menu (commands).
 // Rev 1.1.10 - Added status to OLED display's main menu when encoder knob is turned.
 //            - Optimized code.
 // Rev 1.1.10a- Replaced JC-Button library with EasyButton library in order to get garage door wall switch to function correctly.
+// Rev 1.1.11 - Replaced ArduinoSerialCommand library with local CliEngine library. Serial input is never waited
+//              on, commands are found in a sorted table in program memory and commands needing more input
+//              ("adi", "ada", "cdb", etc.) continue in the background when the operator or keypad enters it. Only
+//              the enrol keypad ("sek") answers them, entries at the other keypads are still decided.
+//            - Added machine protocol (JSON lines) on the serial console for provisioning tools. Requests carry an
+//              id and are answered with one line each. On the serial console the host keeps one request of at most
+//              63 bytes in flight (JSON_MAXLINE), the UART receive buffer would overflow during EEPROM writes.
+//            - Doors with a lock solenoid are described once in "doorTable". Unlock, relock, the ISR 60Hz drive and
+//              permission matching use it with port registers computed at startup instead of per-door code.
+//            - Door permissions are kept in RAM ("acsMap", one bitmap per door indexed by user position) and rebuilt
+//              whenever the database changes. Granting access is a bit test with no EEPROM write. Expired temporary
+//              access is retired by a sweep on the 1 minute tick and used one-time access is cleared in EEPROM
+//              after the door has been opened.
+//            - Added weekly schedule profiles (one bit per day and hour) kept in EEPROM and cached in RAM. Each user
+//              may be given a profile with "asp". The current day/hour slot is updated on the 1 minute tick, so the
+//              schedule check at the door is one bit lookup. Added "rsp", "ssp" and "asp" commands.
+//            - Each keypad has its own session (digits, ID + password stage, entry timer, retry count and lock-out).
+//              Sessions advance from decoded Wiegand frames without waiting, so the ID + password check no longer
+//              stops the doors, buttons and console and two people may use different keypads at the same time.
+//            - EEPROM is written through "eeMeter". Writes of a value already stored are skipped, and reads, writes
+//              and skipped writes are counted for each operation (database lookup, insert, configuration, DST,
+//              ...) when EEMETER is defined in "EepromMeter.h" (off by default, the counters take RAM). Writes per
+//              128 byte region are saved once a day at "eAddrWear". Added "rew" command.
+//            - Corrected "userInfo" prototype (int16_t user) to match the method. The sketch also builds on a Linux
+//              PC for the scenario runner in "host" (see README).
+//            - The database is a "RfidDbFixed" with DBUSERS, DBSTART and NAMELENGTH as template parameters. Column
+//              addresses are constants, so lookups and reads at the door do no address arithmetic at run time.
+//            - Added "RfidDbCompact" database (selected in RFID DATABASE SETUP) storing only the fields each user
+//              has, 3 byte IDs and PINs and names of their own length. About twice the users fit in the EEPROM.
+//            - Added "fnd" command to find users by name. A sorted RAM index of the first two letters of each name
+//              ("nameIdx", 3 bytes per user) is kept up to date by the database, so only matching users are read.
+//            - Added database replication between controllers on UART2 (DBSYNC). Database changes are recorded in a
+//              RAM journal ("dbJnl") and sent to the other controller, which applies them and acknowledges. When
+//              the other controller missed too many changes the whole database is sent, never by an empty database
+//              and, unless both are new, never by one not synchronized before (flag at "eAddrSyncd"). Temporary
+//              access is sent as the minutes left on "timeStmp", each controller keeps it on its own clock. Added "rsy"
+//              and "syn".
+//            - Added access events sent to a host collector (EVENTS) on UART3, or on the W5100 Ethernet board with
+//              ETHERNET (UDP or TCP). Events wait in a RAM ring ("evRing") until the collector acknowledges them and
+//              are sent in batches. Machine protocol requests from the collector are answered on the same link, so
+//              the USB console is left to the operator. A password or PIN typed at a keypad is never sent, its
+//              events carry the user number instead. Added "rec".
+//            - Added "Sampler", sampling VIN/VCC (ADC on interrupt, oversampled and averaged) and the garage door
+//              switches and PIR (port registers, debounced) in the background from the timer ISR. The VIN/VCC pages,
+//              the garage door logic and the PIR read the values kept in RAM instead of the pins or the ADC.
+//            - Replaced the EasyButton objects read at every loop pass by "InputEngine". The buttons and garage door
+//              switches are read a port at a time by the timer ISR and debounced together (vertical counter). PORTK
+//              buttons are only read after a pin change interrupt (PCINT2). Press, release, long press and click
+//              events are queued, "checkBtn" only handles the queued events. The garage door switches moved from
+//              "sampler" to the engine.
+//            - Beepers, keypad LEDs, bells and the speaker are driven by "fb" (Feedback), which plays PROGMEM patterns
+//              on each output from the timer ISR. The startup melody, error tone, lock-out blink, unlock and bell
+//              feedback no longer use delay(), and a denied entry only beeps the keypad it was entered on. The garage
+//              door opener pulse is played the same way ("fbGarDr") instead of blocking the loop for 2 seconds.
+//            - Staged startup. "setup" only brings up what serves the doors (lock outputs, Wiegand, timer ISR, inputs,
+//              database and access map, configuration). The RTC check, replication, event link, displays, banners,
+//              melody and LED self test run afterwards from "loop" as deferred tasks ("bootTask"), one per pass.
+//              The boot-to-ready time is measured and shown by "rvb". Dropped the delay(10) between first-time
+//              configuration writes (EEPROM.write waits for the previous write). Users with a schedule profile are
+//              denied until the RTC stage has read the day and hour.
+//            - Recent tag decisions are kept in "dcache" (DecisionCache) for the duplicate tag window ("dct", default
+//              2 seconds). A tag read again at the same keypad within the window is absorbed: no database lookup,
+//              unlock, log line or retry count. A grant is forgotten once its door relocks, so a card held after
+//              a short unlock delay opens the door again. Added "rdc" (cache status) and "sdc" (set the window).
+//            - User groups. A user may belong to one of 8 groups (high 4 bits of its schedule byte in the database,
+//              the low 4 bits keep the schedule profile). A group has door bits and permanent or temporary access
+//              with its own expiry (EEPROM at "eAddrGrp"). "acsRebuild" adds the doors of a user's valid group to its
+//              own. Added "agr" (assign group), "sgr" (set group), "rgr" (list groups) and "bop", which changes the
+//              users of a group, with temporary access expiring within N days or all users in one pass over the
+//              database with a single commit (extend, revoke, set attributes, move to a group). The groups are
+//              kept on each controller, only the group number of the users is replicated.
 // 
 //  TIMER PINS
 //  ==========
@@ -304,19 +401,14 @@ menu or MENU or ?     Displays menu (commands).
 #define SWITCHES
 #define RGBLED
 #define PIR
-
-/* ArduinoSerialCommand library modified as follows
-   Serial.Command.h 
-                    - Line 66 "SERIALCOMMANDBUFFER 20" changed to "SERIALCOMMANDBUFFER 16"
-                      Command argument size includes NULL character.
-                    - Line 67 "MAXSERIALCOMMANDS 35" changed to "MAXSERIALCOMMANDS 40"
-                      to support the number of commands required.
-                  
-  SerialCommand.cpp
-                    - Line 128 modified to ignore caps so cammands could be entered in upper or lower case.
-                      This reduced the buffer size needed to support commands and arguments.
-              WAS:    if (strncmp(token,CommandList[i].command,SERIALCOMMANDBUFFER) == 0)
-              IS NOW: if (strncasecmp(token,CommandList[i].command,SERIALCOMMANDBUFFER) == 0)
+#define DBSYNC                                    // Database replication with another controller on UART2.
+#define EVENTS                                    // Access events to a host collector on UART3 (or ETHERNET).
+//#define ETHERNET                                // Event collector on the W5100 Ethernet board instead of UART3.
+
+/* The ArduinoSerialCommand library has been replaced by the local CliEngine library (CliEngine.h).
+   Lines are assembled from the UART without blocking and commands are found with a binary search of the
+   sorted "cmdTable" in program memory. Commands are still accepted in upper or lower case. Commands that need
+   more input from the operator use "argThen" or "ynReply" to wait for it in the background.
 */ 
 
 #define PROTOTYPE 0                               // Use code for prototype box used for the aquarium development.
@@ -332,14 +424,33 @@ menu or MENU or ?     Displays menu (commands).
 #if defined RFID
   #include "Wiegand.h"                              // Wiegand Rev 3.4 library for keypad (modified by Guy Bastien).
   #include "RfidDb.h"                               // https://www.arduinolibraries.info/libraries/rfid-db v1.1.1.
+  #include "RfidDbFixed.h"                          // RfidDb with the database size fixed at compile time.
+  #include "RfidDbCompact.h"                        // Variable length records, about twice the users of RfidDb.
+  #include "AccessMap.h"                            // Per-door permission bitmaps kept in RAM.
+  #include "NameIndex.h"                            // Sorted name prefixes of the users kept in RAM.
+#endif
+
+#if defined DBSYNC
+  #include "DbJournal.h"                            // Journal of the database changes kept in RAM.
+  #include "DbSync.h"                               // Replication of the database over a serial link.
+#endif
+
+#include "EventLink.h"                            // Access event types, events sent to a host collector (EVENTS).
+#include "Sampler.h"                              // Analog and digital inputs sampled in the background.
+#if defined EVENTS && defined ETHERNET
+  #include <SPI.h>                                  // Built-in library.
+  #include <Ethernet.h>                             // Built-in library (W5100).
+  #include "TransportW5100.h"                       // Event link on the W5100 (UDP or TCP).
 #endif
 
 #if defined ENCODER
   #include <ClickEncoder.h>
 #endif
 
-#include <SerialCommand.h>                        // https://github.com/scogswell/ArduinoSerialCommand
+#include "CliEngine.h"                            // Non-blocking command line interface (replaces SerialCommand).
+#include "JsonLine.h"                             // Machine protocol (JSON lines) on the serial console.
 #include <EEPROM.h>                               // Mega328P EEPROM (1KB), Mega2560 EEPROM (4KB).
+#include "EepromMeter.h"                          // EEPROM writes skipped when unchanged, traffic and wear counts.
 
 #if defined SOUND
   #include "pitches.h"                              // Pitch data for each note. https://www.arduino.cc/en/Tutorial/BuiltInExamples/toneMelody
@@ -349,10 +460,9 @@ menu or MENU or ?     Displays menu (commands).
   #include <RTClib.h>                               // https://github.com/adafruit/RTClib
 #endif
 
-#if defined SWITCHES
-//  #include <JC_Button.h>                            // https://github.com/JChristensen/JC_Button
-  #include <EasyButton.h>
-#endif
+#include "InputEngine.h"                          // Buttons and switches debounced in the background, event queue.
+#include "Feedback.h"                             // Beeper, LED, bell and speaker patterns played in the background.
+#include "DecisionCache.h"                        // Recent tag decisions, repeated reads of a held card absorbed.
 
 // Libraries below are used for OLED display.
 #if defined OLEDDISPLAY
@@ -386,17 +496,19 @@ menu or MENU or ?     Displays menu (commands).
 
   const uint8_t   D0APin          = 2;            // INT4,(RESERVED) Front door RFID D0 weigand signal (See setup).
   const uint8_t   D1APin          = 3;            // INT5,(RESERVED) Front door RFID D1 wiegand signal (See setup).
-  const uint8_t   SdSelPin        = 4;            // (RESERVED) W5100 Ethernet controller SD card select.
+  const uint8_t   SdSelPin        = 4;            // (RESERVED) W5100 Ethernet controller SD card select (kept HIGH with ETHERNET).
   const uint8_t   frtLedPin       = 6;            // RFID Green LED OUTPUT (operation indication).
   const uint8_t   frtBprPin       = 7;            // Access keypad Beeper control OUTPUT.
   const uint8_t   spkrPin         = 9;            // Speaker ouput (Error/condition feedback).
-  const uint8_t   W5100SelPin     = 10;           // (RESERVED) W5100 Ethernet controller select.
+  const uint8_t   W5100SelPin     = 10;           // (RESERVED) W5100 Ethernet controller select (event collector, ETHERNET).
   const uint8_t   frtDrKeyPdPin   = 11;           // Keypad 1 location pin. Used to identify which keypad is active.
   const uint8_t   garDrKeyPdPin   = 12;           // Keypad 2 location pin. Used to identify which keypad is active.
   const uint8_t   rearDrKeyPdPin  = 13;           // Keypad 3 location pin. Used to identify which keypad is active.
 
-//const uint8_t   txd2Pin         = 16;           // (RESERVED) TXD2 Transmit data UART2.
-//const uint8_t   rxd2Pin         = 17;           // (RESERVED) RXD2 Receive  data UART2.
+//const uint8_t   txd3Pin         = 14;           // TXD3 Transmit data UART3, event collector (EVENTS).
+//const uint8_t   rxd3Pin         = 15;           // RXD3 Receive  data UART3, event collector (EVENTS).
+//const uint8_t   txd2Pin         = 16;           // TXD2 Transmit data UART2, database replication (DBSYNC).
+//const uint8_t   rxd2Pin         = 17;           // RXD2 Receive  data UART2, database replication (DBSYNC).
   const uint8_t   encAPin         = 18;           // Rotory encoder A input (INT3).
   const uint8_t   encBPin         = 19;           // Rotory encoder B input (INT2).
 
@@ -514,6 +626,9 @@ const uint16_t  eAddrGarDrSn      = (eAddr + 24); // 0X018 EPPROM location for g
 const uint16_t  eAddrMenuTimeout  = (eAddr + 25); // 0X019 EPPROM location for menu timer.
 const uint16_t  eAddrBkLtLed      = (eAddr + 26); // 0X01A EPPROM location for LCD backlight setting.
 const uint16_t  eAddrLcdContr     = (eAddr + 27); // 0X01B EPPROM location for LCD contrast setting.
+const uint16_t  eAddrDcTtl        = (eAddr + 28); // 0X01C EPPROM location for duplicate tag window (0.1 second).
+const uint16_t  eAddrSyncd        = (eAddr + 29); // 0X01D EPPROM location for database replication paired flag.
+const uint16_t  eAddrEnrolKp      = (eAddr + 30); // 0X01E EPPROM location for the enrol keypad (KEYPADLOC).
 
 // DEFAULT CONSTANTS ----------------------------------------------------------------------------------------------
 const bool      SETMONDEFAULT     = 0;            // Sets continuous verbose monitoring to serial port ON/OFF.
@@ -540,6 +655,8 @@ const uint8_t   SHDDRLOCKTMRDEFAULT = 30;         // Shed door unlock time, defa
 const uint8_t   BKLTTMRDEFAULT    = 10;           // Backlight on timer, default = 10 seconds.
 const uint8_t   KEYTMRDEFAULT     = 20;           // Keypad entry timer, default = 20 seconds. 
 const uint8_t   KPLCKTMDEFAULT    = 5;            // Keypad lock-out time, default = 5 minutes. 
+const uint8_t   DCTTLDEFAULT      = 20;           // Duplicate tag window, default = 2 seconds (0.1 second units).
+const uint8_t   ENROLKPDEFAULT    = 1;            // Enrol keypad, default = front door keypad (FRTDRKEYPD).
 const uint8_t   TENHZTIMERDEFAULT = 12;           // Ten hertz time generator (12 X 8.333 MSEC). 
 const uint8_t   ONEHZTIMERDEFAULT = 120;          // One hertz time generator (120 X 8.333MSEC).
 const uint8_t   ONEMNTIMERDEFAULT = 60;           // One minute time generator (60 X 1HZ).
@@ -548,14 +665,27 @@ const uint8_t   GARDRTMRDEFAULT   = 30;           // Garage door close timer (30
 const int8_t    TEMPROFFSETDEFAULT= 0;            // RTC's temperature offset.
 const uint8_t   DBUSERS           = 30;           // Number of users to be stored in the database.
 const uint8_t   NAMELENGTH        = 11;           // Name length (including null character).
+const uint8_t   DBJOURNAL         = 16;           // Database changes kept for the other controller (5 bytes each).
+const uint8_t   EVENTCOUNT        = 16;           // Access events kept until the collector has them (10 bytes each).
 const uint16_t  DBSTART           = 32;           // 0x20 Location in EEPROM where database starts.
+const uint8_t   SCHPROFILES       = 4;            // Number of weekly schedule profiles (user profile 0 = no schedule).
+const uint8_t   SCHBYTES          = 21;           // Bytes per schedule profile, 7 days X 24 hours, one bit per hour.
+const uint8_t   SCHNOSLOT         = 0xFF;         // "schSlot" before the RTC has been read, schedules deny.
+const uint16_t  eAddrSch          = EEPROMSIZE - (SCHPROFILES * SCHBYTES); // Schedule profiles at the top of EEPROM.
+const uint16_t  eAddrWear         = eAddrSch - EEMETER_BLOCK; // EEPROM wear counts, below the schedule profiles.
+const uint8_t   GROUPS            = 8;            // Number of user groups (user group 0 = no group).
+const uint8_t   GRPBYTES          = 5;            // Bytes per group, attribute + expiry time stamp.
+const uint16_t  eAddrGrp          = eAddrWear - (GROUPS * GRPBYTES); // User groups, below the EEPROM wear counts.
+const uint8_t   SCHMASK           = 0x0F;         // Schedule profile bits of the user schedule byte.
+const uint8_t   GRPSHIFT          = 4;            // User group in the high 4 bits of the user schedule byte.
 const uint32_t  APWD              = 123456;       // Default user password.
 const uint32_t  PPWD              = 666666;       // Default programming password.
 const uint8_t   NUMBER_OF_ITEMS   = 8;            // Number of items in the attribute list. 
 const uint8_t   NUMBER_OF_PERMS   = 9;            // Number of items in the permissions list. 
 const int       MAX_SIZE          = 55;           // Number of charaters in each list item.
-const uint16_t  DEBOUNCE          = 400;          // Switch debounce time 50 milliseconds.
-const uint32_t  HOLDTM            = 1000;         // Switch hold time. Default = 1000 milliseconds.
+const uint16_t  HOLDTM            = 1000;         // Switch hold time. Default = 1000 milliseconds.
+const uint8_t   TIMERHZ           = 120;          // Timer1 ISR rate (see "ISR(TIMER1_OVF_vect)").
+const uint16_t  BOOTREVMS         = 3000;         // Time the firmware revision stays on the OLED at startup.
 const uint8_t   LCDROW            = 4;            // LCD number of rows (20x4 LCD display).
 const uint8_t   LCDCOL            = 20;           // LCD number of colums (20x4 LCD display.
 
@@ -597,6 +727,8 @@ const int16_t   PWDMASK           = 0xFFF;        // Removes password flag to pr
 
 
 // OLED MESSAGES IN PROGRAM MEMORY --------------------------------------------------------------------------------
+const char      eeOpName[EEOP_COUNT][11] PROGMEM = {"OTHER", "CONFIG", "DST", "ERROR LOG", "DB READ", "DB LOOKUP",
+                  "DB INSERT", "DB REMOVE", "DB MOVE", "DB NAME", "DB ATTRIB", "DB MODIFY", "DB INIT", "WEAR METER"};
 const char      daysOfTheWeek[7][12] PROGMEM = {"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
 const char      months[12][4] PROGMEM = {"JAN", "FEB", "MAR", "APR", "MAY", "JUN", "JUL", "AUG", "SEP", "OCT", "NOV", "DEC"};
 
@@ -616,9 +748,6 @@ volatile bool     tenHzTick       = 0;            // Shows 10Hz timer has counte
 volatile bool     oneHzTick       = 0;            // Shows 1Hz timer has counted down to zero.
 volatile bool     oneMnTick       = 0;            // Shows 1 minute timer has counted down to zero.
 volatile bool     pirFlag         = 0;            // Shows when PIR detected a presents. Used to keep ISR running fast.
-volatile uint8_t  frtDrLckDlyTmr  = 0;            // Front door unlock time delay in seconds.
-volatile uint8_t  rrDrLckDlyTmr   = 0;            // Rear door unlock time delay in seconds.
-volatile uint8_t  shdDrLckDlyTmr  = 0;            // Shed door unlock time delay in seconds.
 volatile uint8_t  progTimer       = 0;            // Configuration counter timeout.
 volatile uint8_t  garDrTmr        = 0;            // Garage door timer.
 volatile uint8_t  keyPdLoc        = 0;            // Keypad location. 0=No keypad, 1=Frt Dr, 2=Gar Dr, 3=Rear Dr.
@@ -633,25 +762,45 @@ volatile uint16_t intKypdFlag     = 0;            // Keypad interrupt flag.
 uint8_t       dowFlag             = 0;            // Used to keep track of the day of week. If same day, the date is not refreshed on OLED.
 uint8_t       drUnlockFlag        = 0;            // Used to check status of door lock during UNLOCK/LOCK cycle.
 uint8_t       runState            = 0;            // Indicates what mode we are in. 0 = normal, 1 = Programming mode.
+uint8_t       bootStage           = 0;            // Next deferred startup task (BOOTSTAGE).
+uint32_t      bootReadyUs         = 0;            // Microseconds from reset to doors served (end of "setup").
+uint32_t      bootDoneMs          = 0;            // Milliseconds from reset to all deferred startup tasks done.
 uint8_t       ConfigTime          = 30;           // Programming mode time-out, default 30 seconds.
-uint8_t       retryCnt            = 0;
-uint8_t       keyTmr              = 20;           // Key entry timer. Is set to default when a key is pressed.
 uint8_t       dsplyTmr            = DSPLYTMRDEFAULT;    // Display timer. OLED is on if timer > 0.
 uint8_t       menuTimeout         = MENUTIMEOUTDEFAULT;
 int8_t        encPosition         = 0;            // Current encoder postion read from encoder.
 int8_t        oldEncPosition      = 0;            // Previous encoder position.
 uint16_t      timer1_counter      = 0;            // timer1 counter variable.
-uint32_t      keyVal              = 0;            // Holds the numeric information entered from the keypad (0-9).
-uint32_t      KpLckTm             = 0;            // Keypad lockout time.
 char          name[NAMELENGTH];                   // Temp location for input/output for id Name.
 uint32_t      idPwd = 0;
 int16_t       pos   = 0;
 uint8_t       att   = 0;
   
-// MELODY VARIABLE ------------------------------------------------------------------------------------------------
-// notes in the melody: (CLOSE ENCOUNTER's OF THE THIRD KIND).
-const int melody[] = {NOTE_G4, NOTE_A4,NOTE_F4, NOTE_F3, NOTE_C3};
-const int noteDurations[] = {8, 4, 2, 4, 1}; // note durations: 4 = quarter note, 8 = eighth note, etc.
+// FEEDBACK PATTERNS ----------------------------------------------------------------------------------------------
+// Played by "fb" (see "Feedback.h"), durations in timer ticks.
+#define FBMS(ms)  ((ms) * TIMERHZ / 1000)         // Milliseconds to timer ticks (255 ticks at most).
+
+const uint8_t fbSteady[]    PROGMEM = {FB_ON(1), FB_HOLD};                           // ON until stopped.
+const uint8_t fbBell[]      PROGMEM = {FB_ON(FBMS(500)), FB_END};                    // Bell relay and status LED.
+const uint8_t fbGarDr[]     PROGMEM = {FB_ON(FBMS(500)), FB_OFF(FBMS(1500)), FB_END}; // Opener pulse, then time for
+                                                                                       // the position switches.
+const uint8_t fbDeny[]      PROGMEM = {FB_ON(FBMS(100)), FB_OFF(FBMS(100)), FB_REPEAT(3), FB_END};  // 4 beeps.
+const uint8_t fbLockout[]   PROGMEM = {FB_ON(FBMS(1000)), FB_OFF(FBMS(1000)), FB_LOOP};  // Keypad LED, 1s blink.
+const uint8_t fbSelfTest1[] PROGMEM = {FB_ON(FBMS(1000)), FB_END};                    // LED self test, one LED
+const uint8_t fbSelfTest2[] PROGMEM = {FB_OFF(FBMS(1000)), FB_ON(FBMS(1000)), FB_END}; // after the other.
+const uint8_t fbSelfTest3[] PROGMEM = {FB_OFF(FBMS(2000)), FB_ON(FBMS(1000)), FB_END};
+const uint8_t fbDenyTone[]  PROGMEM = {FB_TONE(100, FBMS(100)), FB_TONE(500, FBMS(100)), FB_TONE(1000, FBMS(100)),
+                                       FB_TONE(1500, FBMS(100)), FB_END};
+
+#if defined SOUND
+// notes in the melody: (CLOSE ENCOUNTER's OF THE THIRD KIND). 8th, quarter, half, quarter and whole note, each
+// followed by a rest of 30% + 10 milliseconds.
+const uint8_t fbStartup[]   PROGMEM = {FB_TONE(NOTE_G4, FBMS(125)),  FB_OFF(FBMS(47)),
+                                       FB_TONE(NOTE_A4, FBMS(250)),  FB_OFF(FBMS(85)),
+                                       FB_TONE(NOTE_F4, FBMS(500)),  FB_OFF(FBMS(160)),
+                                       FB_TONE(NOTE_F3, FBMS(250)),  FB_OFF(FBMS(85)),
+                                       FB_TONE(NOTE_C3, FBMS(1000)), FB_OFF(FBMS(310)), FB_END};
+#endif
 
 // ENUMERATION DEFINITIONS ----------------------------------------------------------------------------------------
 enum RUNSTATE
@@ -667,6 +816,29 @@ enum RUNMODE
   VCCVAL                                          // Displays the board's 5VDC voltage.
 };
 
+enum SNANALOG                                     // Analog inputs of "sampler" (order of "snAdcPins").
+{
+  SNVIN,                                          // +12V VIN.
+  SNVCC                                           // +5V VCC.
+};
+
+enum SNDIGITAL                                    // Digital inputs of "sampler" (order of "snDigPins").
+{
+  SNPIR                                           // PIR detector.
+};
+
+enum INCHANNEL                                    // Channels of "inputs" (order of "inPins").
+{
+  INFRTBEL,                                       // Front door RFID keypad bell button.
+  INGARBEL,                                       // Garage door RFID keypad bell button.
+  INREARBEL,                                      // Rear door RFID keypad bell button.
+  INGARWAL,                                       // Garage door wall switch.
+  INAUX,                                          // Intercom auxiliary button.
+  INDOOR,                                         // Intercom door unlock button.
+  INGARUP,                                        // Garage door up position switch (pressed = door open).
+  INGARDN                                         // Garage door down position switch (pressed = door closed).
+};
+
 enum CONFIGMODE                                   // Indicates the programing opsion selected.
 {
   ADDTAG,
@@ -687,6 +859,17 @@ enum LOCKUNLOCK                                   // Front/Rear door lock soleno
   UNLOCK                                          // 1 - Unlock door solenoid (Activate).
 };
 
+enum BOOTSTAGE                                    // Deferred startup tasks, run in order by "bootTask" from "loop".
+{
+  BOOTRTC,                                        // RTC check (I2C), the time is needed for the access log.
+  BOOTSYNC,                                       // Database replication, the journal epoch comes from the RTC.
+  BOOTEVENTS,                                     // Access event link, Ethernet start can take half a second.
+  BOOTDISPLAY,                                    // LCD and OLED initialization, firmware revision shown.
+  BOOTGREET,                                      // Console banners, startup melody and LED self test.
+  BOOTCLEAR,                                      // Clears the OLED once the revision has been shown BOOTREVMS.
+  BOOTDONE
+};
+
 enum ONOFF                                        // LED and other basic function requiring a logic "1" for ON.
 {
   OFF,                                            // Led control. When off (deactivated), Red LED is on.
@@ -715,6 +898,118 @@ enum KEYPADLOC
   REARDRKEYPD,
   SHEDDRKEYPD
 };
+
+enum PROTOERR                                     // Machine protocol error codes (returned in the "err" member).
+{
+  PERR_OK,                                        // 0 - Request completed.
+  PERR_SYNTAX,                                    // 1 - Line is not a valid JSON object.
+  PERR_OP,                                        // 2 - Unknown or missing "op".
+  PERR_ARG,                                       // 3 - Missing or invalid member.
+  PERR_NOTFOUND,                                  // 4 - Tag ID, password or user position not found.
+  PERR_FULL,                                      // 5 - Database is full.
+  PERR_RANGE                                      // 6 - Value out of range (or name or request too long).
+};
+
+// DOOR DEFINITIONS -----------------------------------------------------------------------------------------------
+// Every door with a lock solenoid is described once in "doorTable". Unlock, relock, the 60Hz solenoid drive in the
+// timer ISR and permission matching are all driven from this table. To add a door, add its pins here and an entry
+// to "DOOR". The garage door is operated through a relay pulse and is handled separately by "garDrCntl".
+enum DOOR                                         // Index of each door in "doorTable" and its unlock timer slot.
+{
+  FRTDR,
+  REARDR,
+  SHEDDR,
+  DOORCOUNT
+};
+
+const char frtDrName[]  PROGMEM = "FRONT DOOR";
+const char rearDrName[] PROGMEM = "REAR DOOR";
+const char shedDrName[] PROGMEM = "SHED DOOR";
+
+struct Door
+{
+  uint8_t     lckPin;                             // Lock solenoid pin.
+  uint8_t     ledPin;                             // Access keypad LED pin.
+  uint8_t     bprPin;                             // Access keypad beeper pin.
+  uint8_t     tmrAddr;                            // EEPROM address of the unlock delay.
+  uint8_t     perm;                               // Permission bit in the user attribute.
+  uint8_t     keypad;                             // Keypad location (KEYPADLOC) used to open this door.
+  const char  *name;                              // Door name stored in program memory.
+};
+
+constexpr Door doorTable[] PROGMEM =
+{
+  {frtDrLckPin,   frtLedPin,  frtBprPin,  eAddrFrtDrLckTmr, FRTDRLOCK,  FRTDRKEYPD,  frtDrName},
+  {rearDrLckPin,  rearLedPin, rearBprPin, eAddrRrDrLckTmr,  REARDRLOCK, REARDRKEYPD, rearDrName},
+  {shedDrLckPin,  shedLedPin, shedBprPin, eAddrShdDrLckTmr, SHEDDRLOCK, SHEDDRKEYPD, shedDrName},
+};
+static_assert(sizeof(doorTable) / sizeof(doorTable[0]) == DOORCOUNT, "doorTable must have one entry per DOOR");
+
+constexpr uint8_t doorPerms(const Door *table, uint8_t count)
+{
+  return count ? (table[0].perm | doorPerms(table + 1, count - 1)) : 0;
+}
+const uint8_t   DOORPERMS         = doorPerms(doorTable, DOORCOUNT);  // Permission bits of all doors in "doorTable".
+
+struct DoorPort                                   // Output registers and bit masks computed from "doorTable" at startup.
+{
+  volatile uint8_t  *lckOut;                      // Keypad LED and beeper are driven by "fb" (FBLED, FBBPR).
+  uint8_t           lckMask;
+};
+
+DoorPort          doorPort[DOORCOUNT];
+const uint8_t     GARDR           = DOORCOUNT;    // "acsMap" index of the garage door (not in "doorTable").
+const uint8_t     NODOOR          = 0xFF;         // "kpDoor" entry for a keypad location which opens no door.
+uint8_t           kpDoor[SHEDDRKEYPD + 1];        // Door opened by each keypad location (GARDR = garage door).
+volatile uint8_t  drLckDlyTmr[DOORCOUNT];         // Unlock time delay in seconds for each door.
+volatile uint8_t  drLckExp        = 0;            // Set by ISR, one bit per door whose unlock delay has expired.
+
+// FEEDBACK CHANNEL DEFINITIONS -----------------------------------------------------------------------------------
+enum FBCHANNEL                                    // Channels of "fb". Keypad beepers and LEDs are in door order,
+{                                                 // the garage keypad (GARDR) last, so FBBPR + door is its beeper.
+  FBFRTBPR,
+  FBREARBPR,
+  FBSHEDBPR,
+  FBGARBPR,
+  FBFRTLED,
+  FBREARLED,
+  FBSHEDLED,
+  FBGARLED,
+  FBSPKR,                                         // Speaker (tone).
+  FBFRTBEL,                                       // Front door bell relay.
+  FBREARBEL,                                      // Rear door bell relay.
+  FBRLED,                                         // RED status LED.
+  FBGLED,                                         // GREEN status LED.
+  FBBLED,                                         // BLUE status LED.
+  FBGAROPN,                                       // Garage door opener relay.
+  FBBPR = FBFRTBPR,
+  FBLED = FBFRTLED
+};
+static_assert(FBGARBPR == FBBPR + GARDR && FBGARLED == FBLED + GARDR, "FBCHANNEL keypads must follow door order");
+
+Feedback          fb;
+
+// KEYPAD SESSION DEFINITIONS -------------------------------------------------------------------------------------
+// All keypads share one Wiegand port, the keypad which sent a frame is known from "keyPdLoc" (see PCINT0 ISR). Each
+// keypad location keeps its own entry state so digits typed on one keypad never mix with another.
+enum KPSTAGE
+{
+  KPIDLE,                                         // Waiting for an ID tag or a keypad entry.
+  KPSECOND                                        // ID + password user found, waiting for the other one.
+};
+
+struct KpSession
+{
+  uint32_t  keyVal;                               // Digits entered so far (until "#" is pressed).
+  uint32_t  lckTm;                                // End of the keypad lock-out (time stamp in minutes).
+  int16_t   user;                                 // First entry ("posOf" result) while in KPSECOND stage.
+  uint8_t   stage;                                // KPSTAGE.
+  uint8_t   tmr;                                  // Seconds left to complete the entry.
+  uint8_t   retryCnt;                             // Unknown IDs or passwords entered in a row.
+};
+
+KpSession         kpSession[SHEDDRKEYPD + 1];     // Entry state of each keypad location.
+DecisionCache     dcache;                         // Recent tag decisions per keypad location (see "kpFrame").
   
 // LCD DEFINITIONS ------------------------------------------------------------------------------------------------
 #if defined LCDDISPLAY
@@ -730,27 +1025,21 @@ enum KEYPADLOC
   #define OLED_RESET    -1                          // Disable reset pin/
 #endif
 
-//CREATE A NEW BUTTON OBJECT (PUSHBUTTON SWITCH DEFINITION)--------------------------------------------------------
-//const uint32_t  LONG_PRESS(HOLDTM);                   // Time in millisec to press garage dr wall sw to disable close timer.
-
-//     INSTANCE--PIN---------DEBOUNCETM PULLUP INVERT
-#if defined SWITCHES
-  EasyButton frtBelBtn(frtBelBtnPin, DEBOUNCE, TRUE, TRUE); // Instantiate a Bounce object
-  EasyButton garDrWalSw(garDrWalSwPin, DEBOUNCE, TRUE, TRUE);
-  EasyButton garDrDnSw(garDrDnSwPin,DEBOUNCE, TRUE, TRUE); // Switch is HIGH, door is open. Also used to resync GARDRLOCK flag.
-  EasyButton garDrUpSw(garDrUpSwPin,DEBOUNCE, TRUE, TRUE); // Switch is HIGH, door is open. Also used to resync GARDRLOCK flag.
-  EasyButton garBelBtn(garBelBtnPin, DEBOUNCE, TRUE, TRUE);
-  EasyButton rearBelBtn(rearBelBtnPin,DEBOUNCE, TRUE, TRUE);
-  EasyButton intDrBtn(intDrBtnPin,DEBOUNCE, TRUE, TRUE);
-  EasyButton intAuxBtn(intAuxBtnPin,DEBOUNCE, TRUE, TRUE);
-#endif
+//CREATE THE BUTTON AND SWITCH INPUTS (PUSHBUTTON SWITCH DEFINITION)-----------------------------------------------
+// All active LOW with pull-ups, see INCHANNEL. The bell and intercom buttons are on PORTK (PCINT2).
+const uint8_t inPins[] = {frtBelBtnPin, garBelBtnPin, rearBelBtnPin, garDrWalSwPin, intAuxBtnPin, intDrBtnPin,
+                          garDrUpSwPin, garDrDnSwPin};
+InputEngine inputs(inPins, sizeof(inPins), TIMERHZ);
+
+const uint8_t snAdcPins[] = {vinPin, vccPin};    // Sampled in the background, see SNANALOG.
+const uint8_t snDigPins[] = {pirPin};             // Sampled and debounced by the timer ISR, see SNDIGITAL.
+Sampler sampler(snAdcPins, sizeof(snAdcPins), snDigPins, sizeof(snDigPins));
 
 
 //CREATE A NEW DISPLAY OBJECT -------------------------------------------------------------------------------------
 #if defined OLEDDISPLAY
   Adafruit_SSD1306 oled(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
 #endif
-SerialCommand SCmd;                               // INITIALIZING CLI OBJECT.
 
 #if defined RFID
   WIEGAND wg;
@@ -758,8 +1047,27 @@ SerialCommand SCmd;                               // INITIALIZING CLI OBJECT.
 // RFID DATABASE SETUP --------------------------------------------------------------------------------------------
 // Setup user database for 30 users with 10 character names starting at EEPROM location 48 (0x30)
 
-  RfidDb db = RfidDb(DBUSERS, DBSTART, NAMELENGTH);	// Used to configure database with a fixed amount of users.
-//  RfidDb db = RfidDb(EEPROMSIZE, DBSTART, NAMELENGTH);// Used to configure database with max EEPROM size.
+  RfidDbFixed<DBUSERS, DBSTART, NAMELENGTH> db;   // Fixed amount of users, column addresses known at compile time.
+//  RfidDb db = RfidDb(DBUSERS, DBSTART, NAMELENGTH);	// Used to configure database with a fixed amount of users.
+//  uint16_t dbIndex[DBUSERS];                    // Record addresses of "RfidDbCompact" (DBUSERS up to 255).
+//  RfidDbCompact db(dbIndex, DBUSERS, DBSTART, eAddrGrp, NAMELENGTH); // Variable length records in all the EEPROM.
+//  RfidDb db = RfidDb(eAddrGrp, DBSTART, NAMELENGTH); // Used to configure database with max EEPROM size.
+  NameKey   nameKeys[DBUSERS];                    // Name index entries (first two letters and user position).
+  NameIndex nameIdx(nameKeys, DBUSERS);           // Users sorted by name, kept up to date by "db".
+  #if defined DBSYNC
+    JnlEntry  jnlEntries[DBJOURNAL];              // Last database changes, sent to the other controller.
+    DbJournal dbJnl(jnlEntries, DBJOURNAL);
+    DbSyncOf<decltype(db)> dbSync(Serial2, dbJnl, db); // Replication link on UART2.
+  #endif
+  AccessMap acsMap;                               // Door permissions of each user position (see "acsRebuild").
+  uint16_t  acsRev        = 0;                    // Database revision "acsMap" was built from.
+  uint32_t  acsNextExp    = 0xFFFFFFFF;           // Earliest temporary access expiry time stamp in database.
+  uint8_t   acsSch[DBUSERS];                      // Schedule profile of each user position (see "acsRebuild").
+  uint8_t   grpAtt[GROUPS];                       // Group door bits and PERMACCESS/TEMPACCESS, copy of "eAddrGrp".
+  uint32_t  grpTm[GROUPS];                        // Group temporary access expiry time stamp.
+  uint8_t   schTable[SCHPROFILES][SCHBYTES];      // Schedule profiles, copy of EEPROM at "eAddrSch".
+  uint8_t   schSlot       = SCHNOSLOT;            // Current day/hour slot (day X 24 + hour), see "schUpdate".
+  static_assert(GARDR < ACSMAP_DOORS, "AccessMap must hold every door and the garage door");
 #endif
 
 //CREATE A NEW RTC OBJECT -----------------------------------------------------------------------------------------
@@ -778,8 +1086,11 @@ SerialCommand SCmd;                               // INITIALIZING CLI OBJECT.
 // DECLARING MENU FUNCTIONS FIRST SO THE COMPLIER WILL WORK.
 void      runMode();                              // Mode Control method.
 void      progMode();                             // Programming Method.
-bool      procAtt(uint8_t user);                  // Process attrbute.
-uint32_t  chkKeypad();                            // Checks keypad for ID or password during run mode.
+void      kpFrame();                              // Passes a Wiegand frame to the session of its keypad.
+uint8_t   kpEntry(uint8_t loc, uint32_t idPwd, bool typed); // Processes an ID tag or a keypad entry for a keypad session.
+void      dcLoad();                               // Sets the duplicate tag window from EEPROM.
+uint8_t   enrolKp();                              // Keypad whose entries go to a CLI command waiting for one.
+void      kpService();                            // Keypad session timers and lock-out (1Hz).
 void      processId(uint32_t idVal);              // Process tag method.
 uint32_t  getId();                                // Get id from keypad or RFID tag.
 uint8_t   getType();                              // Get Wiegand type last scanned.
@@ -793,7 +1104,7 @@ void      readVerbose();                          // Read all battery parametrs
 void      readAcsCnt();                           // Read and display the last number of access retries.
 void      readKpTmOut();                          // Read keypad Timeout setting.
 void      readTime();                             // Reads and displays the time/date and temperature from RTC chip.
-void      readTmDt();                              // Reads and displays the date and time on the console. 
+void      readTmDt();                             // Reads and displays the date and time on the console. 
 void      readUnlckDly();                         // Read and display the Unlock delay time in seconds.
 void      readGarDrTmr();                         // Read and display the garage door lock timer in minutes.
 void      readDsplyTmr();                         // Read and display the OLED on timer.
@@ -803,6 +1114,16 @@ void      readKeypad();                           // Read/display information on
 void      readLastErr();                          // Read and display the last error code logged.
 void      readIdPwd();
 void      readDbNam();
+void      findUser();                             // Displays the users whose name starts with the given letters.
+void      readSync();                             // Displays the database replication status.
+void      syncDb();                               // Sends the whole database to the other controller.
+void      readEvents();                           // Displays the access event link status.
+void      readDcache();                           // Displays the recent tag decisions.
+void      setDcTtl();                             // Set the duplicate tag window.
+void      readEnrolKp();                          // Displays the enrol keypad.
+void      setEnrolKp();                           // Set the enrol keypad.
+void      evPush(uint8_t type, uint8_t loc, uint32_t key, bool typed); // Sends an access event to the collector (EVENTS).
+void      evFrame(char *line);                    // Machine protocol request from the collector.
 void      setMon();                               // Set verbose monitoring ON or OFF.
 void      setAcsCnt();                            // Set access control panel retry count(Default = 3).
 void      setKpTmOut();                           // Set keypad time out delay.
@@ -831,24 +1152,25 @@ void      modDbPwd();
 void      modDbIdNam();
 void      modDbPwdNam();
 //
-bool      unlockDoor(int16_t user);               // Unlock solenoid for the duration of the unlock delay.
+uint8_t   unlockDoor(int16_t user, uint8_t loc, uint32_t key, bool typed); // Unlock solenoid for the duration of the unlock delay.
 void      menu();                                 // Display commands.
 int8_t    argOnOff();                             // Processes ON/OFF parameter from command input.
 int8_t    argyn();                                // Processes YES/NO response from command line input.
 int       argcf();                                // Gets "C" or "F" argument from console input.
 bool      argNum(uint32_t &tagId);                // Gets id tag number and store it in variable tagId.
 int16_t   argNumMinMax(uint16_t argMin, uint16_t argMax);  // Processes numerical parameter from command input.
-int16_t   argAtt();
-bool      argNam(char * name);
+uint8_t   argAtt();                               // Processes attribute selection from command input.
+char *    argNam();                               // Gets user name from command input.
 void      syntaxError();                          // Displays syntax error message.
 void      missingArg();                           // Displays Missing Argument error method.
 void      ledSelfTest();                          // Run led selftest.
+void      bootTask();                             // Runs the next deferred startup task.
 void      bprSelfTest();                          // Run beeper selftest.
 void      lckSelfTest();
 void      printBits(uint32_t n, uint8_t numBits); // prints decimal number with leading zero's
 void      printDecimal(uint32_t idPwdTm);
 void      logErr(uint8_t errNum);                 // Displays error logs.
-void      userInfo(uint8_t user);                 // Displays database record for user position.
+void      userInfo(int16_t user);                 // Displays database record for user position.
 void      eepromDump();                           // EEPROM Dump function.
 void      displayAtt(uint8_t att);
 void      printAttList (const char * str);
@@ -860,22 +1182,217 @@ void      ringRearBel();                          // Rings door bell according t
 void      help();                                 // Displays Help command.
 void      checkBtn();                             // Checks all push button status. Must be run in the loop function.
 void      startupTone();                          // Play startup melody.
-void      errorTone();                            // Error tone.
-bool      unlockFrtDr();                          // Unlocks front door strike.
-bool      unlockRearDr();                         // Unlocks rear door strike.
-bool      unlockShedDr();                         // Unlocks shed door strike.
+void      errorTone(uint8_t dr = NODOOR);         // Error tone at the keypad of door "dr" (NODOOR = all keypads).
+void      initDoors();                            // Computes door port registers and configures door pins.
+void      doorOut(volatile uint8_t *out, uint8_t mask, uint8_t val);  // Sets or clears a door output bit.
+bool      unlockDr(uint8_t dr);                   // Unlocks door strike.
+void      lockDr(uint8_t dr);                     // Locks door strike once its unlock delay has expired.
+void      acsRebuild();                           // Rebuilds door permissions in RAM from the database.
+void      acsSweep();                             // Retires expired temporary access.
+void      acsService();                           // Clears used one-time access and keeps "acsMap" up to date.
+uint8_t   acsDoors(uint8_t att);                  // Converts attribute door bits into "acsMap" door bits.
+void      grpLoad();                              // Loads the user groups from EEPROM.
+bool      grpValid(uint8_t grp);                  // Checks if group "grp" (0 to GROUPS - 1) gives access now.
+void      addGroup();                             // Assigns a user to a group.
+void      addGroupUser();
+void      addGroupStep();
+void      setGroup();                             // Sets the access and doors of a group.
+void      readGroups();                           // Displays the groups.
+void      bulkOp();                               // Changes many users in one pass over the database.
+void      schUpdate();                            // Updates the current schedule slot from the RTC.
+bool      schAllowed(uint8_t sch);                // Checks if schedule profile "sch" allows access now.
+int16_t   argRange(uint8_t argMin, uint8_t argMax); // Gets a number within a range from command input.
+void      readSchProfile();                       // Displays a schedule profile.
+void      readEeWear();                           // Displays EEPROM traffic and wear estimate ("rew clr" clears).
+void      setSchProfile();                        // Sets hours of a schedule profile.
+void      addSchProfile();                        // Assigns a schedule profile to a user.
+void      addSchProfileUser();
+void      addSchProfileStep();
 void      drawDigits(int digits);                 // Adds leading "0" to time/date if needed.
 void      printDigits(int digits);                // Used to print leading "0" to time/date if needed on serial console.
 void      checkDst();                             // Check and adjusts RTC for DST or standard time.
-//char      ynReply();                              // Returns Y/N response from console. Waits 10 senconds for input.
-bool      ynReply();                              // Returns Y/N response from console. Waits 10 senconds for input.
 void      clrDb();
 void      clrConfig();                            // Clears configuration values in EEPROM.
 void      clrEeprom();               
 void      eraseEeprom(uint16_t eepromStart);      // Clears database.
 void      keypadLoc();                            // Locates which keypad IdTag was read from.
 void      dsplyMsg (const char * str);            // Takes text stored in program memory and displays it on OLED display.
+void      printMsg (const char * str);            // Prints text stored in program memory on the console.
 void      (* resetFunc) (void) = 0;               // Declare reset function at address 0.
+void      resetCtrl();                            // Resets the controller (rst command).
+void      argThen(void (*step)());                // Runs the next step of a CLI command once its argument is available.
+void      ynReply(void (*step)());                // Runs "step" once the operator has answered Y/N.
+void      argAttList();                           // Displays the attribute options.
+void      readDbNamStep();                        // CLI command steps waiting for operator input.
+void      addDbIdStep();
+void      addDbIdPwdStep();
+void      addDbPwdStep();
+void      addDbPwdTagStep();
+void      addDbIdNamTag();
+void      addDbIdNamStep();
+void      addDbPwdNamPwd();
+void      addDbPwdNamStep();
+void      addDbAttUser();
+void      addDbAttStep();
+void      addDbTmUser();
+void      addDbTmStep();
+void      delDbIdStep();
+void      delDbPwdStep();
+void      delDbIdNamStep();
+void      delDbPwdNamStep();
+void      delDbAttStep();
+void      modDbIdOld();
+void      modDbIdStep();
+void      modDbPwdOld();
+void      modDbPwdNew();
+void      modDbPwdStep();
+void      clrDbStep();
+void      clrConfigStep();
+void      clrEepromStep();
+void      protoFrame(char *line);                 // Machine protocol request handler (lines starting with '{').
+void      conFrame(char *line);                   // Machine protocol request on the serial console.
+int16_t   protoPos();                             // Finds user position from "pos", "tag" or "pwd" request member.
+void      protoAdd();                             // Machine protocol operations.
+void      protoCnt();
+void      protoDel();
+void      protoGet();
+void      protoMod();
+void      protoRdCfg();
+void      protoRdErr();
+void      protoSetCfg();
+
+//#################################################################################################################
+// CLI COMMAND TABLE
+//#################################################################################################################
+// Must be kept in alphabetical order, the CLI engine uses a binary search to find commands. 
+constexpr CliCommand cmdTable[] PROGMEM =
+{
+  {"?",     menu},                                // Displays menu (commands).
+  {"ada",   addDbAtt},                            // Adds/Modifies user permission in database for a given id number or password.
+  {"adi",   addDbId},                             // Adds user id number in database.
+  {"adp",   addDbPwd},                            // Adds user password in database.
+  {"adt",   addDbTm},                             // Adds time stamp for user.
+  {"agr",   addGroup},                            // Assigns a user to a group.
+  {"ain",   addDbIdNam},                          // Adds/modifies user name in database for a given id number.
+  {"apn",   addDbPwdNam},                         // Adds/modifies user name in database for a given password number.
+  {"asp",   addSchProfile},                       // Assigns a schedule profile to a user.
+  {"bop",   bulkOp},                              // Changes the users of a group or matching a condition in one pass.
+  {"ccf",   clrConfig},                           // Clears configuration in EEPROM RFID Database is left unchanged..
+  {"cdb",   clrDb},                               // Clears user database (ID Tags, passwords, user names and attributes.
+  {"cep",   clrEeprom},                           // Clears All of EEPROM including database and all configuration settings.
+  {"dda",   delDbAtt},                            // Deletes user permission byte in database for a given id number or password.
+  {"ddi",   delDbId},                             // Deletes user id number in database.
+  {"ddp",   delDbPwd},                            // Deletes user password in database.
+  {"din",   delDbIdNam},                          // Deletes user name in database for a given id number.
+  {"dpn",   delDbPwdNam},                         // Deletes user name in database for a given password.
+  {"fnd",   findUser},                            // Displays the users whose name starts with the given letters.
+  {"mdi",   modDbId},                             // Modifies a user id number in database.
+  {"mdp",   modDbPwd},                            // Modifies a user password in database.
+  {"menu",  menu},                                // Displays menu (commands).
+  {"min",   modDbIdNam},                          // Modifies a user name in database for a given id number.
+  {"mpn",   modDbPwdNam},                         // Modifies a user name in database for a given password.
+  {"rar",   readAcsCnt},                          // Reads/display the maximum keypad retry count.
+  {"rdc",   readDcache},                          // Displays the recent tag decisions and the reads absorbed.
+  {"rdn",   readDbNam},                           // Reads/displays the user name for a give id in the database.
+  {"rec",   readEvents},                          // Displays the access event link status.
+  {"rek",   readEnrolKp},                         // Displays the keypad used to enter tags and passwords for commands.
+  {"rep",   eepromDump},                          // Displays all internal EEPROM contents.
+  {"rew",   readEeWear},                          // Displays EEPROM traffic and wear estimate.
+  {"rgr",   readGroups},                          // Displays the groups.
+  {"rgs",   readGarStatus},                       // Reads/display the garage door position.
+  {"rip",   readIdPwd},                           // Reads/displays the Database user id for a given user number.
+  {"rkp",   readKeypad},                          // Reads/displays the keypad data.
+  {"rkt",   readKpTmOut},                         // Reads/display the keypad timeout delay, Default = 30 seconds.
+  {"rle",   readLastErr},                         // Reads/display the last error code recorded.
+  {"rot",   readDsplyTmr},                        // Reads/displays the OLED OFF display timer.
+  {"rsp",   readSchProfile},                      // Displays a schedule profile.
+  {"rst",   resetCtrl},                           // Resets the controller.
+  {"rsy",   readSync},                            // Displays the database replication status.
+  {"rtm",   readTime},                            // Displays current RTC time from the DS3231 I2C chip.
+  {"rto",   readTOffset},                         // Displays current RTC temperature offset set in EEPROM.
+  {"rud",   readUnlckDly},                        // Reads/display the unlock delay. Default = 5 seconds.
+  {"rvb",   readVerbose},                         // Reads/display all values and parameters.
+  {"sar",   setAcsCnt},                           // Set the keypad retry count, Default = 3.
+  {"sdc",   setDcTtl},                            // Set the duplicate tag window (0.1 second), Default = 2 seconds.
+  {"sdt",   setDate},                             // Set RTC date.
+  {"sek",   setEnrolKp},                          // Set the keypad used to enter tags and passwords for commands.
+  {"sgr",   setGroup},                            // Set the access and doors of a group.
+  {"sgs",   setGarSensor},                        // Enable or disable garage door sensors (default = Enabled).
+  {"sgt",   setGarDrTmr},                         // Set the garage door lock timer. Default = 30 minutes.
+  {"skt",   setKpTmOut},                          // Set the keypad timeout, Default - 20 seconds.
+  {"slk",   setUnlckDly},                         // Set the unlock delay. Default = 5 seconds.
+  {"sot",   setdsplyTmr},                         // Set the OLED OFF timer. Default = 10 seconds.
+  {"ssp",   setSchProfile},                       // Sets the hours of a schedule profile.
+  {"stm",   setTime},                             // Set RTC time.
+  {"sto",   setTOffset},                          // Set temperature offset of RTC to calibrate temperature reading.
+  {"sts",   setTemprScale},                       // Set the temperature scale.
+  {"svb",   setMon},                              // Turn ON/ continuous verbose monitoring every second to serial port.
+  {"syn",   syncDb},                              // Sends the whole database to the other controller.
+};
+const uint8_t CMDCOUNT = sizeof(cmdTable) / sizeof(cmdTable[0]);
+static_assert(cliSorted(cmdTable, CMDCOUNT), "cmdTable must be sorted in alphabetical order");
+
+CliEngine console(cmdTable, CMDCOUNT, menu);      // INITIALIZING CLI OBJECT (unknown commands display the menu).
+uint32_t  cliVal[2]   = {0, 0};                   // Values carried between the steps of a CLI command.
+
+//#################################################################################################################
+// MACHINE PROTOCOL TABLES
+//#################################################################################################################
+// Operations available to host tools through the machine protocol. Must be kept in alphabetical order.
+constexpr CliCommand opTable[] PROGMEM =
+{
+  {"add",   protoAdd},                            // Adds/updates a user: tag, pwd, name, att, days.
+  {"cnt",   protoCnt},                            // Number of users and database capacity.
+  {"del",   protoDel},                            // Deletes a tag or pwd.
+  {"get",   protoGet},                            // Reads a user record by pos, tag or pwd.
+  {"mod",   protoMod},                            // Changes a user: new_tag, new_pwd, name, sch (profile), grp (group).
+  {"rcf",   protoRdCfg},                          // Reads configuration values.
+  {"rle",   protoRdErr},                          // Reads the last error code recorded.
+  {"scf",   protoSetCfg},                         // Sets configuration values.
+};
+const uint8_t OPCOUNT = sizeof(opTable) / sizeof(opTable[0]);
+static_assert(cliSorted(opTable, OPCOUNT), "opTable must be sorted in alphabetical order");
+
+struct CfgItem                                    // Configuration value available through the machine protocol.
+{
+  char    name[4];                                // Member name.
+  uint8_t addr;                                   // EEPROM address.
+  uint8_t min;                                    // Minimum value accepted by "scf".
+  uint8_t max;                                    // Maximum value accepted by "scf".
+};
+
+const CfgItem cfgTable[] PROGMEM =
+{
+  {"mon",   eAddrSetMon,        0,  1},           // Continuous verbose monitoring.
+  {"dsp",   eAddrDsplyTmr,      1,  240},         // OLED OFF timer (seconds).
+  {"rty",   eAddrRetryCnt,      1,  5},           // Keypad retry count.
+  {"fdl",   eAddrFrtDrLckTmr,   1,  240},         // Front door unlock delay (seconds).
+  {"rdl",   eAddrRrDrLckTmr,    1,  240},         // Rear door unlock delay (seconds).
+  {"sdl",   eAddrShdDrLckTmr,   1,  240},         // Shed door unlock delay (seconds).
+  {"kto",   eAddrKeyTmr,        1,  240},         // Keypad timeout (seconds).
+  {"dct",   eAddrDcTtl,         0,  240},         // Duplicate tag window (0.1 second, 0 = off).
+  {"ekp",   eAddrEnrolKp,       0,  4},           // Enrol keypad (KEYPADLOC).
+  {"klk",   eAddrKpLckTm,       1,  240},         // Keypad lock-out time (minutes).
+  {"gdt",   eAddrGarDrTmr,      1,  240},         // Garage door timer (minutes).
+  {"gds",   eAddrGarDrSn,       0,  1},           // Garage door position sensors enabled.
+  {"tsc",   eAddrTemprScale,    0,  1},           // Temperature scale (0 = Fahrenheit, 1 = Celsius).
+};
+const uint8_t CFGCOUNT = sizeof(cfgTable) / sizeof(cfgTable[0]);
+
+JsonLine  json;                                   // Machine protocol request/reply.
+uint8_t   protoErr    = PERR_OK;                  // Error code of the request being processed.
+
+#if defined EVENTS
+  #if defined ETHERNET
+    uint8_t         ethMac[]  = {0x02, 0x52, 0x46, 0x49, 0x44, 0x01}; // Locally administered MAC of the controller.
+    IPAddress       ethIp(192, 168, 1, 40);       // Controller address.
+    W5100Transport  evPort(IPAddress(192, 168, 1, 10), 5140, false); // Collector address, port, UDP (true = TCP).
+  #else
+    UartTransport   evPort(Serial3);              // Collector on UART3.
+  #endif
+  AccessEvent evRing[EVENTCOUNT];                 // Events not yet acknowledged by the collector.
+  EventLink   evLink(evRing, EVENTCOUNT, evPort);
+#endif
 
 
 //#################################################################################################################
@@ -904,32 +1421,16 @@ void setup()
   pinMode(garDrKeyPdPin,  INPUT_PULLUP);          // Garage door KeyPad location pin.
   pinMode(rearDrKeyPdPin, INPUT_PULLUP);          // Rear door KeyPad location pin.
   pinMode(almZone6Pin,    OUTPUT);                // Controls 5V relay which handles the garage door status for the alarm zone7.
-  pinMode(frtLedPin,      OUTPUT);                // Showns when door is open. Also shows config mode when flashing.
-  digitalWrite(frtLedPin, OFFINV);                // Turns LED RED OFF (Deavitvated HIGH).
-  pinMode(frtBprPin,      OUTPUT);                // keypad buzzer output.
-  digitalWrite(frtBprPin, OFFINV);                // Turns front door beeper OFF (Deavitvated HIGH).
+  initDoors();                                    // Door lock, keypad LED and beeper pins (see "doorTable").
   pinMode(frtBelPin,      OUTPUT);                // Front door BELL OUTPUT.
-  pinMode(frtDrLckPin,    OUTPUT);                // Front door lock control.
-  digitalWrite(frtDrLckPin, OFF);                 // Lock front door.
-  pinMode(garLedPin,      OUTPUT);                // Garage door access keypad led control.
-  digitalWrite(garLedPin, OFFINV);                // Turns LED RED (Deavitvated HIGH).
-  pinMode(garBprPin,      OUTPUT);                // Garage door access keypad beeper control.
-  digitalWrite(garBprPin, OFFINV);                // Turns garage door beeper OFF (Deavitvated HIGH).
   pinMode(garDrOpnPin,    OUTPUT);                // Garage door lock control.
-  pinMode(rearLedPin,     OUTPUT);                // Rear door access keypad led control.
-  digitalWrite(rearLedPin,OFFINV);                // Turns LED RED (Deavitvated HIGH).
-  pinMode(rearBprPin,     OUTPUT);                // Rear door access keypad beeper control.
-  digitalWrite(rearBprPin, OFFINV);               // Turns rear door beeper OFF (Deavitvated HIGH).
-  pinMode(rearDrLckPin,   OUTPUT);                // Rear door lock control.
-  digitalWrite(rearDrLckPin, OFF);                // Lock front door.
   pinMode(rearBelPin,     OUTPUT);                // Rear door BELL OUTPUT.
-  pinMode(shedDrLckPin,   OUTPUT);                // Shed door lock control.
 
   // BUTTON RELATED I/O PINS
-  pinMode(frtBelBtnPin,   INPUT_PULLUP);          // Front door RFID Access keypad Bell button. Handled by EasyButton Library.
+  pinMode(frtBelBtnPin,   INPUT_PULLUP);          // Front door RFID Access keypad Bell button. Handled by "inputs".
   pinMode(rearBelBtnPin,  INPUT_PULLUP);          // Library.Rear door RFID Access keypad Bell button.
   pinMode(garBelBtnPin,   INPUT_PULLUP);          // Front door RFID Access keypad Bell button.
-  pinMode(garDrWalSwPin,  INPUT_PULLUP);          // Garage Door Open/close switch (wall switch). Handled by EasyButton Library.
+  pinMode(garDrWalSwPin,  INPUT_PULLUP);          // Garage Door Open/close switch (wall switch). Handled by "inputs".
   pinMode(intDrBtnPin,    INPUT_PULLUP);          // Library.Intercom door unlock button (used to unlock front door).
   pinMode(intAuxBtnPin,   INPUT_PULLUP);          // Intercom door unlock button (used to unlock front door).
 
@@ -966,6 +1467,9 @@ void setup()
   ICR1=2082;                                      // fPWM=120Hz (20msec). (16MHz/64)/120Hz=2083-1=2082
   TIMSK1 |= (1 << TOIE1);                         // enable timer overflow interrupt
 
+  // INITIALIZE BACKGROUND SAMPLING -------------------------------------------------------------------------------
+  sampler.begin();                                // ADC on interrupt, inputs read at each timer tick (120Hz).
+
   // INITIALIZE PIN CHANGE INTERRUPT FOR PORTB PINS D11, D12, D13 for keypad location detection -------------------
   PCICR |=  B00000001;                            // Bit0 = 1 -> "PCIE0" enabeled (PCINT0 - PCINT5)
   PCMSK0 |= B11100000;           // Bit2,3 = 1 -> "PCINT5,6,7" enabeled -> D11, D12, D13 will trigger an interrupt.
@@ -988,23 +1492,22 @@ void setup()
   // INITIALIZE RFID DATABASE -------------------------------------------------------------------------------------
   #if defined RFID
     db.begin();
+    db.nameIndex(&nameIdx);
+    #if defined DBSYNC
+      db.journal(&dbJnl);                         // Changes are recorded once the journal is started below.
+    #endif
+    grpLoad();
+    acsRebuild();
   #endif
   
   // INITIALIZE SWITCHES ------------------------------------------------------------------------------------------
-  #if defined SWITCHES
-    frtBelBtn.begin();
-    garDrWalSw.begin();
-    garBelBtn.begin();
-    garDrDnSw.begin();
-    garDrUpSw.begin();
-    rearBelBtn.begin();
-    intDrBtn.begin();
-    intAuxBtn.begin();
-    
-    garDrWalSw.onPressedFor(HOLDTM, longPressGarDrWalSw);
-    garDrWalSw.onPressed(singlePressGarDrWalSw);    
-  #endif
+  inputs.longPress(INGARWAL, HOLDTM);             // Long press disables the garage door timer, see "checkBtn".
+  inputs.begin();                                 // Enables PCINT2 for the PORTK buttons.
   
+  // INITIALIZE EEPROM METER --------------------------------------------------------------------------------------
+  eeMeter.begin(eAddrWear);                       // Loads wear counts saved before the last reset.
+  eeMeter.op(EEOP_CONFIG);                        // Writes outside the database, DST and error log are configuration.
+
   // INITIALIZE DEFAULT CONFIGURATION VALUES IN EEPROM ------------------------------------------------------------
   // USED TO RESET EEPROM SHOULD BE COMMENTED OUT DURING NORMAL OPERATION.
   //   EEPROM.write(eAddr,0xFF);// Used to reset EEPROM values (Run once to reset values).
@@ -1012,191 +1515,41 @@ void setup()
 
   if(!(EEPROM.read(eAddr) == 0xAA))
   {
-    EEPROM.write(eAddr, 0xAA);          // Test byte to see if data has been written to EEPROM at least once.
-    delay(10);                          // More writes will only give errors when _EEPROMEX_DEBUG is set.
-    EEPROM.write(eAddrSetMon, SETMONDEFAULT);     // Initialize verbose default setting (OFF).
-    delay(10);
-    EEPROM.write(eAddrDsplyTmr, DSPLYTMRDEFAULT); // Initialize OLED on timer (default = 10 seconds).
-    delay(10);
-    EEPROM.write(eAddrProgTime, PROGTIMERDEFAULT);// Initialize configuration timeout, (default = 30 seconds).
-    delay(10);
-    EEPROM.write(eAddrRetryCnt, RETRYCNTDEFAULT); // Initialize user ID retry count, (default = 3 retrys)
-    delay(10);
-    EEPROM.write(eAddrFrtDrLckTmr, FRTDRLOCKTMRDEFAULT);// Initialize unlock delay time, (default = 5 seconds).
-    delay(10);
-    EEPROM.write(eAddrRrDrLckTmr, RRDRLOCKTMRDEFAULT);  // Initialize unlock delay time, (default = 5 seconds).
-    delay(10);
-    EEPROM.write(eAddrShdDrLckTmr, SHDDRLOCKTMRDEFAULT);// Initialize unlock delay time, (default = 5 seconds).
-    delay(10);
-    EEPROM.write(eAddrBkLtTmr, BKLTTMRDEFAULT);   // Initialize keypad backlight on delay, (default = 15 seconds).
-    delay(10);
-    EEPROM.write(eAddrKeyTmr, KEYTMRDEFAULT);     // Initialize keypad time-out delay, (default = 20 seconds).
-    delay(10);
-    EEPROM.write(eAddrKpLckTm, KPLCKTMDEFAULT);   // Initialize keypad Lock delay, after retry count is exceeded (default = 5 minutes).
-    delay(10);
-    EEPROM.write(eAddrErrCode, ERRORCODEDEFAULT); // Initialize last errorcode, (default = 00).
-    delay(10);
-    EEPROM.write(eAddrGarDrTmr, GARDRTMRDEFAULT); // Initialize Garage door timer, (default = 30).
-    delay(10);
-    EEPROM.write(eAddrDst, DSTDEFAULT);           // Initialize DST. 0 = Standard time, 1 = DST, Default = 0.
-    delay(10);
-    EEPROM.write(eAddrTOffset, TEMPROFFSETDEFAULT);// RTC's temperature offset value.
-    delay(10);
-    EEPROM.write(eAddrTemprScale,TEMPRSCALEDEFAULT);
-    delay(10);
-    EEPROM.write(eAddrGarDrSn,GARDRSNDEFAULT);
-    delay(10);
-    EEPROM.write(eAddrMenuTimeout,MENUTIMEOUTDEFAULT);
-    delay(10);
-    EEPROM.write(eAddrBkLtLed,BKLTLEDDEFAULT);
-    delay(10);
-    EEPROM.write(eAddrLcdContr,LCDCONTRDEFAULT);
-    delay(10);
-  }
-
-  // Setup callbacks for SerialCommand commands
-  SCmd.addCommand("rvb", readVerbose);            // Reads/display all values and parameters.
-  SCmd.addCommand("rar", readAcsCnt);             // Reads/display the maximum keypad retry count.
-  SCmd.addCommand("rkt", readKpTmOut);            // Reads/display the keypad timeout delay, Default = 30 seconds.
-  SCmd.addCommand("rud", readUnlckDly);           // Reads/display the unlock delay. Default = 5 seconds.
-  SCmd.addCommand("rgs", readGarStatus);          // Reads/display the garage door position.
-  SCmd.addCommand("rkp", readKeypad);             // Reads/displays the keypad data.
-  SCmd.addCommand("rip", readIdPwd);              // Reads/displays the Database user id for a given user number.
-                                                  // If user 999 is entered,all user id and names are displayed.
-  SCmd.addCommand("rdn", readDbNam);              // Reads/displays the user name for a give id in the database.
-  SCmd.addCommand("rle", readLastErr);            // Reads/display the last error code recorded.
-  SCmd.addCommand("rep", eepromDump);             // Displays all internal EEPROM contents.
-  SCmd.addCommand("rtm", readTime);               // Displays current RTC time from the DS3231 I2C chip.
-  SCmd.addCommand("rto", readTOffset);            // Displays current RTC temperature offset set in EEPROM.
-  SCmd.addCommand("rot", readDsplyTmr);           // Reads/displays the OLED OFF display timer.
-  //
-  SCmd.addCommand("svb", setMon);                 // Turn ON/ continuous verbose monitoring every second to serial port.
-  SCmd.addCommand("stm", setTime);                // Set RTC time.
-  SCmd.addCommand("sdt", setDate);                // Set RTC date.
-  SCmd.addCommand("sto", setTOffset);             // Set temperature offset of RTC to calibrate temperature reading.
-  SCmd.addCommand("skt", setKpTmOut);             // Set the keypad timeout, Default - 20 seconds.
-  SCmd.addCommand("sar", setAcsCnt);              // Set the keypad retry count, Default = 3.
-  SCmd.addCommand("slk", setUnlckDly);            // Set the unlock delay. Default = 5 seconds.
-  SCmd.addCommand("sgs", setGarSensor);           // Enable or disable garage door sensors (default = Enabled).
-  SCmd.addCommand("sgt", setGarDrTmr);            // Set the garage door lock timer. Default = 30 minutes.
-  SCmd.addCommand("sot", setdsplyTmr);            // Set the OLED OFF timer. Default = 10 seconds.
-  SCmd.addCommand("sts", setTemprScale);          // Set the temperature scale.
-  //
-  SCmd.addCommand("adi", addDbId);                // Adds user id number in database.
-  SCmd.addCommand("adp", addDbPwd);               // Adds user password in database.
-  SCmd.addCommand("ain", addDbIdNam);             // Adds/modifies user name in database for a given id number.
-  SCmd.addCommand("apn", addDbPwdNam);            // Adds/modifies user name in database for a given password number.
-  SCmd.addCommand("ada", addDbAtt);               // Adds/Modifies user permission in database for a given id number or password.
-  SCmd.addCommand("adt", addDbTm);                // Adds time stamp for user.
-  //
-  SCmd.addCommand("ddi", delDbId);                // Deletes user id number in database.
-  SCmd.addCommand("ddp", delDbPwd);               // Deletes user password in database.
-  SCmd.addCommand("din", delDbIdNam);             // Deletes user name in database for a given id number.
-  SCmd.addCommand("dpn", delDbPwdNam);            // Deletes user name in database for a given id number.
-  SCmd.addCommand("dda", delDbAtt);               // Deletes user permission byte in database for a given id number or password.
-  //
-  SCmd.addCommand("mdi", modDbId);                // Modifies a user id number in database.
-  SCmd.addCommand("mdp", modDbPwd);               // Modifies a user password in database.
-  SCmd.addCommand("min", modDbIdNam);             // Modifies a user name in database for a given id number.
-  SCmd.addCommand("mpn", modDbPwdNam);            // Modifies a user name in database for a given password.
-  //
-  SCmd.addCommand("cdb", clrDb);                  // Clears user database (ID Tags, passwords, user names and attributes.
-  SCmd.addCommand("ccf", clrConfig);              // Clears configuration in EEPROM RFID Database is left unchanged..
-  SCmd.addCommand("cep", clrEeprom);              // Clears All of EEPROM including database and all configuration settings.
-  //
-  SCmd.addCommand("rst", resetFunc);              // Displays menu (commands).
-  SCmd.addCommand("menu", menu);                  // Displays menu (commands).
-  SCmd.addCommand("?", menu);                     // Displays menu (commands).
-  SCmd.addDefaultHandler(menu);                   // Handler for command that isn't matched.
+    eeMeter.write(eAddr, 0xAA);         // Test byte to see if data has been written to EEPROM at least once.
+    eeMeter.write(eAddrSetMon, SETMONDEFAULT);    // Initialize verbose default setting (OFF).
+    eeMeter.write(eAddrDsplyTmr, DSPLYTMRDEFAULT); // Initialize OLED on timer (default = 10 seconds).
+    eeMeter.write(eAddrProgTime, PROGTIMERDEFAULT);// Initialize configuration timeout, (default = 30 seconds).
+    eeMeter.write(eAddrRetryCnt, RETRYCNTDEFAULT); // Initialize user ID retry count, (default = 3 retrys)
+    eeMeter.write(eAddrFrtDrLckTmr, FRTDRLOCKTMRDEFAULT);// Initialize unlock delay time, (default = 5 seconds).
+    eeMeter.write(eAddrRrDrLckTmr, RRDRLOCKTMRDEFAULT); // Initialize unlock delay time, (default = 5 seconds).
+    eeMeter.write(eAddrShdDrLckTmr, SHDDRLOCKTMRDEFAULT);// Initialize unlock delay time, (default = 5 seconds).
+    eeMeter.write(eAddrBkLtTmr, BKLTTMRDEFAULT);  // Initialize keypad backlight on delay, (default = 15 seconds).
+    eeMeter.write(eAddrKeyTmr, KEYTMRDEFAULT);    // Initialize keypad time-out delay, (default = 20 seconds).
+    eeMeter.write(eAddrKpLckTm, KPLCKTMDEFAULT);  // Initialize keypad Lock delay, after retry count is exceeded (default = 5 minutes).
+    eeMeter.write(eAddrErrCode, ERRORCODEDEFAULT); // Initialize last errorcode, (default = 00).
+    eeMeter.write(eAddrGarDrTmr, GARDRTMRDEFAULT); // Initialize Garage door timer, (default = 30).
+    eeMeter.write(eAddrDst, DSTDEFAULT);          // Initialize DST. 0 = Standard time, 1 = DST, Default = 0.
+    eeMeter.write(eAddrTOffset, TEMPROFFSETDEFAULT);// RTC's temperature offset value.
+    eeMeter.write(eAddrTemprScale,TEMPRSCALEDEFAULT);
+    eeMeter.write(eAddrGarDrSn,GARDRSNDEFAULT);
+    eeMeter.write(eAddrMenuTimeout,MENUTIMEOUTDEFAULT);
+    eeMeter.write(eAddrBkLtLed,BKLTLEDDEFAULT);
+    eeMeter.write(eAddrLcdContr,LCDCONTRDEFAULT);
+    eeMeter.write(eAddrDcTtl, DCTTLDEFAULT);      // Initialize duplicate tag window, (default = 2 seconds).
+    eeMeter.write(eAddrEnrolKp, ENROLKPDEFAULT);  // Initialize enrol keypad, (default = front door).
+  }
 
+  console.setFrameHandler(conFrame);              // Lines starting with '{' are machine protocol requests.
+  dcLoad();
   runState = NORMAL;                              // Stert in normal operating mode.
 
-  #if PROTOTYPE
-    Serial.println (F("PROTOTYPE CONFIGURATION USED"));
-  #endif
-     
-  #if DEBUG
-    Serial.println (F("DEBUGGING MODE IS ON"));
-  #endif
-
- // INITIALIZE RTC OBJECT -----------------------------------------------------------------------------------------
-  #if defined CLOCK
-    if (! rtc.begin())
-    {
-      uint8_t i=0;
-      while (i < 10)
-      {
-        delay(10);
-        Serial.println("Couldn't find RTC");
-        i++;
-      }
-    }
-    if (rtc.lostPower())
-    {  
-      Serial.println("RTC lost power, let's set the time!");
-      rtc.adjust(DateTime(F(__DATE__), F(__TIME__)));
-      DateTime now = rtc.now();
-      // PC's compile time is in STANDARD TIME only. The line below adjusts for DST if DST flag is set in EEPROM.
-      if(EEPROM.read(eAddrDst)){rtc.adjust(DateTime(now.year(), now.month(), now.day(), now.hour()+1, now.minute(), now.second()));}
-    }
-
-    // When time needs to be re-set on a previously configured device, the    
-    // following line sets the RTC to the date & time this sketch was compiled
-    // rtc.adjust(DateTime(F(__DATE__), F(__TIME__)));
-  
-    // This line sets the RTC with an explicit date & time, for example to set
-    // January 21, 2014 at 3am you would call:
-    // rtc.adjust(DateTime(2014, 1, 21, 3, 0, 0));
-
-    // SETUP OF RTC SO OSC KEEPS RUNNING WHEN ON BATTAERY POWER -----------------------------------------------------
-    #define DS3231_I2C_ADDRESS 0x68               // 0x68 is the RTC address
-    //  Wire.begin();                             // Not needed. Called by rtc library.
-    //  Wire.beginTransmission(DS3231_I2C_ADDRESS);// Not needed. Called by rtc library.
-    Wire.write(0xE);                              // Address the Control Register
-    Wire.write(0x00);                             // Write 0x0 to control Register
-    Wire.endTransmission();
-    Wire.beginTransmission(DS3231_I2C_ADDRESS);
-    Wire.write(0xF);                              // Address the Status register
-    Wire.write(0x00);                             // Write 0x0 to Status Register
-    Wire.endTransmission();
-  #endif
-            
-
-    lcd.begin(LCDCOL,LCDROW);                  // columns, rows.  use 20,4 for a 20x4 LCD, etc.
-
-  
-  // INITIALIZE OLED DISPLAY --------------------------------------------------------------------------------------
-  // initialize with the I2C addr 0x3C (for the 128x32)
-  // Check your I2C address and enter it here, in Our case address is 0x3C
-  #if defined OLEDDISPLAY
-    oled.begin(SSD1306_SWITCHCAPVCC, OLEDADR);
-    oled.clearDisplay();
-    oled.display();                               // this command will display all the data which is in buffer
-    oled.ssd1306_command(SSD1306_DISPLAYOFF);
-    oled.setTextColor(WHITE, BLACK);
-  #endif
-
-  readVerbose();
-
-  #if defined OLEDDISPLAY
-    drawRev();
-  #endif
-
-  #if defined SOUND
-    startupTone();                                // Play close encounters of the 3rd kind.
-  #endif
-
-  #if defined RGBLED
-    ledSelfTest();                                // Toogle all leds
-  #endif
-
-  #if defined OLEDDISPLAY
-    oled.clearDisplay();                          // Clear the buffer
-    oled.display();                               // Show buffer containts on the display.
-  #endif
+  // INITIALIZE SCHEDULE PROFILES ---------------------------------------------------------------------------------
+  for(uint8_t p = 0; p < SCHPROFILES; p++)
+  {
+    for(uint8_t i = 0; i < SCHBYTES; i++){schTable[p][i] = EEPROM.read(eAddrSch + p * SCHBYTES + i);}
+  }                                               // "schSlot" is set once the RTC is up (BOOTRTC).
 
-  //  bprSelfTest();                              // Check keypad buzzers.
-  help();
+  bootReadyUs = micros();                         // Doors are served from here, the rest runs from "loop".
 }
 
 //#################################################################################################################
@@ -1204,6 +1557,7 @@ void setup()
 //#################################################################################################################
 void loop()
 {
+  if(bootStage != BOOTDONE){bootTask();}         // Startup tasks left for after the doors are served.
   switch (runState)
   {
     case NORMAL:
@@ -1214,10 +1568,139 @@ void loop()
       progMode();
     break;
   }
-  SCmd.readSerial();                              // We don't do much, just process serial commands}
+  console.readSerial();                           // Process serial commands (never waits for input).
+  #if defined DBSYNC
+    if(bootStage > BOOTSYNC){dbSync.service();}   // Exchange database changes with the other controller (never waits).
+  #endif
+  #if defined EVENTS
+    if(bootStage > BOOTEVENTS)
+    {
+      evPort.maintain();                          // Reconnect the collector, receive its next datagram.
+      evLink.service();                           // Send access events, answer collector requests (never waits).
+    }
+  #endif
   readEncoder();                                  // Check if encoder has moved, display temperature in hires (smallFont).
 }
 
+//#################################################################################################################
+// DEFERRED STARTUP METHOD
+//#################################################################################################################
+// Runs the next startup task left out of "setup" (see BOOTSTAGE), one per loop pass, so keypads and locks are
+// served from the first pass. Replication and the event link are only serviced once started.
+void bootTask()
+{
+  switch(bootStage)
+  {
+    case BOOTRTC:                               // INITIALIZE RTC OBJECT
+    #if defined CLOCK
+      if (! rtc.begin())
+      {
+        Serial.println(F("Couldn't find RTC"));
+      }
+      if (rtc.lostPower())
+      {  
+        Serial.println("RTC lost power, let's set the time!");
+        rtc.adjust(DateTime(F(__DATE__), F(__TIME__)));
+        DateTime now = rtc.now();
+        // PC's compile time is in STANDARD TIME only. The line below adjusts for DST if DST flag is set in EEPROM.
+        if(EEPROM.read(eAddrDst)){rtc.adjust(DateTime(now.year(), now.month(), now.day(), now.hour()+1, now.minute(), now.second()));}
+      }
+
+      // When time needs to be re-set on a previously configured device, the    
+      // following line sets the RTC to the date & time this sketch was compiled
+      // rtc.adjust(DateTime(F(__DATE__), F(__TIME__)));
+  
+      // This line sets the RTC with an explicit date & time, for example to set
+      // January 21, 2014 at 3am you would call:
+      // rtc.adjust(DateTime(2014, 1, 21, 3, 0, 0));
+
+      // SETUP OF RTC SO OSC KEEPS RUNNING WHEN ON BATTAERY POWER ----------------------------------------------------
+      #define DS3231_I2C_ADDRESS 0x68               // 0x68 is the RTC address
+      //  Wire.begin();                             // Not needed. Called by rtc library.
+      //  Wire.beginTransmission(DS3231_I2C_ADDRESS);// Not needed. Called by rtc library.
+      Wire.write(0xE);                              // Address the Control Register
+      Wire.write(0x00);                             // Write 0x0 to control Register
+      Wire.endTransmission();
+      Wire.beginTransmission(DS3231_I2C_ADDRESS);
+      Wire.write(0xF);                              // Address the Status register
+      Wire.write(0x00);                             // Write 0x0 to Status Register
+      Wire.endTransmission();
+    #endif
+    schUpdate();                                  // Schedules are checked from here (see "schAllowed").
+    break;
+
+    case BOOTSYNC:                              // INITIALIZE DATABASE REPLICATION
+    #if defined DBSYNC
+      #if defined CLOCK
+        dbJnl.begin((uint16_t)rtc.now().unixtime()); // Epoch differs at each start, the peer knows older changes are gone.
+      #else
+        dbJnl.begin((uint16_t)micros());
+      #endif
+      dbSync.begin(eAddrSyncd);                   // A controller never synchronized does not send its database.
+      dbSync.clock(timeStmp);                     // Temporary access is sent as minutes left, rebased by the peer.
+      Serial2.begin(115200);
+    #endif
+    break;
+
+    case BOOTEVENTS:                            // INITIALIZE ACCESS EVENT LINK
+    #if defined EVENTS
+      #if defined ETHERNET
+        pinMode(SdSelPin, OUTPUT);
+        digitalWrite(SdSelPin, HIGH);               // SD card of the Ethernet board off the SPI bus.
+        Ethernet.init(W5100SelPin);
+        Ethernet.begin(ethMac, ethIp);              // Fixed address, DHCP could wait a minute.
+      #else
+        Serial3.begin(115200);
+      #endif
+      evPort.begin();
+      evLink.setFrameHandler(evFrame);              // Machine protocol requests of the collector.
+    #endif
+    break;
+
+    case BOOTDISPLAY:                           // INITIALIZE LCD AND OLED DISPLAY
+      lcd.begin(LCDCOL,LCDROW);                 // columns, rows.  use 20,4 for a 20x4 LCD, etc.
+      // initialize with the I2C addr 0x3C (for the 128x32)
+      // Check your I2C address and enter it here, in Our case address is 0x3C
+      #if defined OLEDDISPLAY
+        oled.begin(SSD1306_SWITCHCAPVCC, OLEDADR);
+        oled.clearDisplay();
+        oled.display();                         // this command will display all the data which is in buffer
+        oled.ssd1306_command(SSD1306_DISPLAYOFF);
+        oled.setTextColor(WHITE, BLACK);
+        drawRev();
+      #endif
+    break;
+
+    case BOOTGREET:
+      #if PROTOTYPE
+        Serial.println (F("PROTOTYPE CONFIGURATION USED"));
+      #endif
+      #if DEBUG
+        Serial.println (F("DEBUGGING MODE IS ON"));
+      #endif
+      readVerbose();
+      #if defined SOUND
+        startupTone();                          // Play close encounters of the 3rd kind.
+      #endif
+      #if defined RGBLED
+        ledSelfTest();                          // Toogle all leds
+      #endif
+      //  bprSelfTest();                          // Check keypad buzzers.
+      help();
+    break;
+
+    case BOOTCLEAR:
+      if(millis() < BOOTREVMS){return;}         // Firmware revision still shown.
+      #if defined OLEDDISPLAY
+        oled.clearDisplay();                    // Clear the buffer
+        oled.display();                         // Show buffer containts on the display.
+      #endif
+      bootDoneMs = millis();
+    break;
+  }
+  bootStage++;
+}
+
 //#################################################################################################################
 // RUN MODE METHOD
 //#################################################################################################################
@@ -1261,46 +1744,22 @@ void runMode()
     } 
 
     if (EEPROM.read(eAddrSetMon)){readVerbose();} // Display all data (if set through "svb" command).
-    if (retryCnt >= EEPROM.read(eAddrRetryCnt)){digitalWrite(frtLedPin, !digitalRead(frtLedPin));}
+    kpService();                                  // Keypad entry timers, flash LED of locked out keypads.
     oneHzTick = OFF;                              // Reset 1Hz timer flag.
   }
 
   if(oneMnTick)
   {
     checkDst();                                   // Check for DST.
+    schUpdate();                                  // Day/hour slot used by the access schedules.
+    if(timeStmp > acsNextExp){acsSweep();}        // A temporary access has expired.
+    eeMeter.tick();                               // Run time the EEPROM wear counts cover.
+    if(eeMeter.minutes() % 1440 == 0){eeMeter.save();} // Keep the wear counts across resets once a day.
     oneMnTick = OFF;
   }
 
-  if(retryCnt < EEPROM.read(eAddrRetryCnt))
-  {
-    idPwd = chkKeypad();                          // Checks to see if valid ID tag or password is entered.
-    if(idPwd)                                     // gets ID tag from keypad.
-    {
-      if(db.contains(idPwd))                      // Check if id Tag or password found in database.
-      {
-        retryCnt = 0;                             // id Tag or passord valid, so reset ID/Paswword retry count.
-        pos = db.posOf(idPwd);
-        //userInfo(pos);
-        //displayPerm();
-        procAtt(pos);                             // Checks permission to unlock door for given ID or password.
-        idPwd = 0;                                // Clear id tag/password buffer.    
-      }
-      else
-      {
-        readTmDt();
-        Serial.println(F("ID OR PASSWORD NOT FOUND IN DATBASE"));
-        retryCnt++;                               // Flag incorrect TagId or password.
-        KpLckTm = timeStmp + EEPROM.read(eAddrKpLckTm);          // Set the keypad lockout time period. 
-        errorTone();
-      }
-    }
-  }
-  else if(timeStmp > KpLckTm)                     // If keypad timeout has expired, reset keypad lockout.
-  {
-    KpLckTm =0;                                   
-    retryCnt = 0;                                 // Remove ketpad lock-out.
-    digitalWrite(frtLedPin, OFFINV);              // Reset keypad LED.
-  }
+  acsService();                                   // Database may have changed through the console.
+  kpFrame();                                      // Checks for an ID tag or keypad entry.
   checkLocks();                                   // Monitor lock status and lock timer. Lock doors once expired.
   checkBtn();                                     // Checks all push buttons for change in status.
 }
@@ -1318,162 +1777,192 @@ void progMode()
 }
 
 //#################################################################################################################
-// PROCESS ATTRIBUTE METHOD
+// OPEN LOCK METHOD
 //#################################################################################################################
-// Checks if password is required with ID tag.
-bool procAtt(int16_t user)
+// Checks open type (permanent, temporary, onetime) in attribute for user to confirm access and on which door.
+// Note "user" variable passed from "kpEntry" method shows position only. PWDFLAG has been stripped as it is 
+// not needed. "loc" is the keypad location the user entered the ID or password at, "key" and "typed" the key of
+// the access event (see "evPush"). Returns the decision (EV_GRANTED, EV_NOPERM or EV_SCHEDULE).
+uint8_t unlockDoor(int16_t userPos, uint8_t loc, uint32_t key, bool typed) // Open (lock) solenoid.
 {
-//  uint8_t att;
-//  uint32_t  idPwd = 0;
-  if (user >= PWDFLAG){db.readAtt((user & PWDMASK), att);} // Remove password flag from position info.
-  else{db.readAtt(user, att);}
-  if (att & IDANDPWD)
+  uint8_t   dr;
+
+  readTmDt();
+  db.readNam(userPos, name);                                           // Get name for id or password.
+  Serial.print(name);
+
+  dr = kpDoor[loc];                                                   // Door for the keypad used (see "doorTable").
+  if(!acsMap.allowed(userPos, dr))                                    // Permanent, temporary and one-time access (see "acsRebuild").
   {
-    keyTmr = EEPROM.read(eAddrKeyTmr);
-    while(keyTmr)
-    {
-      idPwd = chkKeypad();
-      if (idPwd)
-      {
-        if (user >= PWDFLAG)                      // 1ST entered password, so now looking for ID.
-        {
-          user &= PWDMASK;
-          if ((db.posOf(idPwd) < PWDFLAG) && (db.posOf(idPwd) == user)){return unlockDoor(user);}
-          else{return false;}
-        }
-        else                                      // 1ST entered ID so now looking for password.
-        {
-          if ((db.posOf(idPwd) >= PWDFLAG) && ((db.posOf(idPwd) & PWDMASK ) == user)){return unlockDoor(user);}
-          else{return false;}
-        }
-      }
-    }
-    return false;                                 // If "WHILE" loop times out, then return.
+    Serial.println(F(" DOES NOT PERMISSION TO OPEN DOOR AT THIS KEYPAD"));
+    evPush(EV_NOPERM, loc, key, typed);
+    return EV_NOPERM;
+  }
+  if(!schAllowed(acsSch[userPos]))                                    // Outside the hours of the user's schedule.
+  {
+    Serial.println(F(" IS OUTSIDE THE HOURS OF ITS ACCESS SCHEDULE"));
+    evPush(EV_SCHEDULE, loc, key, typed);
+    return EV_SCHEDULE;
+  }
+  acsMap.use(userPos);                                                // Revokes one-time access, EEPROM is updated by "acsService".
+  evPush(EV_GRANTED, loc, key, typed);
+
+  if(dr < DOORCOUNT)                                                  // Unlock door at this keypad.
+  {
+    Serial.print(F(" IS UNLOCKING "));
+    printMsg((const char *)pgm_read_ptr(&doorTable[dr].name));
+    Serial.print(F("..."));
+    unlockDr(dr);
   }
-  else                                            // Code + Pwd not required so just open door.
+  else                                                                // Id Tag or password from garage keypad with GARAGE attribute set.
   {
-    if (user >= PWDFLAG){user &= PWDMASK;}
-    return unlockDoor(user);
+    if(inputs.pressed(INGARDN)){Serial.print(F(" IS UNLOCKING"));}
+    else{Serial.print(F(" IS LOCKING"));}
+    Serial.print(F(" GARAGE DOOR, "));
+    garDrCntl();
   }
+  return EV_GRANTED;
 }
 
 //#################################################################################################################
-// OPEN LOCK METHOD
+// KEYPAD SESSION METHODS
 //#################################################################################################################
-// Checks open type (permanent, temporary, onetime) in attribute for user to confirm access and on which door.
-// Note "user" variable passed from "procAtt"  method shows position only. PWDFLAG has been stripped as it is 
-// not needed.
-bool unlockDoor(int16_t userPos)                     // Open (lock) solenoid.
+// Passes a decoded Wiegand frame to the session of the keypad that sent it. Tag IDs (W26/W34) are processed at once,
+// keypad digits (W4) are added to the session until "#" is pressed. Frames from a locked out keypad are ignored.
+// A tag read again at the same keypad within the duplicate tag window is absorbed by "dcache".
+void kpFrame()
 {
-  //uint8_t att;
-  //char name[NAMELENGTH];
-  //uint32_t      idPwd = 0;
-  uint32_t  tm    = 0;
-
-  readTmDt();
-  db.readNam(userPos, name);                                           // Get name for id or password.
-  Serial.print(name);
-  
-  db.readAtt(userPos, att);                                             // Reads attribute of user position in database.
-  if((att & ONETMACCESS) || (att & TEMPACCESS) || (att & PERMACCESS))   // Processes the type of access (onetime, temporary or permanent).
+  uint8_t     loc;
+  uint8_t     dec;
+  uint32_t    code;
+  KpSession   *kp;
+
+  if(!wg.available()){return;}
+  loc = keyPdLoc;                                 // Keypad which sent the frame.
+  if(loc > SHEDDRKEYPD){loc = NOKEYPD;}
+  kp = &kpSession[loc];
+  if(kp->retryCnt >= EEPROM.read(eAddrRetryCnt)){return;}  // Keypad locked out.
+
+  code = wg.getCode();
+  if(wg.getWiegandType() == 26 || wg.getWiegandType() == 34)   // TagID received.
   {
-    if (att & ONETMACCESS)                                              // Check for ONE TIME ACCESS.
-    {
-      if(!db.readId(userPos, idPwd)){db.readPwd(userPos,idPwd);}              // Get ID or password.
-      db.insertAtt(idPwd, (att & ~ONETMACCESS));                        // Turn off one time use for this user.
-    }
-
-    if (att & TEMPACCESS)                                               // Check for TIME LIMITED ACCESS
+    if(console.awaiting() && loc == enrolKp()){kpEntry(loc, code, false); return;}  // Tag for a CLI command, never cached.
+    if(dcache.seen(loc, code, millis(), dec)){return;}            // Same card still held, already decided.
+    dec = kpEntry(loc, code, false);
+    dcache.put(loc, code, dec, millis());
+  }
+  else if(wg.getWiegandType() == 4)
+  {
+    kp->tmr = EEPROM.read(eAddrKeyTmr);           // Reset keypad timer.
+    if (code == '#')                              // # acts as "Enter" key.
     {
-      // If timer is greater than time period set then return  .
-      if (!db.readTm(userPos,tm)){return false;}
-      else if (timeStmp > tm)                                           // Time expired, disable temporary access.
+      // If garage door is open and no value was entered, just pressing the # key will close the garage door.
+      if(kp->keyVal == 0 && !inputs.pressed(INGARDN) && loc == GARDRKEYPD)
       {
-        if(!db.readId(userPos, idPwd)){db.readPwd(userPos,idPwd);}            // Find id or password for user.
-        db.insertAtt(idPwd,att & ~TEMPACCESS);                          // Turn off temp access.
-        return false;                                                   // Temp access expired, so do NOT unlock door.
+        readTmDt();
+        Serial.print(F("# KEY PRESSED ON GARAGE KEYPAD, "));
+        garDrCntl();
       }
+      code = kp->keyVal;
+      kp->keyVal = 0;                             // Clear accumilator for next entry.
+      if(code){kpEntry(loc, code, true);}
     }
-
-    if((att & FRTDRLOCK) && (keyPdLoc == FRTDRKEYPD))                      // Unlock front door.
-    {
-      Serial.print(F(" IS UNLOCKING FRONT DOOR..."));
-      unlockFrtDr();
-    }
-
-    else if((att & REARDRLOCK) && (keyPdLoc == REARDRKEYPD))               // Unlock rear door.
+    else if(code == '*')
     {
-      Serial.print(F(" IS UNLOCKING REAR DOOR..."));     
-      unlockRearDr();
+      progTimer = EEPROM.read(eAddrProgTime);
+      runState = PROGRAM;
+      kp->keyVal = 0;
     }
+    else{kp->keyVal = kp->keyVal * 10UL + code;}
+  }
+}
 
-    else if((att & SHEDDRLOCK) && (keyPdLoc == SHEDDRKEYPD))               // Unlock Shed door.
-    {
-      Serial.print(F(" IS UNLOCKING SHED DOOR..."));     
-      unlockShedDr();
-    }
+// Processes an ID tag or keypad entry. Users with the ID + password attribute must enter the other one on the same
+// keypad before the keypad timer expires. Unknown entries count towards the keypad lock-out. Returns the decision
+// (EV_xxx), 0 while the other entry is awaited or if the entry went to a CLI command. An entry "typed" on the keypad
+// is never sent to the collector, its events carry the user number instead (see "evPush").
+uint8_t kpEntry(uint8_t loc, uint32_t idPwd, bool typed)
+{
+  KpSession   *kp   = &kpSession[loc];
+  int16_t     user;
+  uint32_t    evKey;
+  uint8_t     usrAtt = 0;
+  uint8_t     dec;
 
-   // Check id Tag or password from garage keypad ONLY with GARAGE attribute set.
-    else if((att & GARDRLOCK) && (keyPdLoc == GARDRKEYPD))
+  if(console.awaiting() && loc == enrolKp())      // A CLI command is waiting for a tag or keypad entry.
+  {
+    console.feedNum(idPwd);
+    return 0;
+  }
+  user = db.posOf(idPwd);
+  evKey = typed ? (user >= 0 ? (user & PWDMASK) + 1 : 0) : idPwd;
+  if(kp->stage == KPSECOND)                       // 2ND entry, must be the other one of the same user.
+  {
+    kp->stage = KPIDLE;
+    kp->tmr = 0;
+    if(user >= 0 && (user & PWDMASK) == (kp->user & PWDMASK) && (user >= PWDFLAG) != (kp->user >= PWDFLAG))
     {
-      if(digitalRead(garDrDnSwPin) == ONINV){Serial.print(F(" IS UNLOCKING"));}
-      else{Serial.print(F(" IS LOCKING"));}
-      Serial.print(F(" GARAGE DOOR, "));
-      garDrCntl();
+      dec = unlockDoor(user & PWDMASK, loc, evKey, typed);
+      acsService();                               // Door is open, now clear one-time access in EEPROM.
+      return dec;
     }
-    else
+    readTmDt();
+    Serial.println(F("ID AND PASSWORD DO NOT MATCH"));
+    evPush(EV_MISMATCH, loc, evKey, typed);
+    dec = EV_MISMATCH;
+  }
+  else if(user < 0)
+  {
+    readTmDt();
+    Serial.println(F("ID OR PASSWORD NOT FOUND IN DATBASE"));
+    evPush(EV_UNKNOWN, loc, evKey, typed);
+    dec = EV_UNKNOWN;
+  }
+  else
+  {
+    kp->retryCnt = 0;                             // id Tag or passord valid, so reset ID/Paswword retry count.
+    db.readAtt(user & PWDMASK, usrAtt);
+    if(usrAtt & IDANDPWD)                         // ID + password required, wait for the other one.
     {
-      Serial.println(F(" DOES NOT PERMISSION TO OPEN DOOR AT THIS KEYPAD"));
-      return false;
+      kp->stage = KPSECOND;
+      kp->user = user;
+      kp->tmr = EEPROM.read(eAddrKeyTmr);
+      return 0;
     }
+    dec = unlockDoor(user & PWDMASK, loc, evKey, typed);
+    acsService();                                 // Door is open, now clear one-time access in EEPROM.
+    return dec;
   }
-  return true;
+  kp->retryCnt++;                                 // Flag incorrect TagId or password.
+  kp->lckTm = timeStmp + EEPROM.read(eAddrKpLckTm);  // Set the keypad lockout time period.
+  if(kp->retryCnt == EEPROM.read(eAddrRetryCnt))
+  {
+    evPush(EV_LOCKOUT, loc, evKey, typed);
+    if(kpDoor[loc] != NODOOR){fb.play(FBLED + kpDoor[loc], fbLockout);}   // Keypad LED flashes while locked out.
+  }
+  errorTone(kpDoor[loc]);
+  return dec;
 }
 
-//#################################################################################################################
-// CHECK KEYPAD METHOD
-//#################################################################################################################
-// Waits for a numerical input from keypad during normal operation.
-uint32_t chkKeypad()
+// Runs once per second. Drops entries not completed in time and ends expired lock-outs.
+void kpService()
 {
-  uint32_t arg = 0;
-  if(wg.available())
+  for(uint8_t loc = 0; loc <= SHEDDRKEYPD; loc++)
   {
-    if(wg.getWiegandType() == 26 || wg.getWiegandType() == 34)
-    {return wg.getCode();}                        // TagID received so exit.
-    else if(wg.getWiegandType() == 4)
+    KpSession *kp = &kpSession[loc];
+    uint8_t   dr  = kpDoor[loc];
+
+    if(kp->tmr && !--kp->tmr)                     // Entry timed out.
     {
-      keyTmr = EEPROM.read(eAddrKeyTmr);          // Reset keypad timer.  
-      arg =  wg.getCode();                        // larger variable to make math easier.
-      if (arg == '#')                             // # acts as "Enter" key.
-      {
-        // If garage door is open and no value was entered, just pressing the # key will close the garage door.
-       if(keyVal == 0 && digitalRead(garDrDnSwPin) == OFFINV && keyPdLoc == GARDRKEYPD) 
-        {
-        readTmDt();
-        Serial.print(F("# KEY PRESSED ON GARAGE KEYPAD, "));
-          keyTmr = 0;
-          arg = 0;                              // Clear "#" for next pass.
-          garDrCntl();
-        }
-        
-        arg = keyVal;
-        keyVal = 0;                               // Clear accumilator for next cycle
-        return arg;                               // Returns keypad etntry.
-      }
-      else if(arg == '*')
-      {
-        progTimer = EEPROM.read(eAddrProgTime);
-        runState = PROGRAM;
-        keyVal = 0;
-      }
-      else
-      {
-        keyVal = keyVal * 10UL + arg;
-      }
+      kp->keyVal = 0;
+      kp->stage = KPIDLE;
+    }
+    if(kp->retryCnt >= EEPROM.read(eAddrRetryCnt) && timeStmp > kp->lckTm)
+    {                                             // If keypad timeout has expired, reset keypad lockout.
+      kp->retryCnt = 0;                           // Remove ketpad lock-out.
+      if(dr != NODOOR){fb.stop(FBLED + dr);}      // Reset keypad LED.
     }
   }
-  return 0;
 }
 
 //#################################################################################################################
@@ -1661,7 +2150,7 @@ void drawVin()
   drawText(0,0,"*** VIN ***",1);
   oled.setTextSize(2);
   oled.setCursor(15,9);
-  oled.print(analogRead(vinPin),1);
+  oled.print(sampler.analog(SNVIN) / (float)SMP_OVERSAMPLE, 1); // ADC counts, averaged in the background.
   oled.print(F("VDC"));
 }
 
@@ -1675,7 +2164,7 @@ void drawVcc()
   drawText(0,0,"*** VCC ***",1);
   oled.setTextSize(2);
   oled.setCursor(15,9);
-  oled.print(analogRead(vccPin),1);
+  oled.print(sampler.analog(SNVCC) / (float)SMP_OVERSAMPLE, 1);
   oled.print(F("VDC"));
 }
 
@@ -1739,6 +2228,11 @@ void readVerbose()                                // Read all battery parametrs
   Serial.print(F("RFID_LOCK, "));
   Serial.print(F("FIRMWARE REVISION "));
   Serial.println(REV);
+  Serial.print(F("DOORS READY "));                // Boot-to-ready time, see "bootTask".
+  Serial.print(bootReadyUs);
+  Serial.print(F(" us AFTER RESET, STARTUP COMPLETED "));
+  if(bootDoneMs){Serial.print(bootDoneMs); Serial.println(F(" ms"));}
+  else{Serial.println(F("PENDING"));}
   readTime();
   //
   // RUN STATE
@@ -1775,8 +2269,13 @@ void readAcsCnt()
 {
   Serial.print(F("LOCK RETRY COUNT IS SET TO = "));
   Serial.print(EEPROM.read (eAddrRetryCnt));
-  Serial.print(F(", CURRENT RETRY COUNT IS = "));
-  Serial.println(retryCnt);
+  Serial.print(F(", CURRENT RETRY COUNT (FRONT/GARAGE/REAR/SHED) IS = "));
+  for(uint8_t loc = FRTDRKEYPD; loc <= SHEDDRKEYPD; loc++)
+  {
+    Serial.print(kpSession[loc].retryCnt);
+    if(loc < SHEDDRKEYPD){Serial.print('/');}
+  }
+  Serial.println();
 }
 
 //#################################################################################################################
@@ -2015,49 +2514,220 @@ void readIdPwd()
 // Displays User name for a given id number in the database.
 void readDbNam()
 {
-  //char name[NAMELENGTH];
-  //char name;
-  //uint32_t idPwd = 0;
-  idPwd = 0;
-  int16_t user;
-  
   Serial.println(F("ENTER A TAG ID OR PASSWORD, OR PLACE A TAG ON THE READER"));
-  if(!argNum(idPwd)){Serial.println(F("NO ID OR PASSWORD ENTERED"));}
-//  else if(!db.contains24(idPwd)){Serial.println(F("ID OR PASSWORD NOT FOUND IN DATABASE"));}
+  argThen(readDbNamStep);
+}
+
+void readDbNamStep()
+{
+  uint32_t  tagId = 0;
+  int16_t   user;
+  
+  if(!argNum(tagId)){Serial.println(F("NO ID OR PASSWORD ENTERED"));}
   else
   {
-    user = db.posOf(idPwd);
+    user = db.posOf(tagId);
     Serial.print(F("NAME FOR ID/PASSWORD \""));
-    Serial.print(idPwd);
+    Serial.print(tagId);
     Serial.print(F("\" IS "));
-    Serial.print(idPwd);
-    Serial.print(F(" IS "));
-    db.readNam(user, name);
-    Serial.println(name);
+    if(user >= 0){user &= PWDMASK;}               // Remove password flag from position info.
+    if(db.readNam(user, name)){Serial.println(name);}
+    else{Serial.println(F("NOT FOUND IN DATABASE"));}
   }
 }
 
 //#################################################################################################################
-// READ GARAGE DOOR STATUS METHOD
+// FIND USER BY NAME METHOD
 //#################################################################################################################
-// utility function for digital clock display: prints preceding colon and leading 0.
-void readGarStatus()
+// Displays the users whose name starts with the letters given, case is ignored. The name index gives the users
+// sharing the first two letters with a binary search, only their names are read from EEPROM to check the rest.
+void findUser()
 {
-  Serial.print(F("GARAGE DOOR SENSORS ARE "));
-
-  if(EEPROM.read(eAddrGarDrSn))
-  { 
-    Serial.println(F("ENABLED"));
-    Serial.print(F("GARAGE DOOR IS "));
-    if(!digitalRead(garDrUpSwPin)){Serial.println(F("OPEN"));}
-    else if(!digitalRead(garDrDnSwPin)){Serial.println(F("CLOSED"));}
-    else{Serial.println(F("IN MOVEMENT"));}
-  }
-  else
+  char      *prefix = console.next();
+  uint8_t   first;
+  uint8_t   found   = 0;
+  uint8_t   len;
+  uint8_t   n;
+
+  if(prefix == NULL){missingArg(); return;}
+  len = strlen(prefix);
+  n = nameIdx.find(prefix, first);
+  for(uint8_t i = first; i < first + n; i++)
   {
-    Serial.println(F("DISABLED"));
+    uint8_t user = nameIdx.slot(i);
+    if(len > 2)                                   // Index holds two letters, compare the rest of the name.
+    {
+      db.readNam(user, name);
+      if(strncasecmp(name, prefix, len) != 0){continue;}
+    }
+    userInfo(user);
+    found++;
   }
-  readGarDrTmr();
+  Serial.print(found);
+  Serial.println(F(" USER(S) FOUND"));
+}
+
+//#################################################################################################################
+// READ DATABASE REPLICATION STATUS METHOD
+//#################################################################################################################
+// Displays the link to the other controller, the changes of each side and how far the other side applied them.
+void readSync()
+{
+  #if defined DBSYNC
+    Serial.print(F("REPLICATION LINK "));
+    Serial.println(dbSync.linkUp() ? F("UP") : F("DOWN"));
+    Serial.print(F("LOCAL  EPOCH "));
+    Serial.print(dbJnl.epoch());
+    Serial.print(F(" CHANGES "));
+    Serial.print(dbJnl.head());
+    Serial.print(F(" APPLIED BY PEER "));
+    Serial.print(dbSync.acked());
+    Serial.print(F(" DIGEST "));
+    Serial.print(dbSync.digest(), HEX);
+    Serial.print(F(" USERS "));
+    Serial.print(db.count());
+    Serial.println(dbSync.paired() ? F(" PAIRED") : F(" NEW"));
+    Serial.print(F("PEER   EPOCH "));
+    Serial.print(dbSync.peerEpoch());
+    Serial.print(F(" CHANGES "));
+    Serial.print(dbSync.peerHead());
+    Serial.print(F(" APPLIED HERE "));
+    Serial.print(dbSync.applied());
+    Serial.print(F(" DIGEST "));
+    Serial.print(dbSync.peerDigest(), HEX);
+    Serial.print(F(" USERS "));
+    Serial.print(dbSync.peerUsers());
+    Serial.println(dbSync.peerPaired() ? F(" PAIRED") : F(" NEW"));
+    Serial.print(F("SNAPSHOTS SENT "));
+    Serial.print(dbSync.snapsSent());
+    Serial.print(F(" RECEIVED "));
+    Serial.print(dbSync.snapsRcvd());
+    Serial.print(F(" FRAMES DROPPED "));
+    Serial.println(dbSync.errors());
+    Serial.println(dbSync.synced() ? F("IN SYNC") : F("NOT IN SYNC"));
+  #else
+    Serial.println(F("REPLICATION NOT ENABLED (DBSYNC)"));
+  #endif
+}
+
+//#################################################################################################################
+// SYNCHRONIZE DATABASE METHOD
+//#################################################################################################################
+// Sends every user to the other controller, which replaces its database. The snapshot is sent in the background.
+void syncDb()
+{
+  #if defined DBSYNC
+    if(!dbSync.linkUp()){Serial.println(F("REPLICATION LINK DOWN")); return;}
+    dbSync.snapshot();
+    Serial.println(F("SENDING DATABASE"));
+  #else
+    Serial.println(F("REPLICATION NOT ENABLED (DBSYNC)"));
+  #endif
+}
+
+//#################################################################################################################
+// READ ACCESS EVENT LINK STATUS METHOD
+//#################################################################################################################
+// Displays the events pushed, acknowledged by the collector, sent again and dropped (ring full).
+void readEvents()
+{
+  #if defined EVENTS
+    Serial.print(F("COLLECTOR LINK "));
+    Serial.println(evPort.connected() ? F("UP") : F("DOWN"));
+    Serial.print(F("EVENTS "));
+    Serial.print(evLink.head());
+    Serial.print(F(" ACKNOWLEDGED "));
+    Serial.print(evLink.acked());
+    Serial.print(F(" WAITING "));
+    Serial.println(evLink.head() - evLink.acked());
+    Serial.print(F("BATCHES "));
+    Serial.print(evLink.batches());
+    Serial.print(F(" SENT AGAIN "));
+    Serial.print(evLink.resent());
+    Serial.print(F(" DROPPED "));
+    Serial.println(evLink.dropped());
+  #else
+    Serial.println(F("ACCESS EVENTS NOT ENABLED (EVENTS)"));
+  #endif
+}
+
+//#################################################################################################################
+// READ DECISION CACHE METHOD
+//#################################################################################################################
+// Displays the duplicate tag window, the decisions recorded, the repeated reads absorbed and the decisions still
+// in the window. "rdc clr" forgets them.
+void readDcache()
+{
+  char          *arg  = console.next();
+  uint32_t      now   = millis();
+  DecisionEntry e;
+
+  if(arg != NULL && strcasecmp(arg, "clr") == 0)
+  {
+    dcache.clear();
+    Serial.println(F("RECENT DECISIONS CLEARED"));
+    return;
+  }
+  Serial.print(F("DUPLICATE TAG WINDOW "));
+  Serial.print(dcache.ttl());
+  Serial.print(F(" ms, DECISIONS "));
+  Serial.print(dcache.decided());
+  Serial.print(F(", READS ABSORBED "));
+  Serial.println(dcache.absorbed());
+  for(uint8_t i = 0; i < DCACHE_ENTRIES; i++)
+  {
+    if(!dcache.entry(i, now, e)){continue;}
+    Serial.print(F("KEYPAD "));
+    Serial.print(e.loc);
+    Serial.print(F("	TAG "));
+    Serial.print(e.code);
+    Serial.print(F("	DECISION "));
+    Serial.print(e.decision);                     // EV_xxx (see "EventLink.h"), 0 = waiting for the password.
+    Serial.print(F("	AGE "));
+    Serial.print(now - e.time);
+    Serial.println(F(" ms"));
+  }
+}
+
+// Returns the keypad location (KEYPADLOC) whose tags and keypad entries go to a CLI command waiting for one. Entries
+// at the other keypads are decided as usual while the command waits.
+uint8_t enrolKp()
+{
+  uint8_t loc = EEPROM.read(eAddrEnrolKp);
+
+  return (loc > SHEDDRKEYPD) ? ENROLKPDEFAULT : loc;  // Not set yet (EEPROM configured by an older revision).
+}
+
+// Sets the duplicate tag window of "dcache" from EEPROM (0.1 second units).
+void dcLoad()
+{
+  uint8_t ttl = EEPROM.read(eAddrDcTtl);
+
+  if(ttl > 240){ttl = DCTTLDEFAULT;}              // Not set yet (EEPROM configured by an older revision).
+  dcache.ttl(ttl * 100);
+}
+
+//#################################################################################################################
+// READ GARAGE DOOR STATUS METHOD
+//#################################################################################################################
+// utility function for digital clock display: prints preceding colon and leading 0.
+void readGarStatus()
+{
+  Serial.print(F("GARAGE DOOR SENSORS ARE "));
+
+  if(EEPROM.read(eAddrGarDrSn))
+  { 
+    Serial.println(F("ENABLED"));
+    Serial.print(F("GARAGE DOOR IS "));
+    if(inputs.pressed(INGARUP)){Serial.println(F("OPEN"));}
+    else if(inputs.pressed(INGARDN)){Serial.println(F("CLOSED"));}
+    else{Serial.println(F("IN MOVEMENT"));}
+  }
+  else
+  {
+    Serial.println(F("DISABLED"));
+  }
+  readGarDrTmr();
 }
 
 //#################################################################################################################
@@ -2070,12 +2740,12 @@ void setMon()
   returnVal = argOnOff();
   if (returnVal == 1)
   {
-    EEPROM.write(eAddrSetMon,ON);
+    eeMeter.write(eAddrSetMon,ON);
     Serial.println(F("CONTINUOUS MONITORING STARTED..."));
   }
   else if (returnVal == 0)
   {
-    EEPROM.write(eAddrSetMon,OFF);
+    eeMeter.write(eAddrSetMon,OFF);
     Serial.println(F("CONTINUOUS MOMITORING STOPPED..."));
   }
 }
@@ -2095,7 +2765,48 @@ void setAcsCnt()                                  // Set lock retry count (defau
   {  
     Serial.print(F("ACCESS CODE RETRY IS SET TO "));
     Serial.println(arg);
-    EEPROM.write(eAddrRetryCnt,arg);
+    eeMeter.write(eAddrRetryCnt,arg);
+  }
+}
+
+//#################################################################################################################
+// SET DUPLICATE TAG WINDOW METHOD
+//#################################################################################################################
+void setDcTtl()                                   // Set duplicate tag window (default = 20, 2 seconds).
+{
+  char    *arg  = console.next();
+  int16_t val   = (arg != NULL) ? atoi(arg) : -1;
+
+  if(val < 0 || val > 240){Serial.println(F("SETTING DUPLICATE TAG WINDOW FAILED (0-240)"));}
+  else
+  {
+    Serial.print(F("DUPLICATE TAG WINDOW IS SET TO "));
+    Serial.print(val * 100);
+    Serial.println(F(" ms"));
+    eeMeter.write(eAddrDcTtl, val);
+    dcLoad();
+  }
+}
+
+//#################################################################################################################
+// ENROL KEYPAD METHODS
+//#################################################################################################################
+void readEnrolKp()
+{
+  Serial.print(F("ENROL KEYPAD IS "));
+  Serial.println(enrolKp());
+}
+
+void setEnrolKp()                                 // Set the enrol keypad (default = 1, front door).
+{
+  int16_t val = argRange(NOKEYPD, SHEDDRKEYPD);
+
+  if(val < 0){Serial.println(F("SETTING ENROL KEYPAD FAILED (0-4)"));}
+  else
+  {
+    Serial.print(F("ENROL KEYPAD IS SET TO "));
+    Serial.println(val);
+    eeMeter.write(eAddrEnrolKp, val);
   }
 }
 
@@ -2111,7 +2822,7 @@ void setKpTmOut()                                 // Set lock retry count (defau
     Serial.print(F("KEYPAD TIMEOUT IS SET TO "));
     Serial.print(arg);
     Serial.println(F(" SECONDS"));
-    EEPROM.write(eAddrKeyTmr,arg);
+    eeMeter.write(eAddrKeyTmr,arg);
   }
 }
 
@@ -2139,21 +2850,21 @@ void setUnlckDly()                                // Set the unlock delay time (
         Serial.print(F("FRONT DOOR UNLOCK DELAY TIME IS SET TO "));
         Serial.print(arg);
         Serial.println(F(" SECONDS"));
-        EEPROM.write(eAddrFrtDrLckTmr, arg);
+        eeMeter.write(eAddrFrtDrLckTmr, arg);
         break;
 
         case 2: 
         Serial.print(F("REAR DOOR UNLOCK DELAY TIME IS SET TO "));
         Serial.print(arg);
         Serial.println(F(" SECONDS"));
-        EEPROM.write(eAddrRrDrLckTmr, arg);
+        eeMeter.write(eAddrRrDrLckTmr, arg);
         break;
 
         case 3: 
         Serial.print(F("SHED DOOR UNLOCK DELAY TIME IS SET TO "));
         Serial.print(arg);
         Serial.println(F(" SECONDS"));
-        EEPROM.write(eAddrShdDrLckTmr, arg);
+        eeMeter.write(eAddrShdDrLckTmr, arg);
         break;
       }
     }
@@ -2171,7 +2882,7 @@ void setGarSensor()
   Serial.print(F("GARAGE DOOR POSITION SENSORS ARE "));
   if (returnVal){Serial.println(F("ENABLED"));}
   else{Serial.println(F("DISABLED"));}
-  EEPROM.write(eAddrGarDrSn,returnVal);
+  eeMeter.write(eAddrGarDrSn,returnVal);
 }
 
 //#################################################################################################################
@@ -2186,7 +2897,7 @@ void setGarDrTmr()                                // Set the garage door lock ti
     Serial.print(F("GARAGE DOOR TIMER IS SET TO "));
     Serial.print(arg);
     Serial.println(F(" MINUTES"));
-    EEPROM.write(eAddrGarDrTmr,(arg));
+    eeMeter.write(eAddrGarDrTmr,(arg));
   }
 }
 
@@ -2202,7 +2913,7 @@ void setdsplyTmr()                                // Set the OLED off time (defa
     Serial.print(F("THE OLED OFF TIMER IS SET TO "));
     Serial.print(arg);
     Serial.println(F(" SECONDS"));
-    EEPROM.write(eAddrDsplyTmr,(arg));
+    eeMeter.write(eAddrDsplyTmr,(arg));
   }
 }
 
@@ -2232,7 +2943,7 @@ void setTime()
   if(arg < 0){return;}
   
   rtc.adjust(DateTime(now.year(), now.month(), now.day(), hr, mn, sc));
-  EEPROM.write(eAddrDst,arg);
+  eeMeter.write(eAddrDst,arg);
   readTime();
 }
 
@@ -2270,7 +2981,7 @@ void setTOffset()                               // Set RTC's temperature offset.
   Serial.print(F("THE TEMPERATURE OFFSET IS SET TO "));
   Serial.print(arg);
   Serial.println(F(" DEGs"));
-  EEPROM.write(eAddrTOffset,(arg));
+  eeMeter.write(eAddrTOffset,(arg));
 }
 
 //#################################################################################################################
@@ -2283,7 +2994,7 @@ void setTemprScale()
   if (returnVal < 0){return;}                         // Syntax error or missing argument occured.
   else if (returnVal){Serial.println(F("TEMPERATURE SCALE IS SET TO CELSIUS"));}
   else{Serial.println(F("TEMPERATURE SCALE IS SET TO FAHRENHEIT"));}
-  EEPROM.write(eAddrTemprScale,returnVal);
+  eeMeter.write(eAddrTemprScale,returnVal);
 }
 
 //#################################################################################################################
@@ -2292,46 +3003,46 @@ void setTemprScale()
 // Adds an ID tag 
 void addDbId()
 {
-// uint32_t idPwd = 0;
-  uint32_t  pwd   = 0;
   Serial.println(F("ENTER A TAG ID TO BE ADDED OR PLACE A TAG ON THE READER"));
   Serial.println(F("TO ASSOCIATE A TAG TO A PASSWORD, FIRST ENTER A PASSWORD"));
-  if(argNum(idPwd))
+  argThen(addDbIdStep);
+}
+
+void addDbIdStep()
+{
+  if(!argNum(cliVal[0])){Serial.println(F("NO TAG ID OR PASSWORD ENTERED")); return;}
+  if(db.contains24(cliVal[0]))                    // Checks to see if idTag is in the database.
   {
-    if(db.contains24(idPwd))                      // Checks to see if idTag is in the database.
-    {
-      if(db.posOf(idPwd) < PWDFLAG)  
-      {
-        Serial.print(F("ID TAG ALREADY IN DATABASE"));
-        return;
-      }
-      else if(db.posOf(idPwd) >= PWDFLAG)
-      {
-        pwd = idPwd;
-        Serial.print(F("NOW ENTER TAG ID"));
-        if(argNum(idPwd))
-        {
-          if(!db.insertId(idPwd,pwd)){Serial.println(F("FAILED TO INSERT TAG ID, DATABASE MAY BE FULL"));}
-          else
-          {
-            Serial.print(F("TAG "));
-            Serial.print(idPwd);
-            Serial.print(F(" STORED IN EEPROM WITH PASSWORD "));
-            Serial.println(pwd);
-            return;
-          }
-        }
-      }
-    }
-    if(!db.insertId(idPwd)){Serial.println(F("FAILED TO INSERT TAG ID, DATABASE MAY BE FULL"));}
-    else
+    if(db.posOf(cliVal[0]) < PWDFLAG)  
     {
-      Serial.print(F("TAG "));
-      Serial.print(idPwd);
-      Serial.println(F(" STORED IN EEPROM"));
+      Serial.println(F("ID TAG ALREADY IN DATABASE"));
+      return;
     }
+    Serial.println(F("NOW ENTER TAG ID"));        // Password entered, so associate a tag to it.
+    argThen(addDbIdPwdStep);
+    return;
+  }
+  if(!db.insertId(cliVal[0])){Serial.println(F("FAILED TO INSERT TAG ID, DATABASE MAY BE FULL"));}
+  else
+  {
+    Serial.print(F("TAG "));
+    Serial.print(cliVal[0]);
+    Serial.println(F(" STORED IN EEPROM"));
+  }
+}
+
+void addDbIdPwdStep()
+{
+  uint32_t  tagId = 0;
+  if(!argNum(tagId)){Serial.println(F("NO TAG ID ENTERED"));}
+  else if(!db.insertId(tagId, cliVal[0])){Serial.println(F("FAILED TO INSERT TAG ID, DATABASE MAY BE FULL"));}
+  else
+  {
+    Serial.print(F("TAG "));
+    Serial.print(tagId);
+    Serial.print(F(" STORED IN EEPROM WITH PASSWORD "));
+    Serial.println(cliVal[0]);
   }
-  else{Serial.println(F("NO TAG ID OR PASSWORD ENTERED"));}
 }
 
 //#################################################################################################################
@@ -2339,47 +3050,46 @@ void addDbId()
 //#################################################################################################################
 void addDbPwd()
 {
-  // uint32_t idPwd = 0;
-  uint32_t    tag   = 0;
   Serial.println(F("ENTER A PASSWORD TO BE ADDED"));
   Serial.println(F("TO ASSOCIATE A PASSWORD TO A TAG ID, FIRST ENTER THE TAG ID"));
-  if(argNum(idPwd))
+  argThen(addDbPwdStep);
+}
+
+void addDbPwdStep()
+{
+  if(!argNum(cliVal[0])){Serial.println(F("NO TAG ID OR PASSWORD ENTERED")); return;}
+  if(db.contains24(cliVal[0]))                    // Checks to see if idTag is in the database.
   {
-    if(db.contains24(idPwd))                      // Checks to see if idTag is in the database.
-    {
-      if(db.posOf(idPwd) >= PWDFLAG)  
-      {
-        Serial.print(F("PASSWORD ALREADY IN DATABASE"));
-        return;
-      }
-      else if(db.posOf(idPwd) < PWDFLAG)
-      {
-        tag = idPwd;
-        idPwd = 0;
-        Serial.print(F("NOW ENTER PASSWORD"));
-        if(argNum(idPwd))
-        {
-          if(!db.insertPwd(tag,idPwd)){Serial.println(F("FAILED TO INSERT PASSWORD, DATABASE MAY BE FULL"));}
-          else
-          {
-            Serial.print(F("PASSWORD "));
-            Serial.print(idPwd);
-            Serial.print(F(" STORED IN EEPROM WITH TAG ID "));
-            Serial.println(tag);
-            return;
-          }
-        }
-      }
-    }
-    if(!db.insertPwd(idPwd)){Serial.println(F("FAILED TO INSERT PASSWORD, DATABASE MAY BE FULL"));}
-    else
+    if(db.posOf(cliVal[0]) >= PWDFLAG)  
     {
-      Serial.print(F("PASSWORD "));
-      Serial.print(idPwd);
-      Serial.println(F(" STORED IN EEPROM"));
+      Serial.println(F("PASSWORD ALREADY IN DATABASE"));
+      return;
     }
+    Serial.println(F("NOW ENTER PASSWORD"));      // Tag entered, so associate a password to it.
+    argThen(addDbPwdTagStep);
+    return;
+  }
+  if(!db.insertPwd(cliVal[0])){Serial.println(F("FAILED TO INSERT PASSWORD, DATABASE MAY BE FULL"));}
+  else
+  {
+    Serial.print(F("PASSWORD "));
+    Serial.print(cliVal[0]);
+    Serial.println(F(" STORED IN EEPROM"));
+  }
+}
+
+void addDbPwdTagStep()
+{
+  uint32_t  pwd = 0;
+  if(!argNum(pwd)){Serial.println(F("NO PASSWORD ENTERED"));}
+  else if(!db.insertPwd(cliVal[0], pwd)){Serial.println(F("FAILED TO INSERT PASSWORD, DATABASE MAY BE FULL"));}
+  else
+  {
+    Serial.print(F("PASSWORD "));
+    Serial.print(pwd);
+    Serial.print(F(" STORED IN EEPROM WITH TAG ID "));
+    Serial.println(cliVal[0]);
   }
-  else{Serial.println(F("NO TAG ID OR PASSWORD ENTERED"));}
 }
 
 //#################################################################################################################
@@ -2387,56 +3097,31 @@ void addDbPwd()
 //#################################################################################################################
 void addDbIdNam()
 {
-//  char *arg;
-  char arg;
-  static char sdata[NAMELENGTH], *psdata = sdata;
-  uint32_t  tagId = 0;
   Serial.println(F("ENTER TAG NUMBER: "));
-  if(argNum(tagId))
+  argThen(addDbIdNamTag);
+}
+
+void addDbIdNamTag()
+{
+  if(!argNum(cliVal[0])){Serial.println(F("NO TAG ID ENTERED"));}
+  else if(!db.contains24(cliVal[0])){Serial.println(F("TAG ID NOT FOUND IN DATABASE"));}
+  else
   {
-    if(db.contains24(tagId))                      // Checks to see if idTag is in the database.
-    {
-      Serial.print(F("ENTER NAME FOR TAG NUMBER "));
-      Serial.println(tagId);
-      keyTmr = EEPROM.read(eAddrKeyTmr);          // Reset keypad timer.  
-      while(keyTmr)                               // Loop until CR detected.
-      {
-        if(Serial.available() > 0)
-        {
-          keyTmr = EEPROM.read(eAddrKeyTmr);      // Reset keypad timer.  
-          arg = Serial.read();
-          if ((psdata - sdata) > NAMELENGTH)
-          {
-            psdata--; 
-            Serial.println(F("NAME TOO LONG")); 
-          }
-          *psdata++ = (char)arg;
-          if (arg == '\r' || arg == '\n')         // Command received and ready.
-          {
-            psdata--;                             // Don't add carrage return (\r) to string.
-            *psdata = '\0';                       // Null terminate the string.
-            break;
-          }
-        }
-      }
-      if (*sdata == '\0')
-      {
-        Serial.println(F("NO NAME ENTERED (TIMEOUT)"));
-        return;
-      }
-      else
-      {
-        db.insertIdNam(tagId,sdata);
-        Serial.print(F("NAME: \""));
-        Serial.print(sdata);
-        Serial.print(F("\" ADDED TO DATABASE FOR ID TAG "));
-        Serial.println(tagId);
-        psdata = sdata;                           // Needed to reset pointer before next name entry.
-      }
-    }
-    else{Serial.println(F("TAG ID NOT FOUND IN DATABASE"));}
+    Serial.print(F("ENTER NAME FOR TAG NUMBER "));
+    Serial.println(cliVal[0]);
+    argThen(addDbIdNamStep);
   }
-  else{Serial.println(F("NO TAG ID ENTERED"));}
+}
+
+void addDbIdNamStep()
+{
+  char *nam = argNam();
+  if(nam == NULL){return;}
+  db.insertIdNam(cliVal[0], nam);
+  Serial.print(F("NAME: \""));
+  Serial.print(nam);
+  Serial.print(F("\" ADDED TO DATABASE FOR ID TAG "));
+  Serial.println(cliVal[0]);
 }
 
 //#################################################################################################################
@@ -2444,58 +3129,31 @@ void addDbIdNam()
 //#################################################################################################################
 void addDbPwdNam()
 {
-//  char *arg;
-  char arg;
-//  static char pwdNam[NAMELENGTH], *pPwdNam = pwdNam;
-  char pwdNam[NAMELENGTH];
-  char *pPwdNam = pwdNam;
-  uint32_t  pwd = 0;
-
   Serial.println(F("ENTER PASSWORD: "));
-  if(argNum(pwd))
+  argThen(addDbPwdNamPwd);
+}
+
+void addDbPwdNamPwd()
+{
+  if(!argNum(cliVal[0])){Serial.println(F("NO PASSWORD ENTERED"));}
+  else if(!db.contains24(cliVal[0])){Serial.println(F("PASSWORD NOT FOUND IN DATABASE"));}
+  else
   {
-    if(db.contains24(pwd))                        // Checks to see if password is in the database.
-    {
-      Serial.print(F("ENTER NAME FOR PASSWORD NUMBER "));
-      Serial.println(pwd);
-      keyTmr = EEPROM.read(eAddrKeyTmr);          // Reset keypad timer.  
-      while(keyTmr)                               // Loop until CR detected.
-      {
-        if(Serial.available() > 0)
-        {
-          keyTmr = EEPROM.read(eAddrKeyTmr);      // Reset keypad timer.  
-          arg = Serial.read();
-          if ((pPwdNam - pwdNam) >= NAMELENGTH-1)
-          {
-            pPwdNam--; 
-            Serial.println(F("NAME TOO LONG")); 
-          }
-          *pPwdNam++ = (char)arg;
-          if (arg == '\r' || arg == '\n')         // Command received and ready.
-          {
-            pPwdNam--;                            // Don't add \r to string.
-            *pPwdNam = '\0';                      // Null terminate the string.
-            break;
-          }
-        }
-      }
-      if (*pwdNam == '\0')
-      {
-        Serial.println(F("NO NAME ENTERED (TIMEOUT)"));
-        return;
-      }
-      else
-      {
-        db.insertPwdNam(pwd,pwdNam);
-        Serial.print(F("NAME: \""));
-        Serial.print(pwdNam);
-        Serial.print(F("\" ADDED TO DATABASE FOR PASSWORD "));
-        Serial.println(pwd);
-      }
-    }
-    else{Serial.println(F("PASSWORD NOT FOUND IN DATABASE"));}
+    Serial.print(F("ENTER NAME FOR PASSWORD NUMBER "));
+    Serial.println(cliVal[0]);
+    argThen(addDbPwdNamStep);
   }
-  else{Serial.println(F("NO PASSWORD ENTERED"));}
+}
+
+void addDbPwdNamStep()
+{
+  char *nam = argNam();
+  if(nam == NULL){return;}
+  db.insertPwdNam(cliVal[0], nam);
+  Serial.print(F("NAME: \""));
+  Serial.print(nam);
+  Serial.print(F("\" ADDED TO DATABASE FOR PASSWORD "));
+  Serial.println(cliVal[0]);
 }
 
 //#################################################################################################################
@@ -2503,24 +3161,30 @@ void addDbPwdNam()
 //#################################################################################################################
 void addDbAtt()
 {
-//  uint8_t att = 0;
-  uint32_t  tagId = 0;
   Serial.println(F("ENTER TAG NUMBER OR PASSWORD OF USER "));
-  if(argNum(tagId))
+  argThen(addDbAttUser);
+}
+
+void addDbAttUser()
+{
+  if(!argNum(cliVal[0])){Serial.println(F("NO TAG ID OR PASWORD ENTERED"));}
+  else if(!db.contains(cliVal[0])){Serial.println(F("ID OR PASSWORD NOT FOUND IN DATABASE"));}
+  else
   {
-    if(!db.contains(tagId)){Serial.println(F("ID OR PASSWORD NOT FOUND IN DATABASE"));}
-    else
-    {
-      uint8_t att =  argAtt();
-      db.insertAtt(tagId,att);
-      Serial.print(F("\nATTRIBUTES STORED IN EEPROM FOR "));
-      Serial.println(tagId);
-      displayAtt(att);
-      Serial.println("");
-      help();
-    }
+    argAttList();
+    argThen(addDbAttStep);
   }
-  else{Serial.println(F("NO TAG ID OR PASWORD ENTERED"));}
+}
+
+void addDbAttStep()
+{
+  uint8_t newAtt = argAtt();
+  db.insertAtt(cliVal[0], newAtt);
+  Serial.print(F("\nATTRIBUTES STORED IN EEPROM FOR "));
+  Serial.println(cliVal[0]);
+  displayAtt(newAtt);
+  Serial.println("");
+  help();
 }
 
 //#################################################################################################################
@@ -2532,37 +3196,338 @@ void addDbAtt()
 // Note, when the timestamp expires, access for this user will be disabled. until a new timestamp is set.
 void addDbTm()
 {
-  //  uint8_t att = 0;
-  // uint32_t idPwd = 0;
-  uint32_t    tm    = 0;
-  
   Serial.println(F("ENTER TAG NUMBER OR PASSWORD OF USER "));
-  if(argNum(idPwd))                               // gets a 32 bit number from serial port or keypad.
+  argThen(addDbTmUser);
+}
+
+void addDbTmUser()
+{
+  if(!argNum(cliVal[0])){Serial.println(F("NO TAG ID ENTERED")); return;}
+  Serial.print(F("TAG OR PASSWORD NUMBER ENTERED = "));
+  Serial.println(cliVal[0]);
+  if(!db.contains(cliVal[0])){Serial.println(F("ID OR PASSWORD NOT FOUND IN DATABASE"));}
+  else
+  {
+    Serial.println(F("ENTER NUMBER OF DAYS FOR TEMPORARY ACCESS"));
+    argThen(addDbTmStep);
+  }
+}
+
+void addDbTmStep()
+{
+  uint32_t  tm    = 0;
+  uint8_t   usrAtt = 0;
+  if (argNum(tm))
+  {
+    db.insertTm(cliVal[0], (timeStmp + (tm * 1440)));  // timestamp + (days * 60 mins. * 24Hrs). 
+    db.readAtt(db.posOf(cliVal[0]) & PWDMASK, usrAtt);
+    usrAtt |= TEMPACCESS;                         // Enable temporary access.
+    usrAtt &= ~ONETMACCESS;                       // Disable One time access (if enabled).
+    usrAtt &= ~PERMACCESS;                        // Disable permanent access.
+    db.insertAtt(cliVal[0], usrAtt);              // Update attribute for user. 
+  }
+  else{Serial.println(F("NO TIME STAMP ENTERED"));}
+}
+
+//#################################################################################################################
+// READ SCHEDULE PROFILE METHOD
+//#################################################################################################################
+// Displays the hours of the week allowed by a schedule profile. "#" = access allowed, "." = no access.
+void readSchProfile()
+{
+  int16_t prof = argRange(1, SCHPROFILES);
+
+  if(prof < 0){Serial.println(F("ENTER A SCHEDULE PROFILE NUMBER FROM 1 TO 4")); return;}
+  Serial.print(F("SCHEDULE PROFILE "));
+  Serial.print(prof);
+  Serial.println(F(" (# = ACCESS ALLOWED)"));
+  Serial.println(F("    HOUR 0         1         2"));
+  Serial.println(F("         012345678901234567890123"));
+  for(uint8_t day = 0; day < 7; day++)
   {
-    Serial.print(F("TAG OR PASSWORD NUMBER ENTERED = "));
-    Serial.println(idPwd);
-    if(!db.contains(idPwd))
+    Serial.print(F("    "));
+    for(uint8_t i = 0; i < 3; i++){Serial.print((char)toupper(pgm_read_byte(&daysOfTheWeek[day][i])));}
+    Serial.print(F("  "));
+    for(uint8_t hr = 0; hr < 24; hr++)
     {
-      Serial.println(F("ID OR PASSWORD NOT FOUND IN DATABASE"));
-      return;
+      uint8_t slot = day * 24 + hr;
+      Serial.print((schTable[prof - 1][slot >> 3] & (1 << (slot & 7))) ? '#' : '.');
     }
-    else
+    Serial.println();
+  }
+  Serial.print(F("ACCESS IS "));
+  Serial.println(schAllowed(prof) ? F("ALLOWED NOW") : F("NOT ALLOWED NOW"));
+}
+
+//#################################################################################################################
+// SET SCHEDULE PROFILE METHOD
+//#################################################################################################################
+// ssp <PROFILE 1-4> <DAY 0-6 OR *> <FROM HOUR 0-23> <TO HOUR 1-24> <ON/OFF>
+// Allows (ON) or denies (OFF) access from the start of "FROM HOUR" up to the start of "TO HOUR". Day 0 = Sunday,
+// "*" selects every day of the week.
+void setSchProfile()
+{
+  int16_t   prof  = argRange(1, SCHPROFILES);
+  char      *arg  = console.next();
+  int16_t   day   = (arg != NULL && strcmp(arg, "*") == 0) ? 7 : -1;
+  int16_t   from;
+  int16_t   to;
+  int8_t    on;
+
+  if(day < 0 && arg != NULL)
+  {
+    day = atoi(arg);
+    if(!isdigit(*arg) || day > 6){day = -1;}
+  }
+  from = argRange(0, 23);
+  to = argRange(1, 24);
+  if(prof < 0 || day < 0 || from < 0 || to <= from)
+  {
+    Serial.println(F("SYNTAX: ssp <PROFILE 1-4> <DAY 0-6 OR *> <FROM HOUR 0-23> <TO HOUR 1-24> <ON/OFF>"));
+    return;
+  }
+  on = argOnOff();
+  if(on < 0){return;}
+
+  for(uint8_t d = (day == 7) ? 0 : day; d <= ((day == 7) ? 6 : day); d++)
+  {
+    for(uint8_t hr = from; hr < to; hr++)
     {
-      Serial.println(F("ENTER NUMBER OF DAYS FOR TEMPORARY ACCESS"));
-      if (argNum(tm))
+      uint8_t slot = d * 24 + hr;
+      if(on){schTable[prof - 1][slot >> 3] |= 1 << (slot & 7);}
+      else{schTable[prof - 1][slot >> 3] &= ~(1 << (slot & 7));}
+    }
+  }
+  for(uint8_t i = 0; i < SCHBYTES; i++){eeMeter.write(eAddrSch + (prof - 1) * SCHBYTES + i, schTable[prof - 1][i]);}
+  Serial.print(F("SCHEDULE PROFILE "));
+  Serial.print(prof);
+  Serial.println(F(" UPDATED"));
+}
+
+//#################################################################################################################
+// ASSIGN SCHEDULE PROFILE METHOD
+//#################################################################################################################
+// Assigns a schedule profile (1-4) to a user. Profile 0 removes the schedule so access is only limited by the
+// user's attributes.
+void addSchProfile()
+{
+  Serial.println(F("ENTER TAG NUMBER OR PASSWORD OF USER "));
+  argThen(addSchProfileUser);
+}
+
+void addSchProfileUser()
+{
+  if(!argNum(cliVal[0])){Serial.println(F("NO TAG ID OR PASWORD ENTERED"));}
+  else if(!db.contains(cliVal[0])){Serial.println(F("ID OR PASSWORD NOT FOUND IN DATABASE"));}
+  else
+  {
+    Serial.println(F("ENTER SCHEDULE PROFILE 1-4 (0 = NO SCHEDULE)"));
+    argThen(addSchProfileStep);
+  }
+}
+
+void addSchProfileStep()
+{
+  int16_t prof = argRange(0, SCHPROFILES);
+
+  int16_t pos = db.posOf(cliVal[0]);
+  uint8_t sch = 0;
+
+  if(prof < 0){Serial.println(F("INCORRECT SCHEDULE PROFILE")); return;}
+  db.readSch(pos & PWDMASK, sch);
+  db.modifySch(pos, (sch & ~SCHMASK) | prof);     // Group is kept.
+  Serial.print(F("SCHEDULE PROFILE "));
+  Serial.print(prof);
+  Serial.print(F(" STORED IN EEPROM FOR "));
+  Serial.println(cliVal[0]);
+}
+
+//#################################################################################################################
+// ASSIGN GROUP METHOD
+//#################################################################################################################
+// Assigns a user to a group (1-8). Group 0 removes the user from its group. The group number is kept in the high 4
+// bits of the user's schedule byte, so it is replicated with the rest of the user. The groups themselves ("sgr")
+// are kept on each controller and are not replicated, so with DBSYNC they must be set the same on both.
+void addGroup()
+{
+  Serial.println(F("ENTER TAG NUMBER OR PASSWORD OF USER "));
+  argThen(addGroupUser);
+}
+
+void addGroupUser()
+{
+  if(!argNum(cliVal[0])){Serial.println(F("NO TAG ID OR PASWORD ENTERED"));}
+  else if(!db.contains(cliVal[0])){Serial.println(F("ID OR PASSWORD NOT FOUND IN DATABASE"));}
+  else
+  {
+    Serial.println(F("ENTER GROUP 1-8 (0 = NO GROUP)"));
+    argThen(addGroupStep);
+  }
+}
+
+void addGroupStep()
+{
+  int16_t grp = argRange(0, GROUPS);
+  int16_t pos = db.posOf(cliVal[0]);
+  uint8_t sch = 0;
+
+  if(grp < 0){Serial.println(F("INCORRECT GROUP")); return;}
+  db.readSch(pos & PWDMASK, sch);
+  db.modifySch(pos, (grp << GRPSHIFT) | (sch & SCHMASK));  // Schedule profile is kept.
+  Serial.print(F("GROUP "));
+  Serial.print(grp);
+  Serial.print(F(" STORED IN EEPROM FOR "));
+  Serial.println(cliVal[0]);
+}
+
+//#################################################################################################################
+// SET GROUP METHOD
+//#################################################################################################################
+// "sgr <1-8> <days> <doors>" gives the users of a group access to the doors (1 = front, 2 = garage, 3 = rear,
+// 4 = shed) for a number of days, 0 days = permanent access. Without doors the group gives no access.
+void setGroup()
+{
+  int16_t   grp   = argRange(1, GROUPS);
+  char      *arg  = console.next();
+  uint32_t  days;
+  uint8_t   att;
+
+  if(grp < 0 || arg == NULL || !isdigit(*arg)){Serial.println(F("SETTING GROUP FAILED (sgr <1-8> <DAYS> <1-4>)")); return;}
+  days = atol(arg);
+  att = argAtt() & (SHEDDRLOCK | REARDRLOCK | GARDRLOCK | FRTDRLOCK);
+  grp--;
+  grpAtt[grp] = att | (days ? TEMPACCESS : PERMACCESS);
+  grpTm[grp] = days ? timeStmp + (days * 1440) : 0;  // timestamp + (days * 60 mins. * 24Hrs).
+  eeMeter.write(eAddrGrp + grp * GRPBYTES, grpAtt[grp]);
+  eeMeter.put(eAddrGrp + grp * GRPBYTES + 1, grpTm[grp]);
+  acsRebuild();
+  Serial.print(F("GROUP "));
+  Serial.print(grp + 1);
+  Serial.println(F(" UPDATED"));
+  displayAtt(grpAtt[grp]);
+}
+
+//#################################################################################################################
+// READ GROUPS METHOD
+//#################################################################################################################
+// Displays the access, doors and number of users of each group. The groups are those of this controller only.
+void readGroups()
+{
+  uint8_t users[GROUPS + 1] = {0};
+  uint8_t sch;
+
+  for(uint8_t i = 0; i < db.count(); i++)
+  {
+    if(db.readSch(i, sch) && (sch >> GRPSHIFT) <= GROUPS){users[sch >> GRPSHIFT]++;}
+  }
+  for(uint8_t grp = 0; grp < GROUPS; grp++)
+  {
+    Serial.print(F("GROUP "));
+    Serial.print(grp + 1);
+    Serial.print(F("\tUSERS "));
+    Serial.print(users[grp + 1]);
+    if(grpAtt[grp] & PERMACCESS){Serial.print(F("\tPERMANENT"));}
+    else if(grpValid(grp))
+    {
+      Serial.print(F("\tEXPIRES IN "));
+      Serial.print((grpTm[grp] - timeStmp) / 60);
+      Serial.print(F(" HOURS"));
+    }
+    else{Serial.print(F("\tNO ACCESS"));}
+    Serial.print(F("\tDOORS"));
+    for(uint8_t dr = 0; dr < 4; dr++)
+    {
+      if(grpAtt[grp] & (1 << dr))
       {
-        db.insertTm(idPwd, (timeStmp + (tm * 1440)));  // timestamp + (tagId * 60 mins. * 24Hrs). 
-        pos = db.posOf(idPwd);
-        db.readAtt(pos,att);
-        att |= TEMPACCESS;                        // Enable temporary access.
-        att &= ~ONETMACCESS;                      // Disable One time access (if enabled).
-        att &= ~PERMACCESS;                       // Disable permanent access.
-        db.insertAtt(idPwd,att);                  // Update attribute for user. 
+        Serial.print(' ');
+        Serial.print(dr + 1);
       }
-      Serial.println(F("NO TIME STAMP ENTERED"));
     }
+    Serial.println("");
   }
-  else{Serial.println(F("NO TAG ID ENTERED"));}
+  Serial.print(F("USERS WITHOUT GROUP "));
+  Serial.println(users[0]);
+  #if defined DBSYNC
+    Serial.println(F("GROUPS ARE SET ON EACH CONTROLLER, ONLY THE USERS' GROUP NUMBERS ARE REPLICATED"));
+  #endif
+}
+
+//#################################################################################################################
+// BULK OPERATION METHOD
+//#################################################################################################################
+// "bop <users> <change>" applies one change to many users in a single pass over the database, committed once.
+// Users: "g1" to "g8" (members of a group), "t<days>" (temporary access still running and expiring within the
+// days) or "all". Change: "ext <days>" (adds days to temporary access still running), "rev" (revokes all access,
+// the user leaves its group), "grp <0-8>" (moves to a group) or "att <1-8>" (sets the attributes, as "ada").
+// Expired temporary access is turned off by "acsSweep" within a minute, so neither "t<days>" nor "ext" finds it,
+// it is given again with "adt".
+void bulkOp()
+{
+  char      *sel  = console.next();
+  char      *op   = console.next();
+  uint8_t   selGrp  = 0;
+  bool      selTemp = false;
+  uint32_t  selTm   = 0;
+  uint32_t  val     = 0;
+  uint8_t   newAtt  = 0;
+  uint8_t   usrAtt  = 0;
+  uint8_t   sch     = 0;
+  uint32_t  tm      = 0;
+  uint8_t   changed = 0;
+
+  if(sel == NULL || op == NULL){missingArg(); return;}
+  if((*sel == 'g' || *sel == 'G') && isdigit(sel[1])){selGrp = atoi(sel + 1);}
+  else if((*sel == 't' || *sel == 'T') && isdigit(sel[1]))
+  {
+    selTemp = true;
+    selTm = timeStmp + atol(sel + 1) * 1440;     // timestamp + (days * 60 mins. * 24Hrs).
+  }
+  if(selGrp > GROUPS || (!selGrp && !selTemp && strcasecmp(sel, "all") != 0)){syntaxError(); return;}
+  if(strcasecmp(op, "ext") == 0)
+  {
+    if(!argNum(val)){Serial.println(F("NO NUMBER OF DAYS ENTERED")); return;}
+    val *= 1440;
+  }
+  else if(strcasecmp(op, "grp") == 0)
+  {
+    int16_t grp = argRange(0, GROUPS);
+    if(grp < 0){Serial.println(F("INCORRECT GROUP")); return;}
+    val = grp;
+  }
+  else if(strcasecmp(op, "att") == 0){newAtt = argAtt();}
+  else if(strcasecmp(op, "rev") != 0){syntaxError(); return;}
+
+  db.beginBatch();                                // Every change below is committed once.
+  for(uint8_t i = 0; i < db.count(); i++)
+  {
+    db.readAtt(i, usrAtt);
+    db.readSch(i, sch);
+    db.readTm(i, tm);
+    if(selGrp && (sch >> GRPSHIFT) != selGrp){continue;}
+    if(selTemp && (!(usrAtt & TEMPACCESS) || tm >= selTm)){continue;}
+    switch(toupper(*op))
+    {
+      case 'E':
+        if(!(usrAtt & TEMPACCESS)){continue;}     // Only temporary access still running (see "acsSweep").
+        db.modifyTm(i, (tm > timeStmp ? tm : timeStmp) + val);  // From now if it expired since the last sweep.
+        break;
+      case 'R':
+        db.modifyAtt(i, 0);
+        db.modifySch(i, sch & SCHMASK);
+        break;
+      case 'G':
+        db.modifySch(i, (val << GRPSHIFT) | (sch & SCHMASK));
+        break;
+      case 'A':
+        db.modifyAtt(i, newAtt);
+        break;
+    }
+    changed++;
+  }
+  db.endBatch();
+  acsService();                                   // Door permissions follow at once.
+  Serial.print(changed);
+  Serial.println(F(" USERS CHANGED"));
 }
 
 //#################################################################################################################
@@ -2570,8 +3535,13 @@ void addDbTm()
 //#################################################################################################################
 void delDbId()
 {
-  uint32_t tagId  = 0;
   Serial.println(F("ENTER TAG NUMBER TO BE DELETED OR PLACE TAG ON READER "));
+  argThen(delDbIdStep);
+}
+
+void delDbIdStep()
+{
+  uint32_t tagId  = 0;
   if(argNum(tagId))
   {
     int16_t idLoc = db.posOf(tagId);
@@ -2597,8 +3567,13 @@ void delDbId()
 //#################################################################################################################
 void delDbPwd()
 {
-  uint32_t tagId = 0;
   Serial.println(F("ENTER PASSWORD TO BE DELETED "));
+  argThen(delDbPwdStep);
+}
+
+void delDbPwdStep()
+{
+  uint32_t tagId = 0;
   if(argNum(tagId))
   {
     int16_t idLoc = db.posOf(tagId);
@@ -2624,10 +3599,13 @@ void delDbPwd()
 //#################################################################################################################
 void delDbIdNam()
 {
-  uint32_t  tagId = 0;
-  //char name[NAMELENGTH];
-  
   Serial.print(F("ENTER USER TAG ID: "));
+  argThen(delDbIdNamStep);
+}
+
+void delDbIdNamStep()
+{
+  uint32_t  tagId = 0;
   if(argNum(tagId))
   {
     Serial.println(tagId);
@@ -2654,10 +3632,13 @@ void delDbIdNam()
 //#################################################################################################################
 void delDbPwdNam()
 {
-  uint32_t  tagId = 0;
-  //char name[NAMELENGTH];
-  
   Serial.print(F("ENTER USER PASSWORD: "));
+  argThen(delDbPwdNamStep);
+}
+
+void delDbPwdNamStep()
+{
+  uint32_t  tagId = 0;
   if(argNum(tagId))
   {
     pos = db.posOf(tagId);
@@ -2680,9 +3661,13 @@ void delDbPwdNam()
 //#################################################################################################################
 void delDbAtt()
 {
-  uint32_t  tagId = 0;
-  
   Serial.println(F("ENTER TAG NUMBER OR PASSWORD OF USER "));
+  argThen(delDbAttStep);
+}
+
+void delDbAttStep()
+{
+  uint32_t  tagId = 0;
   if(argNum(tagId))                               // function stores result in variable "tagId".
   {
     if(!db.contains(tagId)){Serial.println(F("ID OR PASSWORD NOT FOUND IN DATABASE"));}
@@ -2702,158 +3687,412 @@ void delDbAtt()
 //#################################################################################################################
 void modDbId()
 {
-  //  uint32_t  idPwd = 0;
-  //  char      name[NAMELENGTH];
-  uint32_t      oldId = 0;
-  uint32_t      newId = 0;
-
   Serial.println(F("ENTER OLD TAG NUMBER OR PLACE TAG ON READER "));
-  if(argNum(oldId))
+  argThen(modDbIdOld);
+}
+
+void modDbIdOld()
+{
+  int16_t idLoc;
+  if(!argNum(cliVal[0])){return;}
+  idLoc = db.posOf(cliVal[0]);
+  if( idLoc >= 0 && idLoc < PWDFLAG)    
   {
-    pos = db.posOf(oldId);
-    if( pos >= 0 && pos <= PWDFLAG)    
-    {
-      Serial.print(F("OLD TAG ID \""));
-      Serial.print(oldId);
-      Serial.print(F("\" FOUND FOR USER "));
-      db.readNam(pos, name);
-      Serial.println(name);
-      Serial.println(F("ENTER NEW TAG NUMBER OR PLACE TAG ON READER"));
-      if(argNum(newId))
-      {
-        db.modifyIdPwd(pos, newId);
-        Serial.print(F("TAG ID "));
-        Serial.print(oldId);
-        Serial.print(F(" REPLACED BY TAG ID "));
-        Serial.println(newId);
-      }
-      else{Serial.println(F("NO TAG ID ENTERED"));}
-    }
-    else
-    {
-      Serial.print(F("TAG ID \""));
-      Serial.print(oldId);
-      Serial.println(F("\" NOT FOUND IN DATABASE"));
-    }
+    cliVal[1] = idLoc;                            // Keep user position for the next step.
+    Serial.print(F("OLD TAG ID \""));
+    Serial.print(cliVal[0]);
+    Serial.print(F("\" FOUND FOR USER "));
+    db.readNam(idLoc, name);
+    Serial.println(name);
+    Serial.println(F("ENTER NEW TAG NUMBER OR PLACE TAG ON READER"));
+    argThen(modDbIdStep);
+  }
+  else
+  {
+    Serial.print(F("TAG ID \""));
+    Serial.print(cliVal[0]);
+    Serial.println(F("\" NOT FOUND IN DATABASE"));
   }
 }
 
+void modDbIdStep()
+{
+  uint32_t  newId = 0;
+  if(argNum(newId))
+  {
+    db.modifyIdPwd(cliVal[1], newId);
+    Serial.print(F("TAG ID "));
+    Serial.print(cliVal[0]);
+    Serial.print(F(" REPLACED BY TAG ID "));
+    Serial.println(newId);
+  }
+  else{Serial.println(F("NO TAG ID ENTERED"));}
+}
+
 //#################################################################################################################
-// DELETE USER PASSWORD METHOD
+// MODIFY USER PASSWORD METHOD
 //#################################################################################################################
 void modDbPwd()
 {
-  //  char      name[NAMELENGTH];
-  //  uint32_t  idPwd   = 0;
-  uint32_t      newPwd  = 0;
-  uint32_t      tempPwd = 0;
-
   Serial.println(F("ENTER OLD PASSCODE "));
-  if(argNum(idPwd))
+  argThen(modDbPwdOld);
+}
+
+void modDbPwdOld()
+{
+  uint32_t  oldPwd  = 0;
+  int16_t   pwdLoc;
+  if(!argNum(oldPwd)){Serial.println(F("PASSCODE NOT ENTERED")); return;}
+  pwdLoc = db.posOf(oldPwd);
+  if(pwdLoc >= PWDFLAG)    
   {
-    pos = db.posOf(idPwd);
-    if(pos > PWDFLAG)    
-    {
-      Serial.print(F("OLD PASSCODE \""));
-      Serial.print(idPwd);
-      Serial.print(F("\" FOUND FOR USER "));
-      db.readNam(pos & PWDMASK, name);
-      Serial.println(F("ENTER NEW PASSCODE "));
-      if(argNum(newPwd))
-      {
-        Serial.println(F("REENTER NEW PASSCODE..."));
-        if(argNum(tempPwd))
-        {
-          if(newPwd == tempPwd)
-          {
-            Serial.print(F("OLD PASSCODE REPLACED BY "));
-            Serial.print(newPwd);
-            Serial.print(F(" FOR USER "));
-            db.readNam(pos & PWDMASK, name);
-            Serial.println(name);
-            db.modifyIdPwd(pos, newPwd);
-          }
-          else{Serial.println(F("NEW PASSCODE ENTERED DID NOT MATCH"));}
-        }
-        else{Serial.println(F("PASSCODE NOT ENTERED A 2ND TIME"));}
-      }
-      else{Serial.println(F("NEW PASSCODE NOT ENTERED"));}
-    }
-    else{Serial.println(F("PASSCODE NOT FOUND IN DAPTABASE"));}
+    cliVal[1] = pwdLoc;                           // Keep user position (with password flag) for the next steps.
+    Serial.print(F("OLD PASSCODE \""));
+    Serial.print(oldPwd);
+    Serial.print(F("\" FOUND FOR USER "));
+    db.readNam(pwdLoc & PWDMASK, name);
+    Serial.println(name);
+    Serial.println(F("ENTER NEW PASSCODE "));
+    argThen(modDbPwdNew);
   }
-  else{Serial.println(F("PASSCODE NOT ENTERED"));}
+  else{Serial.println(F("PASSCODE NOT FOUND IN DAPTABASE"));}
+}
+
+void modDbPwdNew()
+{
+  if(!argNum(cliVal[0])){Serial.println(F("NEW PASSCODE NOT ENTERED")); return;}
+  Serial.println(F("REENTER NEW PASSCODE..."));
+  argThen(modDbPwdStep);
+}
+
+void modDbPwdStep()
+{
+  uint32_t  tempPwd = 0;
+  if(!argNum(tempPwd)){Serial.println(F("PASSCODE NOT ENTERED A 2ND TIME"));}
+  else if(cliVal[0] == tempPwd)
+  {
+    Serial.print(F("OLD PASSCODE REPLACED BY "));
+    Serial.print(cliVal[0]);
+    Serial.print(F(" FOR USER "));
+    db.readNam(cliVal[1] & PWDMASK, name);
+    Serial.println(name);
+    db.modifyIdPwd(cliVal[1], cliVal[0]);
+  }
+  else{Serial.println(F("NEW PASSCODE ENTERED DID NOT MATCH"));}
 }
 
 //#################################################################################################################
-// DELETE ID USER NAME METHOD
+// MODIFY ID USER NAME METHOD
 //#################################################################################################################
 void modDbIdNam()
 {
   addDbIdNam();
+}
 
-//  uint32_t  idPwd = 0;
-//  char      name[NAMELENGTH];
-//  char      *name;
-//  char      oldNam[db.maxNameLength()];
-//  char      newNam[db.maxNameLength()];
-  
-//  Serial.println(F("ENTER A TAG ID, OR PLACE A TAG ON THE READER"));
-//  if(argNum(idPwd))
-//  {
-//    pos = db.posOf(idPwd);
-//    if(pos < PWDMASK)
-//    {
-//      db.readNam(pos,oldNam);
-//      Serial.print(F("ENTER NEW USER NAME: "));
-//      argNam(name);                                                 // Get new password name.
-//      Serial.print(F("FOR USER # "));
-//      Serial.print(pos);
-//      Serial.print(F("NAME CHANGED FROM "));
-//      Serial.print(oldNam);
-//      Serial.print(F(" TO "));
-//      Serial.println(name);
-      
-//      db.modifyNam(pos,name);
-//    }
-//    else{Serial.println(F("ID NOT FOUND IN DATABASE"));}
-//  }
+//#################################################################################################################
+// MODIFY PASSWORD USER NAME METHOD
+//#################################################################################################################
+void modDbPwdNam()
+{
+  addDbPwdNam();
+}
+
+
+//#################################################################################################################
+// MACHINE PROTOCOL METHOD
+//#################################################################################################################
+// Handles one machine protocol request (a JSON object on a single line) and answers it with exactly one line:
+//   {"id":7,"op":"add","tag":4660,"name":"JOHN","att":65}   ->  {"id":7,"pos":3,"err":0}
+//   {"id":8,"op":"get","pwd":999999}                         ->  {"id":8,"err":4}
+// Requests are answered in the order received and never wait for input, answers are matched up with "id". Error
+// codes are listed in "PROTOERR". On the serial console the host sends one request at a time (see "conFrame").
+void protoFrame(char *line)
+{
+  uint32_t          id  = 0;
+  const char        *op;
+  const CliCommand  *cmd;
+  bool              valid = json.parse(line);
+
+  json.num(F("id"), id);                          // Also read from a malformed line, if it came before the error.
+  json.begin(id);
+  if(!valid)
+  {
+    json.end(PERR_SYNTAX);
+    return;
+  }
+  op = json.str(F("op"));
+  cmd = (op == NULL) ? NULL : CliEngine::find(opTable, OPCOUNT, op);
+  if(cmd == NULL){protoErr = PERR_OP;}
+  else
+  {
+    protoErr = PERR_OK;
+    ((void (*)())pgm_read_ptr(&cmd->handler))();
+  }
+  json.end(protoErr);
+}
+
+//#################################################################################################################
+// ACCESS EVENT METHODS
+//#################################################################################################################
+// Queues an access event for the collector. Nothing is sent here, "evLink.service" sends it from the main loop.
+// "key" is the tag ID read or, for an entry "typed" on the keypad, the user number (position + 1, 0 if none).
+void evPush(uint8_t type, uint8_t loc, uint32_t key, bool typed)
+{
+  #if defined EVENTS
+    evLink.push(type, loc, key, typed);
+  #endif
+}
+
+// A request on the serial console. The host waits for each answer before sending the next request, and a request
+// must fit the UART receive buffer (JSON_MAXLINE) or its end could be lost while the controller writes EEPROM.
+// Longer requests are refused (PERR_RANGE), with the id if it could be read.
+void conFrame(char *line)
+{
+  uint32_t id = 0;
+
+  if(strlen(line) < JSON_MAXLINE){protoFrame(line); return;}  // Line end not counted by "strlen".
+  json.parse(line);
+  json.num(F("id"), id);
+  json.begin(id);
+  json.end(PERR_RANGE);
+}
+
+// Answers a machine protocol request of the collector on the collector link, in one batch (one datagram on UDP).
+void evFrame(char *line)
+{
+  #if defined EVENTS
+    json.output(evPort);
+    evPort.beginBatch();
+    protoFrame(line);
+    evPort.endBatch();
+    json.output(Serial);
+  #endif
+}
+
+//#################################################################################################################
+// MACHINE PROTOCOL USER POSITION METHOD
+//#################################################################################################################
+// Finds the user position from the "pos", "tag" or "pwd" member of the request. Returns -1 and sets "protoErr" if
+// the user is not found.
+int16_t protoPos()
+{
+  uint32_t  val = 0;
+  int16_t   user;
+
+  if(json.num(F("pos"), val)){user = (val < db.count()) ? val : -1;}
+  else if(json.num(F("tag"), val)){user = db.posOf(val); user = (user < PWDFLAG) ? user : -1;}
+  else if(json.num(F("pwd"), val)){user = db.posOf(val); user = (user >= PWDFLAG) ? (user & PWDMASK) : -1;}
+  else
+  {
+    protoErr = PERR_ARG;
+    return -1;
+  }
+  if(user < 0){protoErr = PERR_NOTFOUND;}
+  return user;
+}
+
+//#################################################################################################################
+// MACHINE PROTOCOL ADD USER METHOD
+//#################################################################################################################
+// Adds a tag ID and/or password, or updates an existing user. A tag and a password in the same request are stored
+// for the same user. The optional "name", "att" and "days" members are then stored for that user.
+void protoAdd()
+{
+  uint32_t    tag   = 0;
+  uint32_t    pwd   = 0;
+  uint32_t    val   = 0;
+  bool        hasTag = json.num(F("tag"), tag);
+  bool        hasPwd = json.num(F("pwd"), pwd);
+  const char  *nam  = json.str(F("name"));
+  bool        ok;
+
+  if((!hasTag && !hasPwd) || (json.has(F("att")) && !json.num(F("att"), val)))
+  {
+    protoErr = PERR_ARG;
+    return;
+  }
+  if((nam != NULL && strlen(nam) > NAMELENGTH - 1) || val > 0xFF)
+  {
+    protoErr = PERR_RANGE;
+    return;
+  }
+
+  if(hasTag && hasPwd)
+  {
+    if(db.contains(tag)){ok = db.insertPwd(tag, pwd);}
+    else if(db.contains(pwd)){ok = db.insertId(tag, pwd);}
+    else
+    {
+      ok = db.insertId(tag) && db.insertPwd(tag, pwd);
+      if(!ok){db.removeId(tag);}                  // No user left with the tag only.
+    }
+  }
+  else if(hasTag){ok = db.insertId(tag);}
+  else{ok = db.insertPwd(pwd);}
+  if(!ok)
+  {
+    protoErr = PERR_FULL;
+    return;
+  }
+
+  if(!hasTag){tag = pwd;}                         // Key used to update the other fields of the user.
+  if(nam != NULL)
+  {
+    if(hasTag){db.insertIdNam(tag, (char *)nam);}
+    else{db.insertPwdNam(pwd, (char *)nam);}
+  }
+  if(json.has(F("att"))){db.insertAtt(tag, val);}
+  if(json.num(F("days"), val))
+  {
+    uint8_t usrAtt = 0;
+    db.insertTm(tag, (timeStmp + (val * 1440)));  // timestamp + (days * 60 mins. * 24Hrs). 
+    db.readAtt(db.posOf(tag) & PWDMASK, usrAtt);
+    usrAtt |= TEMPACCESS;                         // Enable temporary access.
+    usrAtt &= ~(ONETMACCESS | PERMACCESS);        // Disable one time and permanent access.
+    db.insertAtt(tag, usrAtt);
+  }
+  json.add(F("pos"), (uint32_t)(db.posOf(tag) & PWDMASK));
+}
+
+//#################################################################################################################
+// MACHINE PROTOCOL USER COUNT METHOD
+//#################################################################################################################
+void protoCnt()
+{
+  json.add(F("cnt"), (uint32_t)db.count());
+  json.add(F("max"), (uint32_t)db.totalUsers());
+}
+
+//#################################################################################################################
+// MACHINE PROTOCOL DELETE METHOD
+//#################################################################################################################
+// Deletes a tag ID or a password. The user is removed when it has neither left.
+void protoDel()
+{
+  uint32_t  val = 0;
+  int16_t   user;
+
+  if(json.num(F("tag"), val))
+  {
+    user = db.posOf(val);
+    if(user >= 0 && user < PWDFLAG){db.removeId(val);}
+    else{protoErr = PERR_NOTFOUND;}
+  }
+  else if(json.num(F("pwd"), val))
+  {
+    if(db.posOf(val) >= PWDFLAG){db.removePwd(val);}
+    else{protoErr = PERR_NOTFOUND;}
+  }
+  else{protoErr = PERR_ARG;}
 }
 
+//#################################################################################################################
+// MACHINE PROTOCOL READ USER METHOD
+//#################################################################################################################
+void protoGet()
+{
+  uint32_t  val = 0;
+  uint8_t   usrAtt = 0;
+  int16_t   user = protoPos();
+
+  if(user < 0){return;}
+  json.add(F("pos"), (uint32_t)user);
+  db.readId(user, val);
+  json.add(F("tag"), val);
+  db.readPwd(user, val);
+  json.add(F("pwd"), val);
+  db.readNam(user, name);
+  json.add(F("name"), name);
+  db.readAtt(user, usrAtt);
+  json.add(F("att"), (uint32_t)usrAtt);
+  db.readTm(user, val);
+  json.add(F("tm"), val);
+  db.readSch(user, usrAtt);
+  json.add(F("sch"), (uint32_t)(usrAtt & SCHMASK));
+  json.add(F("grp"), (uint32_t)(usrAtt >> GRPSHIFT));
+}
+
+//#################################################################################################################
+// MACHINE PROTOCOL MODIFY USER METHOD
+//#################################################################################################################
+// Replaces the tag ID ("new_tag"), password ("new_pwd"), name, schedule profile ("sch") and/or group ("grp") of the
+// user found by "pos", "tag" or "pwd".
+void protoMod()
+{
+  uint32_t    val = 0;
+  uint8_t     sch = 0;
+  const char  *nam = json.str(F("name"));
+  int16_t     user = protoPos();
+
+  if(user < 0){return;}
+  if((nam != NULL && strlen(nam) > NAMELENGTH - 1) || (json.num(F("sch"), val) && val > SCHPROFILES) ||
+    (json.num(F("grp"), val) && val > GROUPS))
+  {
+    protoErr = PERR_RANGE;
+    return;
+  }
+  db.readSch(user, sch);
+  if(json.num(F("sch"), val)){sch = (sch & ~SCHMASK) | val;}
+  if(json.num(F("grp"), val)){sch = (val << GRPSHIFT) | (sch & SCHMASK);}
+  if(json.num(F("sch"), val) || json.num(F("grp"), val)){db.modifySch(user, sch);}
+  if(json.num(F("new_tag"), val)){db.modifyIdPwd(user, val);}
+  if(json.num(F("new_pwd"), val)){db.modifyIdPwd(user | PWDFLAG, val);}
+  if(nam != NULL){db.modifyNam(user, (char *)nam);}
+}
+
+//#################################################################################################################
+// MACHINE PROTOCOL READ CONFIGURATION METHOD
+//#################################################################################################################
+// Returns every configuration value in "cfgTable" as a member of the reply.
+void protoRdCfg()
+{
+  for(uint8_t i = 0; i < CFGCOUNT; i++)
+  {
+    json.add((const __FlashStringHelper *)cfgTable[i].name, (uint32_t)EEPROM.read(pgm_read_byte(&cfgTable[i].addr)));
+  }
+}
+
+//#################################################################################################################
+// MACHINE PROTOCOL SET CONFIGURATION METHOD
+//#################################################################################################################
+// Sets every configuration value present in the request. All values are checked before any is written so a
+// request is applied completely or not at all.
+void protoSetCfg()
+{
+  uint32_t  val;
+  uint8_t   pass;
 
+  for(pass = 0; pass < 2; pass++)                 // Pass 0 checks, pass 1 writes.
+  {
+    for(uint8_t i = 0; i < CFGCOUNT; i++)
+    {
+      if(!json.num((const __FlashStringHelper *)cfgTable[i].name, val))
+      {
+        if(json.has((const __FlashStringHelper *)cfgTable[i].name)){protoErr = PERR_ARG; return;}
+        continue;
+      }
+      if(pass == 0)
+      {
+        if(val < pgm_read_byte(&cfgTable[i].min) || val > pgm_read_byte(&cfgTable[i].max))
+        {
+          protoErr = PERR_RANGE;
+          return;
+        }
+      }
+      else{eeMeter.write(pgm_read_byte(&cfgTable[i].addr), val);}
+    }
+  }
+  dcLoad();                                       // Duplicate tag window may have changed.
+}
 
 //#################################################################################################################
-// DELETE PASSWORD USER NAME METHOD
+// MACHINE PROTOCOL READ LAST ERROR METHOD
 //#################################################################################################################
-void modDbPwdNam()
+void protoRdErr()
 {
-  addDbPwdNam();
-//  char oldNam[NAMELENGTH];
-//  char newNam[NAMELENGTH];
-  
-//  Serial.print(F("ENTER USER PASSWORD: "));
-//  if(argNum(idPwd))
-//  {
-//    pos = db.posOf(idPwd);
-//    if(pos >= PWDMASK)
-//    {
-//      pos &= PWDMASK;                                           // Remove password flag.
-//      db.readNam(pos,oldNam);
-//      Serial.print(F("ENTER NEW USER NAME: "));
-//      argNam(newNam);                                                 // Get new password name.
-//      Serial.print(F("FOR USER # "));
-//      Serial.print(pos);
-//      Serial.print(F("NAME CHANGED FROM "));
-//      Serial.print(oldNam);
-//      Serial.print(F(" TO "));
-//      Serial.println(newNam);
-//      
-//      db.modifyNam(pos,newNam);
-//    }
-//    else{Serial.println(F("PASSWORD NOT FOUND IN DATABASE"));}
-//  }
+  json.add(F("code"), (uint32_t)EEPROM.read(eAddrErrCode));
 }
 
-
 //#################################################################################################################
 // MENU COMMAND METHOD
 //#################################################################################################################
@@ -2868,22 +4107,34 @@ void menu()                             // Display commands.
   Serial.println(F("rkp or RKP\t\t\tDISPLAY KEYPAD DATA OR SCANNED ID"));
   Serial.println(F("rip or RIP <1-999>\t\tDISPLAYS THE ID OR PASSWORD FOR A USER NUMBER, 999 DISPLAYS ALL USERS"));
   Serial.println(F("rdn or RDN <ID TAG>\t\tDISPLAYS THE USER NAME FOR A GIVEN ID NUMBER OR PASSWORD"));
+  Serial.println(F("fnd or FND <NAME>\t\tDISPLAYS THE USERS WHOSE NAME STARTS WITH THE LETTERS GIVEN"));
   Serial.println(F("rle or RLE\t\t\tDISPLAY LAST ERROR CODE RECORDED"));
   Serial.println(F("rep or REP\t\t\tDISPLAYS INTERNAL EEPROM CONTENTS"));
+  Serial.println(F("rew or REW <CLR>\t\tDISPLAYS EEPROM WRITES PER OPERATION AND REGION, CLR CLEARS THE COUNTS"));
   Serial.println(F("rtm or RTM\t\t\tDISPLAYS RTC TIME/DATE AND TEMPERATURE"));
   Serial.println(F("rto or RTO\t\t\tDISPLAYS RTC's TEMPERATURE OFFEST VALUE, DEFAULT = 0 DEGs"));
   Serial.println(F("rot or ROT\t\t\tDISPLAYS THE OLED OFF TIMER, DEFAULT = 10 SECONDS"));
+  Serial.println(F("rsp or RSP <1-4>\t\tDISPLAYS THE HOURS OF A WEEKLY SCHEDULE PROFILE"));
+  Serial.println(F("rsy or RSY\t\t\tDISPLAYS THE DATABASE REPLICATION STATUS"));
+  Serial.println(F("rec or REC\t\t\tDISPLAYS THE ACCESS EVENT LINK STATUS"));
+  Serial.println(F("rdc or RDC [clr]\t\tDISPLAYS RECENT TAG DECISIONS AND REPEATED READS ABSORBED"));
+  Serial.println(F("rek or REK\t\t\tDISPLAYS THE ENROL KEYPAD (TAGS AND PASSWORDS FOR COMMANDS)"));
   Serial.println("");
   Serial.println(F("svb or SVB <ON-OFF>\t\tSET VERBOSE DISPLAY ON OR OFF (REFRESH RATE EVERY SECOND)"));
   Serial.println(F("stm or STM <HH MM SS>\t\tSETS THE RTC's TIME"));
   Serial.println(F("sdt or SDT <DD MM YY>\t\tSETS THE RTC's DATE"));
   Serial.println(F("sto or STO <DEG>\t\tSETS THE RTC's TEMPERATURE OFFSET VALUE IN DEG's C (RANGE IS 10 to + 10)"));
   Serial.println(F("skt or SKT <1-240>\t\tSET KEYPAD TIMEOUT, DEFAULT = 20 SEC."));
+  Serial.println(F("sdc or SDC <0-240>\t\tSET DUPLICATE TAG WINDOW (0.1 SEC, 0 = OFF), DEFAULT = 2 SEC."));
+  Serial.println(F("sek or SEK <0-4>\t\tSET THE ENROL KEYPAD, DEFAULT = 1 (FRONT DOOR)"));
   Serial.println(F("sar or SAR <1-5>\t\tSET ACCESS CODE RETRY COUNT BEFORE LOCKOUT OCCURS (DEFAULT = 3)"));
   Serial.println(F("slk or SLK <1-240>\t\tSET UNLOCK DELAY TIME, DEFAULT = 5 SECONDS."));
   Serial.println(F("sgt or SGT <1-240>\t\tSET GARAGE DOOR LOCK TIME, DEFAULT = 30 MINUTES"));
   Serial.println(F("sot or SOT <1-240>\t\tSET OLED OFF TIMER, DEFAULT = 10 SECONDS"));
   Serial.println(F("sts or STS <C/F>\t\tSET THE TEMPERATURE SCALE"));
+  Serial.println(F("syn or SYN\t\t\tSENDS THE WHOLE DATABASE TO THE OTHER CONTROLLER"));
+  Serial.println(F("ssp or SSP <1-4> <DAY 0-6/*> <FROM 0-23> <TO 1-24> <ON/OFF>"));
+  Serial.println(F("\t\t\t\tALLOWS/DENIES ACCESS FOR THE HOURS OF A SCHEDULE PROFILE, DAY 0 = SUNDAY, * = EVERY DAY"));
   Serial.println(F("sgs or SGS <ON/OFF>\t\tENABLES/DISABLES GARAGE DOOR POSITION SENSORS"));
   Serial.println(F("\t\t\t\tNOTE: IF SENSORS ARE DISABLED, GARAGE DOOR TIMER and CLOSING DOOR USING # KEY IS ALSO DISABLED"));
   
@@ -2895,6 +4146,12 @@ void menu()                             // Display commands.
   Serial.println(F("apn or APN <PWD> <ID Name>\tADD USER NAME TO PASSWORD"));
   Serial.println(F("ada or ADA <Tag ID OR PWD>\tADDS USER PERMISSIONS TO ID TAG OR PASSWORD"));
   Serial.println(F("adt or ADT <Tag ID OR PWD>\tADDS TIME STAMP TO ID TAG OR PASSWORD FOR TEMPORARY ACCESS"));
+  Serial.println(F("asp or ASP <Tag ID OR PWD> <0-4>\tASSIGNS SCHEDULE PROFILE TO ID TAG OR PASSWORD, 0 = NO SCHEDULE"));
+  Serial.println(F("agr or AGR <Tag ID OR PWD> <0-8>\tASSIGNS ID TAG OR PASSWORD TO A GROUP, 0 = NO GROUP"));
+  Serial.println(F("sgr or SGR <1-8> <DAYS> <1-4>\tSETS GROUP ACCESS FOR DAYS (0 = PERMANENT) TO DOORS 1-4 (NONE = NO ACCESS)"));
+  Serial.println(F("rgr or RGR\t\t\tDISPLAYS THE GROUPS"));
+  Serial.println(F("bop or BOP <G1-8/T<DAYS>/ALL> <EXT DAYS/REV/GRP 0-8/ATT 1-8>"));
+  Serial.println(F("\t\t\t\tCHANGES THE USERS OF A GROUP, WITH TEMPORARY ACCESS EXPIRING WITHIN DAYS OR ALL USERS"));
   Serial.println("");
   Serial.println(F("ddi or DDI <Tag ID>\t\tDELETE USER ID"));
   Serial.println(F("ddp or DDP <PWD>\t\tDELETE USER PASSWORD IN DATABASE"));
@@ -2906,12 +4163,6 @@ void menu()                             // Display commands.
   Serial.println(F("mdp or MDP <PWD>\t\tMODIFY A PASSORD FOR A USER"));
   Serial.println(F("min or MIN <TAG ID>\t\tMODIFY USER NAME FOR A SPECIFIC USER USING THE ID TAG"));
   Serial.println(F("mpn or MPN <PWD>\t\tMODIFY USER NAME FOR A SPECIFIC USER USING THE PASSWORD"));
-  
-
-  SCmd.addCommand("min", modDbIdNam);             // Modifies a user name in database for a given id number.
-  SCmd.addCommand("mpn", modDbPwdNam);            // Modifies a user name in database for a given password.
-
-  
   Serial.println("");
   Serial.println(F("cdb or CDB <Y/N>\t\tCLEAR USER DATABASE"));
   Serial.println(F("ccf or CCF <Y/N>\t\tCLEAR CONFIGURATION (RFID DATABASE IS UNCHANGED)"));
@@ -2919,6 +4170,7 @@ void menu()                             // Display commands.
   //
   Serial.println("");
   Serial.println(F("rst or RST\t\t\tRESETS THE RFID CONTROLLER"));
+  Serial.println(F("{\"id\":N,\"op\":\"...\"}\t\tMACHINE PROTOCOL REQUEST (HOST TOOLS)"));
   Serial.println(F("menu or ?\t\t\tHELP MENU"));
 }
 
@@ -2928,7 +4180,7 @@ void menu()                             // Display commands.
 int8_t argOnOff()
 {
   char *arg;
-  arg = SCmd.next();                              // Get the next argument from the SerialCommand object buffer
+  arg = console.next();                           // Get the next argument from the CLI engine buffer
 
   if (arg != NULL)
   {
@@ -2954,7 +4206,7 @@ int8_t argyn()
 {
   char *arg;  
 
-  arg = SCmd.next();                                  // Get the next argument from the SerialCommand object buffer
+  arg = console.next();                           // Get the next argument from the CLI engine buffer
   if (arg != NULL)
   {
     if (strcasecmp(arg, "n") == 0){return 0;}         // NO selected.
@@ -2980,7 +4232,7 @@ int argcf()
 {
   char *arg;  
 
-  arg = SCmd.next();                                  // Get the next argument from the SerialCommand object buffer
+  arg = console.next();                           // Get the next argument from the CLI engine buffer
   if (arg != NULL)
   {
     if (strcasecmp(arg, "f") == 0){return 0;}         // Fahrenheit scale selected.
@@ -3002,45 +4254,36 @@ int argcf()
 //#################################################################################################################
 // ARGUMENT NUMBER METHOD
 //#################################################################################################################
-// Waits for a numerical input and returns a 32 bit number or error if outside the range of 0-9,294,295,967
-// Could have used the Serial.parse method but could not establish input limits.
+// Converts the next argument of the command line (typed on the console or passed in from a keypad or tag reader)
+// into a 32 bit number. Non numeric characters are ignored. Returns false if no number was entered.
 bool argNum(uint32_t &tagId)
 {
-  uint32_t arg = 0;
-  
-  for (int8_t i=0; i<10; i++)                     // Gets 10 digit (32bit) ID Tag.
-  {  
-    while(Serial.available() == 0)                // do until CR detected.
+  char      *arg;
+  uint8_t   digits = 0;
+
+  tagId = 0;
+  arg = console.next();
+  if (arg == NULL){return 0;}
+  for (; *arg != '\0' && *arg != '#' && digits < 10; arg++)  // Gets 10 digit (32bit) ID Tag.
+  {
+    if ((*arg >= '0') && (*arg <= '9'))
     {
-      if(wg.available())
-      {
-        if(wg.getWiegandType() == 26 || wg.getWiegandType() == 34)
-        {
-          tagId = wg.getCode();
-          return 1;                               // TagID received so exit.
-        }
-        else if(wg.getWiegandType() == 4)
-        {
-          arg =  wg.getCode(); // larger variable to make math easier.
-          if (arg == '#'){return true;}
-          else{tagId = tagId * 10UL + arg;} 
-          break;                                  // Exits "WHILE" loop back to "FOR" loop above.
-        }
-      }
+      tagId = tagId * 10UL + *arg - 48UL;
+      digits++;
     }
-    
-    arg = Serial.read();                          // get the character.
-    if (arg == '\r'){break;}                      // CR detected so exit serial input.
-    else if ((arg >= '0') && (arg <= '9')){tagId = tagId * 10UL + arg - 48UL;}
-    else{i--;}                          // Move character counter"i" back one so non numeric characters are ignored.
   }
+  return tagId != 0;                              // Return successful status.
+}
 
-  if(tagId){return 1;}                            // Return successful status.
-  else
-  {
-    tagId = 0;
-    return 0;
-  }
+//#################################################################################################################
+// ARGUMENT THEN METHOD
+//#################################################################################################################
+// Runs the next step of a command immediately if its argument was entered on the same line, otherwise the step
+// is left pending in the CLI engine until the operator enters it or the keypad timer (eAddrKeyTmr) expires.
+void argThen(void (*step)())
+{
+  if(console.peek()){step();}
+  else{console.await(step, EEPROM.read(eAddrKeyTmr));}
 }
 
 //#################################################################################################################
@@ -3054,7 +4297,7 @@ int16_t argNumMinMax(uint16_t argMin, uint16_t argMax)
   uint16_t  aNumber = 0;
   char      *arg;
 
-  arg = SCmd.next();
+  arg = console.next();
   if (arg != NULL)
   {
     aNumber=atoi(arg);                            // Converts a char string to an integer
@@ -3075,65 +4318,76 @@ int16_t argNumMinMax(uint16_t argMin, uint16_t argMax)
   }
 }
 
+//#################################################################################################################
+// ARGUMENT RANGE METHOD
+//#################################################################################################################
+// Converts the next argument of the command line into a number. Returns -1 if the argument is missing, is not a
+// number or is outside "argMin" to "argMax". Unlike "argNumMinMax", zero is a valid value.
+int16_t argRange(uint8_t argMin, uint8_t argMax)
+{
+  char    *arg = console.next();
+  char    *end;
+  long    val;
+
+  if(arg == NULL || !isdigit(*arg)){return -1;}
+  val = strtol(arg, &end, 10);
+  if(*end != '\0' || val < argMin || val > argMax){return -1;}
+  return val;
+}
+
+//#################################################################################################################
+// ARGUMENT ATTRUIBUTE LIST METHOD
+//#################################################################################################################
+// Displays the attribute options before the operator is asked to select them.
+void argAttList()
+{
+  Serial.println(F("ATTRIBUTE OPTIONS"));
+  Serial.println(F("================="));
+  for (int i = 0; i < NUMBER_OF_ITEMS; i++)
+  {
+    printAttList ((const char *) &attList [i]);
+    Serial.println("\n");
+  }
+  Serial.println(F("ENTER 1-8 TO SELECT ATTIBUTE(S),# TO EXIT:"));
+}
+
 //#################################################################################################################
 // ARGUMENT ATTRUIBUTE METHOD
 //#################################################################################################################
-// Waits for a numerical input and returns a 16 bit number or error if outside the range of 0-4,294,967,295
-// Could have used the Serial.parse method but could not establish input limits.
-int16_t argAtt()
+// Converts the remainder of the command line into an attribute byte. Each digit 1-8 sets the matching attribute
+// bit, "#" ends the selection and all other characters are ignored.
+uint8_t argAtt()
 {
-//  uint8_t att = 0;
-  uint8_t arg = 0;
-  
-  while (arg != '#')
-  {  
-    Serial.println(F("ATTRIBUTE OPTIONS"));
-    Serial.println(F("================="));
-    for (int i = 0; i < NUMBER_OF_ITEMS; i++)
-    {
-      printAttList ((const char *) &attList [i]);
-      Serial.println("\n");
-    }
-    Serial.println(F("ENTER 1-8 TO SELECT ATTIBUTE(S),# TO EXIT:"));
-    while(Serial.available() == 0)                // do until CR detected.
-    {
-      if(wg.available())
-      {
-        if(wg.getWiegandType() == 4)
-        {
-          arg =  wg.getCode();                    // larger variable to make math easier.
-          if (arg == '#'){return att;}
-          else if((arg >= 1) && (arg <= 8)){att |= (1 << (arg-1));}        // Set permission bit.
-        }
-      }
-    }
-    arg = Serial.read();                          // get the character.
-    if (arg == '#'){return att;}                  // CR detected so exit serial input. 
-    else if ((arg >= '1') && (arg <= '8')){att |= (1 << (arg - 49));} // convert from ASCII to int and offset by -1.
+  uint8_t   newAtt = 0;
+  char      *arg = console.rest();
+
+  for (; *arg != '\0' && *arg != '#'; arg++)
+  {
+    if ((*arg >= '1') && (*arg <= '8')){newAtt |= (1 << (*arg - 49));} // convert from ASCII to int and offset by -1.
   }
+  return newAtt;
 }
 
 //#################################################################################################################
 // ARGUMENT NAME METHOD
 //#################################################################################################################
-// Waits for name to be entered.
-bool argNam(char name)
+// Returns the name entered on the remainder of the command line or NULL if no name (or a name too long
+// for the database) was entered.
+char *argNam()
 {
-  char *arg;
+  char *arg = console.rest();
 
-  arg = SCmd.next();
-  if (arg != NULL)
+  if (*arg == '\0')
   {
-    name = *arg;                                 // Place id nane in global variable.
-    return true;
+    Serial.println(F("No arguments entered"));
+    return NULL;
   }
-  else
+  if (strlen(arg) > (NAMELENGTH - 1))
   {
-    Serial.println(F("No arguments entered"));
-//    name = NULL;
-    name = '\0';
-    return false;
+    Serial.println(F("NAME TOO LONG"));
+    return NULL;
   }
+  return arg;
 }
 
 //#################################################################################################################
@@ -3155,17 +4409,13 @@ void missingArg()                                 // Incorrect argument.
 //#################################################################################################################
 // LED SELFTEST METHOD
 //#################################################################################################################
+// Lights the RED, GREEN and BLUE status LEDs one second each, in the background.
 void ledSelfTest()
 {
-  Serial.print(F("LED SELFTEST STARTED..."));
-
-  for (uint8_t i = 0; i < 3; i++)
-  {
-    digitalWrite((rLedPin - i),!digitalRead(rLedPin - i));
-    delay(1000);
-    digitalWrite((rLedPin - i),!digitalRead(rLedPin - i));
-  }
-  Serial.println(F("LED SELFTEST COMPLETED"));
+  Serial.println(F("LED SELFTEST STARTED..."));
+  fb.play(FBRLED, fbSelfTest1);
+  fb.play(FBGLED, fbSelfTest2);
+  fb.play(FBBLED, fbSelfTest3);
 }
 
 //#################################################################################################################
@@ -3247,17 +4497,22 @@ ISR (PCINT0_vect)                                 // Interrupt vector for PCINT0
 // Time base for ISR is set to 120Hz to allow lock solenoid to cycle ON/OFF at 60Hz.
 ISR(TIMER1_OVF_vect)                              // interrupt service routine 
 {
+  sampler.tick();                                 // Read the inputs, start the next ADC block.
+  inputs.tick();                                  // Debounce the buttons and switches, queue their events.
+  fb.tick();                                      // Next step of the beeper, LED, bell and speaker patterns.
+
   // If door unlock sequence active, simulate 60Hz AC using PWM square wave)
-  if(frtDrLckDlyTmr){digitalWrite(frtDrLckPin,(!digitalRead(frtDrLckPin)));}       // Unlock front door with 60Hz.
-  if(rrDrLckDlyTmr){digitalWrite(rearDrLckPin,(!digitalRead(rearDrLckPin)));}      // Unlock rear door with 60Hz.
-  if(shdDrLckDlyTmr){digitalWrite(shedDrLckPin,(!digitalRead(shedDrLckPin)));}     // Unlock shed door with 60Hz.
+  for(uint8_t i = 0; i < DOORCOUNT; i++)
+  {
+    if(drLckDlyTmr[i]){*doorPort[i].lckOut ^= doorPort[i].lckMask;}  // Unlock door with 60Hz.
+  }
 
   if(tenHzTimer){tenHzTimer--;}
   else
   {
     tenHzTick = ON;
     tenHzTimer = TENHZTIMERDEFAULT;               // Reset ten hertz timer.
-    if(digitalRead(pirPin))
+    if(sampler.read(SNPIR))
     {
       pirFlag = ON;
 //      digitalWrite(bLedPin, ON);
@@ -3270,10 +4525,11 @@ ISR(TIMER1_OVF_vect)                              // interrupt service routine
   {
     oneHzTick = ON;                               // Used when verbose is set to "ON".
     oneHzTimer = ONEHZTIMERDEFAULT;               // Reset one Hz timer.
-    if (keyTmr){keyTmr--;}                        // Keypad timer resets to 30 sec. when key is pressed.
-    if(frtDrLckDlyTmr){frtDrLckDlyTmr--;}         // Unlock front door for the duration of the unlock delay timer.
-    if(rrDrLckDlyTmr){rrDrLckDlyTmr--;}           // Unlock rear door for the duration of the unlock delay timer.
-    if(shdDrLckDlyTmr){shdDrLckDlyTmr--;}         // Unlock shed door for the duration of the unlock delay timer.
+    console.tick();                               // Timeout for CLI commands waiting for operator input.
+    for(uint8_t i = 0; i < DOORCOUNT; i++)        // Unlock doors for the duration of the unlock delay timer.
+    {
+      if(drLckDlyTmr[i] && !--drLckDlyTmr[i]){drLckExp |= (1 << i);}   // Flag door to be locked by "checkLocks".
+    }
 
     if (oneMnTimer){oneMnTimer--;}
     else
@@ -3296,13 +4552,32 @@ ISR(TIMER1_OVF_vect)                              // interrupt service routine
   encoder->service();                             // Maintain encoder
 }
 
+//#################################################################################################################
+// PIN CHANGE INTERRUPT 2 METHOD
+//#################################################################################################################
+// A PORTK button (A8 - A15) changed, the input engine reads them at the next timer tick.
+ISR(PCINT2_vect)
+{
+  inputs.wake();
+}
+
+//#################################################################################################################
+// ADC INTERRUPT SERVICE METHOD
+//#################################################################################################################
+// Conversion complete, the sampler stores it and starts the next one (see "Sampler.h").
+ISR(ADC_vect)
+{
+  sampler.adcDone();
+}
+
 
 //#################################################################################################################
 // ERROR LOG METHOD
 //#################################################################################################################
 void logErr(uint8_t errNum)
 {
-  EEPROM.write(eAddrErrCode, errNum);             // Record last error.
+  EeScope scope(EEOP_LOG);
+  eeMeter.write(eAddrErrCode, errNum);            // Record last error.
     errorTone();                                  // Sound error tone.
 }
 
@@ -3387,6 +4662,73 @@ void eepromDump()
   Serial.println();
 }
 
+//#################################################################################################################
+// READ EEPROM WEAR METHOD
+//#################################################################################################################
+// Displays EEPROM accesses per operation since the last reset and writes per region since the counts were cleared.
+// The life left of the most written region is estimated from its write rate. The low figure assumes every write
+// went to the same byte, the high figure assumes writes were spread over the whole region.
+void readEeWear()
+{
+  char      *arg    = console.next();
+  uint8_t   hot     = 0;
+  uint32_t  minutes = eeMeter.minutes();
+
+  #if !defined EEMETER
+    Serial.println(F("EEPROM METER NOT ENABLED (EEMETER IN EepromMeter.h)"));
+    return;
+  #endif
+
+  if(arg != NULL && strcasecmp(arg, "clr") == 0)
+  {
+    eeMeter.clear();
+    Serial.println(F("EEPROM COUNTS CLEARED"));
+    return;
+  }
+  Serial.println(F("OPERATION\tREADS\tWRITES\tSKIPPED\tCOMMITS"));
+  for(uint8_t op = 0; op < EEOP_COUNT; op++)
+  {
+    const EeCount &cnt = eeMeter.count(op);
+    if(cnt.reads == 0 && cnt.writes == 0 && cnt.skipped == 0){continue;}
+    printMsg(eeOpName[op]);
+    Serial.print('\t');
+    Serial.print(cnt.reads);
+    Serial.print('\t');
+    Serial.print(cnt.writes);
+    Serial.print('\t');
+    Serial.print(cnt.skipped);
+    Serial.print('\t');
+    Serial.println(cnt.commits);
+  }
+  Serial.print(F("WRITES PER REGION OVER "));
+  Serial.print(minutes / 1440);
+  Serial.print(F(" DAYS "));
+  Serial.print(minutes / 60 % 24);
+  Serial.println(F(" HOURS"));
+  for(uint8_t r = 0; r < EEMETER_REGIONS; r++)
+  {
+    Serial.print(F("0x"));
+    if(r * EEMETER_REGION < 0x100){Serial.print('0');}
+    if(r * EEMETER_REGION < 0x10){Serial.print('0');}
+    Serial.print(r * EEMETER_REGION, HEX);
+    Serial.print('\t');
+    Serial.print(eeMeter.regionWrites(r));
+    Serial.print((r % 4 == 3) ? '\n' : '\t');
+    if(eeMeter.regionWrites(r) > eeMeter.regionWrites(hot)){hot = r;}
+  }
+  uint32_t writes = eeMeter.regionWrites(hot);
+  if(writes == 0 || minutes < 60){Serial.println(F("NOT ENOUGH DATA TO ESTIMATE EEPROM LIFE")); return;}
+  if(writes >= EEMETER_ENDURANCE){Serial.println(F("WARNING, RATED ENDURANCE MAY BE EXCEEDED")); return;}
+  float daysPerWrite = (float)minutes / writes / 1440;
+  Serial.print(F("MOST WRITTEN REGION 0x"));
+  Serial.print(hot * EEMETER_REGION, HEX);
+  Serial.print(F(", ESTIMATED LIFE LEFT "));
+  Serial.print((EEMETER_ENDURANCE - writes) * daysPerWrite / 365, 1);
+  Serial.print(F(" TO "));
+  Serial.print((EEMETER_ENDURANCE * EEMETER_REGION - writes) * daysPerWrite / 365, 1);
+  Serial.println(F(" YEARS"));
+}
+
 //#################################################################################################################
 // DISPALY ATTRIBUTE LIST METHOD
 //#################################################################################################################
@@ -3433,45 +4775,20 @@ void displayPerm()
 //#################################################################################################################
 void checkLocks()
 {
-  if(drUnlockFlag)
+  if(drLckExp)                                    // One or more unlock delays expired (see ISR).
   {
-    if(!frtDrLckDlyTmr && (drUnlockFlag & FRTDRLOCK))
-    {
-      digitalWrite(frtDrLckPin,LOCK);
-      Serial.println(F("FRONT DOOR LOCKED"));
-      drUnlockFlag &= ~FRTDRLOCK;                 // Turn off flag to show door is now locked.
-      digitalWrite(frtLedPin,OFFINV);             // Turn Front door access keypad LED to red.
-      digitalWrite(frtBprPin,OFFINV);             // Turn Front door access keypad beeper.
-     digitalWrite(gLedPin, OFF);                  // Turn on GREEN control panel Status LED.
-   }
-
-    if(!rrDrLckDlyTmr && (drUnlockFlag & REARDRLOCK))
+    noInterrupts();
+    uint8_t expired = drLckExp;
+    drLckExp = 0;
+    interrupts();
+    for(uint8_t i = 0; i < DOORCOUNT; i++)
     {
-      digitalWrite(rearDrLckPin,LOCK);
-      Serial.println(F("REAR DOOR LOCKED"));
-      drUnlockFlag &= ~REARDRLOCK;                // Turn off flag to show door is now locked.
-      digitalWrite(frtLedPin,OFFINV);             // Turn Front door access keypad LED to red.
-      digitalWrite(frtBprPin,OFFINV);             // Turn off front door access keypad beeper.
-      digitalWrite(rearLedPin,OFF);               // Turn rear door access keypad LED to red.
-      digitalWrite(rearBprPin,OFFINV);            // Turn off rear door access keypad beeper.
-      digitalWrite(gLedPin, OFF);                 // Turn on GREEN control panel Status LED.
-    }
-
-    if(!shdDrLckDlyTmr && (drUnlockFlag & SHEDDRLOCK))
-    {
-      digitalWrite(shedDrLckPin,LOCK);
-      Serial.println(F("SHED DOOR LOCKED"));
-      drUnlockFlag &= ~SHEDDRLOCK;                // Turn off flag to show door is now locked.
-      digitalWrite(frtLedPin,OFFINV);             // Turn Front door access keypad LED to red.
-      digitalWrite(frtBprPin,OFFINV);             // Turn off front door access keypad beeper.
-      digitalWrite(shedLedPin,OFF);               // Turn rear door access keypad LED to red.
-      digitalWrite(shedBprPin,OFFINV);            // Turn off shed door access keypad beeper.
-      digitalWrite(gLedPin, OFF);                 // Turn on GREEN control panel Status LED.
+      if(expired & (1 << i)){lockDr(i);}
     }
   }
   if(EEPROM.read(eAddrGarDrSn))                   // Garage door sensors enabled, so check garage door timer.
   {
-    if(!garDrTmr && (drUnlockFlag & GARDRLOCK) && digitalRead(garDrUpSwPin) == ONINV)
+    if(!garDrTmr && (drUnlockFlag & GARDRLOCK) && inputs.pressed(INGARUP))
     {
       readTmDt();
       Serial.print(F("GARAGE DOOR TIMEOUT, "));   // Flag that door was closed due to timer at 0.
@@ -3481,25 +4798,174 @@ void checkLocks()
   }
 }
 
+//#################################################################################################################
+// ACCESS MAP METHODS
+//#################################################################################################################
+// Rebuilds the door permissions of every user from the attribute and time stamp in the database. A user may open
+// a door if its door bit is set and it has permanent access, unexpired temporary access or one-time access, or if
+// the door bit of its group is set and the group has permanent or unexpired temporary access. The earliest
+// temporary access expiry (users and groups) is kept in "acsNextExp" so the sweep only runs when something has
+// expired.
+void acsRebuild()
+{
+  uint8_t   usrAtt = 0;
+  uint8_t   doors;
+  uint8_t   grp;
+  uint32_t  tm;
+  bool      valid;
+
+  acsMap.clear();
+  dcache.clear();                                 // Decisions taken on the old rights are forgotten.
+  acsNextExp = 0xFFFFFFFF;
+  for(grp = 0; grp < GROUPS; grp++)
+  {
+    if((grpAtt[grp] & TEMPACCESS) && grpTm[grp] < acsNextExp){acsNextExp = grpTm[grp];}
+  }
+  for(uint8_t i = 0; i < db.count() && i < DBUSERS; i++)
+  {
+    db.readAtt(i, usrAtt);
+    db.readSch(i, acsSch[i]);
+    grp = acsSch[i] >> GRPSHIFT;
+    acsSch[i] &= SCHMASK;
+    valid = usrAtt & PERMACCESS;
+    if((usrAtt & TEMPACCESS) && db.readTm(i, tm))
+    {
+      if(tm < acsNextExp){acsNextExp = tm;}
+      if(timeStmp <= tm){valid = true;}
+    }
+    doors = (valid || (usrAtt & ONETMACCESS)) ? acsDoors(usrAtt) : 0;
+    if(grp && grp <= GROUPS && grpValid(grp - 1) && acsDoors(grpAtt[grp - 1]))
+    {
+      doors |= acsDoors(grpAtt[grp - 1]);
+      valid = true;
+    }
+    if(!doors){continue;}
+    acsMap.set(i, doors, !valid);                 // One-time access only matters if it is the only access.
+  }
+  acsRev = db.revision();
+}
+
+// Door bits of "acsMap" (bit = door number, GARDR for the garage door) of the door bits of an attribute.
+uint8_t acsDoors(uint8_t att)
+{
+  uint8_t doors = 0;
+
+  for(uint8_t dr = 0; dr < DOORCOUNT; dr++)
+  {
+    if(att & pgm_read_byte(&doorTable[dr].perm)){doors |= 1 << dr;}
+  }
+  if(att & GARDRLOCK){doors |= 1 << GARDR;}
+  return doors;
+}
+
+// Turns off temporary access of every user and group whose time has expired. The users are committed once.
+void acsSweep()
+{
+  uint8_t   usrAtt = 0;
+  uint32_t  tm;
+
+  for(uint8_t grp = 0; grp < GROUPS; grp++)
+  {
+    if((grpAtt[grp] & TEMPACCESS) && (timeStmp > grpTm[grp]))
+    {
+      grpAtt[grp] &= ~TEMPACCESS;                 // Turn off temp access.
+      eeMeter.write(eAddrGrp + grp * GRPBYTES, grpAtt[grp]);
+      readTmDt();
+      Serial.print(F("GROUP "));
+      Serial.print(grp + 1);
+      Serial.println(F(" TEMPORARY ACCESS EXPIRED"));
+    }
+  }
+  db.beginBatch();
+  for(uint8_t i = 0; i < db.count(); i++)
+  {
+    db.readAtt(i, usrAtt);
+    if((usrAtt & TEMPACCESS) && db.readTm(i, tm) && (timeStmp > tm))
+    {
+      db.modifyAtt(i, usrAtt & ~TEMPACCESS);      // Turn off temp access.
+      db.readNam(i, name);
+      readTmDt();
+      Serial.print(name);
+      Serial.println(F(" TEMPORARY ACCESS EXPIRED"));
+    }
+  }
+  db.endBatch();
+  acsRebuild();
+}
+
+// Clears the one-time access of users who have used it, then rebuilds "acsMap" if the database has changed. Must
+// run before users can be moved (removed) in the database.
+void acsService()
+{
+  int16_t   slot;
+  uint8_t   usrAtt;
+
+  while((slot = acsMap.nextPending()) >= 0)
+  {
+    if(db.readAtt(slot, usrAtt)){db.modifyAtt(slot, usrAtt & ~ONETMACCESS);}  // Turn off one time use for this user.
+    acsMap.done(slot);
+  }
+  if(acsRev != db.revision()){acsRebuild();}
+}
+
+//#################################################################################################################
+// GROUP METHODS
+//#################################################################################################################
+// A group is an attribute byte (door bits, PERMACCESS or TEMPACCESS) and an expiry time stamp at "eAddrGrp". Bits
+// other than these (erased EEPROM) leave the group without access.
+void grpLoad()
+{
+  for(uint8_t grp = 0; grp < GROUPS; grp++)
+  {
+    grpAtt[grp] = EEPROM.read(eAddrGrp + grp * GRPBYTES);
+    EEPROM.get(eAddrGrp + grp * GRPBYTES + 1, grpTm[grp]);
+    if(grpAtt[grp] & ~(PERMACCESS | TEMPACCESS | SHEDDRLOCK | REARDRLOCK | GARDRLOCK | FRTDRLOCK)){grpAtt[grp] = 0;}
+  }
+}
+
+bool grpValid(uint8_t grp)
+{
+  return (grpAtt[grp] & PERMACCESS) || ((grpAtt[grp] & TEMPACCESS) && timeStmp <= grpTm[grp]);
+}
+
+//#################################################################################################################
+// SCHEDULE METHODS
+//#################################################################################################################
+// Schedule profiles hold one bit per hour of the week (bit "day X 24 + hour", Sunday = day 0). A user with profile 0
+// (or a profile number left over from an erased EEPROM) has no schedule. "schSlot" is updated on the 1 minute tick
+// so checking a schedule at the door is a single bit lookup. Until the RTC is up (BOOTRTC) the slot is unknown
+// (SCHNOSLOT) and only users without a schedule are allowed.
+void schUpdate()
+{
+  DateTime now = rtc.now();
+  schSlot = now.dayOfTheWeek() * 24 + now.hour();
+}
+
+bool schAllowed(uint8_t sch)
+{
+  if(!sch || sch > SCHPROFILES){return true;}    // No schedule.
+  if(schSlot == SCHNOSLOT){return false;}         // Time not known yet.
+  return schTable[sch - 1][schSlot >> 3] & (1 << (schSlot & 7));
+}
+
 //#################################################################################################################
 // GARAGE DOOR CONTROL METHOD
 //#################################################################################################################
+// Pulses the opener relay for 500 milliseconds in the background ("fbGarDr"). Until the position switches had 1.5
+// seconds to change state after the pulse, the door is not operated again.
 void garDrCntl()
 //bool garDrCntl()
 {
+  if(fb.busy(FBGAROPN)){return;}                  // Door still moving from the last pulse.
   // if door is closed or door is in mid-way postion, then turn on garage door flag to show door was opened.
-  if(digitalRead(garDrDnSwPin) == ONINV)
+  if(inputs.pressed(INGARDN))
   {
     drUnlockFlag |= GARDRLOCK;
     garDrTmr = EEPROM.read(eAddrGarDrTmr);
   }
   
-  digitalWrite(bLedPin,ON);                       // Turn on BLUE status LED.
-  digitalWrite(garDrOpnPin,1);                    // Turn on relay.
-  delay (500);                
-  digitalWrite(bLedPin,OFF);                      // Turn off BLUE status LED.
-  digitalWrite(garDrOpnPin,0);                    // Turn off relay.
-  delay (1500);                                   // Give time for door position switch to change state.          
+  fb.play(FBGAROPN, fbGarDr);                     // Relay pulse.
+  fb.play(FBBLED, fbBell);                        // BLUE status LED while the relay is on.
 }   
 
 //#################################################################################################################
@@ -3536,83 +5002,75 @@ void longPressGarDrWalSw()
 // Updates the status of all switch inputs and performs the appropriate action if pressed.
 // Monitors the Garage wall switch, Intercom unlock switch, Intercom auxilary switch, Intercom bell
 // button switch, RFID bell button switch for press event and performsrequired action if pressed.
-void  checkBtn()                                  // Update all Button instances.
-{
-  frtBelBtn.read();
-  garDrWalSw.read();
-  garBelBtn.read();
-  garDrDnSw.read();
-  garDrUpSw.read();
-  rearBelBtn.read();
-  intDrBtn.read();
-  intAuxBtn.read();
-  
-  
-  if (frtBelBtn.wasPressed())                     // RFID "BELL" button pressed, Ring front door bell.
-  {
-    readTmDt();
-    Serial.println(F("FRONT RFID BELL BUTTON PRESSED"));
-    ringFrtBel();
-  }
-  
-  if (garBelBtn.wasPressed())                     // Garage RFID "BELL" button pressed.Ring front door bell.
-  {
-    readTmDt();
-    Serial.println(F("GARAGE RFID BELL BUTTON PRESSED"));
-    ringFrtBel();
-  }
-  
-  if (rearBelBtn.wasPressed())                    // Rear RFID "BELL" button pressed, Ring front door bell.
-  {
-    readTmDt();
-    Serial.println(F("REAR RFID BELL BUTTON PRESSED"));
-    ringRearBel();
-  }
-  
-  if (intDrBtn.wasPressed())                      // Unlock front door.
-  {
-    readTmDt();
-    Serial.println(F("INTERCOM DOOR BUTTON PRESSED"));
-    unlockFrtDr();
-  }
-  
-  if (intAuxBtn.wasPressed())                     // Intercom Aux sw pressed, Open/Close garage door.
-  {
-    readTmDt();
-    Serial.println(F("INTERCOM AUX BUTTON PRESSED"));
-//    garDrCntl();
-  }
-  
-//  if (garDrWalSw.wasPressed())                    // Garage wall sw pressed, Open/Close garage door.
-//  {
-//    garDrCntl();
-//    readTmDt();
-//    Serial.print(F("GARAGE DOOR WALL SWITCH PRESSED, "));
-//  }
-  
-//  if (garDrWalSw.pressedFor(HOLDTM))          // Bypass garage door timer.
-//  {
-//    garDrWalSwLongPress();
-//    readTmDt();
-//    Serial.println(F("GARAGE DOOR WALL SWITCH LONG PRESS"));
-//  }
+void  checkBtn()                                  // Handles the queued button and switch events.
+{
+  InputEvent  ev;
 
-  if (garDrDnSw.wasPressed())                     // Garage door is closed.
-  {
-    Serial.println(F("CLOSED"));
-    digitalWrite(almZone6Pin, OFF);               // Turn off relay for alarm zone 6 (Door closed).
-    drUnlockFlag &= ~GARDRLOCK;                   // Turn off  "DISABLE GARAGE DOOR TIMER" flag.
-    garDrTmr = 0;
-  }
-  
-  if (garDrDnSw.wasReleased())                    // Garage door is opening.
+  while(inputs.next(ev))                          // Nothing to do until an input changed (see "InputEngine").
   {
-    digitalWrite(almZone6Pin, ON);                // Turn on relay for alarm zone 6 (Door open).
-    Serial.print(F("GARAGE DOOR IS OPENING..."));
-  }
+    switch(ev.chan)
+    {
+      case INFRTBEL:                              // RFID "BELL" button pressed, Ring front door bell.
+        if(ev.type != IN_PRESS){break;}
+        readTmDt();
+        Serial.println(F("FRONT RFID BELL BUTTON PRESSED"));
+        ringFrtBel();
+      break;
+
+      case INGARBEL:                              // Garage RFID "BELL" button pressed.Ring front door bell.
+        if(ev.type != IN_PRESS){break;}
+        readTmDt();
+        Serial.println(F("GARAGE RFID BELL BUTTON PRESSED"));
+        ringFrtBel();
+      break;
+
+      case INREARBEL:                             // Rear RFID "BELL" button pressed, Ring front door bell.
+        if(ev.type != IN_PRESS){break;}
+        readTmDt();
+        Serial.println(F("REAR RFID BELL BUTTON PRESSED"));
+        ringRearBel();
+      break;
+
+      case INDOOR:                                // Unlock front door.
+        if(ev.type != IN_PRESS){break;}
+        readTmDt();
+        Serial.println(F("INTERCOM DOOR BUTTON PRESSED"));
+        unlockDr(FRTDR);
+      break;
+
+      case INAUX:                                 // Intercom Aux sw pressed, Open/Close garage door.
+        if(ev.type != IN_PRESS){break;}
+        readTmDt();
+        Serial.println(F("INTERCOM AUX BUTTON PRESSED"));
+//        garDrCntl();
+      break;
+
+      case INGARWAL:                              // Garage wall sw, open/close garage door or bypass the timer.
+        if(ev.type == IN_CLICK){singlePressGarDrWalSw();}
+        else if(ev.type == IN_LONG){longPressGarDrWalSw();}
+      break;
+
+      case INGARDN:
+        if(ev.type == IN_PRESS)                   // Garage door is closed.
+        {
+          Serial.println(F("CLOSED"));
+          digitalWrite(almZone6Pin, OFF);         // Turn off relay for alarm zone 6 (Door closed).
+          drUnlockFlag &= ~GARDRLOCK;             // Turn off  "DISABLE GARAGE DOOR TIMER" flag.
+          garDrTmr = 0;
+        }
+        else if(ev.type == IN_RELEASE)            // Garage door is opening.
+        {
+          digitalWrite(almZone6Pin, ON);          // Turn on relay for alarm zone 6 (Door open).
+          Serial.print(F("GARAGE DOOR IS OPENING..."));
+        }
+      break;
 
-  if (garDrUpSw.wasPressed()){Serial.println(F("OPEN"));} // Garage door is opened.
-  if (garDrUpSw.wasReleased()){Serial.print(F("GARAGE DOOR IS CLOSING..."));} // Garage door is opening.
+      case INGARUP:
+        if(ev.type == IN_PRESS){Serial.println(F("OPEN"));}   // Garage door is opened.
+        else if(ev.type == IN_RELEASE){Serial.print(F("GARAGE DOOR IS CLOSING..."));}
+      break;
+    }
+  }
 }
 
 //#################################################################################################################
@@ -3622,11 +5080,8 @@ void ringFrtBel()
 {
   readTmDt();
   Serial.println(F("FRONT RFID BELL BUTTON PRESSED"));
-  digitalWrite(frtBelPin,ON);                     // Turn front doorbell FET.
-  digitalWrite(gLedPin,ON);                       // Turn on GREEN status LED.
-  delay (500);                
-  digitalWrite(frtBelPin,OFF);                    // Turn off relay.
-  digitalWrite(gLedPin,OFF);                      // Turn off GREEN status LED.
+  fb.play(FBFRTBEL, fbBell);                      // Ring front doorbell FET for 500 milliseconds.
+  fb.play(FBGLED, fbBell);                        // Flash GREEN status LED.
 }
 
 //#################################################################################################################
@@ -3636,11 +5091,8 @@ void ringRearBel()
 {
   readTmDt();
   Serial.println(F("FRONT RFID BELL BUTTON PRESSED"));
-  digitalWrite(rearBelPin,ON);                    // Turn on relay.
-  digitalWrite(bLedPin,ON);                       // Turn on BLUE status LED.
-  delay (500);                
-  digitalWrite(rearBelPin,OFF);                   // Turn off relay.
-  digitalWrite(bLedPin,OFF);                      // Turn off BLUE status LED.
+  fb.play(FBREARBEL, fbBell);                     // Ring rear doorbell relay for 500 milliseconds.
+  fb.play(FBBLED, fbBell);                        // Flash BLUE status LED.
 }
 
 //#################################################################################################################
@@ -3658,92 +5110,115 @@ void help()
 //#################################################################################################################
 void startupTone()                                // Play startup melody.
 {
-  Serial.print("POWERUP MELODY STARTED...");
-  for(int thisNote = 0; thisNote < 5; thisNote++)
+  Serial.println(F("POWERUP MELODY STARTED..."));
+  #if defined SOUND
+    fb.play(FBSPKR, fbStartup);                   // Plays in the background (see "fbStartup").
+  #endif
+}
+
+//#################################################################################################################
+// ERROR TONE METHOD
+//#################################################################################################################
+// Beeps the keypad of door "dr" (FRTDR..GARDR) or every keypad (NODOOR) and sounds the error tone, in the
+// background so the other doors are not held up.
+void errorTone(uint8_t dr)                        // Error tone meoldy.
+{
+  if(dr != NODOOR){fb.play(FBBPR + dr, fbDeny);}
+  else
   {
-    int noteDuration = 1000/noteDurations[thisNote];
-    int pauseBetweenNotes = noteDuration * 1.30;
-  
-    tone(spkrPin, melody[thisNote],noteDuration);
-    delay(pauseBetweenNotes);
-    noTone(spkrPin);
-    delay (10);
+    fb.play(FBFRTBPR, fbDeny);                    // Turn on beeper.
+    fb.play(FBGARBPR, fbDeny);                    // Turn on beeper.
+    fb.play(FBREARBPR, fbDeny);                   // Turn on beeper.
   }
-  Serial.println("POWERUP MELODY COMPLETED");
+  fb.play(FBSPKR, fbDenyTone);
 }
 
 //#################################################################################################################
-// ERROR TONE METHOD
+// INITIALIZE DOORS METHOD
 //#################################################################################################################
-void errorTone()                                  // Error tone meoldy.
+// Converts the pins in "doorTable" to output registers and bit masks so the doors can be driven without the
+// pin lookups done by digitalWrite, then configures the pins with every door locked. The keypad LEDs and
+// beepers (garage keypad included), bells, status LEDs and speaker become "fb" channels (see FBCHANNEL).
+void initDoors()
 {
-  for(uint8_t i =0;i < 4;i++)
+  memset(kpDoor, NODOOR, sizeof(kpDoor));
+  kpDoor[GARDRKEYPD] = GARDR;
+  for(uint8_t i = 0; i < DOORCOUNT; i++)
   {
-    digitalWrite(frtBprPin, ONINV);             // Turn on beeper.
-    digitalWrite(garBprPin, ONINV);             // Turn on beeper.
-    digitalWrite(rearBprPin, ONINV);            // Turn on beeper.
-    delay(100); 
-    digitalWrite(frtBprPin, OFFINV);            // Turn off beeper.
-    digitalWrite(garBprPin, OFFINV);            // Turn off beeper.
-    digitalWrite(rearBprPin, OFFINV);           // Turn off beeper.
+    uint8_t lckPin = pgm_read_byte(&doorTable[i].lckPin);
+    uint8_t ledPin = pgm_read_byte(&doorTable[i].ledPin);
+    uint8_t bprPin = pgm_read_byte(&doorTable[i].bprPin);
+
+    doorPort[i].lckOut  = portOutputRegister(digitalPinToPort(lckPin));
+    doorPort[i].lckMask = digitalPinToBitMask(lckPin);
+    kpDoor[pgm_read_byte(&doorTable[i].keypad)] = i;
+
+    pinMode(lckPin, OUTPUT);                      // Door lock control.
+    digitalWrite(lckPin, LOCK);                   // Lock door.
+    fb.setPin(FBLED + i, ledPin, ONINV);          // Door access keypad LED, RED when OFF (Deavitvated HIGH).
+    fb.setPin(FBBPR + i, bprPin, ONINV);          // Door access keypad beeper, OFF (Deavitvated HIGH).
   }
-  
-  tone(spkrPin,100,100); 
-  delay(100); 
-  tone(spkrPin,500,100); 
-  delay(100); 
-  tone(spkrPin,1000,100); 
-  delay(100); 
-  tone(spkrPin,1500,100); 
-  delay(100); 
-  noTone(spkrPin);
+  fb.setPin(FBGARLED, garLedPin, ONINV);          // Garage door access keypad LED.
+  fb.setPin(FBGARBPR, garBprPin, ONINV);          // Garage door access keypad beeper.
+  fb.setPin(FBFRTBEL, frtBelPin, ON);             // Front door bell.
+  fb.setPin(FBREARBEL, rearBelPin, ON);           // Rear door bell.
+  fb.setPin(FBRLED, rLedPin, ON);                 // RED status LED.
+  fb.setPin(FBGLED, gLedPin, ON);                 // GREEN status LED.
+  fb.setPin(FBBLED, bLedPin, ON);                 // BLUE status LED.
+  fb.setPin(FBGAROPN, garDrOpnPin, ON);           // Garage door opener relay.
+  fb.setTone(FBSPKR, spkrPin);                    // Speaker.
 }
 
 //#################################################################################################################
-// UNLOCK FRONT DOOR METHOD
+// DOOR OUTPUT METHOD
 //#################################################################################################################
-bool unlockFrtDr()
+// Sets (val = 1) or clears (val = 0) a door output. Interrupts are held off during the read-modify-write as the
+// timer ISR toggles lock pins that may share the same port.
+void doorOut(volatile uint8_t *out, uint8_t mask, uint8_t val)
 {
-      frtDrLckDlyTmr = EEPROM.read(eAddrFrtDrLckTmr);
-      digitalWrite(frtDrLckPin,UNLOCK);           // Check ISR for 60Hz unlock simulation.
-      digitalWrite(frtLedPin, ONINV);             // Turn on green LED.
-      digitalWrite(gLedPin, ON);                  // Turn on GREEN control panel Status LED.
-      Serial.print(F(", FRONT DOOR UNLOCKED..."));
-      digitalWrite(frtBprPin, ONINV);             // Turn on beeper.
-      drUnlockFlag |= FRTDRLOCK;                  // Show door lock status.
-      return true;
+  uint8_t oldSREG = SREG;
+  noInterrupts();
+  if(val){*out |= mask;}
+  else{*out &= ~mask;}
+  SREG = oldSREG;
 }
 
 //#################################################################################################################
-// UNLOCK REAR DOOR METHOD
+// UNLOCK DOOR METHOD
 //#################################################################################################################
-bool unlockRearDr()
+// A delay that expired but was not yet handled by "checkLocks" is dropped, so the new grant is not locked at once.
+bool unlockDr(uint8_t dr)
 {
-    rrDrLckDlyTmr = EEPROM.read(eAddrRrDrLckTmr);
-    digitalWrite(rearDrLckPin,UNLOCK);            // Check ISR for 60Hz unlock simulation.
-    digitalWrite(frtLedPin, ONINV);               // Turn on green LED.
-    digitalWrite(gLedPin, ON);                    // Turn on GREEN control panel Status LED.
-    Serial.print(F(", UNLOCKED REAR DOOR..."));
-    drUnlockFlag |= REARDRLOCK;                   // Show door lock status.
-    digitalWrite(rearLedPin, ONINV);              // Turn on green LED.
-    digitalWrite(rearBprPin, ONINV);              // Turn on beeper.
-    return true;
+  uint8_t dly = EEPROM.read(pgm_read_byte(&doorTable[dr].tmrAddr));
+  noInterrupts();
+  drLckDlyTmr[dr] = dly;
+  drLckExp &= ~(1 << dr);
+  interrupts();
+  doorOut(doorPort[dr].lckOut, doorPort[dr].lckMask, UNLOCK);  // Check ISR for 60Hz unlock simulation.
+  fb.play(FBLED + dr, fbSteady);                  // Turn on green LED.
+  fb.play(FBBPR + dr, fbSteady);                  // Turn on beeper.
+  digitalWrite(gLedPin, ON);                      // Turn on GREEN control panel Status LED.
+  Serial.print(F(", "));
+  printMsg((const char *)pgm_read_ptr(&doorTable[dr].name));
+  Serial.print(F(" UNLOCKED..."));
+  drUnlockFlag |= pgm_read_byte(&doorTable[dr].perm);  // Show door lock status.
+  return true;
 }
 
 //#################################################################################################################
-// UNLOCK SHED DOOR METHOD
+// LOCK DOOR METHOD
 //#################################################################################################################
-bool unlockShedDr()
+void lockDr(uint8_t dr)
 {
-    shdDrLckDlyTmr = EEPROM.read(eAddrShdDrLckTmr);
-    digitalWrite(shedDrLckPin,UNLOCK);
-    digitalWrite(frtLedPin, ONINV);               // Turn on green LED.
-    digitalWrite(gLedPin, ON);                    // Turn on GREEN control panel Status LED.
-    Serial.print(F(", UNLOCKED SHED DOOR..."));
-    drUnlockFlag |= SHEDDRLOCK;                   // Show door lock status.
-    digitalWrite(shedLedPin, ONINV);              // Turn on green LED.
-    digitalWrite(shedBprPin, ONINV);              // Turn on beeper.
-    return true;
+  drLckDlyTmr[dr] = 0;                            // Stops the ISR 60Hz unlock toggling.
+  dcache.forget(pgm_read_byte(&doorTable[dr].keypad), EV_GRANTED);  // A card still held unlocks the door again.
+  doorOut(doorPort[dr].lckOut, doorPort[dr].lckMask, LOCK);
+  fb.stop(FBLED + dr);                            // Turn door access keypad LED to red.
+  fb.stop(FBBPR + dr);                            // Turn off door access keypad beeper.
+  printMsg((const char *)pgm_read_ptr(&doorTable[dr].name));
+  Serial.println(F(" LOCKED"));
+  drUnlockFlag &= ~pgm_read_byte(&doorTable[dr].perm);  // Turn off flag to show door is now locked.
+  if(!(drUnlockFlag & DOORPERMS)){digitalWrite(gLedPin, OFF);}  // Turn off GREEN status LED once all doors locked.
 }
 
 //#################################################################################################################
@@ -3773,6 +5248,7 @@ void printDigits(int digits)
 // Tests for DST and ajusts RTC if needed.
 void checkDst()
 {
+  EeScope scope(EEOP_DST);
   uint8_t dst;
   dst = EEPROM.read(eAddrDst);
   DateTime now = rtc.now();   
@@ -3781,43 +5257,30 @@ void checkDst()
   {       
     rtc.adjust(DateTime(now.year(), now.month(), now.day(), now.hour()+1, now.minute(), now.second()));
     dst = 1;
-    EEPROM.write(eAddrDst, dst);
+    eeMeter.write(eAddrDst, dst);
   }
 
   else if(now.dayOfTheWeek() == 0 && now.month() == 11 && now.day() >= 1 && now.day() <= 8 && now.hour() == 2 && now.minute() == 0 && now.second() == 0 && dst == 1)
   {
     rtc.adjust(DateTime(now.year(), now.month(), now.day(), now.hour()-1, now.minute(), now.second()));
     dst = 0;
-    EEPROM.write(eAddrDst, dst);     
+    eeMeter.write(eAddrDst, dst);     
   }
 }
 
 //#################################################################################################################
 // YES NO RESPONSE METHOD
 //#################################################################################################################
-//char ynReply()
-bool ynReply()
+// Runs "step" immediately if the reply was entered on the command line, otherwise asks for confirmation and leaves
+// "step" pending for 10 seconds. The step reads the reply with argyn().
+void ynReply(void (*step)())
 {
-  char yn;
-  Serial.print(F("PLEASE CONFIRM Y/N? "));
-  for(uint8_t i = 0; i < 10; i++)                               //get a new char if available     
-  { 
-    if( Serial.available() > 0 )
-    {
-      yn = Serial.read();
-      Serial.println(yn);
-      if(yn == 'Y' || yn == 'y'){return 1;}        
-      else if(yn == 'N' || yn == 'n'){return 0;}
-      else
-      {
-        Serial.println(F(" Input Error..."));
-        return 0;        
-      }
-    }
-    delay(1000);                                                // Wait 10 x 1 sec for serial input.
+  if(console.peek()){step();}
+  else
+  {
+    Serial.print(F("PLEASE CONFIRM Y/N? "));
+    console.await(step, 10);                      // Wait 10 sec for serial input.
   }
-  Serial.println(F("SERIAL INPUT TIMEOUT"));
-  return 0;
 }
 
 //#################################################################################################################
@@ -3825,9 +5288,13 @@ bool ynReply()
 //#################################################################################################################
 void clrDb()
 {
-  bool yn = ynReply();
   Serial.println(F("CLEAR DATABASE"));
-  if(yn)
+  ynReply(clrDbStep);
+}
+
+void clrDbStep()
+{
+  if(argyn() == 1)
   {
     Serial.print(F("CLEARING..."));
     db.initDb();                                    // clear database, but keep magic number.
@@ -3847,8 +5314,12 @@ void clrDb()
 void clrConfig()
 {
   Serial.println(F("CLEAR EEPROM CONFIGURATION"));
-  bool yn = ynReply();
-  if(yn)
+  ynReply(clrConfigStep);
+}
+
+void clrConfigStep()
+{
+  if(argyn() == 1)
   {
     Serial.print(F("ERASING CONFIGURATION IN EEPROM..."));
     eraseEeprom(0x0000, DBSTART,0xFF);
@@ -3864,16 +5335,30 @@ void clrConfig()
 void clrEeprom()
 {
   Serial.println(F("CLEAR EVERYTHING IN EEPROM"));
-  bool yn = ynReply();
-  if(yn)
+  ynReply(clrEepromStep);
+}
+
+void clrEepromStep()
+{
+  if(argyn() == 1)
   {
     Serial.print(F("ERASING EEPROM..."));
-    eraseEeprom(0x0000, EEPROMSIZE,0xFF);
+    eraseEeprom(0x0000, eAddrWear,0xFF);          // EEPROM wear counts are kept.
+    eraseEeprom(eAddrSch, EEPROMSIZE,0xFF);
+    memset(schTable, 0xFF, sizeof(schTable));     // Erased schedule profiles allow every hour.
     Serial.println(F("EEPROM ERASED"));
   }
   else{Serial.print(F("CANCELLED"));}
 }
 
+//#################################################################################################################
+// RESET CONTROLLER METHOD
+//#################################################################################################################
+void resetCtrl()
+{
+  resetFunc();
+}
+
 
 //#################################################################################################################
 // ERASE EEPROM METHOD
@@ -3884,8 +5369,7 @@ void eraseEeprom(uint16_t eepStart, uint16_t eepEnd, uint8_t fillVal)
   {
     if(i % 20 == 0){Serial.print(".");}        // One every 20 erases, show progress.
     if(i % 800 == 0){Serial.println();}
-    EEPROM.write(i, fillVal);
-    delay(10);
+    eeMeter.write(i, fillVal);
   } 
 }
 
@@ -3,8 +3,9 @@
 
 #include "Arduino.h"
 #include "RfidDb.h"
+#include "EepromMeter.h"
 
-// REV 1.1.10
+// REV 1.1.16
 
 // Magic number to verify RFID database in EEPROM
 #define RFID_DB_MAGIC 0x75
@@ -48,6 +49,12 @@
 // returns the EEPROM location of the Ith user permission in the database
 #define tmOffset(I) (firstTmOffset() + ((I) * sizeof(uint32_t)))
 
+// returns the EEPROM location of the first schedule profile in the database
+#define firstSchOffset() (tmOffset(_totalUsers))
+
+// returns the EEPROM location of the Ith schedule profile in the database
+#define schOffset(I) (firstSchOffset() + ((I) * sizeof(uint8_t)))
+
 // RfidDb Setup Method --------------------------------------------------------------------------------------------------
 RfidDb::RfidDb(uint8_t totalUsers, uint16_t eepromOffset){init(totalUsers, eepromOffset, 0, 0);}
 
@@ -70,14 +77,18 @@ uint8_t RfidDb::totalUsers() {return _totalUsers;}
 uint8_t RfidDb::maxNameLength() {return _maxNameLength;}
 
 // count Method ---------------------------------------------------------------------------------------------------------
-uint8_t RfidDb::count() {return EEPROM.read(countOffset());}
+uint8_t RfidDb::count()
+{
+  EeScope scope(EEOP_DBREAD);
+  return eeMeter.read(countOffset());
+}
 
 // dbSize Method --------------------------------------------------------------------------------------------------------
 uint32_t RfidDb::dbSize() 
 {
   uint32_t recordSize;
-    //                    id size            password size      Name size         Attribute size    Time Stamp
-    recordSize = sizeof(uint32_t) + sizeof(uint32_t) + maxNameLength() + sizeof(uint8_t) + sizeof(uint32_t);
+    //                    id size            password size      Name size         Attribute size    Time Stamp         Schedule
+    recordSize = sizeof(uint32_t) + sizeof(uint32_t) + maxNameLength() + sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint8_t);
   if(!_eepromSize)                       // EEPROM size not specified so use totalUsers to calculate database size.
   {
   
@@ -107,6 +118,7 @@ bool RfidDb::insertIdNam(uint32_t id, char* name)
   if ((pos != -1) && (pos < PWDFLAG))
 	{
     writeNam(pos, name);
+    logSet(pos);
     return true;
 	}
 	else{return false;}
@@ -121,6 +133,7 @@ bool RfidDb::insertPwdNam(uint32_t pwd, char* name)
 	{
 		pos &= PWDMASK;                           // Remove flag showing this is a password.
     writeNam(pos, name);
+    logSet(pos);
     return true;
 	}
 	else{return false;}
@@ -129,12 +142,14 @@ bool RfidDb::insertPwdNam(uint32_t pwd, char* name)
 // insertAtt Method ------------------------------------------------------------------------------------------------------
 bool RfidDb::insertAtt(uint32_t idPwd, uint8_t att)
 {
+  EeScope scope(EEOP_DBATT);
 		int16_t pos = posOf(idPwd);
 		if (pos != -1)
 		{
-			if (pos > PWDFLAG){pos &= PWDMASK;}     // If > 0x1000 then it's an password position.
+			if (pos >= PWDFLAG){pos &= PWDMASK;}    // If >= 0x1000 then it's an password position.
 			writeAtt(pos, att);
 			commitEeprom();
+			logSet(pos);
 			return true;
 		}
 		else return false;
@@ -143,12 +158,14 @@ bool RfidDb::insertAtt(uint32_t idPwd, uint8_t att)
 // insertTm Method -------------------------------------------------------------------------------------------------------
 bool RfidDb::insertTm(uint32_t idPwd, uint32_t tm)
 {
+  EeScope scope(EEOP_DBATT);
 		int16_t pos = posOf(idPwd);
 		if (pos != -1)
 		{
-			if (pos > PWDFLAG){pos &= PWDMASK;}     // If > 0x1000 then it's an password position.
+			if (pos >= PWDFLAG){pos &= PWDMASK;}    // If >= 0x1000 then it's an password position.
 			writeTm(pos, tm);
 			commitEeprom();
+			logSet(pos);
 			return true;
 		}
 		else return false;
@@ -157,6 +174,7 @@ bool RfidDb::insertTm(uint32_t idPwd, uint32_t tm)
 // insert Method ---------------------------------------------------------------------------------------------------------
 bool RfidDb::insert(uint32_t id, uint32_t pwd) 
 {
+  EeScope scope(EEOP_DBINSERT);
 // if id already exists in the database, we update the password
 	if (id)                                     // Write password to dsatabase using id to locate position.
 	{
@@ -164,7 +182,7 @@ bool RfidDb::insert(uint32_t id, uint32_t pwd)
 		if ((pos != -1) && (pos < PWDFLAG))       // If less than 0x10000 then it's an id position.
 		{
 //			Serial.println(F("PASSWORD ADDED TO ID IN DATABASE"));
-			if (pwd){writePwd(pos, pwd);}           // If password value given, add to database. 
+			if (pwd){writePwd(pos, pwd); logSet(pos);}  // If password value given, add to database. 
 			commitEeprom();
 			return true;
 		}
@@ -177,7 +195,7 @@ bool RfidDb::insert(uint32_t id, uint32_t pwd)
 		if ((pos != -1) && (pos >= PWDFLAG))      // If greater than 0x10000 then it's a password position.
 		{
 //			Serial.println(F("ID ADDED TO PASSWORD IN DATABASE"));
-			if (id){writeId((pos & PWDMASK), id);}
+			if (id){writeId((pos & PWDMASK), id); logSet(pos & PWDMASK);}
 			commitEeprom();
 			return true;
 		}
@@ -195,8 +213,10 @@ bool RfidDb::insert(uint32_t id, uint32_t pwd)
 //		Serial.println(F("NEW ENTRY ADDED"));
 		if (id){writeId(c, id);}
 		if (pwd){writePwd(c, pwd);}
-		EEPROM.write(countOffset(), c + 1);
+		writeSch(c, 0);                             // No schedule, column may hold data from older firmware.
+		eeMeter.write(countOffset(), c + 1);
 		commitEeprom();
+		logSet(c);
 		return true;
 	}
 }
@@ -213,7 +233,12 @@ bool RfidDb::removeIdNam(uint32_t id)
 	int16_t pos;
 	pos = posOf(id);
 	if(pos >= PWDFLAG || pos == -1){return false;}
-	else{return removeNam(pos);}
+	else
+	{
+		removeNam(pos);
+		logSet(pos);
+		return true;
+	}
 }
 
 // removePwdNam ---------------------------------------------------------------------------------------------------------
@@ -225,7 +250,9 @@ bool RfidDb::removePwdNam(uint32_t pwd)
 	else
 	{
 		pos &= PWDMASK;
-		return removeNam(pos);
+		removeNam(pos);
+		logSet(pos);
+		return true;
 	}
 }
 
@@ -233,6 +260,7 @@ bool RfidDb::removePwdNam(uint32_t pwd)
 bool RfidDb::remove(uint32_t id, uint32_t pwd)// Removes ID or password from the database.
 // if id already exists in the database, we update the password and, or name.
 {
+  EeScope scope(EEOP_DBREMOVE);
 	bool returnVal = false;
   uint8_t originalCount = count();  
   if (originalCount == 0){return;}
@@ -243,8 +271,9 @@ bool RfidDb::remove(uint32_t id, uint32_t pwd)// Removes ID or password from the
 		if ((posToRemove != -1))                  // If less than 0x10000 then it's an id position.
 		{
 			if(posToRemove >= PWDFLAG){return false;}	// Check if password value was given in error.
-			if (readPwd(posToRemove)){writeId(posToRemove,0);}		// Clear ID.
+			if (readPwd(posToRemove)){writeId(posToRemove,0); logSet(posToRemove);}		// Clear ID.
 			else{moveLast(originalCount,posToRemove);}// Password does not exist so move last user data to this location.
+			logDel(id, false);
 			returnVal = true;
 		}
 		else{return false;}
@@ -258,8 +287,9 @@ bool RfidDb::remove(uint32_t id, uint32_t pwd)// Removes ID or password from the
 			if(posToRemove < PWDFLAG){
 				return false;}                          // Check if id value was given in error.
 			posToRemove &= PWDMASK;
-			if (readId(posToRemove)){writePwd(posToRemove,0);}  // Is ID found in database, clear password.
+			if (readId(posToRemove)){writePwd(posToRemove,0); logSet(posToRemove);}  // Is ID found in database, clear password.
 			else{moveLast(originalCount,posToRemove);}// ID does not exist, so move last user data to this location.
+			logDel(pwd, true);
 			returnVal = true;
 		}
 		else{return false;}
@@ -271,26 +301,110 @@ bool RfidDb::remove(uint32_t id, uint32_t pwd)// Removes ID or password from the
 // modifyNam Method ----------------------------------------------------------------------------------------------------
 bool RfidDb::modifyNam(int16_t pos, char* name)
 {
-  if(pos > PWDFLAG){pos &= PWDMASK;}
+  if(pos >= PWDFLAG){pos &= PWDMASK;}
   if(pos >= count() || pos < 0) {return false;}
   writeNam(pos, name);
+  logSet(pos);
+  return true;
+}
+
+// modifyAtt Method ----------------------------------------------------------------------------------------------------
+bool RfidDb::modifyAtt(int16_t pos, uint8_t att)
+{
+  EeScope scope(EEOP_DBATT);
+  if(pos >= PWDFLAG){pos &= PWDMASK;}
+  if(pos >= count() || pos < 0) {return false;}
+  writeAtt(pos, att);
+  logSet(pos);
+  return true;
+}
+
+// modifySch Method ----------------------------------------------------------------------------------------------------
+bool RfidDb::modifySch(int16_t pos, uint8_t sch)
+{
+  EeScope scope(EEOP_DBATT);
+  if(pos >= PWDFLAG){pos &= PWDMASK;}
+  if(pos >= count() || pos < 0) {return false;}
+  writeSch(pos, sch);
+  logSet(pos);
+  return true;
+}
+
+// modifyTm Method -----------------------------------------------------------------------------------------------------
+bool RfidDb::modifyTm(int16_t pos, uint32_t tm)
+{
+  EeScope scope(EEOP_DBATT);
+  if(pos >= PWDFLAG){pos &= PWDMASK;}
+  if(pos >= count() || pos < 0) {return false;}
+  writeTm(pos, tm);
+  logSet(pos);
   return true;
 }
 
+// beginBatch Method ---------------------------------------------------------------------------------------------------
+void RfidDb::beginBatch() {_batch++;}
+
+// endBatch Method -----------------------------------------------------------------------------------------------------
+void RfidDb::endBatch()
+{
+  if(_batch == 0 || --_batch > 0){return;}
+  if(_batchWrites)
+  {
+    _batchWrites = false;
+    commitEeprom();
+  }
+}
+
+// revision Method -----------------------------------------------------------------------------------------------------
+uint16_t RfidDb::revision() {return _revision;}
+
+// journal Method ------------------------------------------------------------------------------------------------------
+void RfidDb::journal(DbJournal* jnl) {_journal = jnl;}
+
+// nameIndex Method ----------------------------------------------------------------------------------------------------
+// Only the first two letters of each name are read, the index holds no more.
+void RfidDb::nameIndex(NameIndex* idx)
+{
+  EeScope scope(EEOP_DBREAD);
+  char prefix[3] = {0, 0, 0};
+
+  _nameIdx = idx;
+  _nameIdx->clear();
+  if (_maxNameLength == 0){return;}
+  for (uint8_t pos = 0; pos < count(); pos++)
+  {
+    prefix[0] = eeMeter.read(nameOffset(pos));
+    prefix[1] = prefix[0] ? eeMeter.read(nameOffset(pos) + 1) : '\0';
+    _nameIdx->set(pos, prefix);
+  }
+}
+
 // modify Method -------------------------------------------------------------------------------------------------------
 bool RfidDb::modifyIdPwd(int16_t pos, uint32_t idPwd)       // Modifies ID or password from the database.
 // If no id or password is found, return false.
 {
+  EeScope scope(EEOP_DBMODIFY);
   if (pos < 0) {return false;}
-  if(pos >= 0 && pos < PWDFLAG){writeId(pos,idPwd);}        // Add new Id to database.
-  else{writePwd(pos & PWDMASK,idPwd);         // Add new password at same user location as old password.
+  uint32_t old;
+  if(pos >= 0 && pos < PWDFLAG)
+  {
+    old = readId(pos);
+    writeId(pos,idPwd);                         // Add new Id to database.
   }
+  else
+  {
+    old = readPwd(pos & PWDMASK);
+    writePwd(pos & PWDMASK,idPwd);              // Add new password at same user location as old password.
+  }
+  logSet(pos & PWDMASK);
+  if (old && old != idPwd){logDel(old, pos >= PWDFLAG);}  // Peers find the user by its new value.
   return true;
 }
 
 // readId --------------------------------------------------------------------------------------------------------------
 bool RfidDb::readId(int16_t pos, uint32_t &id)
 {
+  EeScope scope(EEOP_DBREAD);
   if (pos >= count() || pos < 0) {return false;}
 	id = readId(pos);
 	return true;
@@ -299,6 +413,7 @@ bool RfidDb::readId(int16_t pos, uint32_t &id)
 // readPwd Method -----------------------------------------------------------------------------------------------------
 bool RfidDb::readPwd(int16_t pos, uint32_t &pwd)
 {
+  EeScope scope(EEOP_DBREAD);
   if (pos >= count() || pos < 0) {return false;}
   pwd = readPwd(pos);
   return true;
@@ -307,6 +422,7 @@ bool RfidDb::readPwd(int16_t pos, uint32_t &pwd)
 // readAtt Method -----------------------------------------------------------------------------------------------------
 bool RfidDb::readAtt(int16_t pos, uint8_t &att)
 {
+  EeScope scope(EEOP_DBREAD);
   if (pos >= count() || pos < 0) {return false;}
   att = readAtt(pos);
   return true;
@@ -315,20 +431,31 @@ bool RfidDb::readAtt(int16_t pos, uint8_t &att)
 // readTm Method ------------------------------------------------------------------------------------------------------
 bool RfidDb::readTm(int16_t pos, uint32_t &tm)
 {
+  EeScope scope(EEOP_DBREAD);
   if (pos >= count() || pos < 0) {return false;}
   tm = readTm(pos);
   return true;
 }
 
+// readSch Method -----------------------------------------------------------------------------------------------------
+bool RfidDb::readSch(int16_t pos, uint8_t &sch)
+{
+  EeScope scope(EEOP_DBREAD);
+  if (pos >= count() || pos < 0) {return false;}
+  sch = readSch(pos);
+  return true;
+}
+
 // readNam ------------------------------------------------------------------------------------------------------------
 bool RfidDb::readNam(int16_t pos, char* name)
 {
+  EeScope scope(EEOP_DBREAD);
   if (pos >= count() || pos < 0 || _maxNameLength == 0){return false;}
 
   uint16_t base = nameOffset(pos);
   for (int i = 0; i < _maxNameLength; i++)
 	{
-    name[i] = EEPROM.read(base + i);
+    name[i] = eeMeter.read(base + i);
     if (name[i] == '\0') {break;}
   }
   return true;
@@ -357,6 +484,7 @@ bool RfidDb::contains24(uint32_t id) {return posOf24(id) != -1;}
 // bit masked with the given mask.
 int16_t RfidDb::posOf(uint32_t idPwd, uint32_t mask)
 {
+  EeScope scope(EEOP_DBLOOKUP);
   uint32_t maskedId = idPwd & mask;
   uint32_t maskedPwd = idPwd;
   for (uint8_t i = 0, n = count(); i < n; i++)
@@ -373,7 +501,7 @@ uint32_t RfidDb::readId(int16_t pos)
 {
   if(pos < 0){return false;}
   uint32_t id;
-  EEPROM.get(idOffset(pos), id);
+  eeMeter.get(idOffset(pos), id);
   return id;
 }
 
@@ -383,7 +511,7 @@ uint32_t RfidDb::readPwd(int16_t pos)
 {
   if(pos < 0){return false;}
   uint32_t pwd;
-  EEPROM.get(pwdOffset(pos), pwd);
+  eeMeter.get(pwdOffset(pos), pwd);
   return pwd;
 }
 
@@ -393,7 +521,7 @@ uint8_t RfidDb::readAtt(int16_t pos)
 {
   if(pos < 0){return false;}
   uint8_t att;
-  att = EEPROM.read(attOffset(pos));
+  att = eeMeter.read(attOffset(pos));
   return att;
 }
 
@@ -403,16 +531,24 @@ uint32_t RfidDb::readTm(int16_t pos)
 {
   if(pos < 0){return false;}
   uint32_t tm;
-  EEPROM.get(tmOffset(pos), tm);
+  eeMeter.get(tmOffset(pos), tm);
   return tm;
 }
 
+// readSch (PRIVATE)-------------------------------------------------------------------------------------------------
+// Returns the schedule profile byte at the given position
+uint8_t RfidDb::readSch(int16_t pos)
+{
+  if(pos < 0){return false;}
+  return eeMeter.read(schOffset(pos));
+}
+
 // writeId Method (PRIVATE)------------------------------------------------------------------------------------------
 // Writes an id to the database at a given position
 inline void RfidDb::writeId(int16_t pos, uint32_t id)
 {
   if(pos < 0){return false;}
-  EEPROM.put(idOffset(pos), id);
+  eeMeter.put(idOffset(pos), id);
   commitEeprom();
 }
 
@@ -421,7 +557,7 @@ inline void RfidDb::writeId(int16_t pos, uint32_t id)
 inline void RfidDb::writePwd(int16_t pos, uint32_t pwd)
 {
   if(pos < 0){return false;}
-  EEPROM.put(pwdOffset(pos), pwd);
+  eeMeter.put(pwdOffset(pos), pwd);
   commitEeprom();
 }
 
@@ -430,7 +566,7 @@ inline void RfidDb::writePwd(int16_t pos, uint32_t pwd)
 inline void RfidDb::writeAtt(int16_t pos, uint8_t att)
 {
   if(pos < 0){return false;}
-  EEPROM.write(attOffset(pos), att);
+  eeMeter.write(attOffset(pos), att);
   commitEeprom();
 }
 
@@ -439,7 +575,16 @@ inline void RfidDb::writeAtt(int16_t pos, uint8_t att)
 inline void RfidDb::writeTm(int16_t pos, uint32_t tm) 
 {
   if(pos < 0){return false;}
-  EEPROM.put(tmOffset(pos), tm);
+  eeMeter.put(tmOffset(pos), tm);
+  commitEeprom();
+}
+
+// writeSch Method (PRIVATE)-----------------------------------------------------------------------------------------
+// Writes a schedule profile to the database at a given position
+inline void RfidDb::writeSch(int16_t pos, uint8_t sch)
+{
+  if(pos < 0){return false;}
+  eeMeter.write(schOffset(pos), sch);
   commitEeprom();
 }
 
@@ -447,6 +592,7 @@ inline void RfidDb::writeTm(int16_t pos, uint32_t tm)
 // Writes a name to the database at a given position
 void RfidDb::writeNam(int16_t pos, const char* name)
 {
+  EeScope scope(EEOP_DBNAME);
   if(pos < 0){return false;}
   if (strlen(name) > 0)                         // Do not store name if parameter was not set up.
 	{
@@ -454,10 +600,11 @@ void RfidDb::writeNam(int16_t pos, const char* name)
 	  uint16_t nameSize = strlen(name);
     for (uint16_t i = 0; i < nameSize; i++)
 		{
-			EEPROM.write(base + i, *name);
+			eeMeter.write(base + i, *name);
 			name++;
 		}
-    EEPROM.write(base + nameSize, '\0');        // Ensure we null terminate
+    eeMeter.write(base + nameSize, '\0');       // Ensure we null terminate
+    if (_nameIdx){_nameIdx->set(pos, name - nameSize);}
 	}
   commitEeprom();
 }
@@ -466,11 +613,13 @@ void RfidDb::writeNam(int16_t pos, const char* name)
 // Clears a name from a given position.
 bool RfidDb::removeNam(int16_t pos)
 {
+  EeScope scope(EEOP_DBNAME);
   if (_maxNameLength > 0)
 	{
     if(pos < 0){return false;}
 		uint16_t base = nameOffset(pos);
-		for (int i = 0; i < _maxNameLength; i++){EEPROM.write(base + i,'\0');}	// Includes terminating character.
+		for (int i = 0; i < _maxNameLength; i++){eeMeter.write(base + i,'\0');}	// Includes terminating character.
+    if (_nameIdx){_nameIdx->remove(pos);}
 		commitEeprom();
 		return true;
   }
@@ -486,10 +635,11 @@ void RfidDb::copyNam(uint8_t srcPos, uint8_t destPos)
     uint16_t destBase = nameOffset(destPos);
     for (int i = 0; i < _maxNameLength; i++)
 		{
-      char c = EEPROM.read(srcbase + i);
-      EEPROM.write(destBase + i, c);
+      char c = eeMeter.read(srcbase + i);
+      eeMeter.write(destBase + i, c);
       if (c == '\0') {break;}
     }
+    if (_nameIdx){_nameIdx->move(srcPos, destPos);}
     commitEeprom();
   }
 }
@@ -497,8 +647,11 @@ void RfidDb::copyNam(uint8_t srcPos, uint8_t destPos)
 // Moves last entry in database to location of removed entry to reduce keep entries in sequence.
 bool RfidDb::moveLast(uint8_t orgCount, int16_t pToRemove)
 {
+  EeScope scope(EEOP_DBMOVE);
 	uint8_t newCount = orgCount - 1;              // Remove last entry from database.
 	uint8_t attToMove = readAtt(newCount);
+	uint32_t tmToMove = readTm(newCount);
+	uint8_t schToMove = readSch(newCount);
 	uint32_t pwdToMove = readPwd(newCount);
 
 	if (newCount > 0 || newCount == pToRemove)
@@ -507,15 +660,18 @@ bool RfidDb::moveLast(uint8_t orgCount, int16_t pToRemove)
 		writeId(pToRemove, idToMove);               // Move id from last location in database to location to be removed.
 		writePwd(pToRemove, pwdToMove);             // Move password from last location in database to location to be removed.
 		writeAtt(pToRemove, attToMove);             // Move attribute from last location in database to location to be removed.
+		writeTm(pToRemove, tmToMove);               // Move time stamp from last location in database to location to be removed.
+		writeSch(pToRemove, schToMove);             // Move schedule from last location in database to location to be removed.
 		copyNam(newCount, pToRemove);              // Move name from last location in database to location to be removed.
 
 		writeId(newCount, 0);                       // Clear old id location.
 		writePwd(newCount, 0);                      // Clear old password location.
 		writeAtt(newCount, 0);                      // Clear old attribute location.
 		writeTm(newCount, 0);                       // Clear old timestamp location.
+		writeSch(newCount, 0);                      // Clear old schedule location.
 		removeNam(newCount);
 
-		EEPROM.write(countOffset(), newCount);      // Update number of user entries.
+		eeMeter.write(countOffset(), newCount);     // Update number of user entries.
 		return 1;
 	}
 	else{return 0;}
@@ -524,7 +680,24 @@ bool RfidDb::moveLast(uint8_t orgCount, int16_t pToRemove)
 // hasMagic Method (PRIVATE)-----------------------------------------------------------------------------------------
 // Returns whether the EEPROM location at the EEPROM base address
 // contains the magic number
-bool RfidDb::hasMagic() {return EEPROM.read(_eepromOffset) == RFID_DB_MAGIC;}
+bool RfidDb::hasMagic() {return eeMeter.read(_eepromOffset) == RFID_DB_MAGIC;}
+
+// logSet Method (PRIVATE)-------------------------------------------------------------------------------------------
+// Journals a change of the user at "pos", named by its id or, without an id, by its password.
+void RfidDb::logSet(int16_t pos)
+{
+  if (_journal == NULL){return;}
+  uint32_t id = readId(pos);
+  if (id){_journal->add(JNL_SET, id);}
+  else{_journal->add(JNL_SET | JNL_PWD, readPwd(pos));}
+}
+
+// logDel Method (PRIVATE)-------------------------------------------------------------------------------------------
+// Journals that no user holds "key" any more.
+void RfidDb::logDel(uint32_t key, bool pwd)
+{
+  if (_journal){_journal->add(pwd ? JNL_DEL | JNL_PWD : JNL_DEL, key);}
+}
 
 // init Mehtod (PRIVATE)---------------------------------------------------------------------------------------------
 void RfidDb::init(uint8_t totalUsers, uint16_t eepromOffset, uint8_t maxNameLength, uint16_t eepromSize)
@@ -533,6 +706,11 @@ void RfidDb::init(uint8_t totalUsers, uint16_t eepromOffset, uint8_t maxNameLeng
   _eepromOffset = eepromOffset;
   _maxNameLength = maxNameLength;
   _eepromSize = eepromSize;
+  _revision = 0;
+  _batch = 0;
+  _batchWrites = false;
+  _nameIdx = NULL;
+  _journal = NULL;
 }
 
 //initDb Method (PRIVATE)--------------------------------------------------------------------------------------------
@@ -540,10 +718,13 @@ void RfidDb::init(uint8_t totalUsers, uint16_t eepromOffset, uint8_t maxNameLeng
 // EEPROM address, followed by a zero count.
 void RfidDb::initDb()
 {
+  EeScope scope(EEOP_DBINIT);
   Serial.print(F("INITIALIZING DATABASE..."));
-	for (uint16_t i = firstIdOffset(); i < (dbSize() -2);i++){EEPROM.write(i,0);}
-	EEPROM.write(_eepromOffset, RFID_DB_MAGIC);   // Magic Number
-  EEPROM.write(countOffset(), 0);               // Initialize Count.
+	for (uint16_t i = firstIdOffset(); i < _eepromOffset + dbSize();i++){eeMeter.write(i,0);}	// dbSize() is counted from _eepromOffset.
+	eeMeter.write(_eepromOffset, RFID_DB_MAGIC);  // Magic Number
+  eeMeter.write(countOffset(), 0);              // Initialize Count.
+  if (_nameIdx){_nameIdx->clear();}
+  if (_journal){_journal->add(JNL_CLR, 0);}
   Serial.println(F("COMPLETED"));
   commitEeprom();
 }
@@ -551,6 +732,9 @@ void RfidDb::initDb()
 // commit Method (PRIVATE)-------------------------------------------------------------------------------------------
 void RfidDb::commitEeprom()
 {
+  if(_batch){_batchWrites = true; return;}     // Committed by endBatch.
+  _revision++;                                  // Every write ends with a commit.
+  eeMeter.commit();
 #if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_ESP32)
   EEPROM.commit();
 #endif
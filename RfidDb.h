@@ -3,7 +3,28 @@
 
 #include "Arduino.h"
 #include "EEPROM.h"
+#include "NameIndex.h"
+#include "DbJournal.h"
 
+// Rev 1.1.16 - Added modifyTm to change the time stamp using the user position.
+//            - Added beginBatch and endBatch. The writes made between them end with a single commit (and a single
+//              revision change), so a change applied to many users is committed once.
+// Rev 1.1.15 - Optional change journal (DbJournal). Every change made through the public methods is added with
+//              the tag ID or password of the user, for the replication of the database to other controllers.
+// Rev 1.1.14 - Optional name index (NameIndex) kept in RAM. nameIndex() builds it from the names in EEPROM and
+//              every name written, removed or moved updates it, so a user can be searched by name.
+// Rev 1.1.13 - EEPROM is accessed through EepromMeter. Writes of a value already stored are skipped and the
+//              accesses of each operation (lookup, insert, remove, move, name, attribute, ...) are counted.
+// Rev 1.1.12 - Added schedule profile column (one byte per user, 0 = no schedule) with readSch and modifySch.
+//              The column follows the time stamps so databases written by earlier revisions stay valid.
+//            - Time stamp and schedule now move with the last user when a user is removed.
+//            - Password positions of user 0 (0x1000) were not unmasked by insertAtt, insertTm and the modify
+//              methods.
+//            - initDb cleared the records up to dbSize() - 2 instead of _eepromOffset + dbSize(), leaving the last
+//              bytes (the schedule column) uncleared, and every record of a database starting above dbSize().
+// Rev 1.1.11 - Added modifyAtt method to change the attribute using the user position.
+//            - Added revision method. The revision changes at each commit (once per batch) so a copy
+//              kept in RAM can tell when it must be rebuilt.
 // Rev 1.1.10 - Added eepromSize parameter to rfIdDb method.
 //            - Changed "maxSize" variable to "totalUsers"
 // Rev 1.1.9	- Corrected writename method to write character array length + null instead of maxNameLength.
@@ -164,6 +185,33 @@ class RfidDb {
     // is not found.
     bool modifyNam(int16_t pos, char* name);
 
+    // Changes the attribute (permission) of the user at the given position. Returns false if
+    // the position is >= count.
+    bool modifyAtt(int16_t pos, uint8_t att);
+
+    // Changes the schedule profile of the user at the given position. Returns false if
+    // the position is >= count.
+    bool modifySch(int16_t pos, uint8_t sch);
+
+    // Changes the time stamp of the user at the given position. Returns false if
+    // the position is >= count.
+    bool modifyTm(int16_t pos, uint32_t tm);
+
+    // Writes made after beginBatch are committed once, by endBatch. Calls may be nested,
+    // the commit is made by the last endBatch.
+    void beginBatch();
+    void endBatch();
+
+    // Returns a number that changes at each commit (once per batch, see beginBatch).
+    uint16_t revision();
+
+    // Attaches a name index, built from the names in the database and kept up to date by every
+    // name change. The index must hold totalUsers entries.
+    void nameIndex(NameIndex* idx);
+
+    // Attaches a change journal. Changes made through the public methods are added to it.
+    void journal(DbJournal* jnl);
+
 		// Returns the identfier at the given position. Callers should check
     // the return value before using the identifier. Returns true if
     // the position is less than the count and writes the identifier value
@@ -192,6 +240,13 @@ class RfidDb {
     // Returns false if pos >= count
     bool readTm(int16_t pos, uint32_t &tm);
 
+    // Returns the schedule profile at the given position. Callers should check
+    // the return value before using the profile. Returns true if
+    // the position is less than the count and writes the profile value
+    // at the given address.
+    // Returns false if pos >= count
+    bool readSch(int16_t pos, uint8_t &sch);
+
     // Returns the name at the given position. Callers should check
     // the return value before using the name. Returns true if
     // the position is less than the count and writes the identifier value
@@ -226,6 +281,11 @@ class RfidDb {
     uint16_t  _eepromSize;
     uint8_t 	_totalUsers;
     uint8_t 	_maxNameLength;
+    uint16_t  _revision;
+    uint8_t   _batch;                                 // Nested beginBatch calls.
+    bool      _batchWrites;                           // Commit left for endBatch.
+    NameIndex* _nameIdx;
+    DbJournal* _journal;
 
     bool      insert(uint32_t id, uint32_t pwd);
     bool      remove(uint32_t id, uint32_t pwd);
@@ -235,15 +295,19 @@ class RfidDb {
     uint32_t  readPwd(int16_t pos);
     uint8_t   readAtt(int16_t pos);
     uint32_t  readTm(int16_t pos);
+    uint8_t   readSch(int16_t pos);
     void      writeId(int16_t pos, uint32_t id);
     void      writePwd(int16_t pos, uint32_t pwd);
     void      writeAtt(int16_t pos, uint8_t att);
     void      writeTm(int16_t pos, uint32_t tm);
+    void      writeSch(int16_t pos, uint8_t sch);
     void      writeNam(int16_t pos, const char* name);
 		bool      removeNam(int16_t pos);
     void      copyNam(uint8_t srcPos, uint8_t destPos);
 		bool      moveLast(uint8_t orgCount, int16_t pToRemove);
 		bool      hasMagic();
+    void      logSet(int16_t pos);
+    void      logDel(uint32_t key, bool pwd);
     void      commitEeprom();
     void      init(uint8_t totalUsers, uint16_t eepromOffset, uint8_t maxNameSize, uint16_t eepromSize);
 };
@@ -0,0 +1,656 @@
+// RfidDbCompact.cpp Rev 1.3
+
+#include "RfidDbCompact.h"
+#include "EepromMeter.h"
+
+#define HAS_ID						0x01					// Presence byte of a record.
+#define HAS_ID32					0x02					// Tag ID takes 4 bytes (3 otherwise).
+#define HAS_PWD						0x04
+#define HAS_PWD32					0x08					// Password takes 4 bytes (3 otherwise).
+#define HAS_TM						0x10
+#define HAS_SCH						0x20
+#define HAS_NAM						0x40
+
+#define BLK_LEN						0							// Block byte offsets.
+#define BLK_POS						1
+#define BLK_HAS						2
+#define BLK_ATT						3
+#define BLK_DATA					4
+#define BLK_FREE					0xFF					// BLK_POS of a free block.
+#define BLK_MIN						2							// Smallest free block (length and position).
+#define BLK_MAX						(BLK_DATA + 4 + 4 + 4 + 1 + RFIDDBC_MAXNAME)
+
+#define PWDMASK						0xFFF
+
+// Reads an "n" byte little endian value (same byte order as EEPROM.get on the AVR).
+static uint32_t readVal(uint16_t addr, uint8_t n)
+{
+	uint32_t val = 0;
+	for(uint8_t i = 0; i < n; i++){val |= (uint32_t)eeMeter.read(addr + i) << (8 * i);}
+	return val;
+}
+
+// Address of the field "bit" of the block at "addr" holding the fields in "has".
+static uint16_t fieldAt(uint16_t addr, uint8_t has, uint8_t bit)
+{
+	addr += BLK_DATA;
+	if(bit == HAS_ID){return addr;}
+	if(has & HAS_ID){addr += has & HAS_ID32 ? 4 : 3;}
+	if(bit == HAS_PWD){return addr;}
+	if(has & HAS_PWD){addr += has & HAS_PWD32 ? 4 : 3;}
+	if(bit == HAS_TM){return addr;}
+	if(has & HAS_TM){addr += 4;}
+	if(bit == HAS_SCH){return addr;}
+	if(has & HAS_SCH){addr += 1;}
+	return addr;
+}
+
+RfidDbCompact::RfidDbCompact(uint16_t *index, uint8_t totalUsers, uint16_t eepromOffset, uint16_t eepromEnd,
+	uint8_t maxNameSize)
+{
+	_index = index;
+	_totalUsers = totalUsers;
+	_maxNameLength = maxNameSize < RFIDDBC_MAXNAME ? maxNameSize : RFIDDBC_MAXNAME;
+	_start = eepromOffset + 2;												// Magic number and count.
+	_end = eepromEnd;
+	_top = _start;
+	_count = 0;
+	_revision = 0;
+	_batch = 0;
+	_batchWrites = false;
+	_nameIdx = NULL;
+	_journal = NULL;
+}
+
+void RfidDbCompact::begin()
+{
+	EeScope scope(EEOP_DBREAD);
+	uint16_t addr;
+
+	if(eeMeter.read(_start - 2) != RFIDDBC_MAGIC){initDb();}
+	_count = eeMeter.read(_start - 1);
+	if(_count > _totalUsers){_count = _totalUsers;}
+	for(addr = _start; addr < _end;)
+	{
+		uint8_t len = eeMeter.read(addr + BLK_LEN);
+		if(len < BLK_MIN || addr + len > _end){break;}					// End of the heap.
+		uint8_t pos = eeMeter.read(addr + BLK_POS);
+		if(pos < _count){_index[pos] = addr;}
+		addr += len;
+	}
+	_top = addr;
+	_revision++;
+}
+
+void RfidDbCompact::initDb()
+{
+	EeScope scope(EEOP_DBINIT);
+	Serial.print(F("INITIALIZING DATABASE..."));
+	eeMeter.write(_start - 2, RFIDDBC_MAGIC);
+	eeMeter.write(_start - 1, 0);
+	_count = 0;
+	setEnd(_start);
+	if(_nameIdx){_nameIdx->clear();}
+	if(_journal){_journal->add(JNL_CLR, 0);}
+	Serial.println(F("COMPLETED"));
+	commitEeprom();
+}
+
+uint8_t RfidDbCompact::totalUsers(){return _totalUsers;}
+uint32_t RfidDbCompact::dbSize(){return _end - (_start - 2);}
+uint8_t RfidDbCompact::maxNameLength(){return _maxNameLength;}
+uint8_t RfidDbCompact::count(){return _count;}
+uint16_t RfidDbCompact::revision(){return _revision;}
+
+void RfidDbCompact::nameIndex(NameIndex *idx)
+{
+	char name[RFIDDBC_MAXNAME];
+
+	_nameIdx = idx;
+	_nameIdx->clear();
+	for(uint8_t pos = 0; pos < _count; pos++)
+	{
+		if(readNam(pos, name)){_nameIdx->set(pos, name);}
+	}
+}
+
+uint16_t RfidDbCompact::freeBytes()
+{
+	EeScope scope(EEOP_DBREAD);
+	uint16_t bytes = _end - _top;
+
+	for(uint16_t addr = _start; addr < _top; addr += eeMeter.read(addr + BLK_LEN))
+	{
+		if(eeMeter.read(addr + BLK_POS) == BLK_FREE){bytes += eeMeter.read(addr + BLK_LEN);}
+	}
+	return bytes;
+}
+
+bool RfidDbCompact::insertId(uint32_t id){return insert(id, 0);}
+bool RfidDbCompact::insertId(uint32_t id, uint32_t pwd){return insert(id, pwd);}
+bool RfidDbCompact::insertPwd(uint32_t pwd){return insert(0, pwd);}
+bool RfidDbCompact::insertPwd(uint32_t id, uint32_t pwd){return insert(id, pwd);}
+
+// An empty name leaves the name unchanged, as in RfidDb.
+bool RfidDbCompact::insertIdNam(uint32_t id, char *name)
+{
+	int16_t pos = posOf(id);
+	if(pos == -1 || pos >= RFIDDBC_PWDFLAG){return false;}
+	return !name[0] || setNam(pos, name);
+}
+
+bool RfidDbCompact::insertPwdNam(uint32_t pwd, char *name)
+{
+	int16_t pos = posOf(pwd);
+	if(pos < RFIDDBC_PWDFLAG){return false;}
+	return !name[0] || setNam(pos & PWDMASK, name);
+}
+
+bool RfidDbCompact::insertAtt(uint32_t idPwd, uint8_t att)
+{
+	EeScope scope(EEOP_DBATT);
+	int16_t pos = posOf(idPwd);
+	if(pos == -1){return false;}
+	return modifyAtt(pos, att);
+}
+
+bool RfidDbCompact::insertTm(uint32_t idPwd, uint32_t tm)
+{
+	EeScope scope(EEOP_DBATT);
+	Rec			r;
+	int16_t	pos = posOf(idPwd);
+
+	if(pos == -1 || !load(pos & PWDMASK, r)){return false;}
+	r.tm = tm;
+	if(!store(pos & PWDMASK, r)){return false;}
+	logSet(pos & PWDMASK);
+	return true;
+}
+
+bool RfidDbCompact::removeId(uint32_t id){return remove(id, 0);}
+bool RfidDbCompact::removePwd(uint32_t pwd){return remove(0, pwd);}
+
+bool RfidDbCompact::removeIdNam(uint32_t id)
+{
+	int16_t pos = posOf(id);
+	if(pos == -1 || pos >= RFIDDBC_PWDFLAG){return false;}
+	return setNam(pos, "");
+}
+
+bool RfidDbCompact::removePwdNam(uint32_t pwd)
+{
+	int16_t pos = posOf(pwd);
+	if(pos < RFIDDBC_PWDFLAG){return false;}
+	return setNam(pos & PWDMASK, "");
+}
+
+bool RfidDbCompact::modifyIdPwd(int16_t pos, uint32_t idPwd)
+{
+	EeScope scope(EEOP_DBMODIFY);
+	Rec r;
+
+	if(pos < 0 || !load(pos & PWDMASK, r)){return false;}
+	uint32_t old = pos < RFIDDBC_PWDFLAG ? r.id : r.pwd;
+	if(pos < RFIDDBC_PWDFLAG){r.id = idPwd;}
+	else{r.pwd = idPwd;}
+	if(!store(pos & PWDMASK, r)){return false;}
+	logSet(pos & PWDMASK);
+	if(old && old != idPwd){logDel(old, pos >= RFIDDBC_PWDFLAG);}		// Peers find the user by its new value.
+	return true;
+}
+
+// An empty name leaves the name unchanged, as in RfidDb.
+bool RfidDbCompact::modifyNam(int16_t pos, char *name)
+{
+	pos = userPos(pos);
+	if(pos < 0){return false;}
+	return !name[0] || setNam(pos, name);
+}
+
+bool RfidDbCompact::modifyAtt(int16_t pos, uint8_t att)
+{
+	EeScope scope(EEOP_DBATT);
+	pos = userPos(pos);
+	if(pos < 0){return false;}
+	eeMeter.write(_index[pos] + BLK_ATT, att);								// Fixed place in the block, no move.
+	commitEeprom();
+	logSet(pos);
+	return true;
+}
+
+bool RfidDbCompact::modifySch(int16_t pos, uint8_t sch)
+{
+	EeScope scope(EEOP_DBATT);
+	Rec r;
+
+	pos = userPos(pos);
+	if(pos < 0 || !load(pos, r)){return false;}
+	r.sch = sch;
+	if(!store(pos, r)){return false;}
+	logSet(pos);
+	return true;
+}
+
+bool RfidDbCompact::modifyTm(int16_t pos, uint32_t tm)
+{
+	EeScope scope(EEOP_DBATT);
+	Rec r;
+
+	pos = userPos(pos);
+	if(pos < 0 || !load(pos, r)){return false;}
+	r.tm = tm;
+	if(!store(pos, r)){return false;}
+	logSet(pos);
+	return true;
+}
+
+void RfidDbCompact::endBatch()
+{
+	if(_batch == 0 || --_batch > 0){return;}
+	if(_batchWrites)
+	{
+		_batchWrites = false;
+		commitEeprom();
+	}
+}
+
+bool RfidDbCompact::readId(int16_t pos, uint32_t &id)
+{
+	EeScope scope(EEOP_DBREAD);
+	if((uint16_t)pos >= _count){return false;}
+	uint16_t	addr = _index[pos];
+	uint8_t		has = eeMeter.read(addr + BLK_HAS);
+	id = has & HAS_ID ? readVal(fieldAt(addr, has, HAS_ID), has & HAS_ID32 ? 4 : 3) : 0;
+	return true;
+}
+
+bool RfidDbCompact::readPwd(int16_t pos, uint32_t &pwd)
+{
+	EeScope scope(EEOP_DBREAD);
+	if((uint16_t)pos >= _count){return false;}
+	uint16_t	addr = _index[pos];
+	uint8_t		has = eeMeter.read(addr + BLK_HAS);
+	pwd = has & HAS_PWD ? readVal(fieldAt(addr, has, HAS_PWD), has & HAS_PWD32 ? 4 : 3) : 0;
+	return true;
+}
+
+bool RfidDbCompact::readAtt(int16_t pos, uint8_t &att)
+{
+	EeScope scope(EEOP_DBREAD);
+	if((uint16_t)pos >= _count){return false;}
+	att = eeMeter.read(_index[pos] + BLK_ATT);
+	return true;
+}
+
+bool RfidDbCompact::readTm(int16_t pos, uint32_t &tm)
+{
+	EeScope scope(EEOP_DBREAD);
+	if((uint16_t)pos >= _count){return false;}
+	uint16_t	addr = _index[pos];
+	uint8_t		has = eeMeter.read(addr + BLK_HAS);
+	tm = has & HAS_TM ? readVal(fieldAt(addr, has, HAS_TM), 4) : 0;
+	return true;
+}
+
+bool RfidDbCompact::readSch(int16_t pos, uint8_t &sch)
+{
+	EeScope scope(EEOP_DBREAD);
+	if((uint16_t)pos >= _count){return false;}
+	uint16_t	addr = _index[pos];
+	uint8_t		has = eeMeter.read(addr + BLK_HAS);
+	sch = has & HAS_SCH ? eeMeter.read(fieldAt(addr, has, HAS_SCH)) : 0;
+	return true;
+}
+
+bool RfidDbCompact::readNam(int16_t pos, char *name)
+{
+	EeScope scope(EEOP_DBREAD);
+	if((uint16_t)pos >= _count || _maxNameLength == 0){return false;}
+	uint16_t	addr = _index[pos];
+	uint8_t		has = eeMeter.read(addr + BLK_HAS);
+	uint16_t	end = addr + eeMeter.read(addr + BLK_LEN);
+	uint8_t		i = 0;
+
+	if(has & HAS_NAM)
+	{
+		for(uint16_t p = fieldAt(addr, has, HAS_NAM); p < end && i < _maxNameLength - 1; p++, i++)
+		{
+			name[i] = eeMeter.read(p);
+			if(name[i] == '\0'){break;}														// Padding.
+		}
+	}
+	name[i] = '\0';
+	return true;
+}
+
+bool RfidDbCompact::contains(uint32_t id){return posOf(id, 0xFFFFFFFF) != -1;}
+bool RfidDbCompact::contains24(uint32_t id){return posOf(id, 0x00FFFFFF) != -1;}
+int16_t RfidDbCompact::posOf(uint32_t idPwd){return posOf(idPwd, 0xFFFFFFFF);}
+int16_t RfidDbCompact::posOf24(uint32_t idPwd){return posOf(idPwd, 0x00FFFFFF);}
+
+// insert Method (PRIVATE)----------------------------------------------------------------------------------------
+// Same rules as RfidDb: an existing id gets the password, an existing password gets the id, otherwise a new user
+// is added.
+bool RfidDbCompact::insert(uint32_t id, uint32_t pwd)
+{
+	EeScope scope(EEOP_DBINSERT);
+	Rec			r;
+	int16_t	pos;
+
+	if(id && (pos = posOf(id)) != -1 && pos < RFIDDBC_PWDFLAG)
+	{
+		if(!pwd){return true;}
+		load(pos, r);
+		r.pwd = pwd;
+		if(!store(pos, r)){return false;}
+		logSet(pos);
+		return true;
+	}
+	if(pwd && (pos = posOf(pwd)) >= RFIDDBC_PWDFLAG)
+	{
+		if(!id){return true;}
+		load(pos & PWDMASK, r);
+		r.id = id;
+		if(!store(pos & PWDMASK, r)){return false;}
+		logSet(pos & PWDMASK);
+		return true;
+	}
+	if(_count >= _totalUsers || (!id && !pwd)){return false;}
+
+	memset(&r, 0, sizeof(r));
+	r.id = id;
+	r.pwd = pwd;
+	_index[_count] = 0;															// New block.
+	if(!store(_count, r)){return false;}
+	eeMeter.write(_start - 1, ++_count);
+	commitEeprom();
+	logSet(_count - 1);
+	return true;
+}
+
+// remove Method (PRIVATE)----------------------------------------------------------------------------------------
+// Same rules as RfidDb: the id (password) is cleared, the user is removed when it has no password (id) left.
+bool RfidDbCompact::remove(uint32_t id, uint32_t pwd)
+{
+	EeScope scope(EEOP_DBREMOVE);
+	Rec			r;
+	int16_t	pos;
+
+	if(_count == 0){return false;}
+	if(id)
+	{
+		pos = posOf(id);
+		if(pos == -1 || pos >= RFIDDBC_PWDFLAG){return false;}
+		load(pos, r);
+		if(r.pwd){r.id = 0; store(pos, r); logSet(pos);}
+		else{drop(pos);}
+		logDel(id, false);
+	}
+	if(pwd)
+	{
+		pos = posOf(pwd);
+		if(pos < RFIDDBC_PWDFLAG){return false;}
+		pos &= PWDMASK;
+		load(pos, r);
+		if(r.id){r.pwd = 0; store(pos, r); logSet(pos);}
+		else{drop(pos);}
+		logDel(pwd, true);
+	}
+	commitEeprom();
+	return true;
+}
+
+// setNam Method (PRIVATE)----------------------------------------------------------------------------------------
+bool RfidDbCompact::setNam(int16_t pos, const char *name)
+{
+	EeScope scope(EEOP_DBNAME);
+	Rec r;
+
+	if(_maxNameLength == 0 || !load(pos, r)){return false;}
+	if(!name[0] && !r.name[0]){return true;}
+	strncpy(r.name, name, _maxNameLength - 1);
+	r.name[_maxNameLength - 1] = '\0';
+	if(!store(pos, r)){return false;}
+	if(_nameIdx){_nameIdx->set(pos, r.name);}
+	logSet(pos);
+	return true;
+}
+
+// posOf Method (PRIVATE)-----------------------------------------------------------------------------------------
+// Returns the position of the user whose id matches "idPwd" under "mask" or whose password matches "idPwd",
+// -1 if none. A password match has RFIDDBC_PWDFLAG set.
+int16_t RfidDbCompact::posOf(uint32_t idPwd, uint32_t mask)
+{
+	EeScope scope(EEOP_DBLOOKUP);
+	uint32_t maskedId = idPwd & mask;
+
+	for(uint8_t i = 0; i < _count; i++)
+	{
+		uint16_t	addr = _index[i] + BLK_DATA;
+		uint8_t		has = eeMeter.read(_index[i] + BLK_HAS);
+		if(has & HAS_ID)
+		{
+			uint8_t n = has & HAS_ID32 ? 4 : 3;
+			if((readVal(addr, n) & mask) == maskedId){return i;}
+			addr += n;
+		}
+		if((has & HAS_PWD) && readVal(addr, has & HAS_PWD32 ? 4 : 3) == idPwd){return i | RFIDDBC_PWDFLAG;}
+	}
+	return -1;
+}
+
+// logSet Method (PRIVATE)---------------------------------------------------------------------------------------
+// Journals a change of user "pos", named by its id or, without an id, by its password.
+void RfidDbCompact::logSet(uint8_t pos)
+{
+	uint32_t id, pwd;
+
+	if(_journal == NULL){return;}
+	readId(pos, id);
+	readPwd(pos, pwd);
+	if(id){_journal->add(JNL_SET, id);}
+	else{_journal->add(JNL_SET | JNL_PWD, pwd);}
+}
+
+// logDel Method (PRIVATE)---------------------------------------------------------------------------------------
+// Journals that no user holds "key" any more.
+void RfidDbCompact::logDel(uint32_t key, bool pwd)
+{
+	if(_journal){_journal->add(pwd ? JNL_DEL | JNL_PWD : JNL_DEL, key);}
+}
+
+// userPos Method (PRIVATE)---------------------------------------------------------------------------------------
+// Position without the password flag, -1 if there is no user at "pos".
+int16_t RfidDbCompact::userPos(int16_t pos)
+{
+	if(pos < 0){return -1;}
+	pos &= PWDMASK;
+	return pos < _count ? pos : -1;
+}
+
+// load Method (PRIVATE)------------------------------------------------------------------------------------------
+bool RfidDbCompact::load(uint8_t pos, Rec &r)
+{
+	if(pos >= _count){return false;}
+	uint16_t addr = _index[pos];
+
+	memset(&r, 0, sizeof(r));
+	r.has = eeMeter.read(addr + BLK_HAS);
+	r.att = eeMeter.read(addr + BLK_ATT);
+	if(r.has & HAS_ID){r.id = readVal(fieldAt(addr, r.has, HAS_ID), r.has & HAS_ID32 ? 4 : 3);}
+	if(r.has & HAS_PWD){r.pwd = readVal(fieldAt(addr, r.has, HAS_PWD), r.has & HAS_PWD32 ? 4 : 3);}
+	if(r.has & HAS_TM){r.tm = readVal(fieldAt(addr, r.has, HAS_TM), 4);}
+	if(r.has & HAS_SCH){r.sch = eeMeter.read(fieldAt(addr, r.has, HAS_SCH));}
+	readNam(pos, r.name);
+	return true;
+}
+
+// encode Method (PRIVATE)----------------------------------------------------------------------------------------
+// Writes the block of "r" to "buf" (position not set) and returns its length.
+uint8_t RfidDbCompact::encode(Rec &r, uint8_t *buf)
+{
+	uint8_t len = BLK_DATA;
+
+	r.has = 0;
+	if(r.id){r.has |= r.id > 0xFFFFFF ? HAS_ID | HAS_ID32 : HAS_ID;}
+	if(r.pwd){r.has |= r.pwd > 0xFFFFFF ? HAS_PWD | HAS_PWD32 : HAS_PWD;}
+	if(r.tm){r.has |= HAS_TM;}
+	if(r.sch){r.has |= HAS_SCH;}
+	if(r.name[0]){r.has |= HAS_NAM;}
+	buf[BLK_HAS] = r.has;
+	buf[BLK_ATT] = r.att;
+	if(r.has & HAS_ID){for(uint8_t i = 0; i < (r.has & HAS_ID32 ? 4 : 3); i++){buf[len++] = r.id >> (8 * i);}}
+	if(r.has & HAS_PWD){for(uint8_t i = 0; i < (r.has & HAS_PWD32 ? 4 : 3); i++){buf[len++] = r.pwd >> (8 * i);}}
+	if(r.has & HAS_TM){for(uint8_t i = 0; i < 4; i++){buf[len++] = r.tm >> (8 * i);}}
+	if(r.has & HAS_SCH){buf[len++] = r.sch;}
+	for(uint8_t i = 0; r.name[i] && i < _maxNameLength - 1; i++){buf[len++] = r.name[i];}
+	buf[BLK_LEN] = len;
+	return len;
+}
+
+// store Method (PRIVATE)-----------------------------------------------------------------------------------------
+// Writes the record of user "pos". The block is rewritten in place when the record fits (it grows into a free
+// block following it or at the top of the heap), otherwise the record moves to a new block. Returns false if the
+// heap is full.
+bool RfidDbCompact::store(uint8_t pos, Rec &r)
+{
+	uint8_t		buf[BLK_MAX];
+	uint8_t		size = encode(r, buf);
+	uint16_t	addr = _index[pos];
+	uint8_t		len = addr ? eeMeter.read(addr + BLK_LEN) : 0;
+	uint16_t	old = 0;
+
+	if(addr && size > len)
+	{
+		uint16_t next = addr + len;
+		if(next == _top && addr + size <= _end){len = size; setEnd(addr + size);}	// Last block, grow the heap.
+		else if(next < _top && eeMeter.read(next + BLK_POS) == BLK_FREE &&
+			len + eeMeter.read(next + BLK_LEN) >= size && len + eeMeter.read(next + BLK_LEN) <= 0xFF)
+		{
+			len += eeMeter.read(next + BLK_LEN);								// Take the free block after it.
+		}
+	}
+	if(!addr || size > len)
+	{
+		bool moved = addr;
+		addr = alloc(size, len);
+		if(!addr){return false;}
+		if(moved){old = _index[pos];}											// alloc may have compacted.
+		_index[pos] = addr;
+	}
+	else if(len - size >= BLK_MIN)
+	{
+		release(addr + size, len - size);									// Shrunk, free the rest.
+		len = size;
+	}
+
+	buf[BLK_LEN] = len;
+	buf[BLK_POS] = pos;
+	for(uint8_t i = 0; i < len; i++){eeMeter.write(addr + i, i < size ? buf[i] : 0);}
+	if(old){release(old, eeMeter.read(old + BLK_LEN));}					// Freed once the new block is written.
+	commitEeprom();
+	return true;
+}
+
+// drop Method (PRIVATE)------------------------------------------------------------------------------------------
+// Removes user "pos". The last user takes its position, only the position byte of its block is written.
+bool RfidDbCompact::drop(uint8_t pos)
+{
+	EeScope scope(EEOP_DBMOVE);
+	uint8_t last = _count - 1;
+
+	release(_index[pos], eeMeter.read(_index[pos] + BLK_LEN));
+	if(_nameIdx){_nameIdx->remove(pos);}
+	if(pos != last)
+	{
+		_index[pos] = _index[last];
+		eeMeter.write(_index[pos] + BLK_POS, pos);
+		if(_nameIdx){_nameIdx->move(last, pos);}
+	}
+	eeMeter.write(_start - 1, --_count);
+	return true;
+}
+
+// alloc Method (PRIVATE)-----------------------------------------------------------------------------------------
+// Returns the address of a block of at least "size" bytes, its length in "len", or 0 if the heap is full. A free
+// block is used first, then the top of the heap, then the heap is compacted.
+uint16_t RfidDbCompact::alloc(uint8_t size, uint8_t &len)
+{
+	for(uint16_t addr = _start; addr < _top; addr += len)
+	{
+		len = eeMeter.read(addr + BLK_LEN);
+		if(eeMeter.read(addr + BLK_POS) == BLK_FREE && len >= size)
+		{
+			if(len - size >= BLK_MIN)
+			{
+				release(addr + size, len - size);
+				len = size;
+			}
+			return addr;
+		}
+	}
+	if(_top + size > _end){compact();}
+	if(_top + size > _end){return 0;}
+	uint16_t addr = _top;
+	len = size;
+	setEnd(_top + size);
+	return addr;
+}
+
+// release Method (PRIVATE)---------------------------------------------------------------------------------------
+// Frees the block of "len" bytes at "addr", joined with the free blocks after it. A free block at the top of the
+// heap lowers the top.
+void RfidDbCompact::release(uint16_t addr, uint8_t len)
+{
+	while(addr + len < _top && eeMeter.read(addr + len + BLK_POS) == BLK_FREE &&
+		len + eeMeter.read(addr + len + BLK_LEN) <= 0xFF)
+	{
+		len += eeMeter.read(addr + len + BLK_LEN);
+	}
+	if(addr + len >= _top){setEnd(addr); return;}
+	eeMeter.write(addr + BLK_LEN, len);
+	eeMeter.write(addr + BLK_POS, BLK_FREE);
+}
+
+// compact Method (PRIVATE)---------------------------------------------------------------------------------------
+// Moves every block down over the free blocks, the free space ends up at the top of the heap.
+void RfidDbCompact::compact()
+{
+	EeScope scope(EEOP_DBMOVE);
+	uint16_t dst = _start;
+
+	for(uint16_t addr = _start; addr < _top;)
+	{
+		uint8_t len = eeMeter.read(addr + BLK_LEN);
+		uint8_t pos = eeMeter.read(addr + BLK_POS);
+		if(pos != BLK_FREE)
+		{
+			if(addr != dst)
+			{
+				for(uint8_t i = 0; i < len; i++){eeMeter.write(dst + i, eeMeter.read(addr + i));}
+				_index[pos] = dst;
+			}
+			dst += len;
+		}
+		addr += len;
+	}
+	setEnd(dst);
+}
+
+// setEnd Method (PRIVATE)----------------------------------------------------------------------------------------
+void RfidDbCompact::setEnd(uint16_t addr)
+{
+	_top = addr;
+	if(addr < _end){eeMeter.write(addr + BLK_LEN, 0);}
+}
+
+// commit Method (PRIVATE)----------------------------------------------------------------------------------------
+void RfidDbCompact::commitEeprom()
+{
+	if(_batch){_batchWrites = true; return;}								// Committed by endBatch.
+	_revision++;
+	eeMeter.commit();
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_ESP32)
+	EEPROM.commit();
+#endif
+}
@@ -0,0 +1,145 @@
+// RfidDbCompact.h Rev 1.3
+
+// Rev 1.3	- Added modifyTm, beginBatch and endBatch, as in RfidDb.
+// Rev 1.2	- Optional change journal (DbJournal), filled as in RfidDb.
+// Rev 1.1	- Optional name index (NameIndex) kept up to date by name changes and user moves, as in RfidDb.
+// Rev 1.0	- RFID database with the methods of RfidDb and a variable length record per user, for about twice the
+//						  users in the same EEPROM. A record holds only what the user has: a presence byte tells which
+//						  fields follow, tag IDs and passwords take 3 bytes when they fit in 24 bits (W26 tags, PINs of
+//						  up to 7 digits), time stamp and schedule are stored only when set and the name takes its own
+//						  length, not NAMELENGTH.
+//						- Records are blocks of a heap filling the database area. A block that grows is moved to a free
+//						  block or to the top of the heap and the heap is compacted when no free space is left. The
+//						  address of each user's record is kept in RAM (2 bytes per user, array given by the caller),
+//						  so access by position stays O(1) and a lookup reads 1 byte more per user than RfidDb and
+//						  only the bytes of the IDs and passwords actually stored.
+//						- Removing a user moves the last user to its position, as RfidDb does. Only the position byte
+//						  of the moved record is written.
+//						- The database uses its own magic number. A database written by RfidDb is initialized by
+//						  begin(), users must be added again.
+//
+// Block:	[length] [position, 0xFF = free] [presence] [attribute] [id 3/4] [password 3/4] [time 4] [schedule 1]
+//				[name, 0 padded to the block length]. A length of 0 ends the heap.
+
+#ifndef _RFIDDBCOMPACT_H
+#define _RFIDDBCOMPACT_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+#include "NameIndex.h"
+#include "DbJournal.h"
+
+#define RFIDDBC_MAGIC			0x76					// RfidDb uses 0x75.
+#define RFIDDBC_MAXNAME		32						// Longest name (including null) a record may hold.
+#define RFIDDBC_PWDFLAG		0x1000				// posOf() result flag of a password match (PWDFLAG of RfidDb).
+
+class RfidDbCompact
+{
+
+public:
+	// Database of at most "totalUsers" users in EEPROM from "eepromOffset" up to "eepromEnd" (excluded). "index"
+	// must hold "totalUsers" addresses and stay allocated. Names are at most "maxNameSize" bytes with the null.
+	RfidDbCompact(uint16_t *index, uint8_t totalUsers, uint16_t eepromOffset, uint16_t eepromEnd, uint8_t maxNameSize);
+
+	// Initializes the database if the EEPROM does not hold one, then builds the index.
+	void							begin();
+
+	// Erases the database.
+	void							initDb();
+
+	uint8_t						totalUsers();
+	uint32_t					dbSize();												// EEPROM bytes of the database area.
+	uint8_t						maxNameLength();
+	uint8_t						count();
+	uint16_t					freeBytes();										// Heap bytes left, compaction included.
+	uint16_t					revision();
+
+	// Attaches a name index of "totalUsers" entries, built from the names in the database.
+	void							nameIndex(NameIndex *idx);
+
+	// Attaches a change journal. Changes made through the public methods are added to it.
+	void							journal(DbJournal *jnl){_journal = jnl;}
+
+	bool							insertId(uint32_t id);
+	bool							insertId(uint32_t id, uint32_t pwd);
+	bool							insertPwd(uint32_t pwd);
+	bool							insertPwd(uint32_t id, uint32_t pwd);
+	bool							insertIdNam(uint32_t id, char *name);
+	bool							insertPwdNam(uint32_t pwd, char *name);
+	bool							insertAtt(uint32_t idPwd, uint8_t att);
+	bool							insertTm(uint32_t idPwd, uint32_t tm);
+
+	bool							removeId(uint32_t id);
+	bool							removePwd(uint32_t pwd);
+	bool							removeIdNam(uint32_t id);
+	bool							removePwdNam(uint32_t pwd);
+
+	bool							modifyIdPwd(int16_t pos, uint32_t idPwd);
+	bool							modifyNam(int16_t pos, char *name);
+	bool							modifyAtt(int16_t pos, uint8_t att);
+	bool							modifySch(int16_t pos, uint8_t sch);
+	bool							modifyTm(int16_t pos, uint32_t tm);
+
+	// Writes made after beginBatch are committed once, by the last (nested) endBatch.
+	void							beginBatch(){_batch++;}
+	void							endBatch();
+
+	bool							readId(int16_t pos, uint32_t &id);
+	bool							readPwd(int16_t pos, uint32_t &pwd);
+	bool							readAtt(int16_t pos, uint8_t &att);
+	bool							readTm(int16_t pos, uint32_t &tm);
+	bool							readSch(int16_t pos, uint8_t &sch);
+	bool							readNam(int16_t pos, char *name);
+
+	bool							contains(uint32_t id);
+	bool							contains24(uint32_t id);
+	int16_t						posOf(uint32_t idPwd);
+	int16_t						posOf24(uint32_t idPwd);
+
+private:
+	struct Rec																				// Decoded record.
+	{
+		uint8_t					has;													// Presence byte.
+		uint8_t					att;
+		uint32_t				id;
+		uint32_t				pwd;
+		uint32_t				tm;
+		uint8_t					sch;
+		char						name[RFIDDBC_MAXNAME];
+	};
+
+	uint16_t *				_index;
+	uint8_t						_totalUsers;
+	uint8_t						_count;
+	uint8_t						_maxNameLength;
+	uint16_t					_start;													// First block.
+	uint16_t					_end;														// End of the database area.
+	uint16_t					_top;														// End of the last block.
+	uint16_t					_revision;
+	uint8_t						_batch;													// Nested beginBatch calls.
+	bool							_batchWrites;										// Commit left for endBatch.
+	NameIndex *				_nameIdx;
+	DbJournal *				_journal;
+
+	bool							insert(uint32_t id, uint32_t pwd);
+	bool							remove(uint32_t id, uint32_t pwd);
+	bool							setNam(int16_t pos, const char *name);
+	int16_t						posOf(uint32_t idPwd, uint32_t mask);
+	int16_t						userPos(int16_t pos);
+	bool							load(uint8_t pos, Rec &r);
+	bool							store(uint8_t pos, Rec &r);
+	uint8_t						encode(Rec &r, uint8_t *buf);
+	bool							drop(uint8_t pos);
+	uint16_t					alloc(uint8_t size, uint8_t &len);
+	void							release(uint16_t addr, uint8_t len);
+	void							compact();
+	void							setEnd(uint16_t addr);
+	void							commitEeprom();
+	void							logSet(uint8_t pos);
+	void							logDel(uint32_t key, bool pwd);
+};
+
+#endif
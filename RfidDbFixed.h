@@ -0,0 +1,97 @@
+// RfidDbFixed.h Rev 1.0
+
+// Rev 1.0	- RfidDb with the number of users, EEPROM offset and name length fixed at compile time. Every column
+//						  address and size is a constant expression, so the lookups and reads used at the door compute
+//						  no offsets at run time, range checks on the sizes fold away and the search walks the id and
+//						  password columns with a constant stride.
+//						- The EEPROM layout is the one of RfidDb. Writes (insert, remove, modify) are inherited from
+//						  RfidDb, they are limited by the EEPROM write time, not by the address arithmetic.
+
+#ifndef _RFIDDBFIXED_H
+#define _RFIDDBFIXED_H
+
+#include "RfidDb.h"
+#include "EepromMeter.h"
+
+template<uint8_t Users, uint16_t Offset, uint8_t NameLen> class RfidDbFixed : public RfidDb
+{
+
+public:
+	RfidDbFixed() : RfidDb(Users, Offset, NameLen){}
+
+	// EEPROM address of each column (see RfidDb.cpp).
+	static constexpr uint16_t	COUNTADDR	= Offset + 1;
+	static constexpr uint16_t	IDADDR		= COUNTADDR + 1;
+	static constexpr uint16_t	PWDADDR		= IDADDR + Users * sizeof(uint32_t);
+	static constexpr uint16_t	NAMEADDR	= PWDADDR + Users * sizeof(uint32_t);
+	static constexpr uint16_t	ATTADDR		= NAMEADDR + Users * NameLen;
+	static constexpr uint16_t	TMADDR		= ATTADDR + Users * sizeof(uint8_t);
+	static constexpr uint16_t	SCHADDR		= TMADDR + Users * sizeof(uint32_t);
+	static constexpr uint16_t	ENDADDR		= SCHADDR + Users * sizeof(uint8_t);
+
+	static_assert(Users > 0, "database must hold at least one user");
+	static_assert((uint32_t)Offset + 2 + Users * (14UL + NameLen) <= EEMETER_SIZE, "database does not fit in EEPROM");
+
+	uint8_t						totalUsers(){return Users;}
+	uint8_t						maxNameLength(){return NameLen;}
+	uint32_t					dbSize(){return ENDADDR - Offset;}
+
+	uint8_t						count()
+	{
+		EeScope scope(EEOP_DBREAD);
+		return eeMeter.read(COUNTADDR);
+	}
+
+	bool							readId(int16_t pos, uint32_t &id){return readCol(pos, IDADDR, id);}
+	bool							readPwd(int16_t pos, uint32_t &pwd){return readCol(pos, PWDADDR, pwd);}
+	bool							readAtt(int16_t pos, uint8_t &att){return readCol(pos, ATTADDR, att);}
+	bool							readTm(int16_t pos, uint32_t &tm){return readCol(pos, TMADDR, tm);}
+	bool							readSch(int16_t pos, uint8_t &sch){return readCol(pos, SCHADDR, sch);}
+
+	bool							readNam(int16_t pos, char *name)
+	{
+		EeScope scope(EEOP_DBREAD);
+		if(NameLen == 0 || (uint16_t)pos >= count()){return false;}
+		uint16_t addr = NAMEADDR + (uint8_t)pos * NameLen;
+		for(uint8_t i = 0; i < NameLen; i++)
+		{
+			name[i] = eeMeter.read(addr + i);
+			if(name[i] == '\0'){break;}
+		}
+		return true;
+	}
+
+	int16_t						posOf(uint32_t idPwd){return find(idPwd, 0xFFFFFFFF);}
+	int16_t						posOf24(uint32_t idPwd){return find(idPwd, 0x00FFFFFF);}
+	bool							contains(uint32_t id){return find(id, 0xFFFFFFFF) != -1;}
+	bool							contains24(uint32_t id){return find(id, 0x00FFFFFF) != -1;}
+
+private:
+	// Reads the value of user "pos" in the column starting at "col". A negative "pos" fails the unsigned compare.
+	template<class T> bool readCol(int16_t pos, uint16_t col, T &val)
+	{
+		EeScope scope(EEOP_DBREAD);
+		if((uint16_t)pos >= count()){return false;}
+		eeMeter.get(col + (uint8_t)pos * sizeof(T), val);
+		return true;
+	}
+
+	// Same result as RfidDb::posOf. The id and password of a user are a constant distance apart, so one address
+	// steps through both columns.
+	int16_t						find(uint32_t idPwd, uint32_t mask)
+	{
+		EeScope scope(EEOP_DBLOOKUP);
+		uint32_t	maskedId = idPwd & mask;
+		uint32_t	val;
+		uint16_t	end = IDADDR + count() * sizeof(uint32_t);
+
+		for(uint16_t addr = IDADDR; addr < end; addr += sizeof(uint32_t))
+		{
+			if((eeMeter.get(addr, val) & mask) == maskedId){return (addr - IDADDR) / sizeof(uint32_t);}
+			if(eeMeter.get(addr + (PWDADDR - IDADDR), val) == idPwd){return ((addr - IDADDR) / sizeof(uint32_t)) | 0x1000;}
+		}
+		return -1;
+	}
+};
+
+#endif
@@ -0,0 +1,114 @@
+// Sampler.cpp Rev 1.0
+
+#include "Sampler.h"
+
+Sampler::Sampler(const uint8_t *adcPins, uint8_t adcCount, const uint8_t *digPins, uint8_t digCount)
+{
+	_adcCount = (adcCount < SMP_ANALOG) ? adcCount : SMP_ANALOG;
+	for(uint8_t i = 0; i < _adcCount; i++)
+	{
+		_adcChan[i] = (adcPins[i] >= A0) ? adcPins[i] - A0 : adcPins[i];	// Pin number or channel number.
+		_adcVal[i] = 0;
+	}
+	_adcSum = 0;
+	_adcIdx = 0;
+	_adcCnt = 0;
+	_adcBusy = false;
+	_adcFirst = true;
+	_blocks = 0;
+	_digCount = (digCount < SMP_DIGITAL) ? digCount : SMP_DIGITAL;
+	_digPins = digPins;
+	_raw = 0;
+	_stable = 0;
+}
+
+void Sampler::begin()
+{
+	for(uint8_t i = 0; i < _digCount; i++)										// Port registers, so tick() does not look them up.
+	{
+		_digIn[i] = portInputRegister(digitalPinToPort(_digPins[i]));
+		_digMask[i] = digitalPinToBitMask(_digPins[i]);
+		_digCnt[i] = 0;
+		if(*_digIn[i] & _digMask[i]){_raw |= (1 << i);}
+	}
+	_stable = _raw;
+	ADCSRA = (1 << ADEN) | (1 << ADIE) | (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);	// 16MHz / 128 = 125kHz.
+	start();
+}
+
+void Sampler::tick()
+{
+	for(uint8_t i = 0; i < _digCount; i++)
+	{
+		uint8_t bit = 1 << i;
+		if(*_digIn[i] & _digMask[i]){_raw |= bit;}
+		else{_raw &= ~bit;}
+		if((_raw ^ _stable) & bit)
+		{
+			if(++_digCnt[i] >= SMP_DEBOUNCE)
+			{
+				_stable ^= bit;
+				_digCnt[i] = 0;
+			}
+		}
+		else{_digCnt[i] = 0;}
+	}
+	if(!_adcBusy){start();}
+}
+
+void Sampler::adcDone()
+{
+	uint16_t val = ADC;
+
+	if(_adcCnt++ > 0){_adcSum += val;}												// First conversion after a channel change dropped.
+	if(_adcCnt <= SMP_OVERSAMPLE)
+	{
+		ADCSRA |= (1 << ADSC);
+		return;
+	}
+	if(_adcFirst){_adcVal[_adcIdx] = _adcSum;}
+	else
+	{
+		int16_t diff = _adcSum - _adcVal[_adcIdx];
+		_adcVal[_adcIdx] += (diff + (1 << (SMP_SMOOTH - 1))) >> SMP_SMOOTH;
+	}
+	if(_adcIdx + 1 < _adcCount){select(_adcIdx + 1); return;}
+	_adcBusy = false;
+	_adcFirst = false;
+	_blocks++;
+}
+
+uint16_t Sampler::analog(uint8_t i)
+{
+	uint16_t val;
+
+	if(i >= _adcCount){return 0;}
+	noInterrupts();																						// 16 bits, written by the ADC ISR.
+	val = _adcVal[i];
+	interrupts();
+	return val;
+}
+
+// start Method (PRIVATE)-----------------------------------------------------------------------------------------
+void Sampler::start()
+{
+	if(_adcCount == 0){return;}
+	_adcBusy = true;
+	select(0);
+}
+
+// select Method (PRIVATE)----------------------------------------------------------------------------------------
+// Switches the ADC to analog input "i" and starts its first conversion.
+void Sampler::select(uint8_t i)
+{
+	uint8_t chan = _adcChan[i];
+
+	_adcIdx = i;
+	_adcCnt = 0;
+	_adcSum = 0;
+	ADMUX = (1 << REFS0) | (chan & 0x07);																// AVCC reference.
+#if defined(MUX5)
+	ADCSRB = (chan & 0x08) ? (1 << MUX5) : 0;															// Channels 8 to 15 (Mega).
+#endif
+	ADCSRA |= (1 << ADSC);
+}
@@ -0,0 +1,82 @@
+// Sampler.h Rev 1.0
+
+// Rev 1.0	- Background sampling of the analog and digital sensor inputs. Readers get the last values from RAM and
+//						  never wait on a conversion or read a pin.
+//						- Analog inputs are converted by the ADC on interrupt, one conversion starting the next, through
+//						  every channel in turn. Each channel is sampled SMP_OVERSAMPLE times per block (the first
+//						  conversion after a channel change is dropped while the input settles) and the block sums are
+//						  averaged over blocks (SMP_SMOOTH), so values are in 1/SMP_OVERSAMPLE ADC counts. A block
+//						  takes about 104 us per conversion (ADC clock 125 kHz) and starts at each tick() once the
+//						  previous one is done.
+//						- Digital inputs are read from their port registers at each tick(). An input takes a new
+//						  level once it has read the same for SMP_DEBOUNCE ticks.
+//						- tick() is called from a timer ISR and adcDone() from ISR(ADC_vect), both in the sketch.
+
+#ifndef _SAMPLER_H
+#define _SAMPLER_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#define SMP_ANALOG				4							// Most analog inputs.
+#define SMP_DIGITAL				8							// Most digital inputs.
+#define SMP_OVERSAMPLE		16						// Conversions per channel and block.
+#define SMP_SMOOTH				2							// Block sums are averaged over 2^SMP_SMOOTH blocks.
+#define SMP_DEBOUNCE			3							// Ticks an input must read the same before it changes.
+
+class Sampler
+{
+
+public:
+	// Samples the analog pins "adcPins" and the digital pins "digPins". Inputs are then numbered in the order
+	// of the arrays.
+	Sampler(const uint8_t *adcPins, uint8_t adcCount, const uint8_t *digPins, uint8_t digCount);
+
+	// Sets up the ADC (AVCC reference, interrupt), reads the digital inputs once and starts the first block.
+	// Call from setup after the pin modes are set.
+	void							begin();
+
+	// Reads the digital inputs and starts the next analog block. Call from a timer ISR.
+	void							tick();
+
+	// Stores the conversion and starts the next one. Call from ISR(ADC_vect).
+	void							adcDone();
+
+	// Average of analog input "i" in 1/SMP_OVERSAMPLE ADC counts (0 to 1023 * SMP_OVERSAMPLE).
+	uint16_t					analog(uint8_t i);
+
+	// Debounced level (HIGH or LOW) of digital input "i", as digitalRead() would return it.
+	uint8_t						read(uint8_t i){return (_stable >> i) & 1;}
+
+	// Level of digital input "i" at the last tick, not debounced.
+	uint8_t						raw(uint8_t i){return (_raw >> i) & 1;}
+
+	uint32_t					blocks(){return _blocks;}								// Analog blocks completed.
+
+private:
+	uint8_t						_adcCount;
+	uint8_t						_adcChan[SMP_ANALOG];
+	volatile uint16_t	_adcVal[SMP_ANALOG];
+	uint16_t					_adcSum;
+	uint8_t						_adcIdx;															// Channel being converted.
+	uint8_t						_adcCnt;															// Conversions of this channel in the block.
+	volatile bool			_adcBusy;
+	bool							_adcFirst;														// No block completed yet.
+	volatile uint32_t	_blocks;
+
+	uint8_t						_digCount;
+	const uint8_t *		_digPins;
+	volatile uint8_t *	_digIn[SMP_DIGITAL];
+	uint8_t						_digMask[SMP_DIGITAL];
+	uint8_t						_digCnt[SMP_DIGITAL];
+	volatile uint8_t	_raw;
+	volatile uint8_t	_stable;
+
+	void							select(uint8_t i);
+	void							start();
+};
+
+#endif
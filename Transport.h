@@ -0,0 +1,56 @@
+// Transport.h Rev 1.0
+
+// Rev 1.0	- Byte stream between the controller and a host collector, under the access event link (EventLink)
+//						  and the machine protocol. Lines written between beginBatch() and endBatch() form a batch: a
+//						  datagram transport sends the batch as one packet, a stream transport (UART, TCP) sends the
+//						  bytes as they are written. availableForWrite() is the room left in the batch or in the
+//						  transmit buffer, so a caller that checks it first never waits.
+//						- UartTransport runs the link on a hardware serial port (UART3 on the Mega), W5100Transport
+//						  (TransportW5100.h) on the W5100 Ethernet board and SocketTransport (host/shim) on a Linux socket.
+
+#ifndef _TRANSPORT_H
+#define _TRANSPORT_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+class Transport : public Stream
+{
+
+public:
+	// Opens the link. Called once from setup, after the port or network interface is started.
+	virtual void			begin(){}
+
+	// Reconnects a connection that dropped and receives the next datagram. Call from the main loop.
+	virtual void			maintain(){}
+
+	// False while the collector cannot be reached (TCP connection down). Always true on a UART.
+	virtual bool			connected(){return true;}
+
+	virtual void			beginBatch(){}
+	virtual void			endBatch(){}
+};
+
+// Link on a serial port, which must be started (begin) by the sketch.
+class UartTransport : public Transport
+{
+
+public:
+	UartTransport(Stream &port) : _port(port){}
+
+	int								available(){return _port.available();}
+	int								read(){return _port.read();}
+	int								peek(){return _port.peek();}
+	size_t						write(uint8_t c){return _port.write(c);}
+	size_t						write(const uint8_t *buf, size_t size){return _port.write(buf, size);}
+	int								availableForWrite(){return _port.availableForWrite();}
+	using							Print::write;
+
+private:
+	Stream &					_port;
+};
+
+#endif
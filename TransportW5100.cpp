@@ -0,0 +1,76 @@
+// TransportW5100.cpp Rev 1.0
+
+#include "TransportW5100.h"
+
+W5100Transport::W5100Transport(IPAddress ip, uint16_t port, bool tcp)
+{
+	_ip = ip;
+	_port = port;
+	_isTcp = tcp;
+	_batch = false;
+	_batchLen = 0;
+	_connTime = 0;
+}
+
+void W5100Transport::begin()
+{
+	if(_isTcp){_tcp.setConnectionTimeout(W5100_CONNECT);}
+	else{_udp.begin(W5100_LOCALPORT);}
+}
+
+void W5100Transport::maintain()
+{
+	if(_isTcp)
+	{
+		if(_tcp.connected() || millis() - _connTime < W5100_RECONNECT){return;}
+		_connTime = millis();
+		_tcp.stop();
+		_tcp.connect(_ip, _port);
+		return;
+	}
+	while(_udp.available() == 0)																// Current datagram read, get the next one.
+	{
+		if(_udp.parsePacket() == 0){return;}
+		if(_udp.remoteIP() == _ip){return;}
+		_udp.flush();																							// Not from the collector.
+	}
+}
+
+bool W5100Transport::connected(){return _isTcp ? _tcp.connected() : true;}
+
+// A UDP batch is a datagram to the collector.
+void W5100Transport::beginBatch()
+{
+	if(_isTcp || _batch){return;}
+	_batch = _udp.beginPacket(_ip, _port);
+	_batchLen = 0;
+}
+
+void W5100Transport::endBatch()
+{
+	if(!_batch){return;}
+	_udp.endPacket();
+	_batch = false;
+}
+
+int W5100Transport::available(){return _isTcp ? _tcp.available() : _udp.available();}
+int W5100Transport::read(){return _isTcp ? _tcp.read() : _udp.read();}
+int W5100Transport::peek(){return _isTcp ? _tcp.peek() : _udp.peek();}
+
+size_t W5100Transport::write(uint8_t c){return write(&c, 1);}
+
+// Writes outside a batch are sent as a datagram of their own at the next endBatch().
+size_t W5100Transport::write(const uint8_t *buf, size_t size)
+{
+	if(_isTcp){return _tcp.connected() ? _tcp.write(buf, size) : 0;}
+	beginBatch();
+	if(!_batch || _batchLen + size > W5100_PACKET){return 0;}
+	_batchLen += size;
+	return _udp.write(buf, size);
+}
+
+int W5100Transport::availableForWrite()
+{
+	if(_isTcp){return _tcp.connected() ? _tcp.availableForWrite() : 0;}
+	return W5100_PACKET - (_batch ? _batchLen : 0);
+}
@@ -0,0 +1,55 @@
+// TransportW5100.h Rev 1.0
+
+// Rev 1.0	- Transport on the W5100 Ethernet board (Arduino Ethernet library 2.0), to a collector at a fixed
+//						  address and port. With UDP each batch is one datagram of up to W5100_PACKET bytes and only
+//						  datagrams from the collector are received. With TCP the controller connects to the collector
+//						  and connects again every W5100_RECONNECT ms while the connection is down. The connect timeout
+//						  is cut to W5100_CONNECT ms, as the main loop waits for it.
+//						- Ethernet.init() and Ethernet.begin() must be called by the sketch before begin().
+
+#ifndef _TRANSPORTW5100_H
+#define _TRANSPORTW5100_H
+
+#include "Transport.h"
+#include <SPI.h>
+#include <Ethernet.h>
+#include <EthernetUdp.h>
+
+#define W5100_PACKET			512						// Largest datagram sent (the W5100 holds 2K per socket).
+#define W5100_RECONNECT		2000					// ms between TCP connection attempts.
+#define W5100_CONNECT			100						// ms before a TCP connection attempt is given up.
+#define W5100_LOCALPORT		5140					// UDP port the controller receives on.
+
+class W5100Transport : public Transport
+{
+
+public:
+	// Link to the collector at "ip":"port", over TCP if "tcp" is true, UDP otherwise.
+	W5100Transport(IPAddress ip, uint16_t port, bool tcp);
+
+	void							begin();
+	void							maintain();
+	bool							connected();
+	void							beginBatch();
+	void							endBatch();
+
+	int								available();
+	int								read();
+	int								peek();
+	size_t						write(uint8_t c);
+	size_t						write(const uint8_t *buf, size_t size);
+	int								availableForWrite();
+	using							Print::write;
+
+private:
+	EthernetUDP				_udp;
+	EthernetClient		_tcp;
+	IPAddress					_ip;
+	uint16_t					_port;
+	bool							_isTcp;
+	bool							_batch;																// Datagram being written.
+	uint16_t					_batchLen;
+	uint32_t					_connTime;
+};
+
+#endif
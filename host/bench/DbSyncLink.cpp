@@ -0,0 +1,295 @@
+// DbSyncLink.cpp Rev 1.1
+
+// Rev 1.1	- Each node has its own minute clock ("timeStmp" of the sketch), far apart, and the users are enrolled
+//						  with temporary access on it. Also fails if the minutes left of the users differ between the nodes.
+// Rev 1.0	- Runs two controllers linked by DbSync over a pty pair, each in its own process with its own EEPROM,
+//						  database and journal (node A on the master side, node B on the slave side). The virtual clock of
+//						  each node follows the wall clock. Node A enrols, changes and removes users, node B enrols users
+//						  of its own, then node B is stopped while node A makes more changes than the journal holds, so
+//						  the link falls back to a snapshot. For each step the host time until the peer applied the
+//						  change is reported with the EEPROM bytes the peer wrote. Fails (exit 1) if the databases of the
+//						  two nodes differ at the end.
+
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "HostShim.h"
+#include "EEPROM.h"
+#include "RfidDb.h"
+#include "DbJournal.h"
+#include "DbSync.h"
+
+#define USERS								100						// Database of each node.
+#define DBSTART							32						// Same layout as the sketch.
+#define NAMELENGTH					11
+#define JOURNAL							16						// Same journal as the sketch.
+#define TIMEOUT							5000					// ms before a step fails.
+
+static RfidDb							db((uint8_t)USERS, (uint16_t)DBSTART, (uint8_t)NAMELENGTH);
+static JnlEntry						jnlEntries[JOURNAL];
+static DbJournal				dbJnl(jnlEntries, JOURNAL);
+static DbSyncOf<RfidDb>		dbSync(Serial2, dbJnl, db);
+
+static std::chrono::steady_clock::time_point	t0 = std::chrono::steady_clock::now();
+static int								cmdFd = -1;						// Node B: commands of node A.
+static int								replyFd = -1;					// Node B: replies to node A.
+static uint32_t						minutes;							// Minute clock of the node.
+
+static double wallMs(){return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();}
+
+// Tag ID of user "i" of node "node". Unique and non zero.
+static uint32_t tagOf(uint8_t node, uint16_t i){return 0x00A50000UL + node * 0x1000UL + i + 1;}
+
+// Moves the virtual clock to the wall clock and services the link.
+static void step()
+{
+	uint64_t ms = (uint64_t)wallMs();
+
+	if(ms > hostNow() / 1000){hostAdvance(ms - hostNow() / 1000);}
+	dbSync.service();
+}
+
+static void setupNode(int fd, uint16_t epoch)
+{
+	struct termios tio;
+
+	tcgetattr(fd, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(fd, TCSANOW, &tio);
+	hostSerialOut(NULL);
+	EEPROM.resize(HOST_EEPROM_SIZE);
+	db.begin();
+	db.journal(&dbJnl);
+	dbJnl.begin(epoch);
+	minutes = epoch * 100000UL;																			// Clocks of the nodes far apart.
+	dbSync.clock(minutes);
+	hostLink(Serial2, fd);
+}
+
+static void enrol(uint8_t node, uint8_t i)
+{
+	char name[NAMELENGTH];
+
+	snprintf(name, sizeof(name), "%c-user%u", 'A' + node, i);
+	db.insertId(tagOf(node, i));
+	db.insertIdNam(tagOf(node, i), name);
+	db.insertAtt(tagOf(node, i), 0x81);
+	db.insertTm(tagOf(node, i), minutes + 1440UL * (i + 1));
+}
+
+// Sum of the minutes left of the temporary access of every user, the same on both nodes once synchronized.
+static unsigned minutesLeft()
+{
+	unsigned	sum = 0;
+	uint32_t	tm;
+
+	for(uint8_t pos = 0; pos < db.count(); pos++)
+	{
+		if(db.readTm(pos, tm) && tm >= minutes){sum += tm - minutes;}
+	}
+	return sum;
+}
+
+// NODE B ---------------------------------------------------------------------------------------------------------
+// Commands: 'e' enrols the next user, 's' replies "<users> <digest> <EEPROM writes> <minutes left>", 'q' quits.
+static void nodeB(int fd)
+{
+	uint16_t	next = 0;
+	char			c;
+
+	setupNode(fd, 2);
+	while(true)
+	{
+		step();
+		if(read(cmdFd, &c, 1) != 1){usleep(100); continue;}
+		if(c == 'e'){enrol(1, next++);}
+		else if(c == 's')
+		{
+			char line[64];
+			int n = snprintf(line, sizeof(line), "%u %u %u %u\n", db.count(), dbSync.digest(), EEPROM.stats.writes,
+				minutesLeft());
+			if(write(replyFd, line, n) != n){_exit(1);}
+		}
+		else if(c == 'q'){_exit(0);}
+	}
+}
+
+// NODE A ---------------------------------------------------------------------------------------------------------
+struct Stat
+{
+	unsigned					users;
+	unsigned					digest;
+	unsigned					writes;
+	unsigned					left;
+};
+
+static pid_t							peer;
+static int								toB;									// Command pipe to node B.
+static FILE *							fromB;								// Reply pipe of node B.
+
+// Services the link until "done" returns true, returns the elapsed ms or -1 after TIMEOUT ms.
+template<class F> static double waitFor(F done)
+{
+	double start = wallMs();
+
+	while(!done())
+	{
+		if(wallMs() - start > TIMEOUT){return -1;}
+		step();
+		usleep(50);
+	}
+	return wallMs() - start;
+}
+
+static Stat statB()
+{
+	Stat	s = {0, 0, 0, 0};
+
+	if(write(toB, "s", 1) != 1){return s;}
+	while(true)
+	{
+		struct pollfd p = {fileno(fromB), POLLIN, 0};
+		step();
+		if(poll(&p, 1, 0) > 0){break;}
+		usleep(50);
+	}
+	if(fscanf(fromB, "%u %u %u %u", &s.users, &s.digest, &s.writes, &s.left) != 4){s.users = 0;}
+	return s;
+}
+
+static bool peerApplied(){return dbSync.acked() == dbJnl.head();}
+
+static void report(const char *name, std::vector<double> &ms, unsigned writes)
+{
+	std::sort(ms.begin(), ms.end());
+	printf("%-24s %6zu %10.3f %10.3f %10.3f %12.1f\n", name, ms.size(), ms[ms.size() / 2], ms[ms.size() * 9 / 10],
+		ms.back(), (double)writes / ms.size());
+}
+
+static bool fail(const char *what)
+{
+	printf("FAIL: %s\n", what);
+	return false;
+}
+
+static bool nodeA(int fd)
+{
+	std::vector<double>	ms;
+	Stat								s;
+	double							t;
+	uint16_t						snaps;
+
+	setupNode(fd, 1);
+	if(waitFor([]{return dbSync.linkUp() && dbSync.synced() && dbSync.digest() == dbSync.peerDigest();}) < 0)
+	{
+		return fail("link not up");
+	}
+	printf("Link up after %.1f ms (epoch %u, peer epoch %u)\n\n", wallMs(), dbJnl.epoch(), dbSync.peerEpoch());
+	printf("%-24s %6s %10s %10s %10s %12s\n", "step (host ms)", "n", "p50", "p90", "max", "peer EE wr");
+
+	// Enrolment on A: tag, name, attributes and time, 4 journal entries.
+	s = statB();
+	for(uint16_t i = 0; i < 20; i++)
+	{
+		double start = wallMs();
+		enrol(0, i);
+		if(waitFor(peerApplied) < 0){return fail("enrolment not applied");}
+		ms.push_back(wallMs() - start);
+	}
+	report("enrol A -> B", ms, statB().writes - s.writes);
+
+	// One change on A.
+	ms.clear();
+	s = statB();
+	for(uint16_t i = 0; i < 20; i++)
+	{
+		double start = wallMs();
+		db.modifyAtt(db.posOf(tagOf(0, i)), 0x82);
+		if(waitFor(peerApplied) < 0){return fail("change not applied");}
+		ms.push_back(wallMs() - start);
+	}
+	report("attribute A -> B", ms, statB().writes - s.writes);
+
+	ms.clear();
+	s = statB();
+	for(uint16_t i = 10; i < 20; i++)
+	{
+		double start = wallMs();
+		db.removeId(tagOf(0, i));
+		if(waitFor(peerApplied) < 0){return fail("removal not applied");}
+		ms.push_back(wallMs() - start);
+	}
+	report("remove A -> B", ms, statB().writes - s.writes);
+
+	// Enrolment on B, until A holds the whole user.
+	ms.clear();
+	s = statB();
+	for(uint16_t i = 0; i < 10; i++)
+	{
+		double start = wallMs();
+		if(write(toB, "e", 1) != 1){return fail("node B gone");}
+		t = waitFor([i]{uint32_t tm = 0; return db.posOf(tagOf(1, i)) >= 0 && db.readTm(db.posOf(tagOf(1, i)), tm) && tm;});
+		if(t < 0){return fail("enrolment of B not applied");}
+		ms.push_back(wallMs() - start);
+	}
+	report("enrol B -> A", ms, statB().writes - s.writes);
+
+	// Node B stopped while A makes more changes than the journal holds: snapshot.
+	ms.clear();
+	snaps = dbSync.snapsSent();
+	kill(peer, SIGSTOP);
+	for(uint16_t i = 20; i < 20 + JOURNAL; i++){enrol(0, i);}
+	kill(peer, SIGCONT);
+	s = statB();
+	t = waitFor([snaps]{return dbSync.snapsSent() > snaps && dbSync.synced();});
+	if(t < 0){return fail("snapshot not applied");}
+	ms.push_back(t);
+	report("snapshot A -> B", ms, statB().writes - s.writes);
+
+	s = statB();
+	printf("\nUsers A %u B %u, digest A %04X B %04X, frames dropped %u, snapshots sent %u received %u\n", db.count(),
+		s.users, dbSync.digest(), s.digest, dbSync.errors(), dbSync.snapsSent(), dbSync.snapsRcvd());
+	if(s.users != db.count() || s.digest != dbSync.digest()){return fail("databases differ");}
+	if(s.left != minutesLeft()){return fail("minutes left of temporary access differ");}
+	return true;
+}
+
+int main()
+{
+	int		cmd[2];
+	int		reply[2];
+	int		master = posix_openpt(O_RDWR | O_NOCTTY);
+	int		status;
+	bool	ok;
+
+	if(master < 0 || grantpt(master) || unlockpt(master) || pipe(cmd) || pipe(reply))
+	{
+		perror("pty");
+		return 1;
+	}
+	int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+	if(slave < 0){perror("pty"); return 1;}
+	fflush(stdout);
+	peer = fork();
+	if(peer == 0)
+	{
+		close(master);
+		cmdFd = cmd[0];
+		replyFd = reply[1];
+		fcntl(cmdFd, F_SETFL, O_NONBLOCK);
+		nodeB(slave);
+	}
+	close(slave);
+	toB = cmd[1];
+	fromB = fdopen(reply[0], "r");
+	ok = nodeA(master);
+	if(write(toB, "q", 1) != 1 || waitpid(peer, &status, 0) != peer){kill(peer, SIGKILL);}
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,259 @@
+// DoorDaemonBench.cpp Rev 1.1
+
+// Rev 1.1	- In the "direct" rows each thread takes the events of its own doors after each run (takeEvent), the
+//						  main thread could not keep up with them and most were dropped. A row that dropped events is
+//						  marked and the benchmark then exits with an error, its rate counts decisions whose event was
+//						  lost.
+// Rev 1.0	- Access decisions per second of the door daemon against the number of threads. The database holds
+//						  USERS users (permanent, temporary, ID + password and one-time access) spread over the shards of
+//						  one image file, 20% of the entries are unknown codes. While the decisions run, the main thread
+//						  changes a user every CHANGEUS (a new index partition is published each time) and takes the
+//						  decisions out of the event queues.
+//						  "direct" rows: each thread calls decide() on the frames of its own doors and takes their
+//						  events, the virtual clock moves past the lock-out and entry timers between runs so keypads do
+//						  not stay locked out.
+//						  "queued" rows: the main thread submits the same frames to the daemon's worker threads (wall
+//						  clock) and also drains the events, so it is the limit once the workers are faster than it.
+//
+//						  door_daemon_bench [--threads N] [--seconds S]
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <thread>
+#include <unistd.h>
+#include "HostShim.h"
+#include "DoorDaemon.h"
+
+#define USERS								2000
+#define SHARDS							10
+#define DOORS								512
+#define FRAMES							(1 << 16)			// Frames generated per thread.
+#define UNKNOWN							20						// Percent of unknown codes.
+#define RUN									64						// Frames per pin of the index.
+#define CHANGEUS						1000					// us between database changes.
+
+struct Result
+{
+	double						rate;									// Decisions per second.
+	uint32_t					publishes;
+	uint32_t					batches;
+	uint64_t					dropped;
+};
+
+static uint32_t tagOf(uint16_t i){return 0x00A50000UL + i * 7919UL % 0xFFFF + 1;}
+static uint32_t pwdOf(uint16_t i){return 100000UL + i * 37UL;}
+
+// User "i": 60% permanent, 15% temporary, 10% ID + password, 10% one-time access, 5% front door only.
+static void userOf(uint16_t i, DbChange &c)
+{
+	uint8_t kind = i % 20;
+
+	memset(&c, 0, sizeof(c));
+	c.id = i + 1;
+	c.op = CHG_ADD;
+	c.tag = tagOf(i);
+	if(i % 3 == 0 || kind == 15 || kind == 16){c.pwd = pwdOf(i);}
+	snprintf(c.name, sizeof(c.name), "USER%u", i);
+	c.hasAtt = true;
+	c.att = DAEMON_PERMACCESS | 0x0F;
+	if(kind >= 12 && kind < 15){c.hasDays = true; c.days = 30;}
+	else if(kind == 15 || kind == 16){c.att |= DAEMON_IDANDPWD;}
+	else if(kind == 17 || kind == 18){c.att = DAEMON_ONETMACCESS | 0x0F;}
+	else if(kind == 19){c.att = DAEMON_PERMACCESS | 0x01;}
+}
+
+// Frames for the doors of thread "t" of "threads". The two entries of an ID + password user follow each other.
+static void framesOf(uint8_t t, uint8_t threads, std::vector<DoorFrame> &frames)
+{
+	std::mt19937	rnd(t + 1);
+	DbChange			c;
+
+	frames.clear();
+	while(frames.size() < FRAMES)
+	{
+		DoorFrame f;
+		f.door = (rnd() % (DOORS / threads)) * threads + t;
+		f.typed = false;
+		if(rnd() % 100 < UNKNOWN)
+		{
+			f.code = 0x80000000UL | rnd();
+			frames.push_back(f);
+			continue;
+		}
+		userOf(rnd() % USERS, c);
+		f.typed = c.pwd && rnd() % 2;
+		f.code = f.typed ? c.pwd : c.tag;
+		frames.push_back(f);
+		if(c.att & DAEMON_IDANDPWD)
+		{
+			f.typed = !f.typed;
+			f.code = f.typed ? c.pwd : c.tag;
+			frames.push_back(f);
+		}
+	}
+}
+
+static bool load(DoorDaemon &d)
+{
+	DbChange	c;
+	DbReply		r;
+	DoorEvent	ev;
+	uint16_t	sent = 0, done = 0;
+
+	while(done < USERS)
+	{
+		if(sent < USERS)
+		{
+			userOf(sent, c);
+			if(d.change(c)){sent++;}
+		}
+		while(d.nextReply(r))
+		{
+			if(r.err){fprintf(stderr, "user %u: error %u\n", r.id, r.err); return false;}
+			done++;
+		}
+		while(d.nextEvent(ev)){}
+	}
+	return d.users() == USERS;																				// Replies follow the commit.
+}
+
+// Changes user "n" back and forth (attribute), one change per call.
+static void churn(DoorDaemon &d, uint32_t n)
+{
+	DbChange c;
+
+	userOf((n / 2) % USERS, c);
+	c.id = 0;
+	c.pwd = 0;
+	c.name[0] = 0;
+	c.hasDays = false;
+	if(n & 1){c.att ^= 0x08;}
+	d.change(c);
+}
+
+static Result run(uint8_t threads, double seconds, bool queued, const char *path)
+{
+	std::vector<std::vector<DoorFrame> >	frames(threads);
+	std::vector<std::thread>							pool;
+	std::atomic<bool>											stop(false);
+	DoorDaemon														d(path, SHARDS, DOORS, threads);
+	Result																res;
+	DoorEvent															ev;
+	DbReply																r;
+	uint32_t															changes = 0;
+	uint32_t															publishes;
+	uint32_t															batches;
+	uint64_t															start;
+
+	unlink(path);
+	if(!d.begin() || !load(d))
+	{
+		fprintf(stderr, "can not load the database\n");
+		d.end();
+		exit(1);
+	}
+	for(uint8_t t = 0; t < threads; t++){framesOf(t, threads, frames[t]);}
+	publishes = d.publishes();
+	batches = d.batches();
+
+	auto t0 = std::chrono::steady_clock::now();
+	auto next = t0;
+	start = d.decisions();
+	if(!queued)
+	{
+		for(uint8_t t = 0; t < threads; t++)
+		{
+			pool.push_back(std::thread([&, t]()
+			{
+				const std::vector<DoorFrame> &fr = frames[t];
+				uint64_t ms = 1;
+				uint32_t minutes = DoorDaemon::nowMinutes();
+				size_t i = 0;
+				DoorEvent tev;
+
+				while(!stop.load(std::memory_order_relaxed))
+				{
+					d.pin(t);
+					for(uint8_t n = 0; n < RUN; n++, i++){d.decide(t, fr[i % FRAMES], ms, minutes);}
+					d.unpin(t);
+					while(d.takeEvent(t, tev)){}
+					ms += DAEMON_LOCKMS + 1;																	// Lock-outs and entries end.
+				}
+			}));
+		}
+	}
+	else{d.startWorkers();}
+
+	std::vector<size_t> pos(threads, 0);
+	while(std::chrono::steady_clock::now() - t0 < std::chrono::duration<double>(seconds))
+	{
+		if(queued)
+		{
+			for(uint8_t t = 0; t < threads; t++)
+			{
+				for(uint8_t n = 0; n < RUN && d.submit(frames[t][pos[t] % FRAMES]); n++){pos[t]++;}
+			}
+		}
+		if(queued){while(d.nextEvent(ev)){}}														// Direct threads take their own.
+		while(d.nextReply(r)){}
+		if(std::chrono::steady_clock::now() >= next)
+		{
+			churn(d, changes++);
+			next += std::chrono::microseconds(CHANGEUS);
+		}
+		if(!queued){std::this_thread::yield();}
+	}
+	stop.store(true);
+	for(std::thread &th : pool){th.join();}
+	double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	res.rate = (d.decisions() - start) / sec;
+	d.end();
+	while(d.nextEvent(ev)){}
+	res.publishes = d.publishes() - publishes;
+	res.batches = d.batches() - batches;
+	res.dropped = d.dropped();
+	unlink(path);
+	return res;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned	maxThreads = std::thread::hardware_concurrency();
+	double		seconds = 1.0;
+	char			path[] = "/tmp/door_daemon_benchXXXXXX";
+	int				fd;
+	std::vector<uint8_t>	counts;
+	bool									dropped = false;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc){maxThreads = atoi(argv[++i]);}
+		else if(strcmp(argv[i], "--seconds") == 0 && i + 1 < argc){seconds = atof(argv[++i]);}
+		else{fprintf(stderr, "door_daemon_bench [--threads N] [--seconds S]\n"); return 2;}
+	}
+	if(maxThreads < 1){maxThreads = 1;}
+	if(maxThreads > DAEMON_WORKERS){maxThreads = DAEMON_WORKERS;}
+	for(unsigned t = 1; t < maxThreads; t <<= 1){counts.push_back(t);}
+	counts.push_back(maxThreads);
+	if((fd = mkstemp(path)) < 0){perror("mkstemp"); return 1;}
+	close(fd);
+	hostSerialOut(NULL);
+
+	printf("Door daemon benchmark, %u users in %u shards, %u doors, %u%% unknown codes, a change every %u us\n",
+		USERS, SHARDS, DOORS, UNKNOWN, CHANGEUS);
+	printf("%u hardware threads\n\n", std::thread::hardware_concurrency());
+	printf("%-7s %7s %14s %14s %10s %8s %8s\n", "mode", "threads", "decisions/s", "per_thread", "publishes", "batches", "dropped");
+	for(uint8_t q = 0; q < 2; q++)
+	{
+		for(uint8_t t : counts)
+		{
+			Result r = run(t, seconds, q, path);
+			printf("%-7s %7u %14.0f %14.0f %10u %8u %8llu%s\n", q ? "queued" : "direct", t, r.rate, r.rate / t,
+				r.publishes, r.batches, (unsigned long long)r.dropped, r.dropped ? " !" : "");
+			if(r.dropped){dropped = true;}
+		}
+	}
+	if(dropped){printf("\n! events dropped, the decisions per second include decisions whose event was lost\n");}
+	return dropped ? 1 : 0;
+}
@@ -0,0 +1,284 @@
+// EventCollector.cpp Rev 1.0
+
+// Rev 1.0	- Runs a controller EventLink on a SocketTransport against a local event collector on 127.0.0.1 (UDP or
+//						  TCP) in the same process. The virtual clock follows the wall clock. The collector acknowledges
+//						  the events received in order and may drop a share of the datagrams it receives (--loss). Reports
+//						  the delivery latency of events pushed at a steady rate, the throughput of a burst of events and
+//						  the round trip time of requests sent by the collector and answered by the controller.
+//						  Fails (exit 1) if an event is lost, duplicated or out of order once acknowledged.
+//
+//						  event_collector [udp|tcp] [--loss percent] [--hold ms]
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "HostShim.h"
+#include "JsonLine.h"
+#include "EventLink.h"
+#include "SocketTransport.h"
+
+#define RING								16						// Same event ring as the sketch.
+#define STEADY							400						// Events pushed at a steady rate.
+#define STEADYUS						5000					// us between steady events.
+#define BURST								5000					// Events pushed as fast as the ring allows.
+#define REQUESTS						200						// Collector requests.
+#define RESEND							100						// ms before the collector sends a request again.
+#define TIMEOUT							10000					// ms before a phase fails.
+
+static std::chrono::steady_clock::time_point	t0 = std::chrono::steady_clock::now();
+static uint64_t wallUs(){return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();}
+
+// COLLECTOR ------------------------------------------------------------------------------------------------------
+static bool								tcp = false;
+static unsigned						loss = 0;							// Percent of received datagrams dropped.
+static int								listenFd = -1;
+static int								fd = -1;							// UDP socket or accepted TCP connection.
+static sockaddr_in				peerAddr;
+static bool								peerKnown = false;
+static std::string				rx;										// Partial line.
+static uint32_t						expected = 0;					// Last event received in order.
+static uint32_t						dups = 0;							// Events received again.
+static bool								again = false;					// Event received again or after a gap, acknowledge again.
+static uint32_t						gaps = 0;							// Events received after a missing one.
+static uint32_t						datagrams = 0;
+static uint32_t						dropped = 0;					// Datagrams dropped (--loss).
+static std::vector<double>	latency;						// ms from push to receipt in order.
+static uint32_t						replyId = 0;					// Last reply received.
+static uint32_t						replyCnt = 0;
+
+static uint16_t openCollector()
+{
+	sockaddr_in	a;
+	socklen_t		len = sizeof(a);
+
+	memset(&a, 0, sizeof(a));
+	a.sin_family = AF_INET;
+	a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	listenFd = socket(AF_INET, (tcp ? SOCK_STREAM : SOCK_DGRAM) | SOCK_NONBLOCK, 0);
+	if(listenFd < 0 || bind(listenFd, (sockaddr *)&a, sizeof(a)) < 0 || (tcp && listen(listenFd, 1) < 0)){return 0;}
+	getsockname(listenFd, (sockaddr *)&a, &len);
+	if(!tcp){fd = listenFd;}
+	return ntohs(a.sin_port);
+}
+
+static void sendLine(const char *line)
+{
+	size_t n = strlen(line);
+
+	if(fd < 0){return;}
+	if(tcp){send(fd, line, n, MSG_NOSIGNAL);}
+	else if(peerKnown){sendto(fd, line, n, 0, (sockaddr *)&peerAddr, sizeof(peerAddr));}
+}
+
+static void line(const char *l)
+{
+	unsigned long	ev, k;
+
+	if(sscanf(l, "{\"ev\":%lu,\"age\":%*u,\"ty\":%*u,\"loc\":%*u,\"k\":%lu}", &ev, &k) == 2)
+	{
+		if(ev <= expected){dups++; again = true; return;}
+		if(ev != expected + 1){gaps++; again = true; return;}
+		expected = ev;
+		latency.push_back((uint32_t)((uint32_t)wallUs() - k) / 1000.0);
+		return;
+	}
+	if(sscanf(l, "{\"id\":%lu,\"cnt\":%lu", &ev, &k) == 2){replyId = ev; replyCnt = k;}
+}
+
+// Reads what the controller sent and acknowledges the events received in order.
+static void collect()
+{
+	char	buf[1024];
+	int		n;
+
+	if(tcp && fd < 0)
+	{
+		int one = 1;
+		fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK);
+		if(fd < 0){return;}
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	}
+	while(true)
+	{
+		sockaddr_in	from;
+		socklen_t		len = sizeof(from);
+
+		n = recvfrom(fd, buf, sizeof(buf), 0, (sockaddr *)&from, &len);
+		if(n <= 0){break;}
+		if(!tcp)
+		{
+			peerAddr = from;
+			peerKnown = true;
+			datagrams++;
+			if((unsigned)(rand() % 100) < loss){dropped++; continue;}
+		}
+		uint32_t before = expected;
+		rx.append(buf, n);
+		for(size_t nl; (nl = rx.find('\n')) != std::string::npos; rx.erase(0, nl + 1)){line(rx.substr(0, nl).c_str());}
+		if(expected != before || again)
+		{
+			snprintf(buf, sizeof(buf), "{\"ack\":%u}\n", expected);
+			sendLine(buf);
+			again = false;
+		}
+	}
+}
+
+// CONTROLLER -----------------------------------------------------------------------------------------------------
+static SocketTransport *	port;
+static AccessEvent				ring[RING];
+static EventLink *				evLink;
+static JsonLine						json;
+static uint32_t						requests = 0;					// Requests answered by the controller.
+
+// Answers {"id":N,"op":"cnt"} with the number of events pushed, as the sketch answers its protocol requests.
+static void frame(char *l)
+{
+	uint32_t id = 0;
+
+	if(!json.parse(l) || !json.num(F("id"), id)){return;}
+	requests++;
+	json.output(*port);
+	port->beginBatch();
+	json.begin(id);
+	json.add(F("cnt"), evLink->head());
+	json.end(0);
+	port->endBatch();
+	json.output(Serial);
+}
+
+// Moves the virtual clock to the wall clock, services the controller and the collector.
+static void step()
+{
+	uint64_t ms = wallUs() / 1000;
+
+	if(ms > hostNow() / 1000){hostAdvance(ms - hostNow() / 1000);}
+	port->maintain();
+	evLink->service();
+	collect();
+}
+
+// Services both ends until "done" returns true, returns the elapsed ms or -1 after "timeout" ms.
+template<class F> static double waitFor(F done, uint32_t timeout = TIMEOUT)
+{
+	uint64_t start = wallUs();
+
+	while(!done())
+	{
+		if(wallUs() - start > timeout * 1000ULL){return -1;}
+		step();
+		usleep(20);
+	}
+	return (wallUs() - start) / 1000.0;
+}
+
+static void report(const char *name, std::vector<double> &ms)
+{
+	std::sort(ms.begin(), ms.end());
+	printf("%-24s %6zu %10.3f %10.3f %10.3f\n", name, ms.size(), ms[ms.size() / 2], ms[ms.size() * 99 / 100], ms.back());
+}
+
+static bool fail(const char *what)
+{
+	printf("FAIL: %s\n", what);
+	return false;
+}
+
+static bool allAcked(){return evLink->acked() == evLink->head() && expected == evLink->head();}
+
+static bool run(uint16_t hold)
+{
+	std::vector<double>	ms;
+	double							t;
+
+	evLink->hold(hold);
+	if(waitFor([]{return port->connected();}) < 0){return fail("no connection");}
+	printf("%-24s %6s %10s %10s %10s\n", "phase (host ms)", "n", "p50", "p99", "max");
+
+	// Steady rate, one event every STEADYUS us.
+	for(uint16_t i = 0; i < STEADY; i++)
+	{
+		uint64_t next = wallUs() + STEADYUS;
+		if(waitFor([]{return evLink->head() - evLink->acked() < RING;}) < 0){return fail("steady rate stalled");}
+		evLink->push(EV_GRANTED, i & 1, (uint32_t)wallUs());
+		while(wallUs() < next){step(); usleep(20);}
+	}
+	if(waitFor(allAcked) < 0){return fail("steady events not delivered");}
+	report("event latency", latency);
+
+	// Burst, as fast as the ring allows.
+	latency.clear();
+	uint64_t start = wallUs();
+	for(uint32_t i = 0; i < BURST; i++)
+	{
+		if(waitFor([]{return evLink->head() - evLink->acked() < RING;}) < 0){return fail("burst stalled");}
+		evLink->push(EV_UNKNOWN, 0, (uint32_t)wallUs());
+	}
+	if(waitFor(allAcked) < 0){return fail("burst events not delivered");}
+	t = (wallUs() - start) / 1e6;
+	report("burst latency", latency);
+
+	// Requests of the collector, sent again every RESEND ms while not answered (lost datagram).
+	for(uint32_t i = 1; i <= REQUESTS; i++)
+	{
+		char		req[48];
+		uint64_t	sent = wallUs();
+
+		snprintf(req, sizeof(req), "{\"id\":%u,\"op\":\"cnt\"}\n", i);
+		while(true)
+		{
+			sendLine(req);
+			if(waitFor([i]{return replyId == i;}, RESEND) >= 0){break;}
+			if(wallUs() - sent > TIMEOUT * 1000ULL){return fail("request not answered");}
+		}
+		ms.push_back((wallUs() - sent) / 1000.0);
+		if(replyCnt != evLink->head()){return fail("wrong reply");}
+	}
+	report("request round trip", ms);
+
+	printf("\nBurst %u events in %.3f s: %.0f events/s, %u batches\n", BURST, t, BURST / t, evLink->batches());
+	printf("Events %u acknowledged %u, resent %u, received again %u, dropped %u\n", evLink->head(), evLink->acked(),
+		evLink->resent(), dups, evLink->dropped());
+	if(!tcp){printf("Datagrams %u, dropped by the collector %u, events after a gap %u\n", datagrams, dropped, gaps);}
+	if(expected != evLink->head() || evLink->dropped()){return fail("events lost");}
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	uint16_t	hold = 0;
+	uint16_t	p;
+	bool			ok;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "tcp") == 0){tcp = true;}
+		else if(strcmp(argv[i], "udp") == 0){tcp = false;}
+		else if(strcmp(argv[i], "--loss") == 0 && i + 1 < argc){loss = atoi(argv[++i]);}
+		else if(strcmp(argv[i], "--hold") == 0 && i + 1 < argc){hold = atoi(argv[++i]);}
+		else
+		{
+			fprintf(stderr, "usage: %s [udp|tcp] [--loss percent] [--hold ms]\n", argv[0]);
+			return 2;
+		}
+	}
+	hostSerialOut(NULL);
+	p = openCollector();
+	if(p == 0){perror("collector"); return 1;}
+	printf("Collector %s 127.0.0.1:%u, loss %u%%, hold %u ms\n\n", tcp ? "TCP" : "UDP", p, tcp ? 0 : loss, hold);
+	port = new SocketTransport("127.0.0.1", p, tcp);
+	evLink = new EventLink(ring, RING, *port);
+	evLink->setFrameHandler(frame);
+	port->begin();
+	ok = run(hold);
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? 0 : 1;
+}
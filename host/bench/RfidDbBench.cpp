@@ -0,0 +1,214 @@
+// RfidDbBench.cpp Rev 1.2
+
+// Rev 1.2	- Added RfidDbCompact ("cp" rows) and the number of users each database holds in the EEPROM area of
+//						  the sketch.
+// Rev 1.1	- Added the lookups and reads of RfidDbFixed ("fx" rows) on the same database.
+// Rev 1.0	- Microbenchmarks of the RfidDb operations at 10, 100 and 255 users. For each operation the host wall
+//						  time is reported with the EEPROM bytes read and written, the commits (database revision steps)
+//						  and the time the same accesses take on an ATmega2560. Host time only compares code paths,
+//						  the EEPROM counts and AVR time are the figures to compare between storage changes.
+
+#include <chrono>
+#include "HostShim.h"
+#include "EEPROM.h"
+#include "RfidDb.h"
+#include "RfidDbFixed.h"
+#include "RfidDbCompact.h"
+
+#define DBSTART							32						// Same layout as the sketch.
+#define NAMELENGTH					11
+#define DBEND								3879					// Sketch database area ends at "eAddrWear".
+#define REPEAT							5							// Runs of each operation, the fastest is reported.
+
+static const uint8_t userCounts[] = {10, 100, 255};
+
+struct Run
+{
+	double						ns;										// Host wall time of the run.
+	EEPROMStats				stats;
+	uint16_t					commits;
+};
+
+// Tag ID of user "i". Unique, non zero and with the facility code in bits 16-23 like a W26 tag.
+static uint32_t tagOf(uint16_t i){return 0x00A50000UL + i * 7919UL % 0xFFFF + 1;}
+static uint32_t pwdOf(uint16_t i){return 100000UL + i * 37UL;}
+
+static uint16_t						compactIndex[255];
+
+// EEPROM size for a RfidDb of "users".
+static uint16_t eepromSize(uint8_t users){return (users * (4 + 4 + NAMELENGTH + 1 + 4 + 1) + DBSTART + 2 + 1023) & ~1023;}
+
+// Erases the EEPROM and creates a database big enough for "users".
+static void freshEeprom(uint8_t users){EEPROM.resize(eepromSize(users));}
+
+// Fills a new database with "users" tag IDs, passwords and names.
+template<class Db> static void fill(Db &db, uint8_t users)
+{
+	char name[NAMELENGTH];
+	db.begin();
+	for(uint16_t i = 0; i < users; i++)
+	{
+		db.insertId(tagOf(i));
+		db.insertPwd(tagOf(i), pwdOf(i));
+		snprintf(name, sizeof(name), "USER%u", i);
+		db.insertIdNam(tagOf(i), name);
+	}
+}
+
+// Runs "op" with EEPROM and time accounting. "setup" prepares the database outside the measurement.
+template<class Db, class Setup, class Op> static Run measure(Db &db, Setup setup, Op op)
+{
+	Run best;
+	best.ns = 0;
+	for(uint8_t r = 0; r < REPEAT; r++)
+	{
+		setup();
+		uint16_t rev = db.revision();
+		EEPROM.resetStats();
+		auto t0 = std::chrono::steady_clock::now();
+		op();
+		auto t1 = std::chrono::steady_clock::now();
+		double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+		if(r == 0 || ns < best.ns)
+		{
+			best.ns = ns;
+			best.stats = EEPROM.stats;
+			best.commits = db.revision() - rev;
+		}
+	}
+	return best;
+}
+
+static void report(const char *op, uint8_t users, uint32_t ops, const Run &run)
+{
+	printf("%-13s %5u %6u %12.1f %10.1f %10.1f %10.2f %12.1f\n", op, users, ops, run.ns / ops,
+		(double)run.stats.reads / ops, (double)run.stats.writes / ops, (double)run.commits / ops,
+		(run.stats.writes * (double)HOST_EEPROM_WR_US + run.stats.reads * HOST_EEPROM_RD_US) / ops);
+	if(run.stats.faults){printf("  WARNING: %u EEPROM accesses outside the EEPROM\n", run.stats.faults);}
+}
+
+// Lookups of RfidDbFixed on a database of "Users" users filled through RfidDb.
+template<uint8_t Users> static void fixedRows(RfidDb &db, volatile int32_t &sink)
+{
+	RfidDbFixed<Users, DBSTART, NAMELENGTH> fx;
+	char name[NAMELENGTH];
+	auto filled = [&]{freshEeprom(Users); fill(db, Users);};
+
+	report("fx posOf hit", Users, Users, measure(fx, filled,
+		[&]{for(uint16_t i = 0; i < Users; i++){sink += fx.posOf(tagOf(i));}}));
+
+	report("fx posOf miss", Users, Users, measure(fx, filled,
+		[&]{for(uint16_t i = 0; i < Users; i++){sink += fx.posOf(0x00FF0000UL + i);}}));
+
+	report("fx readNam", Users, Users, measure(fx, filled,
+		[&]{for(uint16_t i = 0; i < Users; i++){sink += fx.readNam(i, name);}}));
+}
+
+// RfidDbCompact with the same users and EEPROM.
+static void compactRows(uint8_t users, volatile int32_t &sink)
+{
+	RfidDbCompact cp(compactIndex, users, DBSTART, eepromSize(users), NAMELENGTH);
+	char name[NAMELENGTH];
+	auto filled = [&]{freshEeprom(users); fill(cp, users);};
+
+	report("cp insertId", users, users, measure(cp, [&]{freshEeprom(users); cp.begin();},
+		[&]{for(uint16_t i = 0; i < users; i++){cp.insertId(tagOf(i));}}));
+
+	report("cp insertPwd", users, users, measure(cp, [&]{freshEeprom(users); cp.begin();
+		for(uint16_t i = 0; i < users; i++){cp.insertId(tagOf(i));}},
+		[&]{for(uint16_t i = 0; i < users; i++){cp.insertPwd(tagOf(i), pwdOf(i));}}));
+
+	report("cp posOf hit", users, users, measure(cp, filled,
+		[&]{for(uint16_t i = 0; i < users; i++){sink += cp.posOf(tagOf(i));}}));
+
+	report("cp posOf pwd", users, users, measure(cp, filled,
+		[&]{for(uint16_t i = 0; i < users; i++){sink += cp.posOf(pwdOf(i));}}));
+
+	report("cp posOf miss", users, users, measure(cp, filled,
+		[&]{for(uint16_t i = 0; i < users; i++){sink += cp.posOf(0x00FF0000UL + i);}}));
+
+	report("cp readNam", users, users, measure(cp, filled,
+		[&]{for(uint16_t i = 0; i < users; i++){sink += cp.readNam(i, name);}}));
+
+	report("cp removeId", users, users, measure(cp, [&]{filled(); for(uint16_t i = 0; i < users; i++)
+		{cp.removePwd(pwdOf(i));}},
+		[&]{for(uint16_t i = 0; i < users; i++){cp.removeId(tagOf(i));}}));
+}
+
+// Adds users with a tag ID, a 6 digit PIN and a name of "namLen" characters until the database is full.
+template<class Db> static uint16_t capacity(Db &db, uint8_t namLen)
+{
+	char			name[NAMELENGTH];
+	uint16_t	i;
+
+	EEPROM.resize(4096);
+	db.begin();
+	for(i = 0; i < 255; i++)
+	{
+		snprintf(name, sizeof(name), "%0*u", namLen, i);
+		if(!db.insertId(tagOf(i), pwdOf(i)) || !db.insertIdNam(tagOf(i), name)){break;}
+	}
+	return i;
+}
+
+int main()
+{
+	hostSerialOut(NULL);												// RfidDb prints progress messages.
+	printf("RfidDb benchmark, figures are per operation (best of %u runs)\n\n", REPEAT);
+	printf("%-13s %5s %6s %12s %10s %10s %10s %12s\n", "operation", "users", "ops", "host_ns", "ee_reads",
+		"ee_writes", "commits", "avr_us");
+
+	for(uint8_t u = 0; u < sizeof(userCounts); u++)
+	{
+		uint8_t		users = userCounts[u];
+		RfidDb		db(users, DBSTART, NAMELENGTH);
+		char			name[NAMELENGTH];
+		volatile int32_t sink = 0;
+
+		report("initDb", users, 1, measure(db, [&]{freshEeprom(users);}, [&]{db.begin();}));
+
+		report("insertId", users, users, measure(db, [&]{freshEeprom(users); db.begin();},
+			[&]{for(uint16_t i = 0; i < users; i++){db.insertId(tagOf(i));}}));
+
+		report("insertPwd", users, users, measure(db, [&]{freshEeprom(users); db.begin();
+			for(uint16_t i = 0; i < users; i++){db.insertId(tagOf(i));}},
+			[&]{for(uint16_t i = 0; i < users; i++){db.insertPwd(tagOf(i), pwdOf(i));}}));
+
+		auto filled = [&]{freshEeprom(users); fill(db, users);};
+		report("posOf hit", users, users, measure(db, filled,
+			[&]{for(uint16_t i = 0; i < users; i++){sink += db.posOf(tagOf(i));}}));
+
+		report("posOf pwd", users, users, measure(db, filled,
+			[&]{for(uint16_t i = 0; i < users; i++){sink += db.posOf(pwdOf(i));}}));
+
+		report("posOf miss", users, users, measure(db, filled,
+			[&]{for(uint16_t i = 0; i < users; i++){sink += db.posOf(0x00FF0000UL + i);}}));
+
+		report("posOf24", users, users, measure(db, filled,
+			[&]{for(uint16_t i = 0; i < users; i++){sink += db.posOf24(tagOf(i) | 0xAB000000UL);}}));
+
+		report("readNam", users, users, measure(db, filled,
+			[&]{for(uint16_t i = 0; i < users; i++){sink += db.readNam(i, name);}}));
+
+		if(users == 10){fixedRows<10>(db, sink);}								// 255 users do not fit in 4KB EEPROM.
+		else if(users == 100){fixedRows<100>(db, sink);}
+
+		report("removeId", users, users, measure(db, [&]{filled(); for(uint16_t i = 0; i < users; i++)
+			{db.removePwd(pwdOf(i));}},
+			[&]{for(uint16_t i = 0; i < users; i++){db.removeId(tagOf(i));}}));
+
+		compactRows(users, sink);
+		printf("\n");
+	}
+
+	printf("Users held in the sketch database area (EEPROM %u to %u), each with a tag ID, a 6 digit PIN and a name\n",
+		DBSTART, DBEND);
+	for(uint8_t namLen = 0; namLen < NAMELENGTH; namLen += 5)
+	{
+		RfidDb				db((uint16_t)DBEND, (uint16_t)DBSTART, (uint8_t)NAMELENGTH);
+		RfidDbCompact	cp(compactIndex, 255, DBSTART, DBEND, NAMELENGTH);
+		printf("  name of %2u characters: RfidDb %3u, RfidDbCompact %3u\n", namLen, capacity(db, namLen),
+			capacity(cp, namLen));
+	}
+	return 0;
+}
@@ -0,0 +1,579 @@
+// ScenarioRunner.cpp Rev 1.3
+
+// Rev 1.3	- Entries lost because their frame met another on the shared bus are counted apart from those the
+//						  controller lost. Each scenario, idle included, has a budget for the decision latency, the
+//						  entries the controller lost, the longest loop pass and the longest relock lag.
+// Rev 1.2	- Console input goes through the 64 byte receive buffer of the AVR (HOST_UART_RX). A scenario fails if
+//						  a character is dropped, the admin scenario also sends machine protocol requests.
+// Rev 1.1	- The ADC conversions the sampler starts complete at once after each timer tick (ADC_vect).
+// Rev 1.0	- Runs the whole sketch (setup, loop and the timer and pin change ISRs) on the virtual clock and drives
+//						  it with scripted, timestamped input: Wiegand tag and keypad frames sent bit by bit on the shared
+//						  D0/D1 lines, the keypad location pins, buttons, garage door position switches, PIR motion and
+//						  console commands. Blocking work takes its ATmega2560 time (UART at 115200 baud with a 64 byte
+//						  transmit buffer, EEPROM writes, I2C transfers to the RTC and OLED, delay()) and every pass of
+//						  loop() takes SIM_LOOP_US more.
+//						- Access decisions are read from the log the controller prints. For each scenario the runner
+//						  reports grant / deny latency from the last bit of the entry, entries lost without a decision,
+//						  Wiegand frames sent while another was on the bus, the lag between an unlock delay expiring and
+//						  the door locking, and the loop() time distribution. Each scenario runs in its own process from
+//						  the same provisioned controller, so the results are repeatable.
+//						- With --gate the run fails if a scenario goes over its budget. --log prints what the controller
+//						  prints during the scenarios to stderr.
+
+#include <vector>
+#include <queue>
+#include <deque>
+#include <string>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "HostShim.h"
+#include "EEPROM.h"
+
+// Prototypes the Arduino IDE generates for the sketch.
+void drawHdr(char *msg);
+void drawMsg(uint8_t fnt, uint8_t fntSiz, uint8_t xPos, uint8_t yPos, char *msg);
+void drawRev();
+bool readEncoder();
+void singlePressGarDrWalSw();
+void longPressGarDrWalSw();
+void eraseEeprom(uint16_t eepStart, uint16_t eepEnd, uint8_t fillVal);
+
+#include "RFID_LOCK_V1110a.ino"
+
+#define SIM_LOOP_US					100						// Estimated AVR time of a pass of loop() with nothing to do.
+#define SIM_TIMER_US				8333					// Timer1 overflow period (120Hz).
+#define SIM_BAUD						115200
+#define SIM_USERS						24
+#define WG_PULSE_US					50						// Wiegand data pulse width.
+#define WG_BIT_US						2000					// Wiegand bit period.
+#define WG_QUIET_US					25000					// Gap that ends a frame (see WIEGAND::DoWiegandConversion).
+#define WG_LOC_US						1000					// Keypad location pin set before the first bit of a frame.
+#define KEY_GAP_MS					300						// Time between key presses of a PIN entry.
+#define DRAIN_MS						10000					// Run time after the last scripted input.
+#define GARDR_TRAVEL_MS			12000					// Garage door travel time between the position switches.
+
+enum SIMEV																				// Scripted input event types.
+{
+	SIM_PIN,																				// Drive "pin" to "val".
+	SIM_KPLOC,																			// Drive a keypad location pin and run the PCINT0 ISR.
+	SIM_ENTRYEND,																		// Last bit of entry "arg" has been sent.
+	SIM_CLI																					// Console command "arg" is typed.
+};
+
+struct SimEvent
+{
+	uint64_t					at;
+	uint32_t					seq;													// Keeps events at the same time in script order.
+	uint8_t						kind;
+	uint8_t						pin;
+	uint8_t						val;
+	uint32_t					arg;
+
+	bool operator>(const SimEvent &e) const{return at != e.at ? at > e.at : seq > e.seq;}
+};
+
+enum ENTRYRESULT
+{
+	ENTRY_PENDING,
+	ENTRY_GRANTED,
+	ENTRY_DENIED,
+	ENTRY_LOST,																			// No decision, frame lost or merged on the bus.
+	ENTRY_LOCKEDOUT																	// Sent to a locked out keypad, ignored by design.
+};
+
+struct Entry
+{
+	uint8_t						loc;
+	uint8_t						result;
+	uint64_t					endUs;
+	bool							collided;											// A frame of the entry met another on the bus.
+};
+
+struct WgFrame
+{
+	uint64_t					first;												// First and last bit.
+	uint64_t					last;
+	uint32_t					entry;
+
+	bool operator<(const WgFrame &f) const{return first < f.first;}
+};
+
+struct Budget
+{
+	uint32_t					latP99Ms;											// Decision latency, 99th percentile.
+	uint32_t					lost;													// Entries without a decision and no collision on the bus.
+	uint32_t					busyMs;												// Longest loop pass.
+	uint32_t					relockMs;											// Longest relock lag.
+};
+
+struct Scenario
+{
+	const char *			name;
+	const char *			title;
+	void							(*script)();
+	Budget						budget;
+};
+
+static std::priority_queue<SimEvent, std::vector<SimEvent>, std::greater<SimEvent> > events;
+static uint32_t						eventSeq;
+static std::vector<Entry>	entries;
+static std::vector<std::string> cliLines;
+static std::deque<uint32_t> pending[SHEDDRKEYPD + 1];		// Entries waiting for a decision, per keypad.
+static std::vector<WgFrame> frames;											// Each Wiegand frame, in script order.
+static uint32_t						unmatched;										// Decisions no entry was waiting for.
+static std::vector<uint64_t> latency;
+static std::vector<uint64_t> relockLag;
+static std::vector<uint64_t> loopBusy;									// Loop passes longer than SIM_LOOP_US.
+static uint64_t						loopIdle;
+static uint64_t						drExpAt[DOORCOUNT];						// When the unlock delay of each door expired.
+static uint8_t						garRelay;
+static bool								garOpen;
+static uint32_t						rng;
+static char								logLine[200];
+static uint8_t						logLen;
+
+static const uint8_t			kpLocPin[] = {0, frtDrKeyPdPin, garDrKeyPdPin, rearDrKeyPdPin};
+
+static uint32_t tagOf(uint16_t i){return 0x00A50000UL + i * 7919UL % 0xFFFF + 1;}
+static uint32_t pwdOf(uint16_t i){return 100000UL + i * 37UL;}
+
+static uint32_t random32()																// xorshift32.
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+static uint32_t randomMs(uint32_t lo, uint32_t hi){return lo + random32() % (hi - lo + 1);}
+
+// EVENTS ---------------------------------------------------------------------------------------------------------
+static void schedule(uint64_t at, uint8_t kind, uint8_t pin, uint8_t val, uint32_t arg)
+{
+	events.push(SimEvent{at, eventSeq++, kind, pin, val, arg});
+}
+
+static uint64_t nextEvent(){return events.empty() ? HOST_NEVER : events.top().at;}
+
+static void runEvents()
+{
+	while(!events.empty() && events.top().at <= hostNow())
+	{
+		SimEvent ev = events.top();
+		events.pop();
+		switch(ev.kind)
+		{
+			case SIM_PIN:
+				hostPin(ev.pin, ev.val);
+			break;
+
+			case SIM_KPLOC:
+				hostPin(ev.pin, ev.val);
+				PCINT0_vect();
+			break;
+
+			case SIM_ENTRYEND:
+			{
+				Entry &e = entries[ev.arg];
+				e.endUs = hostNow();
+				if(kpSession[e.loc].retryCnt >= EEPROM.read(eAddrRetryCnt)){e.result = ENTRY_LOCKEDOUT;}
+				else{pending[e.loc].push_back(ev.arg);}
+			}
+			break;
+
+			case SIM_CLI:
+				Serial.inject(cliLines[ev.arg].c_str());
+			break;
+		}
+	}
+}
+
+// Sends "count" bits of "bits" (MSB first) from keypad "loc" starting at "at". Returns the time of the last bit.
+static uint64_t wgFrame(uint64_t at, uint8_t loc, uint32_t bits, uint8_t count)
+{
+	uint64_t end = at + (uint64_t)(count - 1) * WG_BIT_US;
+
+	frames.push_back(WgFrame{at, end, (uint32_t)entries.size()});		// Entry finished after its frames.
+	schedule(at - WG_LOC_US, SIM_KPLOC, kpLocPin[loc], LOW, 0);
+	for(uint8_t i = 0; i < count; i++)
+	{
+		uint8_t pin = (bits >> (count - 1 - i)) & 1 ? D1APin : D0APin;
+		schedule(at + (uint64_t)i * WG_BIT_US, SIM_PIN, pin, LOW, 0);
+		schedule(at + (uint64_t)i * WG_BIT_US + WG_PULSE_US, SIM_PIN, pin, HIGH, 0);
+	}
+	schedule(end + 5000, SIM_KPLOC, kpLocPin[loc], HIGH, 0);
+	return end;
+}
+
+static void entryEnd(uint64_t at, uint8_t loc)
+{
+	entries.push_back(Entry{loc, ENTRY_PENDING, 0, false});
+	schedule(at, SIM_ENTRYEND, 0, 0, entries.size() - 1);
+}
+
+// W26 frame: even parity of the first 12 data bits, 24 data bits, odd parity of the last 12.
+static void swipe(uint64_t at, uint8_t loc, uint32_t tag)
+{
+	uint32_t data = tag & 0xFFFFFF;
+	uint32_t frame = (__builtin_parity(data >> 12) << 25) | (data << 1) | !__builtin_parity(data & 0xFFF);
+	entryEnd(wgFrame(at, loc, frame, 26), loc);
+}
+
+// One W4 frame per digit followed by "#" (0x0B).
+static void keyIn(uint64_t at, uint8_t loc, uint32_t pwd)
+{
+	char digits[11];
+	uint64_t end = at;
+
+	snprintf(digits, sizeof(digits), "%lu", (unsigned long)pwd);
+	for(uint8_t i = 0; digits[i]; i++)
+	{
+		wgFrame(at, loc, digits[i] - '0', 4);
+		at += KEY_GAP_MS * 1000ULL;
+	}
+	end = wgFrame(at, loc, 0x0B, 4);
+	entryEnd(end, loc);
+}
+
+static void press(uint64_t at, uint8_t pin, uint32_t ms)
+{
+	schedule(at, SIM_PIN, pin, LOW, 0);
+	schedule(at + ms * 1000ULL, SIM_PIN, pin, HIGH, 0);
+}
+
+static void cli(uint64_t at, const char *line)
+{
+	cliLines.push_back(std::string(line) + "\r");
+	schedule(at, SIM_CLI, 0, 0, cliLines.size() - 1);
+}
+
+// CONTROLLER OBSERVATION -----------------------------------------------------------------------------------------
+static bool endsWith(const char *s){size_t n = strlen(s); return logLen >= n && memcmp(logLine + logLen - n, s, n) == 0;}
+
+// The entry decided is the last one finished at the keypad the controller took the frame from. Entries before it
+// at the same keypad which are still waiting were lost (frame overwritten while the loop was blocked).
+static void decision(uint8_t result)
+{
+	uint8_t loc = keyPdLoc <= SHEDDRKEYPD ? keyPdLoc : (uint8_t)NOKEYPD;
+
+	if(pending[loc].empty()){unmatched++; return;}
+	Entry &e = entries[pending[loc].back()];
+	pending[loc].pop_back();
+	e.result = result;
+	latency.push_back(hostNow() - e.endUs);
+	for(uint32_t i : pending[loc]){entries[i].result = ENTRY_LOST;}
+	pending[loc].clear();
+}
+
+static void logTap(char c)
+{
+	if(c == '\n'){logLen = 0; return;}
+	if(logLen == sizeof(logLine))															// Keep the end of long lines.
+	{
+		memmove(logLine, logLine + sizeof(logLine) / 2, sizeof(logLine) / 2);
+		logLen = sizeof(logLine) / 2;
+	}
+	logLine[logLen++] = c;
+	if(endsWith(" IS UNLOCKING") || endsWith(" IS LOCKING")){decision(ENTRY_GRANTED);}
+	else if(endsWith(" DOES NOT PERMISSION") || endsWith(" IS OUTSIDE THE HOURS") ||
+		endsWith("NOT FOUND IN DATBASE") || endsWith("DO NOT MATCH")){decision(ENTRY_DENIED);}
+}
+
+// Timer1 ISR and the ADC conversions it starts, also notes unlock delays expiring and moves the garage door when the opener relay is pulsed.
+static void simTimer()
+{
+	uint8_t before = drLckExp;
+
+	TIMER1_OVF_vect();
+	while(ADCSRA & (1 << ADSC))																// Conversions started by the sampler, done at once.
+	{
+		ADCSRA &= ~(1 << ADSC);
+		ADC = analogRead(A0 + ((ADMUX & 0x07) | ((ADCSRB & (1 << MUX5)) ? 8 : 0)));
+		ADC_vect();
+	}
+	for(uint8_t i = 0; i < DOORCOUNT; i++)
+	{
+		if((drLckExp & ~before) & (1 << i)){drExpAt[i] = hostNow();}
+	}
+	uint8_t relay = hostPort[garDrOpnPin];
+	if(relay && !garRelay)
+	{
+		uint64_t now = hostNow();
+		uint8_t leave = garOpen ? garDrUpSwPin : garDrDnSwPin;
+		uint8_t reach = garOpen ? garDrDnSwPin : garDrUpSwPin;
+		schedule(now + 1000000ULL, SIM_PIN, leave, HIGH, 0);
+		schedule(now + GARDR_TRAVEL_MS * 1000ULL, SIM_PIN, reach, LOW, 0);
+		garOpen = !garOpen;
+	}
+	garRelay = relay;
+}
+
+static void loopPass()
+{
+	uint64_t t0 = hostNow();
+
+	loop();
+	hostBusy(SIM_LOOP_US);
+	uint64_t dt = hostNow() - t0;
+	if(dt > SIM_LOOP_US){loopBusy.push_back(dt);}
+	else{loopIdle++;}
+	for(uint8_t i = 0; i < DOORCOUNT; i++)
+	{
+		if(drExpAt[i] && !(drLckExp & (1 << i)))
+		{
+			relockLag.push_back(hostNow() - drExpAt[i]);
+			drExpAt[i] = 0;
+		}
+	}
+}
+
+// SCENARIOS ------------------------------------------------------------------------------------------------------
+static uint64_t scriptStart;
+static uint64_t scriptEnd;
+
+static uint64_t atMs(uint32_t ms){return scriptStart + ms * 1000ULL;}
+
+// An ordinary user, a user without rear and garage door access, or someone unknown.
+static void entry(uint64_t at, uint8_t loc)
+{
+	uint32_t pick = random32() % 100;
+	uint16_t user = random32() % SIM_USERS;
+	bool			pin = random32() % 100 < 30;
+
+	if(pick < 8)
+	{
+		if(pin){keyIn(at, loc, 900000UL + random32() % 99999);}
+		else{swipe(at, loc, 0x00F00000UL + random32() % 0xFFFF);}
+		return;
+	}
+	if(pick < 13){user = SIM_USERS - 1 - random32() % 4;}
+	if(pin){keyIn(at, loc, pwdOf(user));}
+	else{swipe(at, loc, tagOf(user));}
+}
+
+// Display on all the time and nothing else.
+static void scriptIdle()
+{
+	scriptEnd = atMs(120000);
+	for(uint32_t ms = 0; ms < 120000; ms += 5000)
+	{
+		schedule(atMs(ms), SIM_PIN, pirPin, HIGH, 0);
+		schedule(atMs(ms + 1000), SIM_PIN, pirPin, LOW, 0);
+	}
+}
+
+// Arrivals at the front, garage and rear keypads, tags and PINs, garage door cycles, bells, an admin reading
+// the controller from the console and people walking past the PIR.
+static void scriptRush()
+{
+	static const char *adminCmds[] = {"rvb", "rip 999", "rac", "rtm", "rgs", "rle"};
+	uint32_t	len = 600000;
+
+	scriptEnd = atMs(len);
+	for(uint8_t loc = FRTDRKEYPD; loc <= REARDRKEYPD; loc++)
+	{
+		for(uint32_t ms = randomMs(0, 5000); ms < len; ms += randomMs(6000, 30000)){entry(atMs(ms), loc);}
+	}
+	for(uint32_t ms = randomMs(20000, 60000); ms < len; ms += randomMs(60000, 120000)){press(atMs(ms), garDrWalSwPin, 600);}
+	for(uint32_t ms = randomMs(30000, 90000); ms < len; ms += randomMs(60000, 180000)){press(atMs(ms), frtBelBtnPin, 600);}
+	for(uint32_t ms = randomMs(10000, 30000); ms < len; ms += randomMs(20000, 40000))
+	{
+		cli(atMs(ms), adminCmds[random32() % (sizeof(adminCmds) / sizeof(adminCmds[0]))]);
+	}
+	for(uint32_t ms = 0; ms < len; ms += randomMs(5000, 20000))
+	{
+		schedule(atMs(ms), SIM_PIN, pirPin, HIGH, 0);
+		schedule(atMs(ms + 1000), SIM_PIN, pirPin, LOW, 0);
+	}
+}
+
+// The three keypads used within a few milliseconds of each other, frames collide on the shared Wiegand lines.
+static void scriptBurst()
+{
+	scriptEnd = atMs(120000);
+	for(uint32_t ms = 1000; ms < 120000; ms += 4000)
+	{
+		for(uint8_t loc = FRTDRKEYPD; loc <= REARDRKEYPD; loc++)
+		{
+			swipe(atMs(ms + randomMs(0, 300)), loc, tagOf(random32() % (SIM_USERS - 4)));
+		}
+	}
+}
+
+// Long console listings (user list, EEPROM dump) while people come in.
+static void scriptAdmin()
+{
+	static const char *adminCmds[] = {"rip 999", "rep", "rvb", "rew", "{\"id\":17,\"op\":\"get\",\"tag\":1193046}"};
+	uint32_t	len = 180000;
+
+	scriptEnd = atMs(len);
+	for(uint8_t loc = FRTDRKEYPD; loc <= REARDRKEYPD; loc++)
+	{
+		for(uint32_t ms = randomMs(0, 3000); ms < len; ms += randomMs(5000, 15000)){entry(atMs(ms), loc);}
+	}
+	for(uint32_t ms = 2000, i = 0; ms < len; ms += 10000, i++)
+	{
+		cli(atMs(ms), adminCmds[i % (sizeof(adminCmds) / sizeof(adminCmds[0]))]);
+	}
+}
+
+// Budgets are the results of Rev 1.3 of the runner against sketch Rev 1.1.11 with a margin: p99 latency, entries
+// lost by the controller, longest loop pass (OLED refresh 53 ms, console listings), longest relock lag (ms).
+static const Scenario scenarios[] =
+{
+	{"idle",	"display refresh only, 2 min",										scriptIdle,		{100,	0,	75,		75}},
+	{"rush",	"morning rush, 3 keypads, garage, CLI, 10 min",		scriptRush,		{100,	0,	450,	75}},
+	{"burst",	"simultaneous swipes on 3 keypads, 2 min",				scriptBurst,	{100,	0,	75,		75}},
+	{"admin",	"console listings during entries, 3 min",					scriptAdmin,	{100,	0,	2000,	75}},
+};
+
+// REPORT ---------------------------------------------------------------------------------------------------------
+static double pct(std::vector<uint64_t> &v, double p)
+{
+	if(v.empty()){return 0;}
+	size_t k = (size_t)(p / 100.0 * (v.size() - 1));
+	std::nth_element(v.begin(), v.begin() + k, v.end());
+	return v[k];
+}
+
+static double maxOf(const std::vector<uint64_t> &v){return v.empty() ? 0 : *std::max_element(v.begin(), v.end());}
+
+// Frames starting before the bus has been quiet for WG_QUIET_US are merged with the frame before them, and a frame
+// whose keypad location pin changes before the frame before it was converted is taken for one of its keypad. Marks
+// the entries of both frames as collided, their loss is not the controller's.
+static uint32_t collisions()
+{
+	uint32_t	n = 0;
+	uint64_t	busFree = 0;
+	uint32_t	busEntry = 0;
+
+	std::sort(frames.begin(), frames.end());
+	for(size_t i = 0; i < frames.size(); i++)
+	{
+		if(i && frames[i].first <= busFree + WG_QUIET_US + WG_LOC_US)
+		{
+			n++;
+			entries[frames[i].entry].collided = true;
+			entries[busEntry].collided = true;
+		}
+		if(frames[i].last >= busFree){busFree = frames[i].last; busEntry = frames[i].entry;}
+	}
+	return n;
+}
+
+// Runs one scenario from the provisioned controller. Returns false if it went over its budget.
+static bool run(const Scenario &sc)
+{
+	uint32_t count[ENTRY_LOCKEDOUT + 1] = {0};
+	uint32_t lostBus = 0;
+
+	rng = 0x1234567 ^ (uint32_t)strlen(sc.name) * 0x9E3779B9;
+	scriptStart = hostNow() + 1000000ULL;
+	sc.script();
+	while(hostNow() < scriptEnd + DRAIN_MS * 1000ULL){loopPass();}
+	uint32_t busFrames = collisions();
+	for(Entry &e : entries)
+	{
+		if(e.result == ENTRY_PENDING){e.result = ENTRY_LOST;}
+		if(e.result == ENTRY_LOST && e.collided){lostBus++;}
+		count[e.result]++;
+	}
+
+	double		latP99 = pct(latency, 99) / 1000;
+	double		busyMax = maxOf(loopBusy) / 1000;
+	double		relockMax = maxOf(relockLag) / 1000;
+	uint32_t	lostLoop = count[ENTRY_LOST] - lostBus;
+	uint32_t	rxDropped = hostSerialDropped();
+	bool			pass = latP99 <= sc.budget.latP99Ms && lostLoop <= sc.budget.lost && busyMax <= sc.budget.busyMs &&
+		relockMax <= sc.budget.relockMs && !rxDropped;
+	size_t		over10 = std::count_if(loopBusy.begin(), loopBusy.end(), [](uint64_t t){return t > 10000;});
+
+	printf("%s: %s\n", sc.name, sc.title);
+	printf("  entries %u: %u granted, %u denied, %u lost (%u on the bus, %u by the loop), %u locked out, "
+		"%u decisions unmatched\n", (unsigned)entries.size(), count[ENTRY_GRANTED], count[ENTRY_DENIED], count[ENTRY_LOST],
+		lostBus, lostLoop, count[ENTRY_LOCKEDOUT], unmatched);
+	printf("  wiegand frames %u, %u sent while the bus was busy\n", (unsigned)frames.size(), busFrames);
+	printf("  decision latency ms    p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f\n", pct(latency, 50) / 1000,
+		pct(latency, 90) / 1000, latP99, maxOf(latency) / 1000);
+	printf("  relock lag ms          p50 %8.1f  p99 %8.1f  max %8.1f  (%u relocks)\n", pct(relockLag, 50) / 1000,
+		pct(relockLag, 99) / 1000, relockMax, (unsigned)relockLag.size());
+	printf("  busy loop passes ms    p50 %8.1f  p99 %8.1f  max %8.1f  (%u of %llu passes, %u over 10ms)\n",
+		pct(loopBusy, 50) / 1000, pct(loopBusy, 99) / 1000, busyMax, (unsigned)loopBusy.size(),
+		(unsigned long long)(loopBusy.size() + loopIdle), (unsigned)over10);
+	printf("  eeprom writes %u, oled refreshes %u, console characters dropped %u\n", EEPROM.stats.writes, oled.refreshes,
+		rxDropped);
+	printf("  budget p99 latency %u ms, lost by the loop %u, busy pass %u ms, relock lag %u ms, no console input "
+		"dropped: %s\n", sc.budget.latP99Ms, sc.budget.lost, sc.budget.busyMs, sc.budget.relockMs, pass ? "PASS" : "FAIL");
+	printf("\n");
+	return pass;
+}
+
+// Starts the controller with an erased EEPROM and adds the users.
+static void provision()
+{
+	EEPROM.resize(EEPROMSIZE);
+	setup();
+	for(uint16_t i = 0; i < SIM_USERS; i++)
+	{
+		char name[NAMELENGTH];
+		uint8_t att = PERMACCESS | FRTDRLOCK | GARDRLOCK | REARDRLOCK;
+		if(i >= SIM_USERS - 4){att = PERMACCESS | FRTDRLOCK;}
+		db.insertId(tagOf(i));
+		db.insertPwd(tagOf(i), pwdOf(i));
+		snprintf(name, sizeof(name), "USER%u", i);
+		db.insertIdNam(tagOf(i), name);
+		db.insertAtt(tagOf(i), att);
+	}
+	hostPin(garDrDnSwPin, LOW);											// Garage door closed.
+	for(uint8_t loc = FRTDRKEYPD; loc <= REARDRKEYPD; loc++){hostPin(kpLocPin[loc], HIGH);}
+	hostPin(D0APin, HIGH);
+	hostPin(D1APin, HIGH);
+	hostAdvance(1000);
+	loop();
+}
+
+int main(int argc, char **argv)
+{
+	bool	gate = false;
+	bool	log = false;
+	int		failed = 0;
+	std::vector<const char *> names;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--gate") == 0){gate = true;}
+		else if(strcmp(argv[i], "--log") == 0){log = true;}
+		else{names.push_back(argv[i]);}
+	}
+	hostSerialOut(NULL);
+	provision();
+	printf("Scenario runner, virtual ATmega2560 time (loop pass %u us, UART %u baud, EEPROM write %u us, I2C)\n\n",
+		SIM_LOOP_US, SIM_BAUD, HOST_EEPROM_WR_US);
+
+	for(const Scenario &sc : scenarios)
+	{
+		if(!names.empty() && std::find_if(names.begin(), names.end(),
+			[&](const char *n){return strcmp(n, sc.name) == 0;}) == names.end()){continue;}
+		fflush(stdout);
+		pid_t pid = fork();
+		if(pid == 0)
+		{
+			EEPROM.resetStats();
+			EEPROM.timing = true;
+			hostSerialBaud(SIM_BAUD);
+			hostSerialTap(logTap);
+			hostSerialOut(log ? stderr : NULL);
+			hostEvents(nextEvent, runEvents);
+			hostTimer(simTimer, SIM_TIMER_US);
+			bool pass = run(sc);
+			fflush(stdout);
+			_exit(pass ? 0 : 1);
+		}
+		int status = 1;
+		waitpid(pid, &status, 0);
+		if(!WIFEXITED(status) || WEXITSTATUS(status) != 0){failed++;}
+	}
+	if(gate && failed){printf("%d scenario(s) over budget\n", failed); return 1;}
+	return 0;
+}
@@ -0,0 +1,95 @@
+// CredIndex.cpp Rev 1.0 (host daemon)
+
+#include "CredIndex.h"
+
+CredIndex::CredIndex()
+{
+	_gen.store(1);
+	_publishes = 0;
+	for(uint8_t r = 0; r < CRED_READERS; r++){_pin[r].gen.store(CRED_IDLE);}
+	for(uint8_t p = 0; p < CRED_PARTS; p++)
+	{
+		Table *t = new Table;
+		t->mask = 0;
+		t->gen = 0;
+		t->slots.assign(1, Cred());
+		_part[p].store(t);
+	}
+}
+
+CredIndex::~CredIndex()
+{
+	for(uint8_t p = 0; p < CRED_PARTS; p++){delete _part[p].load();}
+	for(Table *t : _retired){delete t;}
+}
+
+// The pin is stored before any table pointer is loaded (both sequentially consistent), so a table loaded after
+// pin() was replaced at a generation above the pin and reclaim() keeps it.
+void CredIndex::pin(uint8_t reader){_pin[reader].gen.store(_gen.load());}
+
+bool CredIndex::find(uint32_t key, Cred &c)
+{
+	uint32_t	h = hash(key);
+	Table			*t = _part[h >> (32 - 4)].load();
+
+	if(key == 0){return false;}
+	for(uint32_t i = (h ^ (h >> 16)) & t->mask;; i = (i + 1) & t->mask)			// Linear probing, tables are never full.
+	{
+		const Cred &s = t->slots[i];
+		if(s.key == key){c = s; return true;}
+		if(s.key == 0){return false;}
+	}
+}
+
+void CredIndex::publish(uint8_t p, const std::vector<Cred> &creds)
+{
+	Table			*t = new Table;
+	uint32_t	size = 2;
+
+	while(size < creds.size() * 2){size <<= 1;}													// At most half full.
+	t->mask = size - 1;
+	t->gen = 0;
+	t->slots.assign(size, Cred());
+	for(const Cred &c : creds)
+	{
+		uint32_t h = hash(c.key);
+		uint32_t i = (h ^ (h >> 16)) & t->mask;
+		while(t->slots[i].key != 0){i = (i + 1) & t->mask;}
+		t->slots[i] = c;
+	}
+	Table *old = _part[p].exchange(t);
+	old->gen = _gen.fetch_add(1) + 1;																// Readers pinned below this may hold it.
+	_retired.push_back(old);
+	_publishes++;
+}
+
+void CredIndex::reclaim()
+{
+	uint64_t gen;
+
+	if(_retired.empty()){return;}
+	gen = low();
+	for(size_t i = 0; i < _retired.size();)
+	{
+		if(_retired[i]->gen <= gen)
+		{
+			delete _retired[i];
+			_retired[i] = _retired.back();
+			_retired.pop_back();
+		}
+		else{i++;}
+	}
+}
+
+// low Method (PRIVATE)-------------------------------------------------------------------------------------------
+uint64_t CredIndex::low()
+{
+	uint64_t low = CRED_IDLE;
+
+	for(uint8_t r = 0; r < CRED_READERS; r++)
+	{
+		uint64_t g = _pin[r].gen.load();
+		if(g < low){low = g;}
+	}
+	return low;
+}
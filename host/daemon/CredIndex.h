@@ -0,0 +1,93 @@
+// CredIndex.h Rev 1.0 (host daemon)
+
+// Rev 1.0	- Credential index shared by the worker threads of the door daemon without locks. Each tag ID and
+//						  password of the database has an entry (user position, attribute, schedule byte, time stamp)
+//						  in an open addressing hash table. The keys are spread over CRED_PARTS partitions by hash, each
+//						  partition is an immutable table published through an atomic pointer, so a change only rebuilds
+//						  the partitions of the keys it touched.
+//						- One writer thread publishes. Readers pin() before a run of lookups and unpin() after it. A
+//						  replaced table is kept until every reader has pinned again since it was replaced (or is not
+//						  pinned), then reclaim() frees it. Readers never wait and never write a shared cache line other
+//						  than their own pin.
+
+#ifndef _CREDINDEX_H
+#define _CREDINDEX_H
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CRED_PARTS					16						// Partitions (power of 2).
+#define CRED_READERS				64						// Most reader threads.
+#define CRED_IDLE						UINT64_MAX		// Pin of a reader holding no table.
+
+struct Cred
+{
+	uint32_t					key;																	// Tag ID or password, 0 = free slot.
+	uint32_t					tm;																		// Temporary access expiry (minutes).
+	uint32_t					once;																	// One-time access ticket, 0 = none.
+	uint8_t						shard;																// Database shard and user position.
+	uint8_t						pos;
+	uint8_t						att;																	// Attribute byte of the user.
+	uint8_t						sch;																	// Schedule byte of the user (profile, group).
+	bool							pwd;																	// "key" is the password of the user.
+};
+
+class CredIndex
+{
+
+public:
+	CredIndex();
+	~CredIndex();
+
+	// Reader side, "reader" is the reader's own number (0 to CRED_READERS - 1). Entries found between pin() and
+	// unpin() come from tables that stay allocated.
+	void							pin(uint8_t reader);
+	void							unpin(uint8_t reader){_pin[reader].gen.store(CRED_IDLE, std::memory_order_release);}
+
+	// Copies the entry of "key" into "c". Returns false if the key is not in the index.
+	bool							find(uint32_t key, Cred &c);
+
+	// Writer side (one thread). Partition of "key".
+	static uint8_t		part(uint32_t key){return hash(key) >> (32 - 4);}
+
+	// Replaces partition "p" with a table holding "creds" (keys of partition "p" only).
+	void							publish(uint8_t p, const std::vector<Cred> &creds);
+
+	// Frees the replaced tables no reader can hold any more.
+	void							reclaim();
+
+	// Current generation. quiet() returns true once no reader holds a table replaced before generation "gen".
+	uint64_t					generation(){return _gen.load();}
+	bool							quiet(uint64_t gen){return low() >= gen;}
+
+	uint32_t					publishes(){return _publishes;}
+	uint32_t					retired(){return _retired.size();}									// Tables waiting to be freed.
+
+private:
+	struct Table
+	{
+		uint32_t				mask;																	// Slots - 1.
+		uint64_t				gen;																	// Generation it was replaced at.
+		std::vector<Cred>	slots;
+	};
+
+	struct Pin
+	{
+		std::atomic<uint64_t>	gen;
+		char						pad[64 - sizeof(std::atomic<uint64_t>)];
+	};
+
+	std::atomic<Table *>	_part[CRED_PARTS];
+	std::atomic<uint64_t>	_gen;														// Bumped by each publish.
+	Pin								_pin[CRED_READERS];
+	std::vector<Table *>	_retired;
+	uint32_t					_publishes;
+
+	uint64_t					low();																// Lowest pin.
+	static uint32_t		hash(uint32_t key){return key * 2654435761UL;}		// Fibonacci hashing.
+	static_assert(CRED_PARTS == 16, "part() takes the top 4 bits of the hash");
+};
+
+#endif
@@ -0,0 +1,708 @@
+// DoorDaemon.cpp Rev 1.1 (host daemon)
+
+#include <chrono>
+#include <string>
+#include <unordered_set>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "EEPROM.h"
+#include "DoorDaemon.h"
+
+#define DAEMON_RUN					64						// Frames decided per pin of the index.
+#define DAEMON_SPINS				64						// Idle passes a thread yields before it sleeps.
+#define DAEMON_WAITUS				200						// Sleep of an idle thread (microseconds).
+#define DAEMON_SERIAL				0xFFFFF				// Ticket serials (20 bits), the low 12 bits name the claim cell.
+#define PWDFLAG							0x1000				// posOf() of a password, as in RfidDb.cpp.
+#define PWDMASK							0xFFF
+
+static_assert(DAEMON_CLAIMS == 4096, "tickets keep the claim cell in 12 bits");
+static_assert(DAEMON_CLAIMS >= DAEMON_SHARDS * DAEMON_USERS, "a claim cell for every user");
+
+static uint8_t shardOf(uint32_t key, uint8_t shards){return (uint32_t)(key * 2654435761UL) % shards;}
+
+static bool same(const Cred &a, const Cred &b)
+{
+	return a.tm == b.tm && a.once == b.once && a.shard == b.shard && a.pos == b.pos && a.att == b.att && a.sch == b.sch &&
+		a.pwd == b.pwd;
+}
+
+DoorDaemon::DoorDaemon(const char *path, uint8_t shards, uint16_t doors, uint8_t workers)
+{
+	_path = path;
+	_shards = (shards < 1) ? 1 : (shards > DAEMON_SHARDS) ? DAEMON_SHARDS : shards;
+	_doors = (doors < 1) ? 1 : doors;
+	_workers = (workers < 1) ? 1 : (workers > DAEMON_WORKERS) ? DAEMON_WORKERS : workers;
+	_session = new Session[_doors]();
+	_worker = new Worker[_workers];
+	for(uint8_t w = 0; w < _workers; w++)
+	{
+		_worker[w].decisions.store(0);
+		_worker[w].dropped.store(0);
+	}
+	for(uint16_t i = 0; i < DAEMON_CLAIMS; i++){_claim[i].store(0);}
+	for(uint16_t i = DAEMON_CLAIMS; i > 0; i--){_freeCells.push_back(i - 1);}
+	_nextEv = 0;
+	_run.store(false);
+	_runWorkers.store(false);
+	_batches = 0;
+	_users.store(0);
+	memset(_slot, 0, sizeof(_slot));
+	memset(_count, 0, sizeof(_count));
+	_ticket = 0;
+	_dirty = 0;
+	memset(_schTable, 0xFF, sizeof(_schTable));														// Until loaded, as erased profiles.
+	memset(_grpAtt, 0, sizeof(_grpAtt));
+	memset(_grpTm, 0, sizeof(_grpTm));
+	publishCfg();
+
+	RfidDb probe((uint8_t)DAEMON_USERS, (uint16_t)0, (uint8_t)DAEMON_NAMELEN);
+	_shardSize = probe.dbSize();
+	for(uint8_t s = 0; s < DAEMON_SHARDS; s++)
+	{
+		_db[s] = (s < _shards) ? new RfidDb((uint8_t)DAEMON_USERS, (uint16_t)(s * _shardSize), (uint8_t)DAEMON_NAMELEN) : NULL;
+	}
+	_cfgAddr = _shards * _shardSize;
+}
+
+DoorDaemon::~DoorDaemon()
+{
+	end();
+	for(uint8_t s = 0; s < _shards; s++){delete _db[s];}
+	delete[] _worker;
+	delete[] _session;
+}
+
+bool DoorDaemon::begin()
+{
+	EEPROM.resize(_cfgAddr + DAEMON_PROFILES * DAEMON_SCHBYTES + DAEMON_GROUPS * DAEMON_GRPBYTES);
+	EEPROM.load(_path);																							// A new (or shorter) file leaves the rest erased.
+	for(uint8_t s = 0; s < _shards; s++){_db[s]->begin();}
+	loadCfg();
+	if(!save()){return false;}
+	_dirty = (1 << _shards) - 1;																		// Index built from every shard.
+	commit();
+	_run.store(true);
+	_writer = std::thread(&DoorDaemon::writerLoop, this);
+	return true;
+}
+
+void DoorDaemon::startWorkers()
+{
+	if(_runWorkers.load()){return;}
+	_runWorkers.store(true);
+	for(uint8_t w = 0; w < _workers; w++){_worker[w].thread = std::thread(&DoorDaemon::workerLoop, this, w);}
+}
+
+void DoorDaemon::end()
+{
+	_runWorkers.store(false);
+	for(uint8_t w = 0; w < _workers; w++)
+	{
+		if(_worker[w].thread.joinable()){_worker[w].thread.join();}
+	}
+	_run.store(false);
+	if(_writer.joinable()){_writer.join();}
+}
+
+bool DoorDaemon::submit(const DoorFrame &f)
+{
+	if(f.door >= _doors){return false;}
+	return _worker[workerOf(f.door)].frames.push(f);
+}
+
+bool DoorDaemon::change(const DbChange &c){return _admin.push(c);}
+
+bool DoorDaemon::nextEvent(DoorEvent &ev)
+{
+	for(uint8_t i = 0; i < _workers; i++)
+	{
+		uint8_t w = (_nextEv + i) % _workers;
+		if(_worker[w].events.pop(ev))
+		{
+			_nextEv = (w + 1) % _workers;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Same steps as kpEntry of the sketch: a user with IDANDPWD needs the other entry (tag ID or password) of the
+// same user before the entry timer ends. A failed entry counts a retry, the third locks the keypad out. The events
+// of a typed entry carry the user number in place of the entry.
+uint8_t DoorDaemon::decide(uint8_t w, const DoorFrame &f, uint64_t ms, uint32_t minutes)
+{
+	Session		&s = _session[f.door];
+	Cred			c;
+	bool			found;
+	uint32_t	key;
+	uint8_t		dec;
+
+	_worker[w].decisions.store(_worker[w].decisions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	if(s.retryCnt >= DAEMON_RETRIES)
+	{
+		if(ms <= s.lockEnd){return 0;}																	// Locked out, entries ignored.
+		s.retryCnt = 0;
+	}
+	if(s.stage && ms > s.deadline){s.stage = 0;}											// Second entry not made in time.
+	found = _index.find(f.code, c);
+	key = f.typed ? (found ? c.shard * DAEMON_USERS + c.pos + 1 : 0) : f.code;
+	if(s.stage)
+	{
+		s.stage = 0;
+		if(found && c.shard == s.shard && c.pos == s.pos && c.pwd != s.pwd){return unlock(w, f, c, key, minutes);}
+		dec = EV_MISMATCH;
+	}
+	else if(!found){dec = EV_UNKNOWN;}
+	else
+	{
+		s.retryCnt = 0;																								// Valid entry, retries start again.
+		if(c.att & DAEMON_IDANDPWD)
+		{
+			s.stage = 1;
+			s.shard = c.shard;
+			s.pos = c.pos;
+			s.pwd = c.pwd;
+			s.deadline = ms + DAEMON_ENTRYMS;
+			return 0;
+		}
+		return unlock(w, f, c, key, minutes);
+	}
+
+	event(w, dec, f.door, key, f.typed);
+	s.lockEnd = ms + DAEMON_LOCKMS;
+	if(++s.retryCnt == DAEMON_RETRIES){event(w, EV_LOCKOUT, f.door, key, f.typed);}
+	return dec;
+}
+
+uint64_t DoorDaemon::decisions()
+{
+	uint64_t n = 0;
+
+	for(uint8_t w = 0; w < _workers; w++){n += _worker[w].decisions.load(std::memory_order_relaxed);}
+	return n;
+}
+
+uint64_t DoorDaemon::dropped()
+{
+	uint64_t n = 0;
+
+	for(uint8_t w = 0; w < _workers; w++){n += _worker[w].dropped.load(std::memory_order_relaxed);}
+	return n;
+}
+
+uint64_t DoorDaemon::nowMs()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t DoorDaemon::nowMinutes(){return time(NULL) / 60;}
+
+// writerLoop Method (PRIVATE)------------------------------------------------------------------------------------
+// Applies up to DAEMON_BATCH changes (admin first, then one-time accesses used by the workers) and commits them
+// as one batch. Changes queued when end() is called are still applied. The replies of the admin changes are sent
+// once their batch is committed, so a client never sees a change that a crash could still lose.
+void DoorDaemon::writerLoop()
+{
+	DbChange	c;
+	DbReply		pend[DAEMON_BATCH];
+	uint32_t	idle = 0;
+
+	while(true)
+	{
+		bool stop = !_run.load();
+		uint16_t n = 0, replies = 0;
+
+		while(n < DAEMON_BATCH && _admin.pop(c))
+		{
+			pend[replies].id = c.id;
+			pend[replies++].err = apply(c);
+			n++;
+		}
+		for(uint8_t w = 0; w < _workers; w++)
+		{
+			while(n < DAEMON_BATCH && _worker[w].changes.pop(c)){apply(c); n++;}
+		}
+		if(n)
+		{
+			commit();
+			_batches++;
+			idle = 0;
+		}
+		for(uint16_t i = 0; i < replies; i++)
+		{
+			while(!_replies.push(pend[i]) && _run.load()){std::this_thread::yield();}
+		}
+		_index.reclaim();
+		for(size_t i = 0; i < _waitCells.size();)												// Cells of dropped tickets.
+		{
+			if(_index.quiet(_waitCells[i].first))
+			{
+				_claim[_waitCells[i].second].store(0);
+				_freeCells.push_back(_waitCells[i].second);
+				_waitCells[i] = _waitCells.back();
+				_waitCells.pop_back();
+			}
+			else{i++;}
+		}
+		if(n){continue;}
+		if(stop){break;}
+		if(++idle < DAEMON_SPINS){std::this_thread::yield();}
+		else{std::this_thread::sleep_for(std::chrono::microseconds(DAEMON_WAITUS));}
+	}
+}
+
+// workerLoop Method (PRIVATE)------------------------------------------------------------------------------------
+void DoorDaemon::workerLoop(uint8_t w)
+{
+	Worker		&wk = _worker[w];
+	DoorFrame	f;
+	uint32_t	idle = 0;
+
+	while(true)
+	{
+		if(!wk.frames.pop(f))
+		{
+			if(!_runWorkers.load(std::memory_order_relaxed)){break;}						// Queue drained after end().
+			if(++idle < DAEMON_SPINS){std::this_thread::yield();}
+			else{std::this_thread::sleep_for(std::chrono::microseconds(DAEMON_WAITUS));}
+			continue;
+		}
+		uint64_t ms = nowMs();
+		uint32_t minutes = nowMinutes();
+		uint16_t n = 0;
+
+		idle = 0;
+		_index.pin(w);
+		do{decide(w, f, ms, minutes);}while(++n < DAEMON_RUN && wk.frames.pop(f));
+		_index.unpin(w);
+	}
+}
+
+// unlock Method (PRIVATE)----------------------------------------------------------------------------------------
+// Same checks as unlockDoor of the sketch (see acsRebuild): the door bit and a valid access (permanent, or
+// temporary and not expired) of the user or of its group, then the hours of its schedule profile. One-time
+// access is granted once, unless the group gives access, the writer then clears it in the database. "key" is the
+// key of the events (see decide).
+uint8_t DoorDaemon::unlock(uint8_t w, const DoorFrame &f, const Cred &c, uint32_t key, uint32_t minutes)
+{
+	uint8_t		bit = 1 << (f.door & 3);
+	uint8_t		grp = c.sch >> DAEMON_GRPSHIFT;
+	bool			valid = (c.att & DAEMON_PERMACCESS) || ((c.att & DAEMON_TEMPACCESS) && minutes <= c.tm);
+	bool			door = (c.att & bit) && (valid || (c.att & DAEMON_ONETMACCESS));
+
+	if(grp && grp <= DAEMON_GROUPS)
+	{
+		uint64_t	g = _grp[grp - 1].load(std::memory_order_relaxed);
+		uint8_t		att = g >> 32;
+		if(((att & DAEMON_PERMACCESS) || ((att & DAEMON_TEMPACCESS) && minutes <= (uint32_t)g)) && (att & DAEMON_DOORBITS))
+		{
+			door = door || (att & bit);
+			valid = true;
+		}
+	}
+	if(!door)
+	{
+		event(w, EV_NOPERM, f.door, key, f.typed);
+		return EV_NOPERM;
+	}
+	if(!schAllowed(c.sch & DAEMON_SCHMASK, minutes))
+	{
+		event(w, EV_SCHEDULE, f.door, key, f.typed);
+		return EV_SCHEDULE;
+	}
+	if(!valid)																											// One-time access only.
+	{
+		if(c.once == 0 || _claim[c.once & (DAEMON_CLAIMS - 1)].exchange(c.once) == c.once)
+		{
+			event(w, EV_NOPERM, f.door, key, f.typed);
+			return EV_NOPERM;
+		}
+		DbChange u;
+		memset(&u, 0, sizeof(u));
+		u.op = CHG_ONCE;
+		u.tag = f.code;
+		u.shard = c.shard;
+		u.pos = c.pos;
+		_worker[w].changes.push(u);																		// If full, the claim still stops a second use.
+	}
+	event(w, EV_GRANTED, f.door, key, f.typed);
+	return EV_GRANTED;
+}
+
+// event Method (PRIVATE)-----------------------------------------------------------------------------------------
+void DoorDaemon::event(uint8_t w, uint8_t type, uint16_t door, uint32_t key, bool typed)
+{
+	DoorEvent ev;
+
+	ev.key = key;
+	ev.door = door;
+	ev.type = type;
+	ev.typed = typed;
+	if(!_worker[w].events.push(ev))
+	{
+		_worker[w].dropped.store(_worker[w].dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+}
+
+// apply Method (PRIVATE)-----------------------------------------------------------------------------------------
+uint8_t DoorDaemon::apply(DbChange &c)
+{
+	switch(c.op)
+	{
+		case CHG_ADD:		return add(c);
+		case CHG_DEL:		return del(c);
+		case CHG_ONCE:	used(c); return DERR_OK;
+		case CHG_SSP:		return setSch(c);
+		case CHG_SGR:		return setGrp(c);
+	}
+	return DERR_OP;
+}
+
+// add Method (PRIVATE)-------------------------------------------------------------------------------------------
+// Same steps as "add" of the sketch's protocol. A key already in the database keeps its shard, a new user goes
+// to the shard of its first key, or the next one with room.
+uint8_t DoorDaemon::add(DbChange &c)
+{
+	uint8_t		tagShard = 0, pwdShard = 0, s, att;
+	int16_t		tagPos = -1, pwdPos = -1;
+	uint32_t	key = c.tag ? c.tag : c.pwd;
+	RfidDb		*db;
+	bool			ok;
+
+	if(key == 0){return DERR_ARG;}
+	if((c.hasSch && c.sch > DAEMON_PROFILES) || (c.hasGrp && c.grp > DAEMON_GROUPS)){return DERR_RANGE;}
+	if(c.tag){tagPos = locate(c.tag, tagShard);}
+	if(c.pwd){pwdPos = locate(c.pwd, pwdShard);}
+	if(tagPos >= 0 && pwdPos >= 0 && (tagShard != pwdShard || (tagPos & PWDMASK) != (pwdPos & PWDMASK))){return DERR_ARG;}
+	if(tagPos >= 0){s = tagShard;}
+	else if(pwdPos >= 0){s = pwdShard;}
+	else
+	{
+		uint8_t i = 0;
+		s = shardOf(key, _shards);
+		while(i < _shards && _db[s]->count() >= DAEMON_USERS){s = (s + 1) % _shards; i++;}
+		if(i == _shards){return DERR_FULL;}
+	}
+	db = touch(s);
+
+	if(c.tag && c.pwd)
+	{
+		if(tagPos >= 0){ok = db->insertPwd(c.tag, c.pwd);}
+		else if(pwdPos >= 0){ok = db->insertId(c.tag, c.pwd);}
+		else
+		{
+			ok = db->insertId(c.tag) && db->insertPwd(c.tag, c.pwd);
+			if(!ok){db->removeId(c.tag);}																// No user left with the tag only.
+		}
+	}
+	else if(c.tag){ok = db->insertId(c.tag);}
+	else{ok = db->insertPwd(c.pwd);}
+	if(!ok){return DERR_FULL;}
+
+	if(c.name[0])
+	{
+		if(c.tag){db->insertIdNam(c.tag, c.name);}
+		else{db->insertPwdNam(c.pwd, c.name);}
+	}
+	if(c.hasAtt){db->insertAtt(key, c.att);}
+	if(c.hasDays)
+	{
+		int16_t pos = db->posOf(key) & PWDMASK;
+		db->insertTm(key, nowMinutes() + c.days * 1440);
+		db->readAtt(pos, att);
+		db->insertAtt(key, (att | DAEMON_TEMPACCESS) & ~(DAEMON_ONETMACCESS | DAEMON_PERMACCESS));
+	}
+	if(c.hasSch || c.hasGrp)
+	{
+		int16_t pos = db->posOf(key) & PWDMASK;
+		uint8_t sch = 0;
+		db->readSch(pos, sch);
+		if(c.hasSch){sch = (sch & ~DAEMON_SCHMASK) | c.sch;}
+		if(c.hasGrp){sch = (c.grp << DAEMON_GRPSHIFT) | (sch & DAEMON_SCHMASK);}
+		db->modifySch(pos, sch);
+	}
+	return DERR_OK;
+}
+
+// del Method (PRIVATE)-------------------------------------------------------------------------------------------
+uint8_t DoorDaemon::del(DbChange &c)
+{
+	uint8_t s;
+	int16_t pos;
+
+	if(c.tag)
+	{
+		pos = locate(c.tag, s);
+		if(pos < 0 || pos >= PWDFLAG){return DERR_NOTFOUND;}
+		touch(s)->removeId(c.tag);
+	}
+	else if(c.pwd)
+	{
+		pos = locate(c.pwd, s);
+		if(pos < PWDFLAG){return DERR_NOTFOUND;}
+		touch(s)->removePwd(c.pwd);
+	}
+	else{return DERR_ARG;}
+	return DERR_OK;
+}
+
+// used Method (PRIVATE)------------------------------------------------------------------------------------------
+// Clears the one-time access a worker granted. The user may have moved (or gone) since the worker's lookup, so
+// it is found again by key.
+void DoorDaemon::used(DbChange &c)
+{
+	uint8_t s, att;
+	int16_t pos = locate(c.tag, s);
+
+	if(pos < 0){return;}
+	pos &= PWDMASK;
+	if(_db[s]->readAtt(pos, att) && (att & DAEMON_ONETMACCESS)){touch(s)->modifyAtt(pos, att & ~DAEMON_ONETMACCESS);}
+}
+
+// setSch Method (PRIVATE)---------------------------------------------------------------------------------------
+// Allows (on) or denies access from the start of hour "from" up to the start of hour "to", as "ssp" of the sketch.
+uint8_t DoorDaemon::setSch(DbChange &c)
+{
+	if(c.sch < 1 || c.sch > DAEMON_PROFILES || c.day > 7 || c.from > 23 || c.to > 24 || c.to <= c.from){return DERR_RANGE;}
+	uint8_t *t = _schTable[c.sch - 1];
+	for(uint8_t d = (c.day == 7) ? 0 : c.day; d <= ((c.day == 7) ? 6 : c.day); d++)
+	{
+		for(uint8_t hr = c.from; hr < c.to; hr++)
+		{
+			uint8_t slot = d * 24 + hr;
+			if(c.on){t[slot >> 3] |= 1 << (slot & 7);}
+			else{t[slot >> 3] &= ~(1 << (slot & 7));}
+		}
+	}
+	for(uint8_t i = 0; i < DAEMON_SCHBYTES; i++){EEPROM.update(_cfgAddr + (c.sch - 1) * DAEMON_SCHBYTES + i, t[i]);}
+	return DERR_OK;
+}
+
+// setGrp Method (PRIVATE)---------------------------------------------------------------------------------------
+// Gives the users of group "grp" the doors of "att" for "days" days (0 = permanent), as "sgr" of the sketch.
+uint8_t DoorDaemon::setGrp(DbChange &c)
+{
+	uint16_t addr;
+
+	if(c.grp < 1 || c.grp > DAEMON_GROUPS || c.days > 365){return DERR_RANGE;}
+	addr = _cfgAddr + DAEMON_PROFILES * DAEMON_SCHBYTES + (c.grp - 1) * DAEMON_GRPBYTES;
+	_grpAtt[c.grp - 1] = (c.att & DAEMON_DOORBITS) | (c.days ? DAEMON_TEMPACCESS : DAEMON_PERMACCESS);
+	_grpTm[c.grp - 1] = c.days ? nowMinutes() + c.days * 1440 : 0;
+	EEPROM.update(addr, _grpAtt[c.grp - 1]);
+	EEPROM.put(addr + 1, _grpTm[c.grp - 1]);
+	return DERR_OK;
+}
+
+// loadCfg Method (PRIVATE)--------------------------------------------------------------------------------------
+// Reads the profiles and groups after the shards. Erased profiles allow every hour, a group with bits other than
+// the door bits and PERMACCESS / TEMPACCESS (erased image) gives no access, as grpLoad of the sketch.
+void DoorDaemon::loadCfg()
+{
+	uint16_t addr = _cfgAddr;
+
+	for(uint8_t p = 0; p < DAEMON_PROFILES; p++)
+	{
+		for(uint8_t i = 0; i < DAEMON_SCHBYTES; i++){_schTable[p][i] = EEPROM.read(addr++);}
+	}
+	for(uint8_t g = 0; g < DAEMON_GROUPS; g++, addr += DAEMON_GRPBYTES)
+	{
+		_grpAtt[g] = EEPROM.read(addr);
+		EEPROM.get(addr + 1, _grpTm[g]);
+		if(_grpAtt[g] & ~(DAEMON_PERMACCESS | DAEMON_TEMPACCESS | DAEMON_DOORBITS)){_grpAtt[g] = 0;}
+	}
+}
+
+// publishCfg Method (PRIVATE)-----------------------------------------------------------------------------------
+// Hands the writer's profiles and groups to the workers.
+void DoorDaemon::publishCfg()
+{
+	for(uint8_t p = 0; p < DAEMON_PROFILES; p++)
+	{
+		for(uint8_t i = 0; i < DAEMON_SCHBYTES; i++){_sch[p][i].store(_schTable[p][i], std::memory_order_relaxed);}
+	}
+	for(uint8_t g = 0; g < DAEMON_GROUPS; g++){_grp[g].store(((uint64_t)_grpAtt[g] << 32) | _grpTm[g], std::memory_order_relaxed);}
+}
+
+// schAllowed Method (PRIVATE)-----------------------------------------------------------------------------------
+// As schAllowed of the sketch, the slot (day X 24 + hour, Sunday = day 0) is taken from the local time of
+// "minutes". Profile 0 has no schedule.
+bool DoorDaemon::schAllowed(uint8_t sch, uint32_t minutes)
+{
+	time_t		t = (time_t)minutes * 60;
+	struct tm	lt;
+	uint8_t		slot;
+
+	if(!sch || sch > DAEMON_PROFILES){return true;}
+	if(localtime_r(&t, &lt) == NULL){return false;}
+	slot = lt.tm_wday * 24 + lt.tm_hour;
+	return _sch[sch - 1][slot >> 3].load(std::memory_order_relaxed) & (1 << (slot & 7));
+}
+
+// touch Method (PRIVATE)-----------------------------------------------------------------------------------------
+// Shard about to be written, its batch begins with the first write.
+RfidDb *DoorDaemon::touch(uint8_t shard)
+{
+	if(!(_dirty & (1 << shard)))
+	{
+		_dirty |= (1 << shard);
+		_db[shard]->beginBatch();
+	}
+	return _db[shard];
+}
+
+// locate Method (PRIVATE)----------------------------------------------------------------------------------------
+// Position of "key" (posOf, PWDFLAG set for a password) and its shard, -1 if not found. Reads the shards, which
+// hold the changes of the current batch, trying the shard of the index entry first.
+int16_t DoorDaemon::locate(uint32_t key, uint8_t &shard)
+{
+	std::unordered_map<uint32_t, Cred> &m = _master[CredIndex::part(key)];
+	auto it = m.find(key);
+	int16_t pos;
+
+	if(it != m.end())
+	{
+		shard = it->second.shard;
+		if((pos = _db[shard]->posOf(key)) >= 0){return pos;}
+	}
+	for(shard = 0; shard < _shards; shard++)
+	{
+		if((pos = _db[shard]->posOf(key)) >= 0){return pos;}
+	}
+	return -1;
+}
+
+// commit Method (PRIVATE)----------------------------------------------------------------------------------------
+// Ends the batch of each shard written (one commit each), saves the image and publishes the index partitions
+// whose entries changed.
+void DoorDaemon::commit()
+{
+	bool									parts[CRED_PARTS] = {false};
+	std::vector<uint32_t>	dropped;
+	uint16_t							users = 0;
+
+	for(uint8_t s = 0; s < _shards; s++)
+	{
+		if(_dirty & (1 << s)){_db[s]->endBatch();}
+	}
+	if(!save()){fprintf(stderr, "door_daemon: can not save %s\n", _path);}
+	publishCfg();
+	for(uint8_t s = 0; s < _shards; s++)
+	{
+		if(_dirty & (1 << s)){rebuild(s, parts, dropped);}
+		users += _count[s];
+	}
+	_dirty = 0;
+	_users.store(users);
+	for(uint8_t p = 0; p < CRED_PARTS; p++)
+	{
+		if(!parts[p]){continue;}
+		std::vector<Cred> creds;
+		creds.reserve(_master[p].size());
+		for(auto &e : _master[p]){creds.push_back(e.second);}
+		_index.publish(p, creds);
+	}
+	uint64_t gen = _index.generation();														// No reader pinned from here holds them.
+	for(uint32_t t : dropped){_waitCells.push_back(std::make_pair(gen, (uint16_t)(t & (DAEMON_CLAIMS - 1))));}
+}
+
+// rebuild Method (PRIVATE)---------------------------------------------------------------------------------------
+// Reads shard "shard" into the writer's copy, updates the index entries of its keys and marks the partitions
+// changed in "parts". A user keeps its one-time ticket while it keeps the access and one of its keys, even if
+// it moved, tickets no longer held are added to "dropped".
+void DoorDaemon::rebuild(uint8_t shard, bool *parts, std::vector<uint32_t> &dropped)
+{
+	RfidDb																*db = _db[shard];
+	uint8_t																n = db->count();
+	std::unordered_map<uint32_t, uint32_t>	oldOnce;
+	std::vector<uint32_t>									oldKeys;
+	std::unordered_set<uint32_t>					kept;
+	std::unordered_map<uint32_t, Cred>		fresh;
+
+	for(uint8_t pos = 0; pos < _count[shard]; pos++)
+	{
+		Slot &o = _slot[shard][pos];
+		if(o.id){oldKeys.push_back(o.id);}
+		if(o.pwd){oldKeys.push_back(o.pwd);}
+		if(o.once)
+		{
+			if(o.id){oldOnce[o.id] = o.once;}
+			if(o.pwd){oldOnce[o.pwd] = o.once;}
+		}
+	}
+
+	for(uint8_t pos = 0; pos < n; pos++)
+	{
+		Slot &o = _slot[shard][pos];
+		db->readId(pos, o.id);
+		db->readPwd(pos, o.pwd);
+		db->readAtt(pos, o.att);
+		db->readTm(pos, o.tm);
+		db->readSch(pos, o.sch);
+		o.once = 0;
+		if(o.att & DAEMON_ONETMACCESS)
+		{
+			auto it = o.id ? oldOnce.find(o.id) : oldOnce.end();
+			if(it == oldOnce.end() && o.pwd){it = oldOnce.find(o.pwd);}
+			if(it != oldOnce.end() && !kept.count(it->second)){o.once = it->second;}
+			else{o.once = newTicket();}
+			kept.insert(o.once);
+		}
+		Cred c;
+		c.tm = o.tm;
+		c.once = o.once;
+		c.shard = shard;
+		c.pos = pos;
+		c.att = o.att;
+		c.sch = o.sch;
+		if(o.id){c.key = o.id; c.pwd = false; fresh[o.id] = c;}
+		if(o.pwd){c.key = o.pwd; c.pwd = true; fresh[o.pwd] = c;}
+	}
+	_count[shard] = n;
+
+	for(auto &e : oldOnce)
+	{
+		if(!kept.count(e.second)){kept.insert(e.second); dropped.push_back(e.second);}
+	}
+	for(uint32_t key : oldKeys)																			// Keys gone from the shard.
+	{
+		if(fresh.count(key)){continue;}
+		uint8_t p = CredIndex::part(key);
+		auto it = _master[p].find(key);
+		if(it != _master[p].end() && it->second.shard == shard){_master[p].erase(it); parts[p] = true;}
+	}
+	for(auto &e : fresh)
+	{
+		uint8_t p = CredIndex::part(e.first);
+		auto it = _master[p].find(e.first);
+		if(it == _master[p].end() || !same(it->second, e.second))
+		{
+			_master[p][e.first] = e.second;
+			parts[p] = true;
+		}
+	}
+}
+
+// newTicket Method (PRIVATE)-------------------------------------------------------------------------------------
+// 0 if every claim cell is in use (or waiting for readers), the one-time access is then refused until a cell
+// is free.
+uint32_t DoorDaemon::newTicket()
+{
+	uint16_t cell;
+
+	if(_freeCells.empty()){return 0;}
+	cell = _freeCells.back();
+	_freeCells.pop_back();
+	_ticket = _ticket % DAEMON_SERIAL + 1;
+	return (_ticket << 12) | cell;
+}
+
+// save Method (PRIVATE)------------------------------------------------------------------------------------------
+// Writes the image to a temporary file first, so a crash leaves the last complete image.
+bool DoorDaemon::save()
+{
+	std::string tmp = std::string(_path) + ".tmp";
+
+	if(!EEPROM.save(tmp.c_str())){return false;}
+	return rename(tmp.c_str(), _path) == 0;
+}
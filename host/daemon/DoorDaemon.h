@@ -0,0 +1,272 @@
+// DoorDaemon.h Rev 1.2 (host daemon)
+
+// Rev 1.0	- The access decisions of the controller (kpEntry / unlockDoor of the sketch) for hundreds of virtual
+//						  doors on a Linux gateway. Each door has a keypad session as in the sketch: ID + password entries,
+//						  retry count, lock-out and entry timer.
+//						- Users are kept in RfidDb shards (up to 255 users each) in one EEPROM image backed by a file, a
+//						  new user goes to the shard chosen by the hash of its first key. Only the writer thread touches
+//						  the shards: changes (add, delete, one-time access used) are applied in batches, each shard
+//						  written in a batch is committed once (beginBatch / endBatch), the image file is saved and the
+//						  credential index (CredIndex) partitions holding changed entries are published again.
+//						- Doors are spread over the worker threads (door % workers), each worker owns the sessions of its
+//						  doors. Frames reach a worker and events leave it through lock-free single producer / single
+//						  consumer queues (SpscQueue), lookups go to the shared credential index without locks.
+//						- A user with one-time access has a ticket naming one of DAEMON_CLAIMS claim cells. The access is
+//						  used by an atomic exchange of the ticket into its cell, so two doors can not both use it before
+//						  the writer has cleared it in the database. A cell is reused once no reader can hold the ticket.
+//						- Time stamps are minutes as in the sketch ("timeStmp"), counted from the Unix epoch so they stay
+//						  valid across restarts.
+// Rev 1.1	- Schedule profiles and groups as on the controller. The schedule profile (low 4 bits) and group (high
+//						  4 bits) of each user are the schedule byte of RfidDb (readSch / modifySch) and go into the
+//						  credential index. The profiles (one bit per hour of the week, local time) and the groups (door
+//						  bits, PERMACCESS or TEMPACCESS and expiry) are kept in the image after the shards, set with
+//						  CHG_SSP and CHG_SGR and handed to the workers once their batch is committed.
+// Rev 1.2	- A password or PIN typed at a keypad ("typed" frame) is never sent. Its event carries the user number
+//						  (shard X DAEMON_USERS + position + 1, 0 if no user matched) as on the controller ("evPush").
+
+#ifndef _DOORDAEMON_H
+#define _DOORDAEMON_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include "RfidDb.h"
+#include "EventLink.h"
+#include "CredIndex.h"
+#include "SpscQueue.h"
+
+#define DAEMON_SHARDS				10						// Most shards, 10 X 6377 bytes fill the 64 KB image.
+#define DAEMON_USERS				255						// Users per shard (RfidDb limit).
+#define DAEMON_NAMELEN			11						// Same name length as the sketch ("NAMELENGTH").
+#define DAEMON_WORKERS			CRED_READERS	// Most worker threads, each is a reader of the index.
+#define DAEMON_FRAMES				1024					// Frames queued per worker.
+#define DAEMON_EVENTS				4096					// Events queued per worker.
+#define DAEMON_CHANGES			256						// Changes queued per worker and for the admin.
+#define DAEMON_BATCH				256						// Most changes applied before the index is published.
+#define DAEMON_RETRIES			3							// Entries before a keypad is locked out ("RETRYCNTDEFAULT").
+#define DAEMON_LOCKMS				300000UL			// Keypad lock-out time ("KPLCKTMDEFAULT", 5 minutes).
+#define DAEMON_ENTRYMS			20000UL				// Time to enter the second entry ("KEYTMRDEFAULT").
+#define DAEMON_CLAIMS				4096					// One-time access tickets in use at once (power of 2).
+#define DAEMON_PROFILES			4							// Schedule profiles ("SCHPROFILES", user profile 0 = no schedule).
+#define DAEMON_SCHBYTES			21						// Bytes per profile, 7 days X 24 hours, one bit per hour.
+#define DAEMON_GROUPS				8							// User groups ("GROUPS", user group 0 = no group).
+#define DAEMON_GRPBYTES			5							// Bytes per group, attribute + expiry time stamp.
+#define DAEMON_SCHMASK			0x0F					// Schedule profile bits of the user schedule byte.
+#define DAEMON_GRPSHIFT			4							// User group in the high 4 bits of the user schedule byte.
+
+// Attribute bits, same as the sketch.
+#define DAEMON_IDANDPWD			0x80
+#define DAEMON_PERMACCESS		0x40
+#define DAEMON_TEMPACCESS		0x20
+#define DAEMON_ONETMACCESS	0x10
+#define DAEMON_DOORBITS			0x0F					// Front, garage, rear and shed door bits.
+
+enum DAEMONOP																// Database changes.
+{
+	CHG_ADD,																	// Adds or updates a user (tag, pwd, name, att, days, sch, grp), as "add" of the sketch.
+	CHG_DEL,																	// Deletes a tag ID or a password, as "del" of the sketch.
+	CHG_ONCE,																	// One-time access of "tag" (user "shard", "pos") was used.
+	CHG_SSP,																	// Sets hours of schedule profile "sch" (day, from, to, on), as "ssp" of the sketch.
+	CHG_SGR																		// Sets group "grp" (att door bits, days, 0 = permanent), as "sgr" of the sketch.
+};
+
+enum DAEMONERR															// Reply error codes, same numbers as "PROTOERR" of the sketch.
+{
+	DERR_OK,
+	DERR_SYNTAX,
+	DERR_OP,
+	DERR_ARG,
+	DERR_NOTFOUND,
+	DERR_FULL,
+	DERR_RANGE
+};
+
+struct DoorFrame
+{
+	uint32_t					code;																	// Tag ID or keypad entry.
+	uint16_t					door;
+	bool							typed;																// Entered on the keypad (password or PIN).
+};
+
+struct DoorEvent
+{
+	uint32_t					key;																	// Tag ID, or user number of a typed entry.
+	uint16_t					door;
+	uint8_t						type;																	// EV_xxx (see "EventLink.h").
+	bool							typed;																// Entered on the keypad, "key" is the user number.
+};
+
+struct DbChange
+{
+	uint32_t					id;																		// Request id, echoed in the reply.
+	uint32_t					tag;
+	uint32_t					pwd;
+	uint32_t					days;
+	uint8_t						op;																		// CHG_xxx
+	uint8_t						att;
+	bool							hasAtt;
+	bool							hasDays;
+	uint8_t						sch;																	// Schedule profile (CHG_ADD, CHG_SSP).
+	uint8_t						grp;																	// Group (CHG_ADD, CHG_SGR).
+	bool							hasSch;
+	bool							hasGrp;
+	uint8_t						day;																	// CHG_SSP only, day 0-6 (Sunday = 0), 7 = every day.
+	uint8_t						from;																	// First hour and the hour after the last.
+	uint8_t						to;
+	bool							on;
+	uint8_t						shard;																// CHG_ONCE only.
+	uint8_t						pos;
+	char							name[DAEMON_NAMELEN];
+};
+
+struct DbReply
+{
+	uint32_t					id;
+	uint8_t						err;																	// DERR_xxx
+};
+
+class DoorDaemon
+{
+
+public:
+	// Database image in file "path" with "shards" shards, "doors" virtual doors served by "workers" threads. Door
+	// N opens for users with door bit N % 4 of the attribute or of their group (front, garage, rear, shed as on the
+	// controller), within the hours of their schedule profile.
+	DoorDaemon(const char *path, uint8_t shards, uint16_t doors, uint8_t workers);
+	~DoorDaemon();
+
+	// Loads (or creates) the database, publishes the index and starts the writer thread. Returns false if the
+	// image file can not be written.
+	bool							begin();
+
+	// Starts the worker threads, which take frames from the queues filled by submit().
+	void							startWorkers();
+
+	// Stops the threads. Frames and changes still queued are decided and applied, the image is saved.
+	void							end();
+
+	// Queues a frame for the worker of its door. Returns false if that queue is full. One producer thread.
+	bool							submit(const DoorFrame &f);
+
+	// Queues a database change. Returns false if the queue is full. One producer thread.
+	bool							change(const DbChange &c);
+
+	// Takes the next event of any worker, or the next change reply (queued once the change is committed). One
+	// consumer thread.
+	bool							nextEvent(DoorEvent &ev);
+	bool							nextReply(DbReply &r){return _replies.pop(r);}
+
+	// Decision for a frame of a door of worker "w", the worker threads call it for each frame taken. A caller
+	// driving the decisions from its own threads (in place of startWorkers) calls it from one thread per worker,
+	// between pin(w) and unpin(w). Returns the decision (EV_xxx), 0 while the other entry is awaited or if the
+	// keypad is locked out.
+	uint8_t						decide(uint8_t w, const DoorFrame &f, uint64_t ms, uint32_t minutes);
+
+	// Takes the next event of worker "w". A caller driving the decisions takes the events of each worker from the
+	// thread calling decide() for it, in place of nextEvent(), so it is the one consumer of that queue.
+	bool							takeEvent(uint8_t w, DoorEvent &ev){return _worker[w].events.pop(ev);}
+	void							pin(uint8_t w){_index.pin(w);}
+	void							unpin(uint8_t w){_index.unpin(w);}
+
+	uint8_t						workerOf(uint16_t door){return door % _workers;}
+	uint16_t					doors(){return _doors;}
+	uint8_t						workers(){return _workers;}
+	uint16_t					users(){return _users.load();}					// Users in all shards, at the last batch.
+	uint64_t					decisions();
+	uint64_t					dropped();															// Events lost, queue full.
+	uint32_t					batches(){return _batches;}						// Change batches applied.
+	uint32_t					publishes(){return _index.publishes();}
+
+	// Wall clock used for the decisions, ms (monotonic) and minutes since the Unix epoch.
+	static uint64_t		nowMs();
+	static uint32_t		nowMinutes();
+
+private:
+	struct Session																					// Keypad session of one door ("KpSession").
+	{
+		uint64_t				deadline;															// ms the second entry must come by.
+		uint64_t				lockEnd;															// ms the lock-out ends at.
+		uint8_t					stage;																// 0 = idle, 1 = second entry awaited.
+		uint8_t					retryCnt;
+		uint8_t					shard;																// User of the first entry.
+		uint8_t					pos;
+		bool						pwd;
+	};
+
+	struct Worker
+	{
+		SpscQueue<DoorFrame, DAEMON_FRAMES>		frames;
+		SpscQueue<DoorEvent, DAEMON_EVENTS>		events;
+		SpscQueue<DbChange, DAEMON_CHANGES>		changes;
+		std::atomic<uint64_t>	decisions;
+		std::atomic<uint64_t>	dropped;
+		std::thread				thread;
+	};
+
+	struct Slot																							// Writer's copy of one user record.
+	{
+		uint32_t				id;
+		uint32_t				pwd;
+		uint32_t				tm;
+		uint32_t				once;
+		uint8_t					att;
+		uint8_t					sch;
+	};
+
+	const char *			_path;
+	uint8_t						_shards;
+	uint16_t					_doors;
+	uint8_t						_workers;
+	uint16_t					_shardSize;														// RfidDb::dbSize() of a shard.
+	RfidDb *					_db[DAEMON_SHARDS];
+	CredIndex					_index;
+	Session *					_session;
+	Worker *					_worker;
+	uint8_t						_nextEv;															// Worker whose events are taken next.
+	SpscQueue<DbChange, DAEMON_CHANGES>		_admin;
+	SpscQueue<DbReply, DAEMON_CHANGES>		_replies;
+	std::atomic<uint32_t>	_claim[DAEMON_CLAIMS];							// Last one-time ticket used in each cell.
+	std::atomic<bool>	_run;
+	std::atomic<bool>	_runWorkers;
+	std::thread				_writer;
+	uint32_t					_batches;
+	std::atomic<uint16_t>	_users;
+	std::atomic<uint8_t>	_sch[DAEMON_PROFILES][DAEMON_SCHBYTES];	// Profiles of the last batch, read by the workers.
+	std::atomic<uint64_t>	_grp[DAEMON_GROUPS];							// Groups of the last batch, attribute << 32 | expiry.
+
+	// Writer thread state.
+	Slot							_slot[DAEMON_SHARDS][DAEMON_USERS];
+	uint8_t						_count[DAEMON_SHARDS];
+	std::unordered_map<uint32_t, Cred>	_master[CRED_PARTS];			// Entries of each index partition.
+	uint32_t					_ticket;															// Serial of the last ticket.
+	std::vector<uint16_t>	_freeCells;
+	std::vector<std::pair<uint64_t, uint16_t> >	_waitCells;		// Cells freed at an index generation.
+	uint16_t					_dirty;																// Shards written in this batch.
+	uint16_t					_cfgAddr;															// Profiles then groups, after the shards.
+	uint8_t						_schTable[DAEMON_PROFILES][DAEMON_SCHBYTES];
+	uint8_t						_grpAtt[DAEMON_GROUPS];
+	uint32_t					_grpTm[DAEMON_GROUPS];
+
+	void							writerLoop();
+	void							workerLoop(uint8_t w);
+	uint8_t						unlock(uint8_t w, const DoorFrame &f, const Cred &c, uint32_t key, uint32_t minutes);
+	void							event(uint8_t w, uint8_t type, uint16_t door, uint32_t key, bool typed);
+	uint8_t						apply(DbChange &c);
+	uint8_t						add(DbChange &c);
+	uint8_t						del(DbChange &c);
+	void							used(DbChange &c);
+	uint8_t						setSch(DbChange &c);
+	uint8_t						setGrp(DbChange &c);
+	void							loadCfg();
+	void							publishCfg();
+	bool							schAllowed(uint8_t sch, uint32_t minutes);
+	RfidDb *					touch(uint8_t shard);
+	int16_t						locate(uint32_t key, uint8_t &shard);
+	void							commit();
+	void							rebuild(uint8_t shard, bool *parts, std::vector<uint32_t> &dropped);
+	uint32_t					newTicket();
+	bool							save();
+};
+
+#endif
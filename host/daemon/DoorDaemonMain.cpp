@@ -0,0 +1,272 @@
+// DoorDaemonMain.cpp Rev 1.2 (host daemon)
+
+// Rev 1.0	- Door daemon: serves the keypads and readers of many doors from one database image. Takes JSON lines
+//						  from stdin, or from one client at a time on a unix socket (--socket). Frames of a door:
+//
+//						    {"door":12,"tag":1234567}  {"door":12,"pin":4321}
+//
+//						  database changes, answered with {"id":N,"err":E} (E as "PROTOERR" of the sketch):
+//
+//						    {"id":1,"op":"add","tag":1234567,"pwd":4321,"name":"Smith","att":193,"days":7}
+//						    {"id":2,"op":"del","tag":1234567}
+//
+//						  Each decision is sent as {"ty":T,"loc":door,"k":key} with T as the "ty" of the event link
+//						  (1 granted, 2 unknown, 3 mismatch, 4 no permission, 5 schedule, 6 lock-out).
+//
+//						  door_daemon --db file [--shards N] [--doors N] [--workers N] [--socket path]
+// Rev 1.1	- "add" takes the schedule profile "sch" (0-4) and group "grp" (0-8) of the user. Schedule profiles and
+//						  groups are set as "ssp" and "sgr" of the sketch's console, day 7 = every day, "att" the door
+//						  bits, 0 days = permanent:
+//
+//						    {"id":3,"op":"ssp","sch":1,"day":7,"from":8,"to":18,"on":1}
+//						    {"id":4,"op":"sgr","grp":2,"days":30,"att":5}
+// Rev 1.2	- The decision of a "pin" frame is sent as {"ty":T,"loc":door,"u":user} with the user number (0 = no
+//						  user matched) in place of the PIN, as the event link of the controller does.
+
+#include <string>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "HostShim.h"
+#include "JsonLine.h"
+#include "DoorDaemon.h"
+
+#define LINEMAX							256						// Longest request line.
+
+static DoorDaemon *				daemonp;
+static JsonLine						json;
+static int								outFd = STDOUT_FILENO;
+static std::string				out;									// Lines not written yet.
+static volatile sig_atomic_t	quit = 0;
+
+static void onSignal(int){quit = 1;}
+
+static void reply(uint32_t id, uint8_t err)
+{
+	char line[48];
+
+	snprintf(line, sizeof(line), "{\"id\":%u,\"err\":%u}\n", id, err);
+	out += line;
+}
+
+static void flush()
+{
+	while(!out.empty())
+	{
+		ssize_t n = write(outFd, out.data(), out.size());
+		if(n <= 0){if(errno == EAGAIN || errno == EINTR){return;} out.clear(); return;}		// Client gone.
+		out.erase(0, n);
+	}
+}
+
+static void request(char *line)
+{
+	uint32_t		id = 0, door, code, v;
+	const char	*op, *name;
+	DbChange		c;
+
+	if(!json.parse(line))
+	{
+		json.num(F("id"), id);																					// Echoed if it came before the error.
+		reply(id, DERR_SYNTAX);
+		return;
+	}
+	if(json.num(F("door"), door))
+	{
+		DoorFrame f;
+		f.typed = !json.num(F("tag"), code);
+		if(f.typed && !json.num(F("pin"), code)){return;}
+		f.code = code;
+		f.door = door;
+		if(door >= daemonp->doors()){return;}
+		while(!daemonp->submit(f)){usleep(50);}														// Worker busy, frames are not dropped.
+		return;
+	}
+	json.num(F("id"), id);
+	op = json.str(F("op"));
+	memset(&c, 0, sizeof(c));
+	c.id = id;
+	if(op == NULL){reply(id, DERR_SYNTAX); return;}
+	if(strcmp(op, "add") == 0){c.op = CHG_ADD;}
+	else if(strcmp(op, "del") == 0){c.op = CHG_DEL;}
+	else if(strcmp(op, "ssp") == 0){c.op = CHG_SSP;}
+	else if(strcmp(op, "sgr") == 0){c.op = CHG_SGR;}
+	else{reply(id, DERR_OP); return;}
+	if(c.op == CHG_SSP)
+	{
+		uint32_t prof, day, from, to, on;
+		if(!json.num(F("sch"), prof) || !json.num(F("day"), day) || !json.num(F("from"), from) || !json.num(F("to"), to) ||
+			!json.num(F("on"), on)){reply(id, DERR_ARG); return;}
+		if(prof < 1 || prof > DAEMON_PROFILES || day > 7 || from > 23 || to > 24 || to <= from || on > 1){reply(id, DERR_RANGE); return;}
+		c.sch = prof;
+		c.day = day;
+		c.from = from;
+		c.to = to;
+		c.on = on;
+		while(!daemonp->change(c)){usleep(50);}
+		return;
+	}
+	if(c.op == CHG_SGR)
+	{
+		uint32_t grp, att = 0;
+		if(!json.num(F("grp"), grp) || !json.num(F("days"), c.days)){reply(id, DERR_ARG); return;}
+		if(grp < 1 || grp > DAEMON_GROUPS || c.days > 365 || (json.has(F("att")) && (!json.num(F("att"), att) ||
+			att > DAEMON_DOORBITS))){reply(id, DERR_RANGE); return;}
+		c.grp = grp;
+		c.att = att;
+		while(!daemonp->change(c)){usleep(50);}
+		return;
+	}
+	json.num(F("tag"), c.tag);
+	json.num(F("pwd"), c.pwd);
+	if(c.tag == 0 && c.pwd == 0){reply(id, DERR_ARG); return;}
+	if(c.op == CHG_ADD)
+	{
+		if((name = json.str(F("name"))) != NULL)
+		{
+			if(strlen(name) > DAEMON_NAMELEN - 1){reply(id, DERR_RANGE); return;}
+			strcpy(c.name, name);
+		}
+		if(json.has(F("att")))
+		{
+			if(!json.num(F("att"), v) || v > 0xFF){reply(id, DERR_RANGE); return;}
+			c.att = v;
+			c.hasAtt = true;
+		}
+		if(json.has(F("days")))
+		{
+			if(!json.num(F("days"), c.days) || c.days < 1 || c.days > 365){reply(id, DERR_RANGE); return;}
+			c.hasDays = true;
+		}
+		if(json.has(F("sch")))
+		{
+			if(!json.num(F("sch"), v) || v > DAEMON_PROFILES){reply(id, DERR_RANGE); return;}
+			c.sch = v;
+			c.hasSch = true;
+		}
+		if(json.has(F("grp")))
+		{
+			if(!json.num(F("grp"), v) || v > DAEMON_GROUPS){reply(id, DERR_RANGE); return;}
+			c.grp = v;
+			c.hasGrp = true;
+		}
+	}
+	while(!daemonp->change(c)){usleep(50);}
+}
+
+// Sends the decisions and replies waiting in the daemon's queues.
+static void drain()
+{
+	DoorEvent	ev;
+	DbReply		r;
+	char			line[64];
+
+	while(daemonp->nextEvent(ev))
+	{
+		snprintf(line, sizeof(line), ev.typed ? "{\"ty\":%u,\"loc\":%u,\"u\":%u}\n" : "{\"ty\":%u,\"loc\":%u,\"k\":%u}\n",
+			ev.type, ev.door, ev.key);
+		out += line;
+	}
+	while(daemonp->nextReply(r)){reply(r.id, r.err);}
+	flush();
+}
+
+static int openSocket(const char *path)
+{
+	sockaddr_un	a;
+	int					fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if(fd < 0 || strlen(path) >= sizeof(a.sun_path)){return -1;}
+	memset(&a, 0, sizeof(a));
+	a.sun_family = AF_UNIX;
+	strcpy(a.sun_path, path);
+	unlink(path);
+	if(bind(fd, (sockaddr *)&a, sizeof(a)) < 0 || listen(fd, 1) < 0){close(fd); return -1;}
+	return fd;
+}
+
+int main(int argc, char **argv)
+{
+	const char	*db = NULL, *sock = NULL;
+	unsigned		shards = 4, doors = 64, workers = 2;
+	int					listenFd = -1, inFd = STDIN_FILENO;
+	char				buf[LINEMAX];
+	size_t			len = 0;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--db") == 0 && i + 1 < argc){db = argv[++i];}
+		else if(strcmp(argv[i], "--shards") == 0 && i + 1 < argc){shards = atoi(argv[++i]);}
+		else if(strcmp(argv[i], "--doors") == 0 && i + 1 < argc){doors = atoi(argv[++i]);}
+		else if(strcmp(argv[i], "--workers") == 0 && i + 1 < argc){workers = atoi(argv[++i]);}
+		else if(strcmp(argv[i], "--socket") == 0 && i + 1 < argc){sock = argv[++i];}
+		else{db = NULL; break;}
+	}
+	if(db == NULL || shards < 1 || shards > DAEMON_SHARDS || doors < 1 || doors > 65535 || workers < 1 || workers > DAEMON_WORKERS)
+	{
+		fprintf(stderr, "door_daemon --db file [--shards 1-%u] [--doors N] [--workers 1-%u] [--socket path]\n", DAEMON_SHARDS, DAEMON_WORKERS);
+		return 2;
+	}
+	hostSerialOut(stderr);																					// Database messages.
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+	signal(SIGPIPE, SIG_IGN);
+	if(sock)
+	{
+		if((listenFd = openSocket(sock)) < 0){fprintf(stderr, "door_daemon: can not listen on %s\n", sock); return 1;}
+		inFd = -1;
+	}
+
+	DoorDaemon d(db, shards, doors, workers);
+	daemonp = &d;
+	if(!d.begin()){fprintf(stderr, "door_daemon: can not write %s\n", db); return 1;}
+	d.startWorkers();
+	fprintf(stderr, "door_daemon: %u users, %u shards, %u doors, %u workers\n", d.users(), shards, doors, workers);
+
+	while(!quit)
+	{
+		pollfd p = {inFd >= 0 ? inFd : listenFd, POLLIN, 0};
+		if(poll(&p, 1, 1) > 0)
+		{
+			if(inFd < 0)																								// Next client.
+			{
+				inFd = outFd = accept(listenFd, NULL, NULL);
+				if(inFd >= 0){fcntl(outFd, F_SETFL, O_NONBLOCK); len = 0;}
+				continue;
+			}
+			ssize_t n = read(inFd, buf + len, sizeof(buf) - 1 - len);
+			if(n <= 0)
+			{
+				if(n < 0 && errno == EINTR){continue;}
+				if(!sock){break;}																					// End of stdin.
+				close(inFd);
+				inFd = -1;
+				outFd = STDOUT_FILENO;
+				out.clear();
+				continue;
+			}
+			len += n;
+			char *s = buf, *e;
+			while((e = (char *)memchr(s, '\n', buf + len - s)) != NULL)
+			{
+				*e = 0;
+				if(e > s && e[-1] == '\r'){e[-1] = 0;}
+				if(*s){request(s);}
+				s = e + 1;
+			}
+			len -= s - buf;
+			memmove(buf, s, len);
+			if(len == sizeof(buf) - 1){reply(0, DERR_SYNTAX); len = 0;}					// Line too long.
+		}
+		drain();
+	}
+
+	d.end();																												// Applies the changes still queued.
+	drain();
+	if(listenFd >= 0){close(listenFd); unlink(sock);}
+	return 0;
+}
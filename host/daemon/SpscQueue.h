@@ -0,0 +1,69 @@
+// SpscQueue.h Rev 1.0 (host daemon)
+
+// Rev 1.0	- Ring buffer between one producer thread and one consumer thread, without locks or read-modify-write
+//						  instructions. The producer only writes the head index and the consumer only the tail index, each
+//						  reads the other one with acquire ordering. Each side keeps a copy of the other side's index and
+//						  reads the shared one again only when the copy says the ring is full (or empty), so the cache
+//						  line of the other side is seldom touched. "Size" is a power of 2.
+
+#ifndef _SPSCQUEUE_H
+#define _SPSCQUEUE_H
+
+#include <atomic>
+#include <stdint.h>
+
+#define SPSC_LINE						64						// Cache line size, the two sides are kept on separate lines.
+
+template<class T, uint32_t Size> class SpscQueue
+{
+	static_assert((Size & (Size - 1)) == 0, "queue size must be a power of 2");
+
+public:
+	SpscQueue() : _head(0), _tail(0), _tailSeen(0), _headSeen(0){}
+
+	// Adds "v" at the head. Returns false if the queue is full. Producer thread only.
+	bool							push(const T &v)
+	{
+		uint32_t head = _head.load(std::memory_order_relaxed);
+
+		if(head - _tailSeen == Size)
+		{
+			_tailSeen = _tail.load(std::memory_order_acquire);
+			if(head - _tailSeen == Size){return false;}
+		}
+		_buf[head & (Size - 1)] = v;
+		_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Takes the item at the tail. Returns false if the queue is empty. Consumer thread only.
+	bool							pop(T &v)
+	{
+		uint32_t tail = _tail.load(std::memory_order_relaxed);
+
+		if(tail == _headSeen)
+		{
+			_headSeen = _head.load(std::memory_order_acquire);
+			if(tail == _headSeen){return false;}
+		}
+		v = _buf[tail & (Size - 1)];
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Items queued, may be stale by the time it returns. Any thread.
+	uint32_t					size(){return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);}
+
+private:
+	std::atomic<uint32_t>	_head;												// Written by the producer.
+	char							_padHead[SPSC_LINE - sizeof(std::atomic<uint32_t>)];
+	std::atomic<uint32_t>	_tail;												// Written by the consumer.
+	char							_padTail[SPSC_LINE - sizeof(std::atomic<uint32_t>)];
+	uint32_t					_tailSeen;														// Producer's copy of "_tail".
+	char							_padProd[SPSC_LINE - sizeof(uint32_t)];
+	uint32_t					_headSeen;														// Consumer's copy of "_head".
+	char							_padCons[SPSC_LINE - sizeof(uint32_t)];
+	T									_buf[Size];
+};
+
+#endif
@@ -0,0 +1,57 @@
+// Adafruit_GFX.h Rev 1.0 (host shim)
+
+// Rev 1.0	- Graphics API used by the sketch. Nothing is drawn, text and shapes only keep the cursor.
+
+#ifndef _ADAFRUIT_GFX_H
+#define _ADAFRUIT_GFX_H
+
+#include "Arduino.h"
+
+#define WHITE								1
+#define BLACK								0
+
+struct GFXglyph
+{
+	uint16_t					bitmapOffset;
+	uint8_t						width;
+	uint8_t						height;
+	uint8_t						xAdvance;
+	int8_t						xOffset;
+	int8_t						yOffset;
+};
+
+struct GFXfont
+{
+	uint8_t *					bitmap;
+	GFXglyph *				glyph;
+	uint16_t					first;
+	uint16_t					last;
+	uint8_t						yAdvance;
+};
+
+class Adafruit_GFX : public Print
+{
+
+public:
+	Adafruit_GFX(int16_t w, int16_t h) : _width(w), _height(h){}
+
+	size_t						write(uint8_t c){_x += 6 * _size; if(c == '\n'){_x = 0; _y += 8 * _size;} return 1;}
+	void							setFont(const GFXfont *f = NULL){(void)f;}
+	void							setTextSize(uint8_t s){_size = s;}
+	void							setTextColor(uint16_t c){(void)c;}
+	void							setTextColor(uint16_t c, uint16_t bg){(void)c; (void)bg;}
+	void							setTextWrap(bool w){(void)w;}
+	void							setCursor(int16_t x, int16_t y){_x = x; _y = y;}
+	void							drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t c){(void)x; (void)y; (void)w; (void)h; (void)c;}
+	void							fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t c){(void)x; (void)y; (void)w; (void)h; (void)c;}
+	void							drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t c){(void)x0; (void)y0; (void)x1; (void)y1; (void)c;}
+
+protected:
+	int16_t						_width;
+	int16_t						_height;
+	int16_t						_x = 0;
+	int16_t						_y = 0;
+	uint8_t						_size = 1;
+};
+
+#endif
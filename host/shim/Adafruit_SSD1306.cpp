@@ -0,0 +1,43 @@
+// Adafruit_SSD1306.cpp Rev 1.0 (host shim)
+
+#include "Adafruit_SSD1306.h"
+#include "Dialog_bold_11.h"
+#include "Fonts/FreeMonoBoldOblique12pt7b.h"
+#include "Fonts/FreeMonoBoldOblique18pt7b.h"
+
+#define SSD1306_CHUNK				32										// Bytes per I2C transmission (Wire buffer).
+
+const GFXfont Dialog_bold_11 = {NULL, NULL, 0x20, 0x7E, 13};
+const GFXfont FreeMonoBoldOblique12pt7b = {NULL, NULL, 0x20, 0x7E, 24};
+const GFXfont FreeMonoBoldOblique18pt7b = {NULL, NULL, 0x20, 0x7E, 35};
+
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *twi, int8_t rst) : Adafruit_GFX(w, h), _twi(twi)
+{
+	(void)rst;
+}
+
+bool Adafruit_SSD1306::begin(uint8_t vcs, uint8_t addr)
+{
+	(void)vcs;
+	(void)addr;
+	send(2 * 25);																// Init sequence, one command per transmission.
+	return true;
+}
+
+// Sets the page and column range, then sends the buffer in chunks each with its address and control byte.
+void Adafruit_SSD1306::display()
+{
+	uint16_t bytes = _width * _height / 8;
+
+	refreshes++;
+	send(2 * 6 + bytes + (bytes / SSD1306_CHUNK) * 2);
+}
+
+void Adafruit_SSD1306::ssd1306_command(uint8_t c){(void)c; send(3);}
+
+void Adafruit_SSD1306::send(uint16_t bytes)
+{
+	_twi->setClock(SSD1306_WIRECLK);
+	_twi->transfer(bytes);
+	_twi->setClock(100000);
+}
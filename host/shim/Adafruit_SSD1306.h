@@ -0,0 +1,37 @@
+// Adafruit_SSD1306.h Rev 1.0 (host shim)
+
+// Rev 1.0	- SSD1306 OLED on I2C. display() and commands take their transfer time at the 400kHz clock the Adafruit
+//						  library uses, so display refreshes show up in the loop time.
+
+#ifndef _ADAFRUIT_SSD1306_H
+#define _ADAFRUIT_SSD1306_H
+
+#include "Adafruit_GFX.h"
+#include "Wire.h"
+
+#define SSD1306_SWITCHCAPVCC	0x02
+#define SSD1306_DISPLAYOFF		0xAE
+#define SSD1306_DISPLAYON			0xAF
+#define SSD1306_WIRECLK				400000UL
+
+class Adafruit_SSD1306 : public Adafruit_GFX
+{
+
+public:
+	Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *twi = &Wire, int8_t rst = -1);
+
+	bool							begin(uint8_t vcs = SSD1306_SWITCHCAPVCC, uint8_t addr = 0x3C);
+	void							clearDisplay(){}
+	void							display();
+	void							ssd1306_command(uint8_t c);
+
+	// Host only.
+	uint32_t					refreshes = 0;								// Calls to display().
+
+private:
+	void							send(uint16_t bytes);
+
+	TwoWire *					_twi;
+};
+
+#endif
@@ -0,0 +1,283 @@
+// Arduino.cpp Rev 1.5 (host shim)
+
+#include "HostShim.h"
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+HostSerial Serial;
+HostPort Serial2;
+HostPort Serial3;
+
+volatile uint8_t	SREG;
+volatile uint8_t	TCCR1A, TCCR1B, TIMSK1, PCICR, PCMSK0, PCMSK1, PCMSK2;
+volatile uint16_t	ICR1, OCR1A, OCR1B, TCNT1;
+volatile uint8_t	ADMUX, ADCSRA, ADCSRB;
+volatile uint16_t	ADC;
+volatile uint8_t	hostPort[HOSTPINS];						// Pin values, see portOutputRegister().
+
+static uint64_t		hostUs = 0;									// Virtual time in microseconds.
+static uint8_t		pinMod[HOSTPINS];
+static void				(*pinIsr[HOSTPINS])();
+static uint8_t		pinIsrMode[HOSTPINS];
+static int				pinAnalog[HOSTPINS];
+
+static void				(*timerIsr)() = NULL;
+static uint32_t		timerPeriod;
+static uint64_t		timerNext;
+static uint64_t		(*evtNext)() = NULL;
+static void				(*evtRun)();
+static bool				advancing = false;
+
+static uint32_t		serialCharUs = 0;						// UART time of one character, 0 = no timing.
+static uint64_t		serialTxDone = 0;						// Time the transmit buffer is empty.
+static void				(*serialTap)(char c) = NULL;
+static uint32_t		serialDropped = 0;					// Characters received while the receive buffer was full.
+
+// TIME -----------------------------------------------------------------------------------------------------------
+// Moves the clock forward, running the timer ISR and host events that fall due on the way. Blocking work done by
+// an ISR or an event only moves the clock, as interrupts are off on the AVR while it runs.
+static void advance(uint64_t us)
+{
+	uint64_t end = hostUs + us;
+
+	if(advancing){hostUs = end; return;}
+	advancing = true;
+	for(;;)
+	{
+		uint64_t t = (timerIsr != NULL) ? timerNext : HOST_NEVER;
+		uint64_t e = (evtNext != NULL) ? evtNext() : HOST_NEVER;
+		if(e < t){t = e;}
+		if(t > end){break;}
+		if(t > hostUs){hostUs = t;}
+		if(timerIsr != NULL && timerNext <= hostUs){timerNext += timerPeriod; timerIsr();}
+		if(evtNext != NULL && evtNext() <= hostUs){evtRun();}
+	}
+	if(hostUs < end){hostUs = end;}
+	advancing = false;
+}
+
+uint32_t millis(){return hostUs / 1000;}
+uint32_t micros(){return hostUs;}
+void delay(uint32_t ms){advance((uint64_t)ms * 1000);}
+void delayMicroseconds(uint16_t us){advance(us);}
+void hostAdvance(uint32_t ms){advance((uint64_t)ms * 1000);}
+void hostBusy(uint32_t us){advance(us);}
+uint64_t hostNow(){return hostUs;}
+
+void hostTimer(void (*isr)(), uint32_t periodUs)
+{
+	timerIsr = isr;
+	timerPeriod = periodUs;
+	timerNext = hostUs + periodUs;
+}
+
+void hostEvents(uint64_t (*next)(), void (*run)())
+{
+	evtNext = next;
+	evtRun = run;
+}
+
+// PINS -----------------------------------------------------------------------------------------------------------
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	if(pin >= HOSTPINS){return;}
+	pinMod[pin] = mode;
+	if(mode == INPUT_PULLUP){hostPort[pin] = HIGH;}
+}
+
+void digitalWrite(uint8_t pin, uint8_t val){if(pin < HOSTPINS){hostPort[pin] = val ? HIGH : LOW;}}
+int digitalRead(uint8_t pin){return (pin < HOSTPINS) ? hostPort[pin] : LOW;}
+uint8_t hostPinOut(uint8_t pin){return digitalRead(pin);}
+int analogRead(uint8_t pin){return (pin < HOSTPINS) ? pinAnalog[pin] : 0;}
+void hostAnalog(uint8_t pin, int val){if(pin < HOSTPINS){pinAnalog[pin] = val;}}
+void tone(uint8_t pin, unsigned int freq, unsigned long ms){(void)pin; (void)freq; (void)ms;}
+void noTone(uint8_t pin){(void)pin;}
+
+void attachInterrupt(uint8_t irq, void (*isr)(), int mode)
+{
+	if(irq >= HOSTPINS){return;}
+	pinIsr[irq] = isr;
+	pinIsrMode[irq] = mode;
+}
+
+void detachInterrupt(uint8_t irq){if(irq < HOSTPINS){pinIsr[irq] = NULL;}}
+void noInterrupts(){}
+void interrupts(){}
+
+void hostPin(uint8_t pin, uint8_t val)
+{
+	if(pin >= HOSTPINS){return;}
+	uint8_t old = hostPort[pin];
+	hostPort[pin] = val ? HIGH : LOW;
+	if(pinIsr[pin] == NULL || old == hostPort[pin]){return;}
+	if(pinIsrMode[pin] == CHANGE || (pinIsrMode[pin] == FALLING && !val) || (pinIsrMode[pin] == RISING && val))
+	{
+		pinIsr[pin]();
+	}
+}
+
+// AVR LIBC -------------------------------------------------------------------------------------------------------
+char *ultoa(unsigned long val, char *buf, int base)
+{
+	char tmp[8 * sizeof(long) + 1];
+	char *p = &tmp[sizeof(tmp) - 1];
+
+	*p = '\0';
+	do
+	{
+		uint8_t d = val % base;
+		*--p = d < 10 ? '0' + d : 'a' + d - 10;
+		val /= base;
+	}while(val);
+	return strcpy(buf, p);
+}
+
+char *ltoa(long val, char *buf, int base)
+{
+	if(val < 0 && base == 10)
+	{
+		buf[0] = '-';
+		ultoa(-(unsigned long)val, buf + 1, base);
+		return buf;
+	}
+	return ultoa((unsigned long)val, buf, base);
+}
+
+char *itoa(int val, char *buf, int base){return ltoa(val, buf, base);}
+
+// PRINT ----------------------------------------------------------------------------------------------------------
+size_t Print::write(const uint8_t *buf, size_t size)
+{
+	size_t n = 0;
+	while(size--){n += write(*buf++);}
+	return n;
+}
+
+size_t Print::print(const char *s){return write((const uint8_t *)s, strlen(s));}
+
+size_t Print::print(const std::string &s){return print(s.c_str());}
+size_t Print::print(const __FlashStringHelper *s){return print((const char *)s);}
+size_t Print::print(char c){return write(c);}
+size_t Print::print(unsigned char n, int base){return printNum(n, base);}
+size_t Print::print(unsigned int n, int base){return printNum(n, base);}
+size_t Print::print(unsigned long n, int base){return printNum(n, base);}
+size_t Print::print(int n, int base){return print((long)n, base);}
+
+size_t Print::print(long n, int base)
+{
+	if(n < 0 && base == DEC){return write('-') + printNum(-(unsigned long)n, base);}
+	return printNum((unsigned long)n, base);
+}
+
+size_t Print::print(double n, int digits)
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.*f", digits, n);
+	return print(buf);
+}
+
+size_t Print::println(){return write('\r') + write('\n');}
+
+size_t Print::printNum(unsigned long n, int base)
+{
+	char buf[8 * sizeof(long) + 1];
+	char *p = &buf[sizeof(buf) - 1];
+
+	if(base < 2){base = 10;}
+	*p = '\0';
+	do
+	{
+		uint8_t d = n % base;
+		*--p = d < 10 ? '0' + d : 'A' + d - 10;
+		n /= base;
+	}while(n);
+	return print(p);
+}
+
+// SERIAL ---------------------------------------------------------------------------------------------------------
+void HostSerial::begin(unsigned long baud){(void)baud;}
+int HostSerial::available(){return _in.size();}
+// The AVR ring buffer holds one character less than its size.
+void HostSerial::inject(const char *s)
+{
+	for(; *s; s++)
+	{
+		if(_in.size() < HOST_UART_RX - 1){_in += *s;}
+		else{serialDropped++;}
+	}
+}
+
+uint32_t hostSerialDropped(){return serialDropped;}
+
+int HostSerial::peek(){return _in.empty() ? -1 : (uint8_t)_in[0];}
+
+int HostSerial::read()
+{
+	int c = peek();
+	if(c >= 0){_in.erase(0, 1);}
+	return c;
+}
+
+// With UART timing on, the character is queued behind those still being sent and the caller waits while the
+// transmit buffer is full.
+size_t HostSerial::write(uint8_t c)
+{
+	if(serialTap != NULL){serialTap(c);}
+	if(out != NULL){fputc(c, out);}
+	if(serialCharUs)
+	{
+		if(serialTxDone < hostUs){serialTxDone = hostUs;}
+		serialTxDone += serialCharUs;
+		uint64_t queued = serialTxDone - hostUs;
+		if(queued > (uint64_t)HOST_UART_TX * serialCharUs){advance(queued - (uint64_t)HOST_UART_TX * serialCharUs);}
+	}
+	return 1;
+}
+
+int HostSerial::availableForWrite()
+{
+	if(!serialCharUs || serialTxDone <= hostUs){return HOST_UART_TX;}
+	uint64_t queued = (serialTxDone - hostUs + serialCharUs - 1) / serialCharUs;
+	return queued < HOST_UART_TX ? HOST_UART_TX - queued : 0;
+}
+
+// Waits until the transmit buffer is empty.
+void HostSerial::flush()
+{
+	if(serialCharUs && serialTxDone > hostUs){advance(serialTxDone - hostUs);}
+}
+
+// SERIAL PORT ON A FILE DESCRIPTOR -------------------------------------------------------------------------------
+int HostPort::available()
+{
+	int n = 0;
+	if(fd < 0 || ioctl(fd, FIONREAD, &n) < 0){n = 0;}
+	return n + (_peek >= 0);
+}
+
+int HostPort::peek()
+{
+	uint8_t c;
+	if(_peek < 0 && fd >= 0 && available() && ::read(fd, &c, 1) == 1){_peek = c;}
+	return _peek;
+}
+
+int HostPort::read()
+{
+	int c = peek();
+	_peek = -1;
+	return c;
+}
+
+size_t HostPort::write(uint8_t c)
+{
+	if(fd >= 0 && ::write(fd, &c, 1) != 1){return 0;}
+	return 1;
+}
+
+int HostPort::availableForWrite(){return HOST_UART_TX;}
+
+void hostLink(HostPort &port, int fd){port.fd = fd;}
+void hostSerialOut(FILE *out){Serial.out = out;}
+void hostSerialBaud(uint32_t baud){serialCharUs = baud ? 10000000UL / baud : 0;}
+void hostSerialTap(void (*tap)(char c)){serialTap = tap;}
@@ -0,0 +1,251 @@
+// Arduino.h Rev 1.6 (host shim)
+
+// Rev 1.6	- Added E2END (last EEPROM address of the Mega2560), used to size the EEPROM meter (EepromMeter).
+// Rev 1.5	- Added the pin change interrupt pin macros for the input engine (InputEngine).
+// Rev 1.4	- Added the ADC registers and portInputRegister() for the background sampler (Sampler).
+// Rev 1.3	- Added Serial3 and Print::write(buf, size), used by the access event link.
+// Rev 1.2	- Added Stream, Print::availableForWrite() and Serial2, a Stream on a file descriptor (pty, pipe) for the
+//						  database replication link.
+// Rev 1.1	- Added what the sketch needs to run on the host: Print base class, analog pin names, binary constants,
+//						  ISR(), SREG and the Mega2560 timer and pin change registers, port registers (one port per pin),
+//						  tone() and analogRead(). Timer ISRs and host events run while the virtual clock advances.
+// Rev 1.0	- Minimal Arduino core used to build the controller libraries on a Linux host. Program memory
+//						  helpers read plain memory, pins are kept in an array, millis() is a virtual clock advanced by
+//						  the host program and Serial writes to stdout. Host only controls are in HostShim.h.
+
+#ifndef _ARDUINO_H
+#define _ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#include <string>
+
+typedef uint8_t							byte;
+typedef bool								boolean;
+typedef unsigned int				word;
+
+#define HIGH								1
+#define LOW									0
+#define INPUT								0
+#define OUTPUT							1
+#define INPUT_PULLUP				2
+#define CHANGE							1
+#define FALLING							2
+#define RISING							3
+#define DEC									10
+#define HEX									16
+#define OCT									8
+#define BIN									2
+
+#define HOSTPINS						70						// Digital pins of a Mega2560.
+#define E2END								0xFFF					// Last EEPROM address of a Mega2560 (avr/io.h).
+
+#define A0									54
+#define A1									55
+#define A2									56
+#define A3									57
+#define A4									58
+#define A5									59
+#define A6									60
+#define A7									61
+#define A8									62
+#define A9									63
+#define A10									64
+#define A11									65
+#define A12									66
+#define A13									67
+#define A14									68
+#define A15									69
+
+#define bit(b)							(1UL << (b))
+#define bitRead(v, b)				(((v) >> (b)) & 1)
+#define bitSet(v, b)				((v) |= (1UL << (b)))
+#define bitClear(v, b)			((v) &= ~(1UL << (b)))
+#define lowByte(w)					((uint8_t)((w) & 0xFF))
+#define highByte(w)					((uint8_t)((w) >> 8))
+
+// Binary constants used by the sketch (avr-libc binary.h).
+#define B00000001						0x01
+#define B00000010						0x02
+#define B00000100						0x04
+#define B00001000						0x08
+#define B00010000						0x10
+#define B00100000						0x20
+#define B01000000						0x40
+#define B01000001						0x41
+#define B10000000						0x80
+#define B11100000						0xE0
+
+// PROGRAM MEMORY -------------------------------------------------------------------------------------------------
+#define PROGMEM
+#define PGM_P								const char *
+#define PSTR(s)							(s)
+#define pgm_read_byte(p)		(*(const uint8_t *)(p))
+#define pgm_read_word(p)		(*(const uint16_t *)(p))
+#define pgm_read_dword(p)		(*(const uint32_t *)(p))
+#define pgm_read_ptr(p)			(*(void * const *)(p))
+#define strcmp_P						strcmp
+#define strncmp_P						strncmp
+#define strcasecmp_P				strcasecmp
+#define strncasecmp_P				strncasecmp
+#define strcpy_P						strcpy
+#define strlen_P						strlen
+#define memcpy_P						memcpy
+
+// AVR LIBC -------------------------------------------------------------------------------------------------------
+char *											ultoa(unsigned long val, char *buf, int base);
+char *											ltoa(long val, char *buf, int base);
+char *											itoa(int val, char *buf, int base);
+
+class __FlashStringHelper;
+#define F(s)								((const __FlashStringHelper *)(s))
+
+// AVR REGISTERS --------------------------------------------------------------------------------------------------
+// Plain variables, writing them has no effect. ISR(v) defines an ordinary function the host program can call
+// or hand to hostTimer().
+#define ISR(v)							extern "C" void v(void)
+
+extern volatile uint8_t			SREG;
+extern volatile uint8_t			TCCR1A, TCCR1B, TIMSK1, PCICR, PCMSK0, PCMSK1, PCMSK2;
+extern volatile uint16_t		ICR1, OCR1A, OCR1B, TCNT1;
+extern volatile uint8_t			ADMUX, ADCSRA, ADCSRB;
+extern volatile uint16_t		ADC;
+
+#define TOIE1								0
+#define CS10								0
+#define CS11								1
+#define CS12								2
+#define WGM10								0
+#define WGM11								1
+#define WGM12								3
+#define WGM13								4
+#define COM1B1							5
+#define COM1A1							7
+#define ADPS0								0
+#define ADPS1								1
+#define ADPS2								2
+#define ADIE								3
+#define MUX5								3
+#define ADSC								6
+#define ADEN								7
+#define REFS0								6
+
+// Every pin is its own port with bit mask 1, so the port register of a pin is its output value.
+extern volatile uint8_t			hostPort[HOSTPINS];
+#define digitalPinToPort(p)				(p)
+#define digitalPinToBitMask(p)		((uint8_t)1)
+#define portOutputRegister(p)			(&hostPort[(p) < HOSTPINS ? (p) : 0])
+#define portInputRegister(p)			(&hostPort[(p) < HOSTPINS ? (p) : 0])
+// No pin change interrupts on the host, so the input engine polls every channel.
+#define digitalPinToPCICR(p)			((volatile uint8_t *)NULL)
+#define digitalPinToPCICRbit(p)		0
+#define digitalPinToPCMSK(p)			((volatile uint8_t *)NULL)
+#define digitalPinToPCMSKbit(p)		0
+
+// TIME AND PINS --------------------------------------------------------------------------------------------------
+uint32_t										millis();
+uint32_t										micros();
+void												delay(uint32_t ms);
+void												delayMicroseconds(uint16_t us);
+void												pinMode(uint8_t pin, uint8_t mode);
+void												digitalWrite(uint8_t pin, uint8_t val);
+int													digitalRead(uint8_t pin);
+int													analogRead(uint8_t pin);
+void												tone(uint8_t pin, unsigned int freq, unsigned long ms = 0);
+void												noTone(uint8_t pin);
+void												attachInterrupt(uint8_t irq, void (*isr)(), int mode);
+void												detachInterrupt(uint8_t irq);
+void												noInterrupts();
+void												interrupts();
+#define digitalPinToInterrupt(p)	(p)					// Every host pin can run an ISR.
+
+// PRINT ----------------------------------------------------------------------------------------------------------
+class Print
+{
+
+public:
+	virtual size_t		write(uint8_t c) = 0;
+	virtual size_t		write(const uint8_t *buf, size_t size);
+	virtual int				availableForWrite(){return 0;}
+
+	size_t						print(const char *s);
+	size_t						print(const std::string &s);
+	size_t						print(const __FlashStringHelper *s);
+	size_t						print(char c);
+	size_t						print(unsigned char n, int base = DEC);
+	size_t						print(int n, int base = DEC);
+	size_t						print(unsigned int n, int base = DEC);
+	size_t						print(long n, int base = DEC);
+	size_t						print(unsigned long n, int base = DEC);
+	size_t						print(double n, int digits = 2);
+	size_t						println();
+
+	template<class T> size_t println(T val){size_t n = print(val); return n + println();}
+	template<class T> size_t println(T val, int base){size_t n = print(val, base); return n + println();}
+
+private:
+	size_t						printNum(unsigned long n, int base);
+};
+
+// STREAM ---------------------------------------------------------------------------------------------------------
+class Stream : public Print
+{
+
+public:
+	virtual int				available() = 0;
+	virtual int				read() = 0;
+	virtual int				peek() = 0;
+};
+
+// SERIAL ---------------------------------------------------------------------------------------------------------
+class HostSerial : public Stream
+{
+
+public:
+	void							begin(unsigned long baud);
+	int								available();
+	int								read();
+	int								peek();
+	size_t						write(uint8_t c);
+	int								availableForWrite();
+	void							flush();
+
+	// Host only, see HostShim.h.
+	void							inject(const char *s);
+	FILE *						out = stdout;
+
+private:
+	std::string				_in;
+};
+
+extern HostSerial						Serial;
+
+// Serial port on a file descriptor, set with hostLink() (HostShim.h). Reads never wait. Without a descriptor
+// nothing is received and writes are dropped.
+class HostPort : public Stream
+{
+
+public:
+	void							begin(unsigned long baud){(void)baud;}
+	int								available();
+	int								read();
+	int								peek();
+	size_t						write(uint8_t c);
+	int								availableForWrite();
+	void							flush(){}
+
+	int								fd = -1;														// Host only.
+
+private:
+	int								_peek = -1;
+};
+
+extern HostPort							Serial2;
+extern HostPort							Serial3;
+
+#endif
@@ -0,0 +1,28 @@
+// ClickEncoder.h Rev 1.0 (host shim)
+
+// Rev 1.0	- Rotary encoder which is never turned or pressed.
+
+#ifndef _CLICKENCODER_H
+#define _CLICKENCODER_H
+
+#include "Arduino.h"
+
+class ClickEncoder
+{
+
+public:
+	enum Button{Open, Closed, Pressed, Held, Released, Clicked, DoubleClicked};
+
+	ClickEncoder(uint8_t a, uint8_t b, uint8_t btn, uint8_t steps = 4, bool active = LOW)
+	{
+		(void)a; (void)b; (void)btn; (void)steps; (void)active;
+	}
+
+	void							service(){}
+	int16_t						getValue(){return 0;}
+	Button						getButton(){return Open;}
+	void							setAccelerationEnabled(bool on){(void)on;}
+	void							setDoubleClickEnabled(bool on){(void)on;}
+};
+
+#endif
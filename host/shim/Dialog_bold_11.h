@@ -0,0 +1,12 @@
+// Dialog_bold_11.h Rev 1.0 (host shim)
+
+// Rev 1.0	- Font declaration only, glyphs are not needed on the host.
+
+#ifndef _DIALOG_BOLD_11_H
+#define _DIALOG_BOLD_11_H
+
+#include "Adafruit_GFX.h"
+
+extern const GFXfont				Dialog_bold_11;
+
+#endif
@@ -0,0 +1,61 @@
+// EEPROM.cpp Rev 1.1 (host shim)
+
+#include "EEPROM.h"
+#include "HostShim.h"
+
+EEPROMClass EEPROM;
+
+EEPROMClass::EEPROMClass(){resize(HOST_EEPROM_SIZE);}
+
+uint8_t EEPROMClass::read(int idx)
+{
+	if(idx < 0 || idx >= (int)_mem.size()){stats.faults++; return 0xFF;}
+	stats.reads++;
+	return _mem[idx];
+}
+
+void EEPROMClass::write(int idx, uint8_t val)
+{
+	if(idx < 0 || idx >= (int)_mem.size()){stats.faults++; return;}
+	stats.writes++;
+	_mem[idx] = val;
+	if(timing){hostBusy(HOST_EEPROM_WR_US);}
+}
+
+void EEPROMClass::update(int idx, uint8_t val)
+{
+	if(idx < 0 || idx >= (int)_mem.size()){stats.faults++; return;}
+	stats.reads++;
+	if(_mem[idx] == val){stats.skipped++;}
+	else{write(idx, val);}
+}
+
+uint16_t EEPROMClass::length(){return _mem.size();}
+
+void EEPROMClass::resize(uint16_t size)
+{
+	_mem.assign(size, 0xFF);
+	resetStats();
+}
+
+bool EEPROMClass::load(const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	if(f == NULL){return false;}
+	size_t n = fread(_mem.data(), 1, _mem.size(), f);
+	fclose(f);
+	return n == _mem.size();
+}
+
+bool EEPROMClass::save(const char *path)
+{
+	FILE *f = fopen(path, "wb");
+	if(f == NULL){return false;}
+	size_t n = fwrite(_mem.data(), 1, _mem.size(), f);
+	fclose(f);
+	return n == _mem.size();
+}
+
+void EEPROMClass::resetStats(){memset(&stats, 0, sizeof(stats));}
+
+double EEPROMClass::costUs(){return stats.writes * (double)HOST_EEPROM_WR_US + stats.reads * HOST_EEPROM_RD_US;}
@@ -0,0 +1,67 @@
+// EEPROM.h Rev 1.1 (host shim)
+
+// Rev 1.1	- Added "timing". When set, every byte written takes its AVR write time on the virtual clock.
+// Rev 1.0	- EEPROM kept in a byte array, erased (0xFF) at startup like a new chip. Every access is counted so
+//						  storage changes can be compared without hardware. put() writes through update() as the AVR
+//						  library does, so unchanged bytes are not counted as writes. Accesses outside the array are
+//						  ignored and counted as faults.
+
+#ifndef _EEPROM_H
+#define _EEPROM_H
+
+#include "Arduino.h"
+#include <vector>
+
+#define HOST_EEPROM_SIZE		4096					// Mega2560 internal EEPROM.
+#define HOST_EEPROM_WR_US		3400					// AVR erase + write time of one byte (microseconds).
+#define HOST_EEPROM_RD_US		0.25					// AVR read time of one byte, 4 clocks at 16MHz (microseconds).
+
+struct EEPROMStats
+{
+	uint32_t					reads;								// Bytes read.
+	uint32_t					writes;								// Bytes written.
+	uint32_t					skipped;							// update() calls that left the byte unchanged.
+	uint32_t					faults;								// Accesses outside the EEPROM.
+};
+
+class EEPROMClass
+{
+
+public:
+	EEPROMClass();
+
+	uint8_t						read(int idx);
+	void							write(int idx, uint8_t val);
+	void							update(int idx, uint8_t val);
+	uint16_t					length();
+
+	template<class T> T &get(int idx, T &t)
+	{
+		uint8_t *p = (uint8_t *)&t;
+		for(size_t i = 0; i < sizeof(T); i++){p[i] = read(idx + i);}
+		return t;
+	}
+
+	template<class T> const T &put(int idx, const T &t)
+	{
+		const uint8_t *p = (const uint8_t *)&t;
+		for(size_t i = 0; i < sizeof(T); i++){update(idx + i, p[i]);}
+		return t;
+	}
+
+	// Host only.
+	void							resize(uint16_t size);						// Resizes and erases the EEPROM.
+	bool							load(const char *path);						// Loads an EEPROM image file.
+	bool							save(const char *path);						// Saves an EEPROM image file.
+	void							resetStats();
+	double						costUs();													// Time the counted accesses take on an AVR.
+	EEPROMStats				stats;
+	bool							timing = false;										// Writes advance the virtual clock.
+
+private:
+	std::vector<uint8_t>	_mem;
+};
+
+extern EEPROMClass					EEPROM;
+
+#endif
@@ -0,0 +1,40 @@
+// EasyButton.cpp Rev 1.0 (host shim)
+
+#include "EasyButton.h"
+
+EasyButton::EasyButton(uint8_t pin, uint32_t debounce, bool pullup, bool invert)
+{
+	_pin = pin;
+	_debounce = debounce;
+	_pullup = pullup;
+	_invert = invert;
+}
+
+void EasyButton::begin()
+{
+	pinMode(_pin, _pullup ? INPUT_PULLUP : INPUT);
+	_pressed = (digitalRead(_pin) == HIGH) != _invert;
+	_lastChange = millis();
+}
+
+// The pressed callback runs on release unless the pressed-for callback already ran for this press.
+bool EasyButton::read()
+{
+	bool pressed = (digitalRead(_pin) == HIGH) != _invert;
+
+	_changed = false;
+	if(pressed != _pressed && millis() - _lastChange >= _debounce)
+	{
+		_pressed = pressed;
+		_changed = true;
+		_lastChange = millis();
+		if(!_pressed && !_heldDone && _onPressed != NULL){_onPressed();}
+		if(_pressed){_heldDone = false;}
+	}
+	if(_pressed && !_heldDone && _onHeld != NULL && pressedFor(_heldMs))
+	{
+		_heldDone = true;
+		_onHeld();
+	}
+	return _pressed;
+}
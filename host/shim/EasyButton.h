@@ -0,0 +1,42 @@
+// EasyButton.h Rev 1.0 (host shim)
+
+// Rev 1.0	- Push button with debounce, edge detection and pressed / pressed-for callbacks like EasyButton 2.0.
+//						  A change of the pin is taken once it is "debounce" milliseconds after the previous change.
+
+#ifndef _EASYBUTTON_H
+#define _EASYBUTTON_H
+
+#include "Arduino.h"
+
+class EasyButton
+{
+
+public:
+	EasyButton(uint8_t pin, uint32_t debounce = 35, bool pullup = true, bool invert = true);
+
+	void							begin();
+	bool							read();
+	bool							isPressed(){return _pressed;}
+	bool							isReleased(){return !_pressed;}
+	bool							wasPressed(){return _changed && _pressed;}
+	bool							wasReleased(){return _changed && !_pressed;}
+	bool							pressedFor(uint32_t ms){return _pressed && millis() - _lastChange >= ms;}
+	bool							releasedFor(uint32_t ms){return !_pressed && millis() - _lastChange >= ms;}
+	void							onPressed(void (*cb)()){_onPressed = cb;}
+	void							onPressedFor(uint32_t ms, void (*cb)()){_heldMs = ms; _onHeld = cb;}
+
+private:
+	uint8_t						_pin;
+	uint32_t					_debounce;
+	bool							_pullup;
+	bool							_invert;
+	bool							_pressed = false;
+	bool							_changed = false;
+	bool							_heldDone = false;
+	uint32_t					_lastChange = 0;
+	uint32_t					_heldMs = 0;
+	void							(*_onPressed)() = NULL;
+	void							(*_onHeld)() = NULL;
+};
+
+#endif
@@ -0,0 +1,12 @@
+// FreeMonoBoldOblique12pt7b.h Rev 1.0 (host shim)
+
+// Rev 1.0	- Font declaration only, glyphs are not needed on the host.
+
+#ifndef _FREEMONOBOLDOBLIQUE12PT7B_H
+#define _FREEMONOBOLDOBLIQUE12PT7B_H
+
+#include "Adafruit_GFX.h"
+
+extern const GFXfont				FreeMonoBoldOblique12pt7b;
+
+#endif
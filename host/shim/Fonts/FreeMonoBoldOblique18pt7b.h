@@ -0,0 +1,12 @@
+// FreeMonoBoldOblique18pt7b.h Rev 1.0 (host shim)
+
+// Rev 1.0	- Font declaration only, glyphs are not needed on the host.
+
+#ifndef _FREEMONOBOLDOBLIQUE18PT7B_H
+#define _FREEMONOBOLDOBLIQUE18PT7B_H
+
+#include "Adafruit_GFX.h"
+
+extern const GFXfont				FreeMonoBoldOblique18pt7b;
+
+#endif
@@ -0,0 +1,64 @@
+// HostShim.h Rev 1.3
+
+// Rev 1.3	- Serial receives into a HOST_UART_RX byte ring as on the AVR, characters injected while it is full are
+//						  dropped and counted (hostSerialDropped).
+// Rev 1.2	- Added hostLink() to connect Serial2 to a pty, pipe or socket.
+// Rev 1.1	- Added the controls used to run the sketch on the virtual clock: a periodic timer ISR, a host event
+//						  source polled while time advances, busy time charged by blocking work, UART transmit timing and
+//						  a tap on every character the sketch prints.
+// Rev 1.0	- Controls of the host shim which have no Arduino equivalent. Used by benchmarks and host tools to
+//						  drive the virtual clock, the input pins and the serial port.
+
+#ifndef _HOSTSHIM_H
+#define _HOSTSHIM_H
+
+#include "Arduino.h"
+
+#define HOST_NEVER					UINT64_MAX				// hostEvents "next" result when nothing is pending.
+#define HOST_UART_TX				64								// AVR HardwareSerial transmit buffer (bytes).
+#define HOST_UART_RX				64								// AVR HardwareSerial receive buffer (bytes, 63 used).
+
+// Advances millis() and micros() by "ms" milliseconds.
+void												hostAdvance(uint32_t ms);
+
+// Advances the virtual clock by "us" microseconds of blocking work (EEPROM write, I2C transfer, ...).
+void												hostBusy(uint32_t us);
+
+// Returns the virtual time in microseconds, without the 32 bit wrap of micros().
+uint64_t										hostNow();
+
+// Runs "isr" every "periodUs" microseconds of virtual time, NULL stops it. Like a hardware timer the ISR also
+// runs during delay() and other blocking work.
+void												hostTimer(void (*isr)(), uint32_t periodUs);
+
+// Host event source. "next" returns the virtual time of the next event (or HOST_NEVER), "run" is called with the
+// clock at that time and must consume every event that is due.
+void												hostEvents(uint64_t (*next)(), void (*run)());
+
+// Drives input "pin" to "val". An ISR attached to the pin runs if the edge matches its mode.
+void												hostPin(uint8_t pin, uint8_t val);
+
+// Returns the last value written to "pin".
+uint8_t											hostPinOut(uint8_t pin);
+
+// Sets the value analogRead() returns for "pin".
+void												hostAnalog(uint8_t pin, int val);
+
+// Sends Serial output to "out", NULL discards it.
+void												hostSerialOut(FILE *out);
+
+// With "baud" not 0, every character printed takes its UART time and Serial blocks once the transmit buffer is
+// full, as on the AVR. 0 (default) prints without taking time.
+void												hostSerialBaud(uint32_t baud);
+
+// Calls "tap" with every character the sketch prints, NULL removes it.
+void												hostSerialTap(void (*tap)(char c));
+
+// Characters Serial.inject() dropped because the receive buffer held HOST_UART_RX - 1 characters already.
+uint32_t										hostSerialDropped();
+
+// Connects "port" (Serial2, Serial3) to file descriptor "fd", -1 disconnects it. The descriptor should be non-blocking or a
+// pty in raw mode.
+void												hostLink(HostPort &port, int fd);
+
+#endif
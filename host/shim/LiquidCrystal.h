@@ -0,0 +1,25 @@
+// LiquidCrystal.h Rev 1.0 (host shim)
+
+// Rev 1.0	- Character LCD. Nothing is displayed.
+
+#ifndef _LIQUIDCRYSTAL_H
+#define _LIQUIDCRYSTAL_H
+
+#include "Arduino.h"
+
+class LiquidCrystal : public Print
+{
+
+public:
+	LiquidCrystal(uint8_t rs, uint8_t en, uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7)
+	{
+		(void)rs; (void)en; (void)d4; (void)d5; (void)d6; (void)d7;
+	}
+
+	void							begin(uint8_t cols, uint8_t rows){(void)cols; (void)rows;}
+	void							clear(){}
+	void							setCursor(uint8_t col, uint8_t row){(void)col; (void)row;}
+	size_t						write(uint8_t c){(void)c; return 1;}
+};
+
+#endif
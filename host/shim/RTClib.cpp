@@ -0,0 +1,83 @@
+// RTClib.cpp Rev 1.0 (host shim)
+
+#include "RTClib.h"
+#include "Wire.h"
+
+#define DS3231_TIME_BYTES		7
+#define DS3231_TEMP_BYTES		2
+
+// Days from 1970-01-01 to year/month/day (proleptic Gregorian calendar).
+static int32_t daysFromCivil(int32_t y, uint8_t m, uint8_t d)
+{
+	y -= m <= 2;
+	int32_t era = (y >= 0 ? y : y - 399) / 400;
+	uint32_t yoe = y - era * 400;
+	uint32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe - 719468;
+}
+
+DateTime::DateTime(uint32_t t)
+{
+	int32_t z = t / 86400 + 719468;
+	int32_t era = z / 146097;
+	uint32_t doe = z - era * 146097;
+	uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	uint32_t mp = (5 * doy + 2) / 153;
+
+	_d = doy - (153 * mp + 2) / 5 + 1;
+	_m = mp < 10 ? mp + 3 : mp - 9;
+	_y = yoe + era * 400 + (_m <= 2);
+	_hh = t / 3600 % 24;
+	_mm = t / 60 % 60;
+	_ss = t % 60;
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min, uint8_t sec)
+{
+	_y = year < 100 ? year + 2000 : year;
+	_m = month;
+	_d = day;
+	_hh = hour;
+	_mm = min;
+	_ss = sec;
+}
+
+DateTime::DateTime(const __FlashStringHelper *date, const __FlashStringHelper *time)
+{
+	static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+	const char *dt = (const char *)date;
+	const char *tm = (const char *)time;
+	const char *m = strstr(months, std::string(dt, 3).c_str());
+
+	_m = m ? (m - months) / 3 + 1 : 1;
+	_d = atoi(dt + 4);
+	_y = atoi(dt + 7);
+	_hh = atoi(tm);
+	_mm = atoi(tm + 3);
+	_ss = atoi(tm + 6);
+}
+
+uint8_t DateTime::dayOfTheWeek() const{return (daysFromCivil(_y, _m, _d) + 4) % 7;}
+
+uint32_t DateTime::unixtime() const
+{
+	return daysFromCivil(_y, _m, _d) * 86400UL + _hh * 3600UL + _mm * 60UL + _ss;
+}
+
+bool RTC_DS3231::begin(){return true;}
+bool RTC_DS3231::lostPower(){return false;}
+void RTC_DS3231::adjust(const DateTime &dt){_offset = (int64_t)dt.unixtime() - millis() / 1000;}
+
+DateTime RTC_DS3231::now()
+{
+	Wire.transfer(2 + 1 + DS3231_TIME_BYTES);			// Register address write, then read of the time registers.
+	return DateTime((uint32_t)(_offset + millis() / 1000));
+}
+
+float RTC_DS3231::getTemperature()
+{
+	Wire.transfer(2 + 1 + DS3231_TEMP_BYTES);
+	return 21.25;
+}
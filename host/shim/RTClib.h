@@ -0,0 +1,53 @@
+// RTClib.h Rev 1.0 (host shim)
+
+// Rev 1.0	- DS3231 real time clock running from the virtual clock. Reading the time or temperature takes its I2C
+//						  transfer time. The clock starts at HOST_RTC_START unless set with adjust().
+
+#ifndef _RTCLIB_H
+#define _RTCLIB_H
+
+#include "Arduino.h"
+
+#define HOST_RTC_START			1772436600UL	// Monday 2026-03-02 07:30:00.
+
+class DateTime
+{
+
+public:
+	DateTime(uint32_t t = HOST_RTC_START);
+	DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0, uint8_t min = 0, uint8_t sec = 0);
+	DateTime(const __FlashStringHelper *date, const __FlashStringHelper *time);	// __DATE__, __TIME__.
+
+	uint16_t					year() const{return _y;}
+	uint8_t						month() const{return _m;}
+	uint8_t						day() const{return _d;}
+	uint8_t						hour() const{return _hh;}
+	uint8_t						minute() const{return _mm;}
+	uint8_t						second() const{return _ss;}
+	uint8_t						dayOfTheWeek() const;												// 0 = Sunday.
+	uint32_t					unixtime() const;
+
+private:
+	uint16_t					_y;
+	uint8_t						_m;
+	uint8_t						_d;
+	uint8_t						_hh;
+	uint8_t						_mm;
+	uint8_t						_ss;
+};
+
+class RTC_DS3231
+{
+
+public:
+	bool							begin();
+	bool							lostPower();
+	void							adjust(const DateTime &dt);
+	DateTime					now();
+	float							getTemperature();
+
+private:
+	int64_t						_offset = HOST_RTC_START;						// Unix time at millis() = 0.
+};
+
+#endif
@@ -0,0 +1,10 @@
+// SPI.h Rev 1.0 (host shim)
+
+// Rev 1.0	- Empty, the sketch includes it for the display libraries only.
+
+#ifndef _SPI_H
+#define _SPI_H
+
+#include "Arduino.h"
+
+#endif
@@ -0,0 +1,122 @@
+// SocketTransport.cpp Rev 1.0 (host shim)
+
+#include "SocketTransport.h"
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+SocketTransport::SocketTransport(const char *host, uint16_t port, bool tcp)
+{
+	memset(&_addr, 0, sizeof(_addr));
+	_addr.sin_family = AF_INET;
+	_addr.sin_port = htons(port);
+	inet_pton(AF_INET, host, &_addr.sin_addr);
+	_isTcp = tcp;
+}
+
+SocketTransport::~SocketTransport(){drop();}
+
+void SocketTransport::begin(){connect();}
+
+void SocketTransport::maintain()
+{
+	if(_isTcp && !connected() && millis() - _connTime >= SOCKET_RECONNECT){connect();}
+	if(_outLen && !_batch){flushOut();}															// Rest of a batch the socket did not take.
+}
+
+// Connected UDP sockets only receive the datagrams of the collector.
+bool SocketTransport::connected()
+{
+	if(!_isTcp || _up){return _fd >= 0;}
+	if(_fd < 0){return false;}
+
+	struct pollfd	p = {_fd, POLLOUT, 0};
+	int						err = 0;
+	socklen_t			len = sizeof(err);
+
+	if(poll(&p, 1, 0) <= 0){return false;}													// Connection in progress.
+	if(getsockopt(_fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err){drop(); return false;}
+	_up = true;
+	return true;
+}
+
+void SocketTransport::beginBatch(){_batch = true;}
+
+void SocketTransport::endBatch()
+{
+	_batch = false;
+	flushOut();
+}
+
+int SocketTransport::available()
+{
+	if(_inPos == _inLen && _fd >= 0 && (!_isTcp || _up))
+	{
+		int n = recv(_fd, _in, sizeof(_in), MSG_DONTWAIT);
+		_inPos = 0;
+		_inLen = n > 0 ? n : 0;
+		if(_isTcp && (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))){drop();}	// Collector closed.
+	}
+	return _inLen - _inPos;
+}
+
+int SocketTransport::read(){return available() ? _in[_inPos++] : -1;}
+int SocketTransport::peek(){return available() ? _in[_inPos] : -1;}
+
+size_t SocketTransport::write(uint8_t c){return write(&c, 1);}
+
+// Bytes written outside a batch are sent at once.
+size_t SocketTransport::write(const uint8_t *buf, size_t size)
+{
+	if(!connected() || _outLen + size > sizeof(_out)){return 0;}
+	memcpy(_out + _outLen, buf, size);
+	_outLen += size;
+	if(!_batch){flushOut();}
+	return size;
+}
+
+int SocketTransport::availableForWrite(){return connected() ? sizeof(_out) - _outLen : 0;}
+
+// connect Method (PRIVATE)---------------------------------------------------------------------------------------
+void SocketTransport::connect()
+{
+	int one = 1;
+
+	drop();
+	_connTime = millis();
+	_fd = socket(AF_INET, (_isTcp ? SOCK_STREAM : SOCK_DGRAM) | SOCK_NONBLOCK, 0);
+	if(_fd < 0){return;}
+	if(_isTcp){setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));}
+	if(::connect(_fd, (sockaddr *)&_addr, sizeof(_addr)) < 0 && errno != EINPROGRESS){drop();}
+}
+
+// flushOut Method (PRIVATE)--------------------------------------------------------------------------------------
+// Sends the batch. A TCP socket may take part of it, the rest stays for the next call. A datagram that cannot be
+// sent is lost, as on a network.
+void SocketTransport::flushOut()
+{
+	if(_outLen == 0 || !connected()){return;}
+	int n = send(_fd, _out, _outLen, MSG_DONTWAIT | MSG_NOSIGNAL);
+	if(!_isTcp){_outLen = 0; return;}
+	if(n < 0)
+	{
+		if(errno != EAGAIN && errno != EWOULDBLOCK){drop();}
+		return;
+	}
+	memmove(_out, _out + n, _outLen - n);
+	_outLen -= n;
+}
+
+// drop Method (PRIVATE)------------------------------------------------------------------------------------------
+void SocketTransport::drop()
+{
+	if(_fd >= 0){close(_fd);}
+	_fd = -1;
+	_up = false;
+	_inLen = _inPos = 0;
+	_outLen = 0;
+}
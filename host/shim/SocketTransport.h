@@ -0,0 +1,56 @@
+// SocketTransport.h Rev 1.0 (host shim)
+
+// Rev 1.0	- Transport on a Linux socket to a collector at "host":"port", the host counterpart of W5100Transport.
+//						  With UDP each batch is one datagram and only datagrams from the collector are received. With
+//						  TCP the socket connects without waiting and connects again every SOCKET_RECONNECT ms while the
+//						  connection is down, the bytes of a batch are sent together. Nothing ever waits.
+
+#ifndef _SOCKETTRANSPORT_H
+#define _SOCKETTRANSPORT_H
+
+#include "Transport.h"
+#include <netinet/in.h>
+
+#define SOCKET_PACKET				512								// Largest batch, same as W5100_PACKET.
+#define SOCKET_RECONNECT		2000							// ms between TCP connection attempts.
+
+class SocketTransport : public Transport
+{
+
+public:
+	SocketTransport(const char *host, uint16_t port, bool tcp);
+	~SocketTransport();
+
+	void							begin();
+	void							maintain();
+	bool							connected();
+	void							beginBatch();
+	void							endBatch();
+
+	int								available();
+	int								read();
+	int								peek();
+	size_t						write(uint8_t c);
+	size_t						write(const uint8_t *buf, size_t size);
+	int								availableForWrite();
+	using							Print::write;
+
+private:
+	sockaddr_in				_addr;
+	bool							_isTcp;
+	int								_fd = -1;
+	bool							_up = false;															// TCP connected.
+	uint32_t					_connTime = 0;
+	uint8_t						_in[SOCKET_PACKET];
+	int								_inLen = 0;
+	int								_inPos = 0;
+	uint8_t						_out[SOCKET_PACKET];
+	int								_outLen = 0;
+	bool							_batch = false;
+
+	void							connect();
+	void							flushOut();
+	void							drop();
+};
+
+#endif
@@ -0,0 +1,2 @@
+// WProgram.h Rev 1.0 (host shim)
+#include "Arduino.h"
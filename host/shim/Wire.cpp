@@ -0,0 +1,32 @@
+// Wire.cpp Rev 1.0 (host shim)
+
+#include "Wire.h"
+#include "HostShim.h"
+
+TwoWire Wire;
+
+void TwoWire::begin(){}
+void TwoWire::setClock(uint32_t hz){_clock = hz;}
+void TwoWire::beginTransmission(uint8_t addr){(void)addr; _bytes = 1;}
+size_t TwoWire::write(uint8_t val){(void)val; _bytes++; return 1;}
+
+uint8_t TwoWire::endTransmission(bool stop)
+{
+	(void)stop;
+	transfer(_bytes);
+	_bytes = 0;
+	return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t addr, uint8_t count)
+{
+	(void)addr;
+	transfer(1 + count);
+	_rx = count;
+	return count;
+}
+
+int TwoWire::available(){return _rx;}
+int TwoWire::read(){if(!_rx){return -1;} _rx--; return 0;}
+
+void TwoWire::transfer(uint16_t bytes){hostBusy(bytes * 9UL * 1000000UL / _clock);}
@@ -0,0 +1,35 @@
+// Wire.h Rev 1.0 (host shim)
+
+// Rev 1.0	- I2C master. Nothing is sent, each transfer takes its bus time on the virtual clock (9 clocks per byte
+//						  at the clock rate set with setClock, 100kHz by default).
+
+#ifndef _WIRE_H
+#define _WIRE_H
+
+#include "Arduino.h"
+
+class TwoWire
+{
+
+public:
+	void							begin();
+	void							setClock(uint32_t hz);
+	void							beginTransmission(uint8_t addr);
+	size_t						write(uint8_t val);
+	uint8_t						endTransmission(bool stop = true);
+	uint8_t						requestFrom(uint8_t addr, uint8_t count);
+	int								available();
+	int								read();
+
+	// Host only. Takes the bus time of "bytes" bytes.
+	void							transfer(uint16_t bytes);
+
+private:
+	uint32_t					_clock = 100000;
+	uint16_t					_bytes = 0;
+	uint8_t						_rx = 0;
+};
+
+extern TwoWire							Wire;
+
+#endif